@@ -185,4 +185,83 @@
 
 }
 
+- (NSDictionary *)mnemonicVectors
+{
+	NSURL *vectorURL = [[NSBundle mainBundle] URLForResource:@"mnemonic_vectors" withExtension:@"json"];
+	NSData *data = [NSData dataWithContentsOfURL:vectorURL];
+	
+	return data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+}
+
+- (void)test_matchingMnemonic
+{
+	NSDictionary *languages = [self mnemonicVectors];
+	
+	for (NSString *language in languages)
+	{
+		NSArray<NSString*> *wordList = [BIP39Mnemonic wordListForLanguageID:language error:nil];
+		
+		for (NSString *word in wordList)
+		{
+			NSError *error = nil;
+			NSString *match = [BIP39Mnemonic matchingMnemonicForString:word languageID:language error:&error];
+			
+			XCTAssert(error == nil);
+			XCTAssert([match isEqualToString:word]);
+		}
+	}
+	
+	NSError *error = nil;
+	NSString *match = [BIP39Mnemonic matchingMnemonicForString:@"ABAN" languageID:@"en_US" error:&error];
+	
+	XCTAssert(error == nil);
+	XCTAssert([match isEqualToString:@"abandon"]);
+}
+
+- (void)testPerformance_dataFromMnemonic
+{
+	NSDictionary *languages = [self mnemonicVectors];
+	
+	[self measureBlock:^{
+		
+		for (NSString *language in languages)
+		{
+			for (NSArray *vectors in languages[language][@"BIP39"])
+			{
+				NSArray *mnemonic = [vectors[1] componentsSeparatedByString:@" "];
+				
+				NSError *error = nil;
+				NSData *data = [BIP39Mnemonic dataFromMnemonic:mnemonic languageID:language error:&error];
+				
+				XCTAssert(data != nil);
+			}
+		}
+	}];
+}
+
+- (void)testPerformance_matchingMnemonic
+{
+	NSDictionary *languages = [self mnemonicVectors];
+	
+	[self measureBlock:^{
+		
+		// Simulates the recovery UI, which performs a lookup after every keystroke.
+		
+		for (NSString *language in languages)
+		{
+			for (NSArray *vectors in languages[language][@"BIP39"])
+			{
+				for (NSString *word in [vectors[1] componentsSeparatedByString:@" "])
+				{
+					for (NSUInteger length = 1; length <= word.length; length++)
+					{
+						NSString *prefix = [word substringToIndex:length];
+						[BIP39Mnemonic matchingMnemonicForString:prefix languageID:language error:nil];
+					}
+				}
+			}
+		}
+	}];
+}
+
 @end
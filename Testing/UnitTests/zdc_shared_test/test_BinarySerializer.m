@@ -0,0 +1,324 @@
+/**
+ * ZeroDark.cloud
+ * <GitHub wiki link goes here>
+**/
+
+#import <XCTest/XCTest.h>
+
+#import <ZeroDarkCloud/ZeroDarkCloud.h>
+#import <ZeroDarkCloud/ZDCBinarySerializer.h>
+#import <ZeroDarkCloud/ZDCChangeList.h>
+#import <ZeroDarkCloud/ZDCCloudNode.h>
+#import <ZeroDarkCloud/ZDCNodeMeta.h>
+#import <ZeroDarkCloud/ZDCNodePrivate.h>
+#import <ZeroDarkCloud/ZDCTrunkNodePrivate.h>
+#import <ZeroDarkCloud/ZDCUserPrivate.h>
+
+@interface test_BinarySerializer : XCTestCase
+@end
+
+static NSString *const userA = @"z55tqmfr9kix1p1gntotqpwkacpuoyno";
+static NSString *const userB = @"ncn3tcwifzxzohnt1id6cbdyq5739d44";
+
+@implementation test_BinarySerializer
+
+- (NSData *)randomData:(NSUInteger)length
+{
+	NSMutableData *data = [NSMutableData dataWithLength:length];
+	arc4random_buf(data.mutableBytes, length);
+	
+	return data;
+}
+
+/**
+ * Serializes the object, and checks that the result is in the compact format, and that it can be deserialized.
+ */
+- (id)roundTrip:(id)object
+{
+	XCTAssert([ZDCBinarySerializer supportsObject:object]);
+	
+	NSData *data = [ZDCBinarySerializer serializeObject:object];
+	XCTAssert([ZDCBinarySerializer isBinaryFormat:data]);
+	
+	NSData *keyedArchive = [NSKeyedArchiver archivedDataWithRootObject:object];
+	XCTAssert(data.length < keyedArchive.length);
+	
+	id result = [ZDCBinarySerializer deserializeData:data];
+	
+	XCTAssert(result != nil);
+	XCTAssert([result class] == [object class]);
+	
+	return result;
+}
+
+- (ZDCNode *)sampleNode
+{
+	ZDCNode *node = [[ZDCNode alloc] initWithLocalUserID:userA];
+	
+	node.parentID = [[NSUUID UUID] UUIDString];
+	node.name = @"Tëst nöde.txt";
+	node.burnDate = [NSDate dateWithTimeIntervalSinceNow:3600];
+	node.senderID = userB;
+	node.pendingRecipients = [NSSet setWithObjects:userA, userB, nil];
+	node.encryptionKey = [self randomData:64];
+	node.dirSalt = [self randomData:20];
+	node.dirPrefix = @"00000000000000000000000000000000";
+	node.cloudID = @"cloudID";
+	node.eTag_rcrd = @"eTag_rcrd";
+	node.eTag_data = @"eTag_data";
+	node.lastModified_rcrd = [NSDate dateWithTimeIntervalSinceReferenceDate:594123456.789];
+	node.lastModified_data = [NSDate date];
+	node.explicitCloudName = @"explicit";
+	
+	ZDCShareItem *item = [[ZDCShareItem alloc] init];
+	[item addPermission:ZDCSharePermission_Read];
+	[item addPermission:ZDCSharePermission_Write];
+	item.key = [self randomData:32];
+	
+	[node.shareList addShareItem:item forUserID:userB];
+	
+	return node;
+}
+
+- (void)checkNode:(ZDCNode *)a equalsNode:(ZDCNode *)b
+{
+	XCTAssertEqualObjects(a.uuid, b.uuid);
+	XCTAssertEqualObjects(a.localUserID, b.localUserID);
+	XCTAssertEqualObjects(a.parentID, b.parentID);
+	XCTAssertEqualObjects(a.name, b.name);
+	XCTAssertEqualObjects(a.shareList, b.shareList);
+	XCTAssertEqualObjects(a.burnDate, b.burnDate);
+	XCTAssertEqualObjects(a.senderID, b.senderID);
+	XCTAssertEqualObjects(a.pendingRecipients, b.pendingRecipients);
+	XCTAssertEqualObjects(a.encryptionKey, b.encryptionKey);
+	XCTAssertEqualObjects(a.dirSalt, b.dirSalt);
+	XCTAssertEqualObjects(a.dirPrefix, b.dirPrefix);
+	XCTAssertEqualObjects(a.cloudID, b.cloudID);
+	XCTAssertEqualObjects(a.eTag_rcrd, b.eTag_rcrd);
+	XCTAssertEqualObjects(a.eTag_data, b.eTag_data);
+	XCTAssertEqualObjects(a.lastModified_rcrd, b.lastModified_rcrd);
+	XCTAssertEqualObjects(a.lastModified_data, b.lastModified_data);
+	XCTAssertEqualObjects(a.explicitCloudName, b.explicitCloudName);
+	XCTAssertEqualObjects(a.pointeeID, b.pointeeID);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Round Trip
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_node
+{
+	ZDCNode *node = [self sampleNode];
+	ZDCNode *result = [self roundTrip:node];
+	
+	[self checkNode:node equalsNode:result];
+}
+
+- (void)test_node_minimal
+{
+	// Most fields are nil
+	
+	ZDCNode *node = [[ZDCNode alloc] initWithLocalUserID:userA];
+	ZDCNode *result = [self roundTrip:node];
+	
+	[self checkNode:node equalsNode:result];
+}
+
+- (void)test_node_pointer
+{
+	ZDCNode *node = [self sampleNode];
+	node.pointeeID = [[NSUUID UUID] UUIDString];
+	
+	ZDCNode *result = [self roundTrip:node];
+	
+	[self checkNode:node equalsNode:result];
+	XCTAssert(result.isPointer);
+}
+
+- (void)test_trunkNode
+{
+	// Subclass of a registered class
+	
+	ZDCTrunkNode *trunk =
+	  [[ZDCTrunkNode alloc] initWithLocalUserID: userA
+	                                     treeID: @"com.4th-a.test"
+	                                      trunk: ZDCTreesystemTrunk_Home];
+	
+	ZDCTrunkNode *result = [self roundTrip:trunk];
+	
+	[self checkNode:trunk equalsNode:result];
+	XCTAssertEqualObjects(trunk.treeID, result.treeID);
+	XCTAssert(trunk.trunk == result.trunk);
+}
+
+- (void)test_nodeMeta
+{
+	ZDCNode *node = [self sampleNode];
+	ZDCNodeMeta *meta = [[ZDCNodeMeta alloc] initWithNode:node treeID:@"com.4th-a.test"];
+	
+	ZDCNodeMeta *result = [self roundTrip:meta];
+	
+	XCTAssertEqualObjects(meta.nodeID, result.nodeID);
+	XCTAssertEqualObjects(meta.localUserID, result.localUserID);
+	XCTAssertEqualObjects(meta.treeID, result.treeID);
+	XCTAssertEqualObjects(meta.parentID, result.parentID);
+	XCTAssertEqualObjects(meta.name, result.name);
+	XCTAssertEqualObjects(meta.collationKey, result.collationKey);
+	XCTAssertEqualObjects(meta.explicitCloudName, result.explicitCloudName);
+	XCTAssertEqualObjects(meta.dirSalt, result.dirSalt);
+	XCTAssertEqualObjects(meta.cloudID, result.cloudID);
+	XCTAssertEqualObjects(meta.dirPrefix, result.dirPrefix);
+	XCTAssertEqualObjects(meta.pointeeID, result.pointeeID);
+}
+
+- (void)test_user
+{
+	ZDCUser *user = [[ZDCUser alloc] initWithUUID:userB];
+	user.publicKeyID = @"publicKeyID";
+	user.aws_region = AWSRegion_US_West_2;
+	user.aws_bucket = @"com.4th-a.user.ncn3tcwifzxzohnt1id6cbdyq5739d44-7eb0f8d0";
+	user.accountBlocked = NO;
+	user.accountDeleted = YES;
+	user.lastRefresh_profile = [NSDate date];
+	user.lastRefresh_blockchain = [NSDate dateWithTimeIntervalSinceNow:-60];
+	user.preferredIdentityID = @"auth0|123";
+	
+	ZDCUser *result = [self roundTrip:user];
+	
+	XCTAssertEqualObjects(user.uuid, result.uuid);
+	XCTAssertEqualObjects(user.publicKeyID, result.publicKeyID);
+	XCTAssertEqualObjects(user.random_uuid, result.random_uuid);
+	XCTAssertEqualObjects(user.random_encryptionKey, result.random_encryptionKey);
+	XCTAssert(user.aws_region == result.aws_region);
+	XCTAssertEqualObjects(user.aws_bucket, result.aws_bucket);
+	XCTAssert(user.accountBlocked == result.accountBlocked);
+	XCTAssert(user.accountDeleted == result.accountDeleted);
+	XCTAssertEqualObjects(user.lastRefresh_profile, result.lastRefresh_profile);
+	XCTAssertEqualObjects(user.lastRefresh_blockchain, result.lastRefresh_blockchain);
+	XCTAssertEqualObjects(user.preferredIdentityID, result.preferredIdentityID);
+}
+
+- (void)test_localUser
+{
+	// Subclass of a registered class
+	
+	ZDCLocalUser *user = [[ZDCLocalUser alloc] initWithUUID:userA];
+	user.aws_region = AWSRegion_US_West_2;
+	user.aws_bucket = @"com.4th-a.user.z55tqmfr9kix1p1gntotqpwkacpuoyno-7eb0f8d0";
+	user.syncedSalt = @"syncedSalt";
+	user.aws_stage = @"prod";
+	user.syncingPaused = YES;
+	user.isPayingCustomer = YES;
+	user.activationDate = [NSDate date];
+	
+	ZDCLocalUser *result = [self roundTrip:user];
+	
+	XCTAssertEqualObjects(user.uuid, result.uuid);
+	XCTAssert(user.aws_region == result.aws_region);
+	XCTAssertEqualObjects(user.aws_bucket, result.aws_bucket);
+	XCTAssertEqualObjects(user.syncedSalt, result.syncedSalt);
+	XCTAssertEqualObjects(user.aws_stage, result.aws_stage);
+	XCTAssert(user.syncingPaused == result.syncingPaused);
+	XCTAssert(user.isPayingCustomer == result.isPayingCustomer);
+	XCTAssertEqualObjects(user.activationDate, result.activationDate);
+}
+
+- (void)test_cloudNode
+{
+	ZDCCloudPath *cloudPath =
+	  [[ZDCCloudPath alloc] initWithTreeID: @"com.4th-a.test"
+	                             dirPrefix: @"00000000000000000000000000000000"
+	                              fileName: @"5f1r1n1tw3qzxc6i9aqs9bpuqqcgwh5q"];
+	
+	ZDCCloudLocator *cloudLocator =
+	  [[ZDCCloudLocator alloc] initWithRegion: AWSRegion_US_West_2
+	                                   bucket: @"com.4th-a.user.z55tqmfr9kix1p1gntotqpwkacpuoyno-7eb0f8d0"
+	                                cloudPath: cloudPath];
+	
+	ZDCCloudNode *cloudNode = [[ZDCCloudNode alloc] initWithLocalUserID:userA cloudLocator:cloudLocator];
+	cloudNode.eTag_rcrd = @"eTag_rcrd";
+	cloudNode.isQueuedForDeletion = YES;
+	
+	ZDCCloudNode *result = [self roundTrip:cloudNode];
+	
+	XCTAssertEqualObjects(cloudNode.uuid, result.uuid);
+	XCTAssertEqualObjects(cloudNode.localUserID, result.localUserID);
+	XCTAssert([cloudNode.cloudLocator isEqualToCloudLocator:result.cloudLocator]);
+	XCTAssertEqualObjects(cloudNode.eTag_rcrd, result.eTag_rcrd);
+	XCTAssertEqualObjects(cloudNode.eTag_data, result.eTag_data);
+	XCTAssert(cloudNode.isQueuedForDeletion == result.isQueuedForDeletion);
+}
+
+- (void)test_changeList
+{
+	ZDCChangeList *changeList = [[ZDCChangeList alloc] initWithLatestChangeID_remote:@"remote"];
+	[changeList didCompleteFullPull];
+	
+	ZDCChangeList *result = [self roundTrip:changeList];
+	
+	XCTAssertEqualObjects(changeList.latestChangeID_local, result.latestChangeID_local);
+	XCTAssertEqualObjects(changeList.latestChangeID_remote, result.latestChangeID_remote);
+	XCTAssert(result.hasPendingChange == changeList.hasPendingChange);
+}
+
+- (void)test_unsupportedClass
+{
+	// Unregistered classes fallback to a keyed archive
+	
+	NSDictionary *dict = @{ @"key": @"value" };
+	
+	XCTAssert([ZDCBinarySerializer supportsObject:dict] == NO);
+	
+	NSData *data = [ZDCBinarySerializer serializeObject:dict];
+	XCTAssert([ZDCBinarySerializer isBinaryFormat:data] == NO);
+	
+	XCTAssertEqualObjects([ZDCBinarySerializer deserializeData:data], dict);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Old Formats
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_legacyKeyedArchive
+{
+	// Rows written before the binary format existed
+	
+	ZDCNode *node = [self sampleNode];
+	NSData *data = [NSKeyedArchiver archivedDataWithRootObject:node];
+	
+	XCTAssert([ZDCBinarySerializer isBinaryFormat:data] == NO);
+	
+	ZDCNode *result = [ZDCBinarySerializer deserializeData:data];
+	[self checkNode:node equalsNode:result];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Corrupt Data
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_truncated
+{
+	NSData *data = [ZDCBinarySerializer serializeObject:[self sampleNode]];
+	
+	for (NSUInteger length = 4; length < data.length; length++)
+	{
+		NSData *truncated = [data subdataWithRange:NSMakeRange(0, length)];
+		
+		XCTAssertNil([ZDCBinarySerializer deserializeData:truncated]);
+	}
+}
+
+- (void)test_unknownFormatVersion
+{
+	NSMutableData *data = [[ZDCBinarySerializer serializeObject:[self sampleNode]] mutableCopy];
+	((uint8_t *)data.mutableBytes)[3] = 99;
+	
+	XCTAssert([ZDCBinarySerializer isBinaryFormat:data] == NO);
+	
+	// Version 1 was never released
+	((uint8_t *)data.mutableBytes)[3] = 1;
+	
+	XCTAssert([ZDCBinarySerializer isBinaryFormat:data] == NO);
+}
+
+@end
@@ -0,0 +1,340 @@
+/**
+ * ZeroDark.cloud
+ * <GitHub wiki link goes here>
+**/
+
+#import <XCTest/XCTest.h>
+
+#import <ZeroDarkCloud/ZeroDarkCloud.h>
+#import <ZeroDarkCloud/ZDCDictionaryAutomaton.h>
+#import <ZeroDarkCloud/BBDictionaryMatcher.h>
+#import <ZeroDarkCloud/BBL33tMatcher.h>
+#import <ZeroDarkCloud/BBPattern.h>
+
+/**
+ * The NSDictionary based matcher that BBDictionaryMatcher used before the automaton.
+ * The automaton must produce exactly the same patterns.
+ */
+@interface test_ReferenceDictionaryMatcher : NSObject <BBPatternMatcher>
+- (instancetype)initWithDictionaryName:(NSString *)name list:(NSArray<NSString *> *)list;
+@end
+
+@implementation test_ReferenceDictionaryMatcher {
+	NSString *name;
+	NSDictionary<NSString *, NSNumber *> *dictionary;
+}
+
+- (instancetype)initWithDictionaryName:(NSString *)inName list:(NSArray<NSString *> *)list
+{
+	if ((self = [super init]))
+	{
+		name = [inName copy];
+		
+		NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:list.count];
+		int i = 1;
+		for (NSString *word in list)
+		{
+			dict[word] = @(i);
+			i++;
+		}
+		dictionary = dict;
+	}
+	return self;
+}
+
+- (NSArray *)match:(NSString *)password
+{
+	NSMutableArray *result = [NSMutableArray array];
+	NSUInteger length = password.length;
+	NSString *lower = [password lowercaseString];
+	
+	for (NSUInteger i = 0; i < length; i++)
+	{
+		for (NSUInteger j = i; j < length; j++)
+		{
+			NSString *word = [lower substringWithRange:NSMakeRange(i, j - i + 1)];
+			NSNumber *rank = dictionary[word];
+			if (rank)
+			{
+				BBPattern *pattern = [[BBPattern alloc] init];
+				pattern.type = BBPatternTypeDictionary;
+				pattern.begin = i;
+				pattern.end = j;
+				pattern.token = [password substringWithRange:NSMakeRange(i, j - i + 1)];
+				pattern.userInfo = @{
+					BBDictionaryPatternUserInfoKeyMatchedWord    : word,
+					BBDictionaryPatternUserInfoKeyRank           : rank,
+					BBDictionaryPatternUserInfoKeyDictionaryName : name
+				};
+				[result addObject:pattern];
+			}
+		}
+	}
+	
+	return result;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface test_DictionaryAutomaton : XCTestCase
+@end
+
+@implementation test_DictionaryAutomaton
+
+- (NSDictionary<NSString *, NSArray<NSString *> *> *)sampleDictionaries
+{
+	return @{
+		@"english": @[
+			@"password", @"pass", @"word", @"sword", @"or", @"ass", @"a", @"dragon", @"drag", @"on",
+			@"monkey", @"key", @"monk", @"letmein", @"let", @"me", @"in", @"football", @"ball", @"foot"
+		],
+		@"passwords": @[
+			@"password", @"123456", @"qwerty", @"dragon", @"letmein", @"iloveyou", @"1234", @"12345",
+			@"password", // duplicate: the last occurrence wins
+			@"abc", @"abc", @"abc"
+		],
+		@"surnames": @[
+			@"smith", @"mith", @"johnson", @"son", @"john", @"ohn", @"dragon"
+		],
+		@"unicode": @[
+			@"pässword", @"straße", @"ñandú", @"日本"
+		]
+	};
+}
+
+- (NSArray<id<BBPatternMatcher>> *)referenceMatchersForDictionaries:(NSDictionary<NSString *, NSArray *> *)dicts
+{
+	NSMutableArray *matchers = [NSMutableArray arrayWithCapacity:dicts.count];
+	for (NSString *name in dicts)
+	{
+		[matchers addObject:[[test_ReferenceDictionaryMatcher alloc] initWithDictionaryName:name list:dicts[name]]];
+	}
+	
+	return matchers;
+}
+
+- (BBDictionaryMatcher *)automatonMatcherForDictionaries:(NSDictionary<NSString *, NSArray *> *)dicts
+{
+	NSData *data = [ZDCDictionaryAutomaton compileDictionaries:dicts fingerprint:42];
+	ZDCDictionaryAutomaton *automaton = [[ZDCDictionaryAutomaton alloc] initWithData:data];
+	
+	XCTAssertNotNil(automaton);
+	XCTAssertEqual(automaton.fingerprint, 42);
+	XCTAssertEqualObjects(automaton.dictionaryNames, [dicts.allKeys sortedArrayUsingSelector:@selector(compare:)]);
+	
+	return [[BBDictionaryMatcher alloc] initWithAutomaton:automaton];
+}
+
+/**
+ * Converts the patterns into sorted strings, so the results can be compared regardless of their order.
+ */
+- (NSArray<NSString *> *)descriptionsOfPatterns:(NSArray<BBPattern *> *)patterns
+{
+	NSMutableArray<NSString *> *result = [NSMutableArray arrayWithCapacity:patterns.count];
+	
+	for (BBPattern *pattern in patterns)
+	{
+		NSDictionary *userInfo = pattern.userInfo;
+		
+		NSMutableString *str = [NSMutableString stringWithFormat:@"%d [%lu-%lu] token(%@) word(%@) rank(%@) dict(%@)",
+		  (int)pattern.type, (unsigned long)pattern.begin, (unsigned long)pattern.end, pattern.token,
+		  userInfo[BBDictionaryPatternUserInfoKeyMatchedWord],
+		  userInfo[BBDictionaryPatternUserInfoKeyRank],
+		  userInfo[BBDictionaryPatternUserInfoKeyDictionaryName]];
+		
+		NSDictionary<NSString *, NSString *> *substitution = userInfo[BBL33tPatternUserInfoKeySubstitution];
+		for (NSString *key in [substitution.allKeys sortedArrayUsingSelector:@selector(compare:)])
+		{
+			[str appendFormat:@" %@->%@", key, substitution[key]];
+		}
+		
+		[result addObject:str];
+	}
+	
+	return [result sortedArrayUsingSelector:@selector(compare:)];
+}
+
+- (NSArray<NSString *> *)matchesForPassword:(NSString *)password matchers:(NSArray<id<BBPatternMatcher>> *)matchers
+{
+	NSMutableArray *patterns = [NSMutableArray array];
+	for (id<BBPatternMatcher> matcher in matchers)
+	{
+		[patterns addObjectsFromArray:[matcher match:password]];
+	}
+	
+	return [self descriptionsOfPatterns:patterns];
+}
+
+- (void)assertMatchersAgreeForDictionaries:(NSDictionary<NSString *, NSArray *> *)dicts
+                                 passwords:(NSArray<NSString *> *)passwords
+{
+	NSArray *reference = [self referenceMatchersForDictionaries:dicts];
+	NSArray *automaton = @[ [self automatonMatcherForDictionaries:dicts] ];
+	
+	for (NSString *password in passwords)
+	{
+		NSArray<NSString *> *expected = [self matchesForPassword:password matchers:reference];
+		NSArray<NSString *> *actual = [self matchesForPassword:password matchers:automaton];
+		
+		XCTAssertEqualObjects(actual, expected, @"password: %@", password);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Matching
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_overlappingWords
+{
+	[self assertMatchersAgreeForDictionaries:[self sampleDictionaries] passwords:@[
+		@"password", @"swordpass", @"passwordpassword", @"aaaa", @"dragonmonkey", @"monkeyletmein",
+		@"footballfootball", @"johnsmithson", @"xpasswordx", @"p", @"", @"zzzz"
+	]];
+}
+
+- (void)test_duplicateWords
+{
+	NSArray<NSString *> *matches =
+	  [self matchesForPassword:@"password" matchers:@[ [self automatonMatcherForDictionaries:[self sampleDictionaries]] ]];
+	
+	XCTAssert([matches containsObject:@"0 [0-7] token(password) word(password) rank(9) dict(passwords)"]);
+	XCTAssertFalse([matches containsObject:@"0 [0-7] token(password) word(password) rank(1) dict(passwords)"]);
+	
+	[self assertMatchersAgreeForDictionaries:[self sampleDictionaries] passwords:@[
+		@"abc", @"abcabc", @"password123456"
+	]];
+}
+
+- (void)test_severalDictionaries
+{
+	// "dragon" is in 3 dictionaries, with a different rank in each
+	
+	NSArray<NSString *> *matches =
+	  [self matchesForPassword:@"dragon" matchers:@[ [self automatonMatcherForDictionaries:[self sampleDictionaries]] ]];
+	
+	XCTAssert([matches containsObject:@"0 [0-5] token(dragon) word(dragon) rank(8) dict(english)"]);
+	XCTAssert([matches containsObject:@"0 [0-5] token(dragon) word(dragon) rank(4) dict(passwords)"]);
+	XCTAssert([matches containsObject:@"0 [0-5] token(dragon) word(dragon) rank(7) dict(surnames)"]);
+	
+	[self assertMatchersAgreeForDictionaries:[self sampleDictionaries] passwords:@[
+		@"dragon", @"Dragon1234", @"iloveyousmith", @"qwertyjohnson"
+	]];
+}
+
+- (void)test_mixedCase
+{
+	[self assertMatchersAgreeForDictionaries:[self sampleDictionaries] passwords:@[
+		@"PassWord", @"DRAGON", @"MonKeY", @"PÄSSWORD", @"Pässword", @"STRASSE", @"Straße", @"ÑANDÚ", @"日本語"
+	]];
+}
+
+- (void)test_l33t
+{
+	NSDictionary *dicts = [self sampleDictionaries];
+	
+	BBL33tMatcher *reference = [[BBL33tMatcher alloc] initWithDictionaryMatchers:[self referenceMatchersForDictionaries:dicts]];
+	BBL33tMatcher *automaton = [[BBL33tMatcher alloc] initWithDictionaryMatchers:@[ [self automatonMatcherForDictionaries:dicts] ]];
+	
+	NSArray<NSString *> *passwords = @[
+		@"p@$$w0rd", @"P4ssw0rd", @"dr4g0n", @"m0nk3y", @"l3tm31n", @"f00tb4ll", @"5m1th", @"j0hn50n", @"@bc", @"1234"
+	];
+	
+	for (NSString *password in passwords)
+	{
+		NSArray<NSString *> *expected = [self matchesForPassword:password matchers:@[ reference ]];
+		NSArray<NSString *> *actual = [self matchesForPassword:password matchers:@[ automaton ]];
+		
+		XCTAssertEqualObjects(actual, expected, @"password: %@", password);
+	}
+	
+	XCTAssert([[self matchesForPassword:@"p@$$w0rd" matchers:@[ automaton ]] count] > 0);
+}
+
+/**
+ * The actual lists used by ZDCPasswordStrengthCalculator.
+ */
+- (void)test_frequencyLists
+{
+	NSString *jsonPath = [[ZeroDarkCloud frameworkBundle] pathForResource:@"frequency_lists" ofType:@"json"];
+	NSData *jsonData = [NSData dataWithContentsOfFile:jsonPath];
+	XCTAssertNotNil(jsonData);
+	
+	NSDictionary *dicts = [NSJSONSerialization JSONObjectWithData:jsonData options:0 error:nil];
+	XCTAssert([dicts isKindOfClass:[NSDictionary class]]);
+	
+	[self assertMatchersAgreeForDictionaries:dicts passwords:@[
+		@"password", @"correcthorsebatterystaple", @"Tr0ub4dor&3", @"iloveyou2019", @"johnsmith1980",
+		@"letmeinletmein", @"qwertyuiop", @"thequickbrownfoxjumpsoverthelazydog", @"ZeroDarkCloud"
+	]];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Validation
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_invalidData
+{
+	NSData *data = [ZDCDictionaryAutomaton compileDictionaries:[self sampleDictionaries] fingerprint:0];
+	
+	XCTAssertNotNil([[ZDCDictionaryAutomaton alloc] initWithData:data]);
+	XCTAssertNil([[ZDCDictionaryAutomaton alloc] initWithData:[NSData data]]);
+	
+	for (NSUInteger length = 0; length < data.length; length += 7)
+	{
+		XCTAssertNil([[ZDCDictionaryAutomaton alloc] initWithData:[data subdataWithRange:NSMakeRange(0, length)]]);
+	}
+}
+
+/**
+ * The cached automaton is read from disk, so it could be corrupt.
+ * Any corruption must either be rejected, or (if structurally valid) still stay within the bounds of the input.
+ */
+- (void)test_corruptData
+{
+	NSData *data = [ZDCDictionaryAutomaton compileDictionaries:[self sampleDictionaries] fingerprint:0];
+	
+	NSString *password = @"passwordabcdragonmonkeyjohnsmithfootballletmein";
+	NSUInteger length = password.length;
+	
+	unichar *characters = malloc(length * sizeof(unichar));
+	[password getCharacters:characters range:NSMakeRange(0, length)];
+	
+	NSArray<NSNumber *> *values = @[ @(0), @(1), @(0x7FFFFFFF), @(0xFFFFFFFF) ];
+	NSUInteger rejectedCount = 0;
+	
+	for (NSUInteger offset = 0; (offset + sizeof(uint32_t)) <= data.length; offset += sizeof(uint32_t))
+	{
+		for (NSNumber *num in values)
+		{
+			uint32_t value = [num unsignedIntValue];
+			
+			NSMutableData *corrupt = [data mutableCopy];
+			[corrupt replaceBytesInRange:NSMakeRange(offset, sizeof(value)) withBytes:&value];
+			
+			ZDCDictionaryAutomaton *automaton = [[ZDCDictionaryAutomaton alloc] initWithData:corrupt];
+			if (automaton == nil)
+			{
+				rejectedCount++;
+				continue;
+			}
+			
+			NSUInteger dictionaryCount = automaton.dictionaryNames.count;
+			
+			[automaton enumerateMatchesInCharacters:characters length:length usingBlock:
+			  ^(NSRange range, NSUInteger dictionaryIndex, NSUInteger rank)
+			{
+				XCTAssert(range.length > 0 && NSMaxRange(range) <= length);
+				XCTAssert(dictionaryIndex < dictionaryCount);
+			}];
+		}
+	}
+	
+	XCTAssert(rejectedCount > 0);
+	free(characters);
+}
+
+@end
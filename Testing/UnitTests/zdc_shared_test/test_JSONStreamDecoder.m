@@ -0,0 +1,498 @@
+/**
+ * ZeroDark.cloud
+ * <GitHub wiki link goes here>
+**/
+
+#import <XCTest/XCTest.h>
+
+#import <ZeroDarkCloud/ZeroDarkCloud.h>
+#import <ZeroDarkCloud/ZDCChangeFeedDecoder.h>
+#import <ZeroDarkCloud/ZDCCryptoTools.h>
+#import <ZeroDarkCloud/ZDCJSONStreamDecoder.h>
+
+/**
+ * Captures the root value, so the decoder can be fed in arbitrary chunks.
+ */
+@interface test_JSONRootCollector : NSObject <ZDCJSONStreamDecoderDelegate>
+@property (nonatomic, strong, readwrite) id root;
+@end
+
+@implementation test_JSONRootCollector
+
+- (void)jsonDecoderDidBeginObject:(ZDCJSONStreamDecoder *)decoder {}
+- (void)jsonDecoderDidEndObject:(ZDCJSONStreamDecoder *)decoder {}
+- (void)jsonDecoderDidBeginArray:(ZDCJSONStreamDecoder *)decoder {}
+- (void)jsonDecoderDidEndArray:(ZDCJSONStreamDecoder *)decoder {}
+- (void)jsonDecoder:(ZDCJSONStreamDecoder *)decoder didDecodeKey:(NSString *)key {}
+
+- (void)jsonDecoder:(ZDCJSONStreamDecoder *)decoder didDecodeValue:(id)value
+{
+	self.root = value;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface test_JSONStreamDecoder : XCTestCase
+@end
+
+@implementation test_JSONStreamDecoder
+
+/**
+ * A response from the `/pull/{change_token}` API.
+ * Includes an unknown top-level key (which the feed decoder skips), and a nested value within a change.
+ */
+- (NSData *)sampleFeed
+{
+	NSString *json =
+	  @"{\"latest_change_token\":\"0f3b0f3c-8a1c-4a5b-b2b6-2a4b0e1f9c01\","
+	  @"\"changes\":["
+	  @"{\"id\":\"a1b2c3d4e5f6\",\"ts\":1573776000123,\"app\":\"com.4th-a.storm4\",\"bucket\":\"com.4th-a.user.z55tqmfr9kix1p1gntotqpwkacpuoyno-3b1a2b0e\","
+	  @"\"region\":\"us-west-2\",\"command\":\"put-if-nonexistent\",\"path\":\"com.4th-a.storm4/3tds4fqbwqxdw3y6jqxuf7qkkrjc6f6n.rcrd\","
+	  @"\"fileID\":\"0A1B2C3D4E5F\",\"eTag\":\"\\\"6d4b3e0a9c2f\\\"\"},"
+	  @"{\"id\":\"b2c3d4e5f6a1\",\"ts\":1573776000456,\"app\":\"com.4th-a.storm4\",\"bucket\":\"com.4th-a.user.z55tqmfr9kix1p1gntotqpwkacpuoyno-3b1a2b0e\","
+	  @"\"region\":\"us-west-2\",\"command\":\"move\",\"srcPath\":\"com.4th-a.storm4/old.rcrd\",\"dstPath\":\"com.4th-a.storm4/new.rcrd\","
+	  @"\"fileID\":\"1B2C3D4E5F60\",\"extra\":{\"nested\":[1,2.5,true,null,\"x\"]}},"
+	  @"{\"uuid\":\"c3d4e5f6a1b2\",\"ts\":1573776000789,\"command\":\"delete-leaf\",\"path\":\"com.4th-a.storm4/gone.rcrd\"},"
+	  @"{\"id\":\"no-command\",\"ts\":1}"
+	  @"],"
+	  @"\"debug\":{\"took_ms\":12,\"shards\":[{\"id\":1},{\"id\":2}],\"note\":\"caf\\u00e9 \\ud83d\\ude00\"}}";
+	
+	return [json dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+/**
+ * A RCRD file, including an unknown section.
+ */
+- (NSData *)sampleRcrd
+{
+	NSString *json =
+	  @"{\"version\":3,\"fileID\":\"0A1B2C3D4E5F\",\"sender\":\"z55tqmfr9kix1p1gntotqpwkacpuoyno\","
+	  @"\"keys\":{"
+	  @"\"UID:z55tqmfr9kix1p1gntotqpwkacpuoyno\":{\"perms\":\"rws\",\"key\":\"eyJ2ZXJzaW9uIjoxLCJrZXlTdWl0ZSI6IkVDQy00MTQiLCJtYWMiOiJhYmMvZGVmKz09In0=\"},"
+	  @"\"UID:ncn3tcwifzxzohnt1id6cbdyq5739d44\":{\"perms\":\"r\",\"burn\":1573776000,\"key\":\"eyJ2ZXJzaW9uIjoxfQ==\"}"
+	  @"},"
+	  @"\"children\":{\"\":{\"prefix\":\"3tds4fqbwqxdw3y6jqxuf7qkkrjc6f6n\"}},"
+	  @"\"metadata\":\"AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+Pw==\","
+	  @"\"data\":{\"pointer\":{\"owner\":\"ncn3tcwifzxzohnt1id6cbdyq5739d44\",\"path\":\"com.4th-a.storm4/x.rcrd\",\"cloudID\":\"ABCDEF\"}},"
+	  @"\"burnDate\":1573776000,"
+	  @"\"futureSection\":[{\"a\":[[],{}]},\"\\\\\\/\",-1.25e-3]}";
+	
+	return [json dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+/**
+ * Feeds the data to a fresh decoder in the given chunks, and returns the captured root value.
+ */
+- (id)decodeChunks:(NSArray<NSData *> *)chunks error:(NSError **)errorPtr
+{
+	test_JSONRootCollector *collector = [[test_JSONRootCollector alloc] init];
+	ZDCJSONStreamDecoder *decoder = [[ZDCJSONStreamDecoder alloc] initWithDelegate:collector];
+	
+	[decoder captureValue];
+	for (NSData *chunk in chunks)
+	{
+		[decoder appendData:chunk];
+	}
+	[decoder finish];
+	
+	if (errorPtr) *errorPtr = decoder.error;
+	return decoder.error ? nil : collector.root;
+}
+
+- (NSArray<NSData *> *)splitData:(NSData *)data at:(NSUInteger)index
+{
+	return @[
+		[data subdataWithRange:NSMakeRange(0, index)],
+		[data subdataWithRange:NSMakeRange(index, data.length - index)]
+	];
+}
+
+- (NSArray<NSData *> *)bytewiseChunks:(NSData *)data
+{
+	NSMutableArray<NSData *> *chunks = [NSMutableArray arrayWithCapacity:data.length];
+	for (NSUInteger i = 0; i < data.length; i++)
+	{
+		[chunks addObject:[data subdataWithRange:NSMakeRange(i, 1)]];
+	}
+	
+	return chunks;
+}
+
+- (void)assertChanges:(NSArray<ZDCChangeItem *> *)changes matchJSON:(NSDictionary *)json
+{
+	NSMutableArray<ZDCChangeItem *> *expected = [NSMutableArray array];
+	for (NSDictionary *dict in json[@"changes"])
+	{
+		ZDCChangeItem *change = [ZDCChangeItem parseChangeInfo:dict];
+		if (change) {
+			[expected addObject:change];
+		}
+	}
+	
+	XCTAssert(changes.count == expected.count);
+	
+	for (NSUInteger i = 0; i < MIN(changes.count, expected.count); i++)
+	{
+		ZDCChangeItem *a = changes[i];
+		ZDCChangeItem *b = expected[i];
+		
+		XCTAssertEqualObjects(a.uuid, b.uuid);
+		XCTAssertEqualObjects(a.timestamp, b.timestamp);
+		XCTAssertEqualObjects(a.app, b.app);
+		XCTAssertEqualObjects(a.bucket, b.bucket);
+		XCTAssertEqualObjects(a.region, b.region);
+		XCTAssertEqualObjects(a.command, b.command);
+		XCTAssertEqualObjects(a.path, b.path);
+		XCTAssertEqualObjects(a.fileID, b.fileID);
+		XCTAssertEqualObjects(a.eTag, b.eTag);
+		XCTAssertEqualObjects(a.srcPath, b.srcPath);
+		XCTAssertEqualObjects(a.dstPath, b.dstPath);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Real Samples
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_feed_matchesNSJSONSerialization
+{
+	NSData *data = [self sampleFeed];
+	
+	NSDictionary *expected = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+	XCTAssertNotNil(expected);
+	
+	NSError *error = nil;
+	id result = [ZDCJSONStreamDecoder JSONObjectWithData:data error:&error];
+	
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(result, expected);
+	
+	ZDCChangeFeedDecoder *feedDecoder = [ZDCChangeFeedDecoder decodeData:data];
+	
+	XCTAssertNil(feedDecoder.error);
+	XCTAssertEqualObjects(feedDecoder.latestChangeToken, expected[@"latest_change_token"]);
+	XCTAssert(feedDecoder.changes.count == 3); // the entry without a command is rejected
+	
+	[self assertChanges:feedDecoder.changes matchJSON:expected];
+}
+
+- (void)test_rcrd_matchesNSJSONSerialization
+{
+	NSData *data = [self sampleRcrd];
+	
+	NSDictionary *expected = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+	XCTAssertNotNil(expected);
+	
+	NSError *error = nil;
+	id result = [ZDCJSONStreamDecoder JSONObjectWithData:data error:&error];
+	
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(result, expected);
+	
+	// decodeCloudRcrdData only returns the known sections
+	
+	NSMutableDictionary *expectedSections = [expected mutableCopy];
+	[expectedSections removeObjectForKey:@"futureSection"];
+	
+	NSDictionary *sections = [ZDCCryptoTools decodeCloudRcrdData:data error:&error];
+	
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(sections, expectedSections);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Chunk Boundaries
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_feed_everySplitPoint
+{
+	NSData *data = [self sampleFeed];
+	NSDictionary *expected = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+	
+	for (NSUInteger i = 0; i <= data.length; i++)
+	{
+		NSError *error = nil;
+		id result = [self decodeChunks:[self splitData:data at:i] error:&error];
+		
+		XCTAssertNil(error, @"split at %lu", (unsigned long)i);
+		XCTAssertEqualObjects(result, expected, @"split at %lu", (unsigned long)i);
+		
+		ZDCChangeFeedDecoder *feedDecoder = [[ZDCChangeFeedDecoder alloc] init];
+		for (NSData *chunk in [self splitData:data at:i])
+		{
+			[feedDecoder appendData:chunk];
+		}
+		
+		XCTAssert([feedDecoder finish], @"split at %lu", (unsigned long)i);
+		XCTAssertEqualObjects(feedDecoder.latestChangeToken, expected[@"latest_change_token"]);
+		
+		[self assertChanges:feedDecoder.changes matchJSON:expected];
+	}
+}
+
+- (void)test_rcrd_everySplitPoint
+{
+	NSData *data = [self sampleRcrd];
+	NSDictionary *expected = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+	
+	for (NSUInteger i = 0; i <= data.length; i++)
+	{
+		NSError *error = nil;
+		id result = [self decodeChunks:[self splitData:data at:i] error:&error];
+		
+		XCTAssertNil(error, @"split at %lu", (unsigned long)i);
+		XCTAssertEqualObjects(result, expected, @"split at %lu", (unsigned long)i);
+	}
+}
+
+- (void)test_bytewise
+{
+	for (NSData *data in @[ [self sampleFeed], [self sampleRcrd] ])
+	{
+		NSDictionary *expected = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+		
+		NSError *error = nil;
+		id result = [self decodeChunks:[self bytewiseChunks:data] error:&error];
+		
+		XCTAssertNil(error);
+		XCTAssertEqualObjects(result, expected);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Strings
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_escapes
+{
+	NSString *json =
+	  @"[\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\", \"\\u0041\\u00e9\\u4e2d\\u0000z\", \"\\ud83d\\ude00 \\uD83C\\uDF89\","
+	  @" \"caf\u00e9 \u65e5\u672c \U0001F600\", \"\", \"\\\\\", {\"k\\\"ey\":\"v\\u00e9\"}]";
+	
+	NSData *data = [json dataUsingEncoding:NSUTF8StringEncoding];
+	NSArray *expected = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+	XCTAssertNotNil(expected);
+	
+	XCTAssertEqualObjects(expected[2], @"\U0001F600 \U0001F389");
+	
+	for (NSUInteger i = 0; i <= data.length; i++)
+	{
+		NSError *error = nil;
+		id result = [self decodeChunks:[self splitData:data at:i] error:&error];
+		
+		XCTAssertNil(error, @"split at %lu", (unsigned long)i);
+		XCTAssertEqualObjects(result, expected, @"split at %lu", (unsigned long)i);
+	}
+	
+	NSError *error = nil;
+	id result = [self decodeChunks:[self bytewiseChunks:data] error:&error];
+	
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(result, expected);
+}
+
+- (void)test_unpairedSurrogates
+{
+	// NSJSONSerialization rejects these. We substitute the replacement character (and must not crash).
+	
+	NSData *data = [@"[\"a\\ud83dz\", \"\\ude00\", \"\\ud83d\"]" dataUsingEncoding:NSUTF8StringEncoding];
+	
+	NSError *error = nil;
+	NSArray *result = [ZDCJSONStreamDecoder JSONObjectWithData:data error:&error];
+	
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(result, (@[ @"a\uFFFDz", @"\uFFFD", @"\uFFFD" ]));
+}
+
+- (void)test_BOM
+{
+	NSData *plain = [self sampleRcrd];
+	
+	NSMutableData *data = [NSMutableData dataWithBytes:"\xEF\xBB\xBF" length:3];
+	[data appendData:plain];
+	
+	id expected = [NSJSONSerialization JSONObjectWithData:plain options:0 error:nil];
+	
+	for (NSUInteger i = 0; i <= 8; i++)
+	{
+		NSError *error = nil;
+		id result = [self decodeChunks:[self splitData:data at:i] error:&error];
+		
+		XCTAssertNil(error, @"split at %lu", (unsigned long)i);
+		XCTAssertEqualObjects(result, expected, @"split at %lu", (unsigned long)i);
+	}
+	
+	// A BOM anywhere else is an error
+	
+	const char misplacedBOM[] = "[1,\xEF\xBB\xBF 2]";
+	NSData *misplaced = [NSData dataWithBytes:misplacedBOM length:strlen(misplacedBOM)];
+	
+	XCTAssertNil([ZDCJSONStreamDecoder JSONObjectWithData:misplaced error:nil]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Numbers
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_numbers
+{
+	NSString *json =
+	  @"[0, 1, -1, 42, 1573776000123, 9223372036854775807, -9223372036854775808,"
+	  @" 0.5, -1.5, 3.14159, 1e3, 1E-5, -2.5e+10, 6.02214076e23]";
+	
+	NSData *data = [json dataUsingEncoding:NSUTF8StringEncoding];
+	NSArray<NSNumber *> *expected = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+	
+	for (NSUInteger i = 0; i <= data.length; i++)
+	{
+		NSError *error = nil;
+		NSArray<NSNumber *> *result = [self decodeChunks:[self splitData:data at:i] error:&error];
+		
+		XCTAssertNil(error, @"split at %lu", (unsigned long)i);
+		XCTAssert(result.count == expected.count, @"split at %lu", (unsigned long)i);
+		
+		for (NSUInteger n = 0; n < MIN(result.count, expected.count); n++)
+		{
+			if (n <= 6)
+			{
+				// Integers must be exact
+				XCTAssert(result[n].longLongValue == expected[n].longLongValue, @"split at %lu", (unsigned long)i);
+			}
+			else
+			{
+				double a = result[n].doubleValue;
+				double b = expected[n].doubleValue;
+				
+				XCTAssertEqualWithAccuracy(a, b, fabs(b) * 1e-15, @"split at %lu", (unsigned long)i);
+			}
+		}
+	}
+	
+	// Larger than LLONG_MAX
+	
+	NSArray<NSNumber *> *big = [ZDCJSONStreamDecoder JSONObjectWithData:
+	  [@"[18446744073709551615]" dataUsingEncoding:NSUTF8StringEncoding] error:nil];
+	
+	XCTAssert(big.firstObject.unsignedLongLongValue == ULLONG_MAX);
+	
+	// A root scalar (fragment) whose end is only known once the input is finished
+	
+	NSNumber *root = [self decodeChunks:@[ [@"12" dataUsingEncoding:NSUTF8StringEncoding],
+	                                       [@"34" dataUsingEncoding:NSUTF8StringEncoding] ] error:nil];
+	XCTAssertEqualObjects(root, @(1234));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Errors
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_malformed
+{
+	NSArray<NSString *> *samples = @[
+		@"", @" ", @"{", @"}", @"[", @"]", @"[1,]", @"[,1]", @"[1 2]", @"{} {}", @"[]]",
+		@"{\"a\"}", @"{\"a\":}", @"{\"a\":1,}", @"{\"a\" 1}", @"{1:2}", @"{\"a\":1 \"b\":2}", @"[}", @"{]",
+		@"[01]", @"[1.]", @"[.5]", @"[-]", @"[1e]", @"[1e+]", @"[+1]", @"[0x10]", @"[--1]", @"[1.2.3]",
+		@"[tru]", @"[truex]", @"[nul", @"[NULL]", @"[True]",
+		@"\"abc", @"\"\\x\"", @"\"\\u12\"", @"\"\\u12G4\"", @"\"a\nb\"", @"\"a\tb\"", @"'a'",
+		@"[1]x", @"/* comment */ 1", @"NaN", @"[Infinity]",
+	];
+	
+	for (NSString *sample in samples)
+	{
+		NSData *data = [sample dataUsingEncoding:NSUTF8StringEncoding];
+		
+		NSError *error = nil;
+		id result = [ZDCJSONStreamDecoder JSONObjectWithData:data error:&error];
+		
+		XCTAssertNil(result, @"%@", sample);
+		XCTAssertNotNil(error, @"%@", sample);
+		
+		// Same result regardless of how the input is chunked
+		
+		for (NSUInteger i = 0; i <= data.length; i++)
+		{
+			error = nil;
+			result = [self decodeChunks:[self splitData:data at:i] error:&error];
+			
+			XCTAssertNil(result, @"%@ split at %lu", sample, (unsigned long)i);
+			XCTAssertNotNil(error, @"%@ split at %lu", sample, (unsigned long)i);
+		}
+	}
+	
+	// Invalid UTF-8
+	
+	const char invalidUTF8[] = { '[', '"', 'a', (char)0xFF, 'b', '"', ']' };
+	NSData *data = [NSData dataWithBytes:invalidUTF8 length:sizeof(invalidUTF8)];
+	
+	XCTAssertNil([ZDCJSONStreamDecoder JSONObjectWithData:data error:nil]);
+}
+
+- (void)test_truncated
+{
+	for (NSData *data in @[ [self sampleFeed], [self sampleRcrd] ])
+	{
+		for (NSUInteger length = 0; length < data.length; length++)
+		{
+			NSData *truncated = [data subdataWithRange:NSMakeRange(0, length)];
+			
+			NSError *error = nil;
+			id result = [ZDCJSONStreamDecoder JSONObjectWithData:truncated error:&error];
+			
+			XCTAssertNil(result, @"truncated to %lu", (unsigned long)length);
+			XCTAssertNotNil(error, @"truncated to %lu", (unsigned long)length);
+			
+			ZDCChangeFeedDecoder *feedDecoder = [[ZDCChangeFeedDecoder alloc] init];
+			[feedDecoder appendData:truncated];
+			
+			XCTAssertFalse([feedDecoder finish], @"truncated to %lu", (unsigned long)length);
+			XCTAssertNotNil(feedDecoder.error, @"truncated to %lu", (unsigned long)length);
+			
+			XCTAssertNil([ZDCCryptoTools decodeCloudRcrdData:truncated error:nil]);
+		}
+	}
+}
+
+- (void)test_inputAfterError
+{
+	test_JSONRootCollector *collector = [[test_JSONRootCollector alloc] init];
+	ZDCJSONStreamDecoder *decoder = [[ZDCJSONStreamDecoder alloc] initWithDelegate:collector];
+	
+	XCTAssertFalse([decoder appendData:[@"[1,]" dataUsingEncoding:NSUTF8StringEncoding]]);
+	XCTAssertNotNil(decoder.error);
+	
+	// Further input is ignored
+	XCTAssertFalse([decoder appendData:[@"[1]" dataUsingEncoding:NSUTF8StringEncoding]]);
+	XCTAssertFalse([decoder finish]);
+}
+
+- (void)test_maxDepth
+{
+	NSUInteger depth = 10000;
+	
+	NSMutableData *data = [NSMutableData dataWithLength:(depth * 2)];
+	memset(data.mutableBytes, '[', depth);
+	memset((uint8_t *)data.mutableBytes + depth, ']', depth);
+	
+	NSError *error = nil;
+	id result = [ZDCJSONStreamDecoder JSONObjectWithData:data error:&error];
+	
+	XCTAssertNil(result);
+	XCTAssertNotNil(error);
+	
+	// But reasonable nesting is fine
+	
+	depth = 100;
+	data = [NSMutableData dataWithLength:(depth * 2)];
+	memset(data.mutableBytes, '[', depth);
+	memset((uint8_t *)data.mutableBytes + depth, ']', depth);
+	
+	result = [ZDCJSONStreamDecoder JSONObjectWithData:data error:&error];
+	
+	XCTAssertNotNil(result);
+}
+
+@end
@@ -7,6 +7,7 @@
 //
 
 #import <XCTest/XCTest.h>
+#import <CommonCrypto/CommonDigest.h>
 
 #import "ZDCMerkleTree.h"
 
@@ -50,4 +51,190 @@
 	}
 }
 
+- (NSArray<ZDCMerkleTree *> *)bundledMerkleTrees
+{
+	NSURL *merkleFilesURL = [[NSBundle bundleForClass:[self class]] URLForResource:@"Merkle Files" withExtension:nil];
+	
+	NSDirectoryEnumerator<NSURL *> *enumerator =
+	  [[NSFileManager defaultManager] enumeratorAtURL: merkleFilesURL
+	                       includingPropertiesForKeys: nil
+	                                          options: NSDirectoryEnumerationSkipsSubdirectoryDescendants
+	                                     errorHandler: nil];
+	
+	NSMutableArray<ZDCMerkleTree *> *merkleTrees = [NSMutableArray array];
+	
+	for (NSURL *fileURL in enumerator)
+	{
+		NSData *fileData = [NSData dataWithContentsOfURL:fileURL];
+		NSDictionary *fileDict = [NSJSONSerialization JSONObjectWithData:fileData options:0 error:nil];
+		
+		ZDCMerkleTree *merkleTree = [ZDCMerkleTree parseFile:fileDict error:nil];
+		XCTAssert(merkleTree != nil, @"Error parsing fileURL: %@", fileURL);
+		
+		if (merkleTree) {
+			[merkleTrees addObject:merkleTree];
+		}
+	}
+	
+	return merkleTrees;
+}
+
+static NSString* HexString(const uint8_t *bytes, size_t length)
+{
+	NSMutableString *hex = [NSMutableString stringWithCapacity:(length * 2)];
+	for (size_t i = 0; i < length; i++) {
+		[hex appendFormat:@"%02x", bytes[i]];
+	}
+	
+	return hex;
+}
+
+static NSString* SHA256Hex(NSString *str)
+{
+	NSData *data = [str dataUsingEncoding:NSUTF8StringEncoding];
+	
+	uint8_t hash[CC_SHA256_DIGEST_LENGTH];
+	CC_SHA256(data.bytes, (CC_LONG)data.length, hash);
+	
+	return HexString(hash, sizeof(hash));
+}
+
+/**
+ * Generates a merkleTree file (in the same format as the server) with the given number of values.
+ */
+- (NSDictionary *)syntheticFileWithCount:(NSUInteger)count
+{
+	NSMutableArray<NSString *> *values = [NSMutableArray arrayWithCapacity:count];
+	NSMutableDictionary<NSString *, NSNumber *> *lookup = [NSMutableDictionary dictionaryWithCapacity:count];
+	NSMutableDictionary *merkle = [NSMutableDictionary dictionaryWithCapacity:(count * 2)];
+	
+	NSMutableArray<NSString *> *level = [NSMutableArray arrayWithCapacity:count];
+	
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		NSString *userID = [NSString stringWithFormat:@"user%05lu", (unsigned long)i];
+		NSString *value = [NSString stringWithFormat:
+		  @"{\"userID\":\"%@\",\"pubKey\":\"pubKey%lu\",\"keyID\":\"keyID%lu\"}",
+		  userID, (unsigned long)i, (unsigned long)i];
+		
+		[values addObject:value];
+		lookup[userID] = @(i);
+		
+		NSString *hash = SHA256Hex(value);
+		merkle[hash] = [@{ @"type": @"leaf", @"level": @(0), @"left": @"data", @"right": @"data" } mutableCopy];
+		
+		[level addObject:hash];
+	}
+	
+	NSUInteger levelNum = 0;
+	while (level.count > 1)
+	{
+		levelNum++;
+		NSMutableArray<NSString *> *nextLevel = [NSMutableArray arrayWithCapacity:((level.count + 1) / 2)];
+		
+		for (NSUInteger i = 0; i < level.count; i += 2)
+		{
+			NSString *left = level[i];
+			NSString *right = ((i + 1) < level.count) ? level[i + 1] : left;
+			
+			NSString *hash = SHA256Hex([left stringByAppendingString:right]);
+			merkle[hash] = [@{ @"type": @"node", @"level": @(levelNum), @"left": left, @"right": right } mutableCopy];
+			
+			merkle[left][@"parent"] = hash;
+			merkle[right][@"parent"] = hash;
+			
+			[nextLevel addObject:hash];
+		}
+		
+		level = nextLevel;
+	}
+	
+	NSString *root = [level firstObject];
+	merkle[root][@"type"] = @"root";
+	merkle[root][@"parent"] = @"root";
+	
+	merkle[@"root"] = root;
+	merkle[@"hashalgo"] = @"sha256";
+	merkle[@"leaves"] = @(count);
+	merkle[@"levels"] = @(levelNum + 1);
+	
+	return @{
+		@"merkle" : merkle,
+		@"values" : values,
+		@"lookup" : lookup
+	};
+}
+
+- (void)testProofs
+{
+	NSMutableArray<ZDCMerkleTree *> *merkleTrees = [[self bundledMerkleTrees] mutableCopy];
+	[merkleTrees addObject:[ZDCMerkleTree parseFile:[self syntheticFileWithCount:37] error:nil]];
+	
+	for (ZDCMerkleTree *merkleTree in merkleTrees)
+	{
+		XCTAssert([merkleTree hashAndVerify:nil], @"Error verifying merkleTree: %@", merkleTree.rootHash);
+		
+		for (NSString *userID in merkleTree.userIDs)
+		{
+			NSString *pubKey = nil;
+			NSString *keyID = nil;
+			NSError *error = nil;
+			
+			BOOL success = [merkleTree verifyProofForUserID:userID pubKey:&pubKey keyID:&keyID error:&error];
+			XCTAssert(success, @"Error verifying proof for userID(%@): %@", userID, error);
+			
+			NSString *expectedPubKey = nil;
+			NSString *expectedKeyID = nil;
+			[merkleTree getPubKey:&expectedPubKey keyID:&expectedKeyID forUserID:userID];
+			
+			XCTAssertEqualObjects(pubKey, expectedPubKey);
+			XCTAssertEqualObjects(keyID, expectedKeyID);
+		}
+		
+		XCTAssertFalse([merkleTree verifyProofForUserID:@"unknown" pubKey:nil keyID:nil error:nil]);
+	}
+}
+
+- (void)testProofTampering
+{
+	NSDictionary *file = [self syntheticFileWithCount:8];
+	
+	// Modify a single value (without updating the hashes)
+	
+	NSMutableArray<NSString *> *values = [file[@"values"] mutableCopy];
+	values[3] = [values[3] stringByReplacingOccurrencesOfString:@"pubKey3" withString:@"evilKey3"];
+	
+	NSMutableDictionary *tamperedFile = [file mutableCopy];
+	tamperedFile[@"values"] = values;
+	
+	ZDCMerkleTree *merkleTree = [ZDCMerkleTree parseFile:tamperedFile error:nil];
+	
+	XCTAssertFalse([merkleTree hashAndVerify:nil]);
+	XCTAssertFalse([merkleTree verifyProofForUserID:@"user00003" pubKey:nil keyID:nil error:nil]);
+	
+	// The other entries still have valid proofs
+	XCTAssertTrue([merkleTree verifyProofForUserID:@"user00002" pubKey:nil keyID:nil error:nil]);
+	XCTAssertTrue([merkleTree verifyProofForUserID:@"user00004" pubKey:nil keyID:nil error:nil]);
+}
+
+- (void)testPerformance_hashAndVerify
+{
+	ZDCMerkleTree *merkleTree = [ZDCMerkleTree parseFile:[self syntheticFileWithCount:10000] error:nil];
+	
+	[self measureBlock:^{
+		
+		XCTAssert([merkleTree hashAndVerify:nil]);
+	}];
+}
+
+- (void)testPerformance_verifyProof
+{
+	ZDCMerkleTree *merkleTree = [ZDCMerkleTree parseFile:[self syntheticFileWithCount:10000] error:nil];
+	
+	[self measureBlock:^{
+		
+		XCTAssert([merkleTree verifyProofForUserID:@"user05000" pubKey:nil keyID:nil error:nil]);
+	}];
+}
+
 @end
@@ -0,0 +1,276 @@
+/**
+ * ZeroDark.cloud
+ * <GitHub wiki link goes here>
+**/
+
+#import <XCTest/XCTest.h>
+
+#import <ZeroDarkCloud/ZeroDarkCloud.h>
+#import <ZeroDarkCloud/ZDCMetricsManagerPrivate.h>
+
+@interface test_MetricsHistogram : XCTestCase
+@end
+
+static NSUInteger const kLastBucket = 527;
+static uint64_t const kMaxValue = (1ULL << 36) - 1;
+
+@implementation test_MetricsHistogram
+
+/**
+ * The manager only keeps a weak reference to its owner, and recording doesn't require one.
+ */
+- (ZDCMetricsManager *)metricsManager
+{
+	ZeroDarkCloud *owner = nil;
+	return [[ZDCMetricsManager alloc] initWithOwner:owner];
+}
+
+/**
+ * Records the given latencies (in milliseconds), and returns the resulting stats.
+ */
+- (ZDCMetricStats *)statsForLatencies:(NSArray<NSNumber *> *)latencies
+{
+	ZDCMetricsManager *metricsManager = [self metricsManager];
+	
+	for (NSNumber *ms in latencies)
+	{
+		uint64_t duration = (uint64_t)([ms doubleValue] * NSEC_PER_MSEC);
+		[metricsManager recordDuration:duration bytes:0 failed:NO forMetric:@"test"];
+	}
+	
+	return [metricsManager snapshot][@"test"];
+}
+
+- (void)assertLatency:(NSTimeInterval)latency nearMilliseconds:(double)expectedMS
+{
+	// The histogram's relative error is at most 1/32 (half a sub-bucket).
+	
+	double expected = expectedMS / 1000.0;
+	XCTAssertEqualWithAccuracy(latency, expected, (expected / 32.0) + 0.000001);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Buckets
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_bucketBoundaries
+{
+	// Small values are exact
+	
+	for (uint64_t value = 0; value < 32; value++)
+	{
+		XCTAssertEqual(ZDCHistogramBucketIndex(value), (NSUInteger)value);
+		XCTAssertEqual(ZDCHistogramBucketMidpoint((NSUInteger)value), value);
+	}
+	
+	// [32, 64) is split into 16 buckets of width 2
+	
+	XCTAssertEqual(ZDCHistogramBucketIndex(32), 32);
+	XCTAssertEqual(ZDCHistogramBucketIndex(33), 32);
+	XCTAssertEqual(ZDCHistogramBucketIndex(34), 33);
+	XCTAssertEqual(ZDCHistogramBucketIndex(63), 47);
+	
+	// [64, 128) is split into 16 buckets of width 4
+	
+	XCTAssertEqual(ZDCHistogramBucketIndex(64), 48);
+	XCTAssertEqual(ZDCHistogramBucketIndex(67), 48);
+	XCTAssertEqual(ZDCHistogramBucketIndex(68), 49);
+	XCTAssertEqual(ZDCHistogramBucketIndex(127), 63);
+	XCTAssertEqual(ZDCHistogramBucketIndex(128), 64);
+	
+	// Every power of 2 (from 32 on) starts a new group of 16 buckets
+	
+	for (int exp = 5; exp < 36; exp++)
+	{
+		uint64_t value = (1ULL << exp);
+		NSUInteger expected = 32 + ((exp - 5) * 16);
+		
+		XCTAssertEqual(ZDCHistogramBucketIndex(value), expected, @"2^%d", exp);
+		XCTAssertEqual(ZDCHistogramBucketIndex(value - 1), expected - 1, @"2^%d - 1", exp);
+	}
+	
+	XCTAssertEqual(ZDCHistogramBucketIndex(kMaxValue), kLastBucket);
+}
+
+- (void)test_midpoints
+{
+	for (NSUInteger index = 0; index <= kLastBucket; index++)
+	{
+		uint64_t midpoint = ZDCHistogramBucketMidpoint(index);
+		
+		// The midpoint falls within its own bucket
+		XCTAssertEqual(ZDCHistogramBucketIndex(midpoint), index, @"index %lu", (unsigned long)index);
+		
+		// Buckets are in ascending order
+		if (index > 0) {
+			XCTAssertGreaterThan(midpoint, ZDCHistogramBucketMidpoint(index - 1));
+		}
+	}
+}
+
+- (void)test_relativeError
+{
+	// Check a spread of values across the entire range (including both edges of many buckets)
+	
+	for (int exp = 5; exp < 36; exp++)
+	{
+		uint64_t base = (1ULL << exp);
+		uint64_t step = MAX(1ULL, base / 64);
+		
+		for (uint64_t value = base; value < (base << 1); value += step)
+		{
+			NSArray<NSNumber *> *values = @[ @(value), @(value + 1), @(value - 1) ];
+			for (NSNumber *num in values)
+			{
+				uint64_t v = [num unsignedLongLongValue];
+				uint64_t midpoint = ZDCHistogramBucketMidpoint(ZDCHistogramBucketIndex(v));
+				
+				double error = fabs((double)midpoint - (double)v) / (double)v;
+				XCTAssertLessThanOrEqual(error, 1.0 / 32.0, @"value %llu", v);
+			}
+		}
+	}
+}
+
+- (void)test_clamping
+{
+	XCTAssertEqual(ZDCHistogramBucketIndex(kMaxValue + 1), kLastBucket);
+	XCTAssertEqual(ZDCHistogramBucketIndex(1ULL << 40), kLastBucket);
+	XCTAssertEqual(ZDCHistogramBucketIndex(UINT64_MAX), kLastBucket);
+	
+	XCTAssertLessThanOrEqual(ZDCHistogramBucketMidpoint(kLastBucket), kMaxValue);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Percentiles
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_percentiles_uniform
+{
+	NSMutableArray<NSNumber *> *latencies = [NSMutableArray arrayWithCapacity:1000];
+	for (int ms = 1000; ms >= 1; ms--) // order doesn't matter
+	{
+		[latencies addObject:@(ms)];
+	}
+	
+	ZDCMetricStats *stats = [self statsForLatencies:latencies];
+	
+	XCTAssertEqual(stats.count, 1000);
+	XCTAssertEqualWithAccuracy(stats.minLatency, 0.001, 0.000001);
+	XCTAssertEqualWithAccuracy(stats.maxLatency, 1.000, 0.000001);
+	XCTAssertEqualWithAccuracy(stats.meanLatency, 0.5005, 0.000001);
+	
+	[self assertLatency:stats.p50 nearMilliseconds:500];
+	[self assertLatency:stats.p90 nearMilliseconds:900];
+	[self assertLatency:stats.p99 nearMilliseconds:990];
+	
+	[self assertLatency:[stats latencyAtPercentile:25.0] nearMilliseconds:250];
+	[self assertLatency:[stats latencyAtPercentile:99.9] nearMilliseconds:999];
+}
+
+- (void)test_percentiles_bimodal
+{
+	// 90% of requests are fast, 10% are slow
+	
+	NSMutableArray<NSNumber *> *latencies = [NSMutableArray arrayWithCapacity:100];
+	for (int i = 0; i < 90; i++) {
+		[latencies addObject:@(10)];
+	}
+	for (int i = 0; i < 10; i++) {
+		[latencies addObject:@(2000)];
+	}
+	
+	ZDCMetricStats *stats = [self statsForLatencies:latencies];
+	
+	[self assertLatency:stats.p50 nearMilliseconds:10];
+	[self assertLatency:stats.p90 nearMilliseconds:10];
+	[self assertLatency:[stats latencyAtPercentile:91.0] nearMilliseconds:2000];
+	[self assertLatency:stats.p99 nearMilliseconds:2000];
+}
+
+- (void)test_percentiles_singleValue
+{
+	// With a single value, the min/max clamp makes every percentile exact
+	
+	ZDCMetricStats *stats = [self statsForLatencies:@[ @(123) ]];
+	
+	XCTAssertEqualWithAccuracy(stats.p50, 0.123, 0.000001);
+	XCTAssertEqualWithAccuracy(stats.p99, 0.123, 0.000001);
+	XCTAssertEqualWithAccuracy([stats latencyAtPercentile:0.0], 0.123, 0.000001);
+}
+
+- (void)test_percentiles_clamping
+{
+	ZDCMetricStats *stats = [self statsForLatencies:@[ @(1), @(2), @(3), @(4) ]];
+	
+	// Out of range percentiles are clamped to [0, 100]
+	
+	XCTAssertEqual([stats latencyAtPercentile:-10.0], [stats latencyAtPercentile:0.0]);
+	XCTAssertEqual([stats latencyAtPercentile:150.0], [stats latencyAtPercentile:100.0]);
+	
+	[self assertLatency:[stats latencyAtPercentile:0.0] nearMilliseconds:1];
+	[self assertLatency:[stats latencyAtPercentile:100.0] nearMilliseconds:4];
+	
+	// Values beyond the histogram's range (~19 hours) land in the last bucket,
+	// but the reported percentile never exceeds the actual max.
+	
+	double hugeMS = 30.0 * 60 * 60 * 1000; // 30 hours
+	stats = [self statsForLatencies:@[ @(1), @(hugeMS) ]];
+	
+	XCTAssertEqualWithAccuracy(stats.maxLatency, hugeMS / 1000.0, 0.001);
+	XCTAssertLessThanOrEqual(stats.p99, stats.maxLatency);
+	XCTAssertGreaterThan(stats.p99, (double)(1ULL << 35) / USEC_PER_SEC);
+	
+	// No events
+	
+	XCTAssertNil([[self metricsManager] snapshot][@"test"]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Counters
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_counters
+{
+	ZDCMetricsManager *metricsManager = [self metricsManager];
+	
+	[metricsManager incrementCounter:@"push: poll requests" by:1];
+	[metricsManager incrementCounter:@"push: poll requests" by:2];
+	[metricsManager incrementCounter:@"push: poll wasted status checks" by:0];
+	
+	ZDCMetricStats *stats = [metricsManager snapshot][@"push: poll requests"];
+	XCTAssertEqual(stats.count, 3);
+	XCTAssertEqual(stats.p99, 0);
+	
+	XCTAssertNil([metricsManager snapshot][@"push: poll wasted status checks"]);
+	
+	[metricsManager reset];
+	XCTAssertNil([metricsManager snapshot][@"push: poll requests"]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Reset
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test_resetOnlyAffectsInstance
+{
+	ZDCMetricsManager *managerA = [self metricsManager];
+	ZDCMetricsManager *managerB = [self metricsManager];
+	
+	[ZDCMetricsManager recordEncryptedBytes:1024 duration:NSEC_PER_MSEC];
+	
+	[managerA reset];
+	
+	XCTAssertNil([managerA snapshot][@"crypto: encrypt"]);
+	XCTAssertGreaterThanOrEqual([managerB snapshot][@"crypto: encrypt"].count, 1);
+	
+	[ZDCMetricsManager recordEncryptedBytes:2048 duration:NSEC_PER_MSEC];
+	
+	ZDCMetricStats *statsA = [managerA snapshot][@"crypto: encrypt"];
+	XCTAssertEqual(statsA.count, 1);
+	XCTAssertEqual(statsA.totalBytes, 2048);
+	
+	XCTAssertGreaterThanOrEqual([managerB snapshot][@"crypto: encrypt"].count, 2);
+}
+
+@end
@@ -0,0 +1,250 @@
+/**
+ * ZeroDark.cloud
+ * <GitHub wiki link goes here>
+**/
+
+#import <XCTest/XCTest.h>
+
+#import <ZeroDarkCloud/ZeroDarkCloud.h>
+#import <ZeroDarkCloud/ZDCNodeMeta.h>
+#import <ZeroDarkCloud/ZDCNodePrivate.h>
+
+@interface test_NodeMetaCollation : XCTestCase
+@end
+
+static NSString *const userA = @"z55tqmfr9kix1p1gntotqpwkacpuoyno";
+
+@implementation test_NodeMetaCollation
+
+/**
+ * A mix of names that get a collationKey (ASCII letters & digits),
+ * and names that don't (punctuation, whitespace, non-ASCII).
+ */
+- (NSArray<NSString *> *)sampleNames
+{
+	return @[
+		@"apple", @"Apple", @"APPLE", @"apples", @"Zebra", @"zebra", @"b", @"B2", @"b10", @"b2",
+		@"A1", @"a10", @"1", @"10", @"2", @"abc", @"ABD", @"z",
+		@"a-b", @"a_b", @"a b", @"a.b", @"ab", @"a(b)", @"-", @"_", @".hidden", @"readme.txt", @"README.TXT",
+		@"Äpfel", @"äpfel", @"Apfel", @"éclair", @"eclair", @"Eclair", @"Œuvre", @"straße", @"strasse",
+		@"日本", @"日本語", @"Ωmega", @"omega", @"ñandú", @"nandu", @"", @"Ø", @"o"
+	];
+}
+
+- (NSArray<ZDCNodeMeta *> *)sampleMetas
+{
+	NSString *parentID = [[NSUUID UUID] UUIDString];
+	NSMutableArray<ZDCNodeMeta *> *metas = [NSMutableArray array];
+	
+	for (NSString *name in [self sampleNames])
+	{
+		ZDCNode *node = [[ZDCNode alloc] initWithLocalUserID:userA];
+		node.parentID = parentID;
+		node.name = name;
+		
+		[metas addObject:[[ZDCNodeMeta alloc] initWithNode:node treeID:@"com.4th-a.test"]];
+	}
+	
+	return metas;
+}
+
+/**
+ * The collationKey is only a shortcut, so the comparison must always match `localizedCaseInsensitiveCompare:`.
+ *
+ * Note: This holds in every locale, but whether the keys are actually used depends on the current locale.
+ * See test_collationKeysMatchLocale for a test of the keys that doesn't depend on the current locale.
+ */
+- (void)test_matchesLocalizedCompare
+{
+	NSArray<ZDCNodeMeta *> *metas = [self sampleMetas];
+	
+	for (ZDCNodeMeta *meta1 in metas)
+	{
+		for (ZDCNodeMeta *meta2 in metas)
+		{
+			NSComparisonResult expected = [meta1.name localizedCaseInsensitiveCompare:meta2.name];
+			
+			XCTAssert([meta1 compareName:meta2] == expected,
+			          @"compareName mismatch: \"%@\" vs \"%@\"", meta1.name, meta2.name);
+			
+			NSData *key2 = [ZDCNodeMeta collationKeyForName:meta2.name];
+			
+			XCTAssert([meta1 compareName:meta2.name collationKey:key2] == expected,
+			          @"find comparison mismatch: \"%@\" vs \"%@\"", meta1.name, meta2.name);
+		}
+	}
+}
+
+/**
+ * Tests the collationKeys against a fixed locale (instead of the current locale),
+ * so the result doesn't depend on the machine running the tests.
+ */
+- (void)test_collationKeysMatchLocale
+{
+	NSLocale *locale = [NSLocale localeWithLocaleIdentifier:@"en_US"];
+	XCTAssertTrue([ZDCNodeMeta canUseCollationKeysForLocale:locale]);
+	
+	for (NSString *name1 in [self sampleNames])
+	{
+		NSData *key1 = [ZDCNodeMeta collationKeyForName:name1];
+		if (key1 == nil) continue;
+		
+		for (NSString *name2 in [self sampleNames])
+		{
+			NSData *key2 = [ZDCNodeMeta collationKeyForName:name2];
+			if (key2 == nil) continue;
+			
+			NSComparisonResult expected =
+			  [name1 compare: name2
+			         options: NSCaseInsensitiveSearch
+			           range: NSMakeRange(0, name1.length)
+			          locale: locale];
+			
+			XCTAssert([ZDCNodeMeta compareCollationKey:key1 withCollationKey:key2] == expected,
+			          @"collationKey mismatch: \"%@\" vs \"%@\"", name1, name2);
+		}
+	}
+}
+
+- (void)test_canUseCollationKeysForLocale
+{
+	XCTAssertTrue([ZDCNodeMeta canUseCollationKeysForLocale:[NSLocale localeWithLocaleIdentifier:@"en_US"]]);
+	XCTAssertTrue([ZDCNodeMeta canUseCollationKeysForLocale:[NSLocale localeWithLocaleIdentifier:@"de_DE"]]);
+	
+	XCTAssertFalse([ZDCNodeMeta canUseCollationKeysForLocale:[NSLocale localeWithLocaleIdentifier:@"da_DK"]]);
+	XCTAssertFalse([ZDCNodeMeta canUseCollationKeysForLocale:[NSLocale localeWithLocaleIdentifier:@"nb_NO"]]);
+	XCTAssertFalse([ZDCNodeMeta canUseCollationKeysForLocale:[NSLocale localeWithLocaleIdentifier:@"lt_LT"]]);
+}
+
+- (void)test_collationKeys
+{
+	XCTAssertNotNil([ZDCNodeMeta collationKeyForName:@"Apple2"]);
+	XCTAssertEqualObjects([ZDCNodeMeta collationKeyForName:@"apple"], [ZDCNodeMeta collationKeyForName:@"APPLE"]);
+	
+	XCTAssertNil([ZDCNodeMeta collationKeyForName:nil]);
+	XCTAssertNil([ZDCNodeMeta collationKeyForName:@"a-b"]);
+	XCTAssertNil([ZDCNodeMeta collationKeyForName:@"a b"]);
+	XCTAssertNil([ZDCNodeMeta collationKeyForName:@"readme.txt"]);
+	XCTAssertNil([ZDCNodeMeta collationKeyForName:@"Äpfel"]);
+	XCTAssertNil([ZDCNodeMeta collationKeyForName:@"日本"]);
+}
+
+/**
+ * The key is derived from the name, so it survives archiving (and isn't trusted from the archive).
+ */
+- (void)test_collationKeyArchive
+{
+	for (ZDCNodeMeta *meta in [self sampleMetas])
+	{
+		NSData *data = [NSKeyedArchiver archivedDataWithRootObject:meta];
+		ZDCNodeMeta *copy = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+		
+		XCTAssertEqualObjects(copy.collationKey, [ZDCNodeMeta collationKeyForName:meta.name]);
+	}
+}
+
+/**
+ * Sorting requires a transitive comparison, or the view's order is garbage.
+ */
+- (void)test_transitive
+{
+	NSArray<ZDCNodeMeta *> *metas = [self sampleMetas];
+	
+	for (ZDCNodeMeta *a in metas)
+	{
+		for (ZDCNodeMeta *b in metas)
+		{
+			NSComparisonResult ab = [a compareName:b];
+			XCTAssert([b compareName:a] == -ab, @"not antisymmetric: \"%@\" vs \"%@\"", a.name, b.name);
+			
+			for (ZDCNodeMeta *c in metas)
+			{
+				NSComparisonResult bc = [b compareName:c];
+				NSComparisonResult ac = [a compareName:c];
+				
+				if (ab != NSOrderedDescending && bc != NSOrderedDescending) {
+					XCTAssert(ac != NSOrderedDescending,
+					          @"not transitive: \"%@\" <= \"%@\" <= \"%@\"", a.name, b.name, c.name);
+				}
+				if (ab == NSOrderedSame && bc == NSOrderedSame) {
+					XCTAssert(ac == NSOrderedSame,
+					          @"not transitive: \"%@\" == \"%@\" == \"%@\"", a.name, b.name, c.name);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Sorts the metas the way Ext_View_Treesystem_Name does,
+ * and then checks that the find comparison (used by `-[ZDCNodeManager findNodeWithName:parentID:transaction:]`)
+ * partitions the sorted array for every name: [Ascending..., Same..., Descending...].
+ *
+ * This is what the binary search in YapDatabaseViewFind relies upon.
+ */
+- (void)test_viewOrderMatchesFind
+{
+	NSArray<ZDCNodeMeta *> *sorted = [[self sampleMetas] sortedArrayUsingComparator:
+	  ^NSComparisonResult(ZDCNodeMeta *meta1, ZDCNodeMeta *meta2)
+	{
+		NSComparisonResult result = [meta1 compareName:meta2];
+		if (result == NSOrderedSame) {
+			result = [meta1.nodeID compare:meta2.nodeID];
+		}
+		return result;
+	}];
+	
+	NSMutableArray<NSString *> *targets = [[self sampleNames] mutableCopy];
+	[targets addObjectsFromArray:@[ @"APPLES", @"aa", @"zz", @"0", @"äPFEL", @"b1", @"日", @"missing" ]];
+	
+	for (NSString *target in targets)
+	{
+		NSData *key = [ZDCNodeMeta collationKeyForName:target];
+		
+		NSComparisonResult prev = NSOrderedAscending;
+		NSUInteger expectedIndex = NSNotFound;
+		
+		for (NSUInteger i = 0; i < sorted.count; i++)
+		{
+			NSComparisonResult cmp = [sorted[i] compareName:target collationKey:key];
+			
+			XCTAssert(cmp >= prev, @"find block disagrees with view order for \"%@\" at \"%@\"", target, sorted[i].name);
+			prev = cmp;
+			
+			if (cmp == NSOrderedSame && expectedIndex == NSNotFound) {
+				expectedIndex = i;
+			}
+		}
+		
+		// Binary search (same algorithm as YapDatabaseViewFind's findFirstMatch)
+		
+		NSUInteger min = 0;
+		NSUInteger max = sorted.count;
+		NSUInteger foundIndex = NSNotFound;
+		
+		while (min < max)
+		{
+			NSUInteger mid = (min + max) / 2;
+			NSComparisonResult cmp = [sorted[mid] compareName:target collationKey:key];
+			
+			if (cmp == NSOrderedAscending) {
+				min = mid + 1;
+			}
+			else
+			{
+				if (cmp == NSOrderedSame) {
+					foundIndex = mid;
+				}
+				max = mid;
+			}
+		}
+		
+		XCTAssert(foundIndex == expectedIndex, @"binary search failed for \"%@\"", target);
+		
+		if ([[self sampleNames] containsObject:target]) {
+			XCTAssert(foundIndex != NSNotFound, @"binary search missed \"%@\"", target);
+		}
+	}
+}
+
+@end
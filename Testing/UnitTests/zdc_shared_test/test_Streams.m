@@ -1161,6 +1161,74 @@ abort:
 	}
 }
 
+- (void)test_cloudDataInfoRanges
+{
+	NSURL *testFilesURL = [[NSBundle bundleForClass:[self class]] URLForResource:@"Test Files" withExtension:nil];
+	
+	NSDirectoryEnumerator<NSURL *> *enumerator =
+	  [[NSFileManager defaultManager] enumeratorAtURL:testFilesURL
+	                       includingPropertiesForKeys:nil
+	                                          options:NSDirectoryEnumerationSkipsSubdirectoryDescendants
+	                                     errorHandler:nil];
+	
+	ZDCNode *node = [[ZDCNode alloc] initWithLocalUserID:@"abc123"];
+	node.encryptionKey = [self sample_raw_key];
+	
+	NSData *rawMetadata = [self sample_raw_metadata];
+	NSData *rawThumbnail = [self sample_raw_thumbnail];
+	
+	for (NSURL *cleartextFileURL in enumerator)
+	{
+		Cleartext2CloudFileInputStream *stream =
+		  [[Cleartext2CloudFileInputStream alloc] initWithCleartextFileURL: cleartextFileURL
+		                                                     encryptionKey: node.encryptionKey];
+		
+		stream.rawMetadata = rawMetadata;
+		stream.rawThumbnail = rawThumbnail;
+		
+		NSURL *cloudFileURL = [self writeStream:stream error:nil];
+		XCTAssert(cloudFileURL != nil);
+		
+		NSData *cloudFileData = [NSData dataWithContentsOfURL:cloudFileURL];
+		
+		ZDCCloudFileHeader headerInfo;
+		NSError *error = nil;
+		
+		BOOL result =
+		  [CloudFile2CleartextInputStream decryptCloudFileData: cloudFileData
+		                                     withEncryptionKey: node.encryptionKey
+		                                                header: &headerInfo
+		                                           rawMetadata: NULL
+		                                          rawThumbnail: NULL
+		                                                 error: &error];
+		
+		XCTAssert(result == YES);
+		XCTAssert(error == nil);
+		
+		ZDCCloudDataInfo *info =
+		  [[ZDCCloudDataInfo alloc] initWithCloudFileHeader: headerInfo
+		                                               eTag: @"etag"
+		                                       lastModified: [NSDate date]];
+		
+		XCTAssert(info.metadataRange.location == sizeof(ZDCCloudFileHeader));
+		XCTAssert(info.metadataRange.length == rawMetadata.length);
+		
+		XCTAssert(info.thumbnailRange.location == NSMaxRange(info.metadataRange));
+		XCTAssert(info.thumbnailRange.length == rawThumbnail.length);
+		
+		XCTAssert(info.dataRange.location == NSMaxRange(info.thumbnailRange));
+		XCTAssert(info.dataRange.length == headerInfo.dataSize);
+		
+		// The cloud file is padded to a multiple of the key length.
+		XCTAssert(NSMaxRange(info.dataRange) <= cloudFileData.length);
+		XCTAssert(cloudFileData.length - NSMaxRange(info.dataRange) < node.encryptionKey.length);
+		
+		if (cloudFileURL) {
+			[[NSFileManager defaultManager] removeItemAtURL:cloudFileURL error:nil];
+		}
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark -
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -101,6 +101,16 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (void)setContentTypeHeaderAutomatically:(BOOL)flag;
 
+/**
+ * Deriving the signing key requires 4 rounds of HMAC-SHA256.
+ * Since the signing key only depends on the credentials, date, region & service,
+ * the derived keys are cached (in memory), and reused for subsequent requests.
+ *
+ * This method clears the cache.
+ * It's primarily for unit testing purposes (e.g. to benchmark signing with a cold cache).
+ */
++ (void)flushSigningKeyCache;
+
 @end
 
 NS_ASSUME_NONNULL_END
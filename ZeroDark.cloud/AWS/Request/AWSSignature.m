@@ -2,35 +2,127 @@
 
 #import "AWSDate.h"
 #import "AWSPayload.h"
-#import "NSData+AWSUtilities.h"
 
 #import <CommonCrypto/CommonDigest.h>
 #import <CommonCrypto/CommonHMAC.h>
+#import <YapDatabase/YapCache.h>
 #import <stdatomic.h>
 
 #if DEBUG
 #define USE_UNSECURE_HTTP 0 // for debugging via packet analyzer
 #endif
 
-@implementation AWSSignature
-
-static atomic_bool setContentTypeHeaderAutomatically = 1;
+/**
+ * A signing key is specific to a credential, date, region & service.
+ * So we typically only need a handful of them (per localUser) at any given time.
+ */
+#define SIGNING_KEY_CACHE_LIMIT 64
 
-+ (NSData *)SHA256Hash:(NSString *)string
+/**
+ * Streams the UTF-8 representation of the string into the hash context,
+ * without allocating an intermediate NSData.
+ */
+static void AWSSHA256UpdateString(CC_SHA256_CTX *ctx, NSString *string)
 {
-	NSData *dataToHash = [string dataUsingEncoding:NSUTF8StringEncoding];
+	CFStringRef cfString = (__bridge CFStringRef)string;
 	
-	CC_SHA256_CTX ctx;
-	CC_SHA256_Init(&ctx);
+	// Fast path: most of our strings are ASCII, and already store a C string internally.
 	
-	CC_SHA256_Update(&ctx, dataToHash.bytes, (CC_LONG)dataToHash.length);
+	const char *cString = CFStringGetCStringPtr(cfString, kCFStringEncodingUTF8);
+	if (cString)
+	{
+		CC_SHA256_Update(ctx, cString, (CC_LONG)strlen(cString));
+		return;
+	}
+	
+	uint8_t buffer[256];
 	
-	int hashLength = CC_SHA256_DIGEST_LENGTH;
-	uint8_t hashBytes[hashLength];
+	CFIndex length = CFStringGetLength(cfString);
+	CFIndex location = 0;
+	
+	while (location < length)
+	{
+		CFIndex usedBufferLength = 0;
+		CFIndex converted =
+		  CFStringGetBytes(cfString, CFRangeMake(location, length - location), kCFStringEncodingUTF8,
+		                   0, false, buffer, sizeof(buffer), &usedBufferLength);
+		
+		if (converted == 0) break;
+		
+		CC_SHA256_Update(ctx, buffer, (CC_LONG)usedBufferLength);
+		location += converted;
+	}
+}
+
+static inline void AWSSHA256UpdateByte(CC_SHA256_CTX *ctx, uint8_t byte)
+{
+	CC_SHA256_Update(ctx, &byte, 1);
+}
+
+/**
+ * Same as AWSSHA256UpdateString, but for an HMAC context.
+ */
+static void AWSHmacUpdateString(CCHmacContext *ctx, NSString *string)
+{
+	NSUInteger length = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+	const char *cString = string.UTF8String;
+	
+	if (cString) {
+		CCHmacUpdate(ctx, cString, length);
+	}
+}
+
+/**
+ * Writes the lowercase hex representation of the bytes into the given buffer,
+ * which must have room for (length * 2) characters.
+ */
+static void AWSLowercaseHex(const uint8_t *bytes, size_t length, char *hexOut)
+{
+	static const char digits[] = "0123456789abcdef";
+	
+	for (size_t i = 0; i < length; i++)
+	{
+		hexOut[(i * 2)    ] = digits[(bytes[i] >> 4) & 0x0F];
+		hexOut[(i * 2) + 1] = digits[(bytes[i]     ) & 0x0F];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface AWSSigningKeyCacheEntry : NSObject
+
+@property (nonatomic, copy, readwrite) NSString *secret;
+@property (nonatomic, copy, readwrite) NSData *signingKey;
+
+@end
+
+@implementation AWSSigningKeyCacheEntry
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation AWSSignature
+
+static atomic_bool setContentTypeHeaderAutomatically = 1;
+
+static dispatch_queue_t signingKeyCacheQueue;
+static YapCache<NSString*, AWSSigningKeyCacheEntry*> *signingKeyCache; // must be accessed from within signingKeyCacheQueue
+
++ (void)initialize
+{
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
 	
-	CC_SHA256_Final(hashBytes, &ctx);
+		signingKeyCacheQueue = dispatch_queue_create("AWSSignature-signingKeyCache", DISPATCH_QUEUE_SERIAL);
 	
-	return [NSData dataWithBytes:(void *)hashBytes length:hashLength];
+		signingKeyCache = [[YapCache alloc] initWithCountLimit:SIGNING_KEY_CACHE_LIMIT];
+		signingKeyCache.allowedKeyClasses = [NSSet setWithObject:[NSString class]];
+		signingKeyCache.allowedObjectClasses = [NSSet setWithObject:[AWSSigningKeyCacheEntry class]];
+	});
 }
 
 + (NSData *)HMACSHA256Hash:(NSString *)string withKey:(NSData *)key
@@ -81,6 +173,69 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 	return encodedString;
 }
 
+/**
+ * Derives the signing key (kSigning) from the secret.
+ *
+ * From the docs:
+ *
+ * To do this, use your secret access key to create a series of hash-based message authentication codes (HMACs).
+ * This is shown in the following pseudocode, where HMAC(key, data) represents an HMAC-SHA256 function that
+ * returns output in binary format. The result of each hash function becomes input for the next one.
+ *
+ * kSecret = "AWS4" + <Your AWS Secret Access Key>
+ * kDate = HMAC(kSecret, Date)
+ * kRegion = HMAC(kDate, Region)
+ * kService = HMAC(kRegion, Service)
+ * kSigning = HMAC(kService, "aws4_request")
+ *
+ * The result only depends on the (secret, date, region, service) tuple.
+ * So we cache it, and only perform the 4 HMAC rounds once per day (per credential, region & service).
+ */
++ (NSData *)signingKeyWithAccessKeyID:(NSString *)accessKeyID
+                               secret:(NSString *)secret
+                       shortTimestamp:(NSString *)shortTimestamp
+                               region:(NSString *)aws_region
+                              service:(NSString *)aws_service
+{
+	NSString *cacheKey =
+	  [NSString stringWithFormat:@"%@/%@/%@/%@", accessKeyID, shortTimestamp, aws_region, aws_service];
+	
+	__block NSData *kSigning = nil;
+	dispatch_sync(signingKeyCacheQueue, ^{
+		
+		AWSSigningKeyCacheEntry *entry = [signingKeyCache objectForKey:cacheKey];
+		
+		// The accessKeyID should uniquely identify the secret.
+		// But we double-check, to be safe, in case the credentials are somehow refreshed in-place.
+		
+		if (entry && [entry.secret isEqualToString:secret]) {
+			kSigning = entry.signingKey;
+		}
+	});
+	
+	if (kSigning) {
+		return kSigning;
+	}
+	
+	NSData *kSecret = [[@"AWS4" stringByAppendingString:secret] dataUsingEncoding:NSUTF8StringEncoding];
+	
+	NSData *kDate = [self HMACSHA256Hash:shortTimestamp withKey:kSecret];
+	NSData *kRegion = [self HMACSHA256Hash:aws_region withKey:kDate];
+	NSData *kService = [self HMACSHA256Hash:aws_service withKey:kRegion];
+	kSigning = [self HMACSHA256Hash:@"aws4_request" withKey:kService];
+	
+	AWSSigningKeyCacheEntry *entry = [[AWSSigningKeyCacheEntry alloc] init];
+	entry.secret = secret;
+	entry.signingKey = kSigning;
+	
+	dispatch_sync(signingKeyCacheQueue, ^{
+		
+		[signingKeyCache setObject:entry forKey:cacheKey];
+	});
+	
+	return kSigning;
+}
+
 + (NSString *)credentialWithAccessKeyID:(NSString *)accessKeyID
                                    date:(NSDate *)date
                                  region:(AWSRegion)region
@@ -301,7 +456,9 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 	// You URI-encode name and values individually. You must also sort the parameters in the canonical
 	// query string alphabetically by key name. The sorting occurs after encoding.
 	
-	NSString *canonicalQueryString = @"";
+	NSArray<NSString *> *canonicalQueryKeys = nil;
+	NSDictionary<NSString *, NSString *> *canonicalQueryValues = nil;
+	
 	if (urlComponents.query.length > 0)
 	{
 		NSArray<NSURLQueryItem *> *queryItems = urlComponents.queryItems;
@@ -309,8 +466,6 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 		NSMutableDictionary *encodedQueryItems = [NSMutableDictionary dictionaryWithCapacity:queryItems.count];
 		NSMutableArray *encodedQueryItemKeys = [NSMutableArray arrayWithCapacity:queryItems.count];
 		
-		NSUInteger strCapacity = 0;
-		
 		for (NSURLQueryItem *queryItem in queryItems)
 		{
 			NSString *key = [self uriEncoded:queryItem.name isCanonicalURI:NO];
@@ -318,24 +473,12 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 			
 			encodedQueryItems[key] = value;
 			[encodedQueryItemKeys addObject:key];
-			
-			strCapacity += (key.length + 1 + value.length + 1);
 		}
 		
 		[encodedQueryItemKeys sortUsingSelector:@selector(compare:)];
 		
-		NSMutableString *str = [NSMutableString stringWithCapacity:strCapacity];
-		for (NSString *key in encodedQueryItemKeys)
-		{
-			NSString *value = encodedQueryItems[key];
-			
-			if (str.length > 0)
-				[str appendFormat:@"&%@=%@", key, value];
-			else
-				[str appendFormat:@"%@=%@", key, value];
-		}
-		
-		canonicalQueryString = str;
+		canonicalQueryKeys = encodedQueryItemKeys;
+		canonicalQueryValues = encodedQueryItems;
 	}
 	
 	// CanonicalHeaders is a list of request headers with their values.
@@ -345,7 +488,9 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 	// SignedHeaders is an alphabetically sorted, semicolon-separated list of lowercase request header names.
 	// The request headers in the list are the same headers that you included in the CanonicalHeaders string.
 	
-	NSString *canonicalHeaders = @"";
+	NSArray<NSString *> *canonicalHeaderKeys = nil;
+	NSDictionary<NSString *, NSString *> *canonicalHeaderValues = nil;
+	
 	NSString *signedHeaders = @"";
 	
 	NSMutableDictionary <NSString *,NSString *> *headers = [request.allHTTPHeaderFields mutableCopy];
@@ -362,9 +507,6 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 		NSMutableDictionary *encodedHeaders = [NSMutableDictionary dictionaryWithCapacity:headers.count];
 		NSMutableArray *encodedHeaderKeys = [NSMutableArray arrayWithCapacity:headers.count];
 		
-		__block NSUInteger str_canonicalHeaders_capacity = 0;
-		__block NSUInteger str_signedHeaders_capacity = 0;
-		
 		[headers enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSString *value, BOOL *stop) {
 			
 			NSString *encodedKey = [key lowercaseString];
@@ -372,30 +514,14 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 			
 			encodedHeaders[encodedKey] = encodedValue;
 			[encodedHeaderKeys addObject:encodedKey];
-			
-			str_canonicalHeaders_capacity += (encodedKey.length + 1 + encodedValue.length + 1);
-			str_signedHeaders_capacity += (encodedKey.length + 1);
 		}];
 		
 		[encodedHeaderKeys sortUsingSelector:@selector(compare:)];
 		
-		NSMutableString *str_canonicalHeaders = [NSMutableString stringWithCapacity:str_canonicalHeaders_capacity];
-		NSMutableString *str_signedHeaders = [NSMutableString stringWithCapacity:str_signedHeaders_capacity];
+		canonicalHeaderKeys = encodedHeaderKeys;
+		canonicalHeaderValues = encodedHeaders;
 		
-		for (NSString *key in encodedHeaderKeys)
-		{
-			NSString *value = headers[key];
-			
-			[str_canonicalHeaders appendFormat:@"%@:%@\n", key, value];
-			
-			if (str_signedHeaders.length > 0)
-				[str_signedHeaders appendFormat:@";%@", key];
-			else
-				[str_signedHeaders appendString:key];
-		}
-		
-		canonicalHeaders = str_canonicalHeaders;
-		signedHeaders = str_signedHeaders;
+		signedHeaders = [encodedHeaderKeys componentsJoinedByString:@";"];
 	}
 	
 	// HashedPayload is the hexadecimal value of the SHA256 hash of the request payload.
@@ -423,15 +549,52 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 	// <CanonicalHeaders>\n
 	// <SignedHeaders>\n
 	// <HashedPayload>
+	//
+	// We only ever need the hash of the canonical request.
+	// So rather than building it as a string (and then converting it to UTF-8 data),
+	// we stream each component directly into the hash context.
 	
-	NSString *canonicalRequest =
-	  [NSString stringWithFormat:@"%@\n%@\n%@\n%@\n%@\n%@",
-	    httpMethod,
-	    canonicalURI,
-	    canonicalQueryString,
-	    canonicalHeaders,
-	    signedHeaders,
-	    hashedPayload];
+	uint8_t canonicalRequestHash[CC_SHA256_DIGEST_LENGTH];
+	{
+		CC_SHA256_CTX ctx;
+		CC_SHA256_Init(&ctx);
+		
+		AWSSHA256UpdateString(&ctx, httpMethod);
+		AWSSHA256UpdateByte(&ctx, '\n');
+		
+		AWSSHA256UpdateString(&ctx, canonicalURI);
+		AWSSHA256UpdateByte(&ctx, '\n');
+		
+		BOOL isFirstQueryItem = YES;
+		for (NSString *key in canonicalQueryKeys)
+		{
+			if (isFirstQueryItem)
+				isFirstQueryItem = NO;
+			else
+				AWSSHA256UpdateByte(&ctx, '&');
+			
+			AWSSHA256UpdateString(&ctx, key);
+			AWSSHA256UpdateByte(&ctx, '=');
+			AWSSHA256UpdateString(&ctx, canonicalQueryValues[key]);
+		}
+		AWSSHA256UpdateByte(&ctx, '\n');
+		
+		for (NSString *key in canonicalHeaderKeys)
+		{
+			AWSSHA256UpdateString(&ctx, key);
+			AWSSHA256UpdateByte(&ctx, ':');
+			AWSSHA256UpdateString(&ctx, canonicalHeaderValues[key]);
+			AWSSHA256UpdateByte(&ctx, '\n');
+		}
+		AWSSHA256UpdateByte(&ctx, '\n');
+		
+		AWSSHA256UpdateString(&ctx, signedHeaders);
+		AWSSHA256UpdateByte(&ctx, '\n');
+		
+		AWSSHA256UpdateString(&ctx, hashedPayload);
+		
+		CC_SHA256_Final(canonicalRequestHash, &ctx);
+	}
 	
 	// Scope binds the resulting signature to a specific date, an AWS region, and a service.
 	// Thus, your resulting signature will work only in the specific region and for a specific service.
@@ -443,6 +606,16 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 	
 	NSString *scope = [NSString stringWithFormat:@"%@/%@/%@/aws4_request", shortTimestamp, aws_region, aws_service];
 	
+	// Derive the signing key.
+	// See 'signingKeyWithAccessKeyID:secret:shortTimestamp:region:service:' for the details.
+	
+	NSData *kSigning =
+	  [self signingKeyWithAccessKeyID: accessKeyID
+	                           secret: secret
+	                   shortTimestamp: shortTimestamp
+	                           region: aws_region
+	                          service: aws_service];
+	
 	// Create a String to Sign
 	//
 	// The string to sign is a concatenation of the following strings:
@@ -451,43 +624,41 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 	// timeStampISO8601Format + "\n" +
 	// <Scope> + "\n" +
 	// Hex(SHA256Hash(<CanonicalRequest>))
+	//
+	// The final signature is the HMAC-SHA256 hash of the string to sign, using the signing key as the key.
+	// As with the canonical request, we stream the string to sign directly into the HMAC context.
 	
 	NSString *iso8601Timestamp = [AWSDate ISO8601TimestampFromDate:date];
 	
-	NSData *canonicalRequestHash = [self SHA256Hash:canonicalRequest];
-	NSString *canonicalRequestHashHex = [canonicalRequestHash lowercaseHexString];
+	char canonicalRequestHashHex[CC_SHA256_DIGEST_LENGTH * 2];
+	AWSLowercaseHex(canonicalRequestHash, sizeof(canonicalRequestHash), canonicalRequestHashHex);
 	
-	NSString *stringToSign =
-	  [NSString stringWithFormat:@"AWS4-HMAC-SHA256\n%@\n%@\n%@",
-	    iso8601Timestamp,
-	    scope,
-	    canonicalRequestHashHex];
+	uint8_t signatureBytes[CC_SHA256_DIGEST_LENGTH];
+	{
+		CCHmacContext ctx;
+		CCHmacInit(&ctx, kCCHmacAlgSHA256, kSigning.bytes, kSigning.length);
 	
-	// Derive the signing key.
-	//
-	// To do this, use your secret access key to create a series of hash-based message authentication codes (HMACs).
-	// This is shown in the following pseudocode, where HMAC(key, data) represents an HMAC-SHA256 function that
-	// returns output in binary format. The result of each hash function becomes input for the next one.
-	//
-	// Pseudocode for deriving a signing key
-	//
-	// kSecret = "AWS4" + <Your AWS Secret Access Key>
-	// kDate = HMAC(kSecret, Date)
-	// kRegion = HMAC(kDate, Region)
-	// kService = HMAC(kRegion, Service)
-	// kSigning = HMAC(kService, "aws4_request")
+		const char prefix[] = "AWS4-HMAC-SHA256\n";
+		CCHmacUpdate(&ctx, prefix, sizeof(prefix) - 1);
 	
-	NSData *kSecret = [[@"AWS4" stringByAppendingString:secret] dataUsingEncoding:NSUTF8StringEncoding];
+		AWSHmacUpdateString(&ctx, iso8601Timestamp);
+		CCHmacUpdate(&ctx, "\n", 1);
 	
-	NSData *kDate = [self HMACSHA256Hash:shortTimestamp withKey:kSecret];
-	NSData *kRegion = [self HMACSHA256Hash:aws_region withKey:kDate];
-	NSData *kService = [self HMACSHA256Hash:aws_service withKey:kRegion];
-	NSData *kSigning = [self HMACSHA256Hash:@"aws4_request" withKey:kService];
+		AWSHmacUpdateString(&ctx, scope);
+		CCHmacUpdate(&ctx, "\n", 1);
 	
-	// The final signature is the HMAC-SHA256 hash of the string to sign, using the signing key as the key.
+		CCHmacUpdate(&ctx, canonicalRequestHashHex, sizeof(canonicalRequestHashHex));
+	
+		CCHmacFinal(&ctx, signatureBytes);
+	}
 	
-	NSData *signatureData = [self HMACSHA256Hash:stringToSign withKey:kSigning];
-	NSString *signature = [signatureData lowercaseHexString];
+	char signatureHex[CC_SHA256_DIGEST_LENGTH * 2];
+	AWSLowercaseHex(signatureBytes, sizeof(signatureBytes), signatureHex);
+	
+	NSString *signature =
+	  [[NSString alloc] initWithBytes: signatureHex
+	                           length: sizeof(signatureHex)
+	                         encoding: NSASCIIStringEncoding];
 	
 	// The following is an example of the Authorization header value.
 	// Line breaks are added to this example for readability:
@@ -518,4 +689,15 @@ static atomic_bool setContentTypeHeaderAutomatically = 1;
 	atomic_store(&setContentTypeHeaderAutomatically, (flag ? 1 : 0));
 }
 
+/**
+ * See header file for description.
+ */
++ (void)flushSigningKeyCache
+{
+	dispatch_sync(signingKeyCacheQueue, ^{
+		
+		[signingKeyCache removeAllObjects];
+	});
+}
+
 @end
@@ -46,6 +46,10 @@ typedef NS_ENUM(NSInteger, BlockchainErrorCode) {
 /**
  * Attempts to fetch the blockchain proof for the given user's public key.
  *
+ * The merkleTreeRoot is always fetched from the blockchain.
+ * But once a (merkleTreeRoot, userID) tuple has been verified, the proof is stored in the database
+ * (kZDCCollection_BlockchainProofs), and the merkleTree file isn't downloaded again for that tuple.
+ *
  * @important This method does NOT compare the proof with the user's local ZDCPublicKey value.
  *            It just performs the network operations to fetch the information.
  */
@@ -18,6 +18,7 @@
 
 // Libraries
 #import <stdatomic.h>
+#import <YapDatabase/YapCache.h>
 
 // Log Levels: off, error, warn, info, verbose
 // Log Flags : trace
@@ -30,10 +31,19 @@
 #endif
 #pragma unused(zdcLogLevel)
 
+/**
+ * Users that were registered around the same time share a merkleTree file.
+ * So when we're checking multiple users, it's likely we'll request the same file multiple times.
+ */
+#define MERKLE_TREE_CACHE_LIMIT 8
+
  
 @implementation ZDCBlockchainManager {
 	
 	__weak ZeroDarkCloud *zdc;
+	
+	dispatch_queue_t cacheQueue;
+	YapCache<NSString*, ZDCMerkleTree*> *merkleTreeCache; // must be accessed from within cacheQueue
 }
 
 - (instancetype)init
@@ -46,6 +56,14 @@
 	if ((self = [super init]))
 	{
 		zdc = owner;
+		
+		cacheQueue = dispatch_queue_create("ZDCBlockchainManager.cacheQueue", DISPATCH_QUEUE_SERIAL);
+		
+		merkleTreeCache = [[YapCache alloc] initWithCountLimit:MERKLE_TREE_CACHE_LIMIT];
+	#ifndef NS_BLOCK_ASSERTIONS
+		merkleTreeCache.allowedKeyClasses = [NSSet setWithObject:[NSString class]];
+		merkleTreeCache.allowedObjectClasses = [NSSet setWithObject:[ZDCMerkleTree class]];
+	#endif
 	}
 	return self;
 }
@@ -76,6 +94,33 @@
 	return [NSError errorWithDomain:domain code:code userInfo:userInfo];
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Cache
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns a merkleTree that was previously downloaded for the given merkleTreeRoot.
+ * The rootHash of the returned tree is known to match the merkleTreeRoot.
+ */
+- (nullable ZDCMerkleTree *)cachedMerkleTreeForRoot:(NSString *)merkleTreeRoot
+{
+	__block ZDCMerkleTree *merkleTree = nil;
+	dispatch_sync(cacheQueue, ^{
+		
+		merkleTree = [self->merkleTreeCache objectForKey:merkleTreeRoot];
+	});
+	
+	return merkleTree;
+}
+
+- (void)cacheMerkleTree:(ZDCMerkleTree *)merkleTree forRoot:(NSString *)merkleTreeRoot
+{
+	dispatch_async(cacheQueue, ^{
+		
+		[self->merkleTreeCache setObject:merkleTree forKey:merkleTreeRoot];
+	});
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Public API
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -102,7 +147,9 @@
 	dispatch_queue_t bgQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
 	
 	__block void (^queryBlockchain)(void);
+	__block void (^checkCache)(NSString *merkleTreeRoot);
 	__block void (^fetchMerkleTreeFile)(NSString *merkleTreeRoot);
+	__block void (^verifyProof)(ZDCMerkleTree *merkleTree, NSString *merkleTreeRoot);
 	
 	queryBlockchain = ^void (){ @autoreleasepool {
 		
@@ -130,7 +177,53 @@
 			}
 	
 			// Next step
-			fetchMerkleTreeFile(merkleTreeRoot);
+			checkCache(merkleTreeRoot);
+		}];
+	}};
+	
+	checkCache = ^void (NSString *merkleTreeRoot){ @autoreleasepool {
+		
+		// The merkleTreeRoot is always fetched from the blockchain (it changes if the user's pubKey changes).
+		// But if we've already verified this (merkleTreeRoot, userID) tuple,
+		// there's no need to download & verify the merkleTree file again.
+		
+		YapDatabaseConnection *roConnection = nil;
+		{
+			__strong typeof(self) strongSelf = weakSelf;
+			if (strongSelf) {
+				roConnection = strongSelf->zdc.databaseManager.roDatabaseConnection;
+			}
+		}
+		
+		__block ZDCBlockchainProof *cachedProof = nil;
+		[roConnection asyncReadWithBlock:^(YapDatabaseReadTransaction *transaction) {
+			
+			cachedProof = [transaction objectForKey:userID inCollection:kZDCCollection_BlockchainProofs];
+			
+		} completionQueue:bgQueue completionBlock:^{
+			
+			__strong typeof(self) strongSelf = weakSelf;
+			if (!strongSelf) return;
+			
+			if ([cachedProof isKindOfClass:[ZDCBlockchainProof class]] &&
+			    [cachedProof.merkleTreeRoot isEqualToString:merkleTreeRoot])
+			{
+				// Success (previously verified)
+				InvokeCompletionBlock(cachedProof, nil);
+				return;
+			}
+			
+			ZDCMerkleTree *merkleTree = [strongSelf cachedMerkleTreeForRoot:merkleTreeRoot];
+			if (merkleTree)
+			{
+				// Next step
+				verifyProof(merkleTree, merkleTreeRoot);
+			}
+			else
+			{
+				// Next step
+				fetchMerkleTreeFile(merkleTreeRoot);
+			}
 		}];
 	}};
 	
@@ -181,18 +274,6 @@
 				}
 			}
 			
-			NSError *verifyError = nil;
-			BOOL isVerified = [merkleTree hashAndVerify:&verifyError];
-			
-			if (!isVerified || verifyError)
-			{
-				NSError *error =
-				  [strongSelf errorWithCode:BlockchainErrorCode_MerkleTreeTampering underlyingError:verifyError];
-				
-				InvokeCompletionBlock(nil, error);
-				return;
-			}
-			
 			if (![merkleTreeRoot isEqual:merkleTree.rootHash])
 			{
 				NSString *msg = @"Downloaded merkleTreeFile doesn't match merkleTreeRoot request.";
@@ -202,27 +283,50 @@
 				return;
 			}
 			
-			NSString *pubKey = nil;
-			NSString *keyID = nil;
+			[strongSelf cacheMerkleTree:merkleTree forRoot:merkleTreeRoot];
 			
-			if (![merkleTree getPubKey:&pubKey keyID:&keyID forUserID:userID])
-			{
-				NSString *msg = @"Downloaded merkleTreeFile doesn't contain entries for user.";
-				NSError *error = [strongSelf errorWithCode:BlockchainErrorCode_MerkleTreeTampering description:msg];
+			// Next step
+			verifyProof(merkleTree, merkleTreeRoot);
+		}];
+	}};
 				
-				InvokeCompletionBlock(nil, error);
-				return;
-			}
+	verifyProof = ^void (ZDCMerkleTree *merkleTree, NSString *merkleTreeRoot){ @autoreleasepool {
 			
-			ZDCBlockchainProof *proof =
-			  [[ZDCBlockchainProof alloc] initWithMerkleTreeRoot: merkleTreeRoot
-			                                         blockNumber: 0
-			                                              pubKey: pubKey
-			                                               keyID: keyID];
+		__strong typeof(self) strongSelf = weakSelf;
+		if (!strongSelf) return;
 			
-			// Success!
-			InvokeCompletionBlock(proof, nil);
+		// We don't need to rebuild the entire tree.
+		// We only need to verify the path from the user's entry to the root.
+		
+		NSString *pubKey = nil;
+		NSString *keyID = nil;
+		NSError *verifyError = nil;
+		
+		BOOL isVerified = [merkleTree verifyProofForUserID:userID pubKey:&pubKey keyID:&keyID error:&verifyError];
+		
+		if (!isVerified || verifyError)
+		{
+			NSError *error =
+			  [strongSelf errorWithCode:BlockchainErrorCode_MerkleTreeTampering underlyingError:verifyError];
+			
+			InvokeCompletionBlock(nil, error);
+			return;
+		}
+		
+		ZDCBlockchainProof *proof =
+		  [[ZDCBlockchainProof alloc] initWithMerkleTreeRoot: merkleTreeRoot
+		                                         blockNumber: 0
+		                                              pubKey: pubKey
+		                                               keyID: keyID];
+		
+		YapDatabaseConnection *rwConnection = strongSelf->zdc.databaseManager.rwDatabaseConnection;
+		[rwConnection asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			[transaction setObject:proof forKey:userID inCollection:kZDCCollection_BlockchainProofs];
 		}];
+		
+		// Success!
+		InvokeCompletionBlock(proof, nil);
 	}};
 	
 	// Start
@@ -33,9 +33,34 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)hashAndVerify:(NSError *_Nullable *_Nullable)outError;
 
+/**
+ * Verifies that the given user's entry is included in the tree, without rebuilding the entire tree.
+ *
+ * This method hashes the user's value, and then walks up the tree (via the merkle section of the file),
+ * recalculating each parent hash from the sibling hash. So it only performs O(log n) hash operations.
+ * The proof succeeds if the walk arrives at the root hash.
+ *
+ * Note that this method does NOT verify the other values in the tree.
+ * Which isn't required in order to trust the user's pubKey & keyID,
+ * assuming the root hash has been compared against the value stored in the blockchain.
+ *
+ * @param userID
+ *   The user for which to verify the inclusion proof.
+ *
+ * @param outPubKey
+ *   On success, returns the pubKey value stored in the tree for the user.
+ *
+ * @param outKeyID
+ *   On success, returns the keyID value stored in the tree for the user.
+ */
+- (BOOL)verifyProofForUserID:(NSString *)userID
+                      pubKey:(NSString *_Nullable *_Nullable)outPubKey
+                       keyID:(NSString *_Nullable *_Nullable)outKeyID
+                       error:(NSError *_Nullable *_Nullable)outError;
+
 /**
  * Returns the merkleTree root value, as specified within the JSON.
- * This value is only valid IF the `hashAndVerify` method returns true.
+ * This value is only valid IF the `hashAndVerify` (or `verifyProofForUserID:::`) method returns true.
  */
 - (NSString *)rootHash;
 
@@ -9,9 +9,7 @@
 
 #import "ZDCMerkleTree.h"
 
-#import "NSData+AWSUtilities.h"
 #import "NSError+ZeroDark.h"
-#import "NSString+S4.h"
 
 #import <S4Crypto/S4Crypto.h>
 
@@ -78,6 +76,98 @@
 //   };
 // }
 
+/**
+ * Large enough for any supported hash algorithm (sha512).
+ */
+#define ZDC_MERKLE_MAX_HASH_SIZE (512 / 8)
+
+/**
+ * Upper bound on the depth of a tree, used when walking a proof (2^64 leaves).
+ */
+#define ZDC_MERKLE_MAX_LEVELS 64
+
+static const char ZDCMerkleHexDigits[] = "0123456789abcdef";
+
+/**
+ * Writes the lowercase hex representation of the given hash into `out` (2 * hashSize bytes, no terminator).
+ */
+static void ZDCMerkleHexEncode(const uint8_t *hash, size_t hashSize, char *out)
+{
+	for (size_t i = 0; i < hashSize; i++)
+	{
+		out[(i * 2)    ] = ZDCMerkleHexDigits[hash[i] >> 4];
+		out[(i * 2) + 1] = ZDCMerkleHexDigits[hash[i] & 0x0F];
+	}
+}
+
+static NSString* ZDCMerkleHexString(const uint8_t *hash, size_t hashSize)
+{
+	char hex[ZDC_MERKLE_MAX_HASH_SIZE * 2];
+	ZDCMerkleHexEncode(hash, hashSize, hex);
+	
+	return [[NSString alloc] initWithBytes:hex length:(hashSize * 2) encoding:NSASCIIStringEncoding];
+}
+
+/**
+ * Parses a (lowercase) hex string, as found in the merkle section of the file.
+ */
+static BOOL ZDCMerkleParseHex(NSString *str, size_t hashSize, uint8_t *out)
+{
+	if (![str isKindOfClass:[NSString class]]) return NO;
+	
+	const char *hex = [str UTF8String];
+	if (hex == NULL || strlen(hex) != (hashSize * 2)) return NO;
+	
+	for (size_t i = 0; i < (hashSize * 2); i++)
+	{
+		char c = hex[i];
+		uint8_t nibble;
+		
+		if (c >= '0' && c <= '9')
+			nibble = (uint8_t)(c - '0');
+		else if (c >= 'a' && c <= 'f')
+			nibble = (uint8_t)(c - 'a' + 10);
+		else
+			return NO;
+		
+		if ((i % 2) == 0)
+			out[i / 2] = (uint8_t)(nibble << 4);
+		else
+			out[i / 2] |= nibble;
+	}
+	
+	return YES;
+}
+
+/**
+ * leaf = hash(value)
+ */
+static BOOL ZDCMerkleHashLeaf(HASH_Algorithm hashAlgo, NSString *value, size_t hashSize, uint8_t *out)
+{
+	NSData *data = [value dataUsingEncoding:NSUTF8StringEncoding];
+	S4Err err = HASH_DO(hashAlgo, data.bytes, data.length, out, hashSize);
+	
+	return (err == kS4Err_NoErr);
+}
+
+/**
+ * node = hash(hex(left) + hex(right))
+ *
+ * The server hashes the concatenated (lowercase) hex strings, not the raw bytes.
+ * So we hex-encode into a stack buffer, which also means `out` may alias `left` or `right`.
+ */
+static BOOL ZDCMerkleHashPair(HASH_Algorithm hashAlgo,
+                              const uint8_t *left, const uint8_t *right, size_t hashSize, uint8_t *out)
+{
+	char hex[ZDC_MERKLE_MAX_HASH_SIZE * 4];
+	ZDCMerkleHexEncode(left,  hashSize, hex);
+	ZDCMerkleHexEncode(right, hashSize, hex + (hashSize * 2));
+	
+	S4Err err = HASH_DO(hashAlgo, hex, (hashSize * 4), out, hashSize);
+	
+	return (err == kS4Err_NoErr);
+}
+
 @implementation ZDCMerkleTree {
 	NSDictionary *file;
 }
@@ -177,94 +267,214 @@ done:
 	NSError *error = nil;
 	NSString *errMsg = nil;
 	
-	NSDictionary *merkle = file[@"merkle"];
-	NSString *hashName = merkle[@"hashalgo"];
+	NSArray<NSString *> *values = file[@"values"];
+	NSUInteger count = values.count;
 	
 	HASH_Algorithm hashAlgo = kHASH_Algorithm_Invalid;
-	NSArray<NSString *> *values = nil;
-	NSMutableArray<NSString *> *queue;
-	NSMutableArray<NSString *> *nextLevel;
+	size_t hashSize = 0;
+	uint8_t *hashes = NULL;
 	
-	if ([hashName isKindOfClass:[NSString class]])
+	if (![self getHashAlgorithm:&hashAlgo size:&hashSize])
+	{
+		errMsg = @"Unsupported hash algorithm";
+		goto done;
+	}
+	
+	if (count == 0)
 	{
-		if([hashName isEqualToString:@"sha256"])
+		errMsg = @"Invalid JSON: 'values' array is empty";
+		goto done;
+	}
+	
+	// All the hashes for a level of the tree are stored in a single buffer.
+	// Each level is computed in-place, since the pair at index (i, i+1) is always consumed
+	// before its parent is written to index (i/2).
+	
+	hashes = malloc(count * hashSize);
+	
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		if (!ZDCMerkleHashLeaf(hashAlgo, values[i], hashSize, hashes + (i * hashSize)))
 		{
-			hashAlgo = kHASH_Algorithm_SHA256;
+			errMsg = @"Error hashing value";
+			goto done;
 		}
-		else if ([hashName isEqualToString:@"sha512"])
+	}
+	
+	// When there's only 1 value, the root hash is simply the hash of the single item.
+	// When there's more than 1 value, we need to build the tree.
+	
+	while (count > 1)
+	{
+		NSUInteger nextCount = 0;
+		
+		for (NSUInteger i = 0; i < count; i += 2)
 		{
-			hashAlgo = kHASH_Algorithm_SHA512;
+			const uint8_t *left = hashes + (i * hashSize);
+	
+			// If there are an odd number of nodes (only one left),
+			// concatenate it with itself, and hash that.
+			const uint8_t *right = ((i + 1) < count) ? (left + hashSize) : left;
+			
+			if (!ZDCMerkleHashPair(hashAlgo, left, right, hashSize, hashes + (nextCount * hashSize)))
+			{
+				errMsg = @"Error hashing node";
+				goto done;
+			}
+			nextCount++;
 		}
+		
+		count = nextCount;
 	}
+	
+	{ // scoping
+		
+		NSString *calculatedRoot = ZDCMerkleHexString(hashes, hashSize);
+		NSString *reportedRoot = [self rootHash];
+		
+		if (![calculatedRoot isEqual:reportedRoot])
+		{
+			errMsg = [NSString stringWithFormat:
+				@"Calculated root (%@) doesn't match file root (%@)", calculatedRoot, reportedRoot];
+		}
+	}
+	
+done:
+	
+	if (hashes) {
+		free(hashes);
+	}
+	
+	if (errMsg)
+	{
+		error = [NSError errorWithClass:[self class] code:0 description:errMsg];
+	}
+	
+	if (outError) *outError = error;
+	return (error == nil);
+}
 
-	if (hashAlgo == kHASH_Algorithm_Invalid)
+/**
+ * See header file for description.
+ */
+- (BOOL)verifyProofForUserID:(NSString *)userID
+                      pubKey:(NSString **)outPubKey
+                       keyID:(NSString **)outKeyID
+                       error:(NSError **)outError
+{
+	NSError *error = nil;
+	NSString *errMsg = nil;
+	
+	NSString *pubKey = nil;
+	NSString *keyID = nil;
+	
+	NSDictionary *merkle = file[@"merkle"];
+	NSString *reportedRoot = [self rootHash];
+	NSString *value = nil;
+	
+	HASH_Algorithm hashAlgo = kHASH_Algorithm_Invalid;
+	size_t hashSize = 0;
+	
+	uint8_t hash[ZDC_MERKLE_MAX_HASH_SIZE];
+	uint8_t sibling[ZDC_MERKLE_MAX_HASH_SIZE];
+	
+	if (![self getHashAlgorithm:&hashAlgo size:&hashSize])
 	{
 		errMsg = @"Unsupported hash algorithm";
 		goto done;
 	}
 	
-	values = file[@"values"];
-	queue = [NSMutableArray arrayWithCapacity:values.count];
-	
-	for (NSString *value in values)
+	value = [self valueForUserID:userID];
+	if (value == nil)
 	{
-		NSData *hash = [value hashWithAlgorithm:hashAlgo error:&error];
-		if (error) goto done;
-
-		[queue addObject:[hash lowercaseHexString]];
+		errMsg = @"File doesn't contain an entry for the user";
+		goto done;
 	}
 	
-	nextLevel = [NSMutableArray arrayWithCapacity:queue.count];
+	if (![self getPubKey:&pubKey keyID:&keyID fromValue:value forUserID:userID])
+	{
+		errMsg = @"File entry for user is invalid";
+		goto done;
+	}
 	
-	if (queue.count == 1)
+	if (!ZDCMerkleHashLeaf(hashAlgo, value, hashSize, hash))
 	{
-		// When there's only 1 value, the root hash is simply the hash of the single item
+		errMsg = @"Error hashing value";
+		goto done;
 	}
-	else
+	
+	// Walk from the leaf up to the root.
+	//
+	// At each level, we only read the sibling hash from the file.
+	// The parent hash is always recalculated from our own hash, and is used as the key for the next lookup.
+	// So the path can only reach the root if every hash along it is correct.
+	//
+	// The number of iterations is bounded, in case the file contains a cycle.
+	
+	for (NSUInteger level = 0; level <= ZDC_MERKLE_MAX_LEVELS; level++)
 	{
-		// When there's more than 1 value, we need to build the tree
+		NSString *current = ZDCMerkleHexString(hash, hashSize);
 		
-		while (queue.count > 0)
+		if ([current isEqualToString:reportedRoot])
 		{
-			NSString *left = [queue firstObject];
-			[queue removeObjectAtIndex:0];
-	
-			NSString *right = [queue firstObject];
-			if (right) {
-				[queue removeObjectAtIndex:0];
-			} else {
-				// If there are an odd number of leaves (only one left),
-				// concatenate it with itself, and hash that.
-				right = left;
-			}
+			break;
+		}
 		
-			NSData *hash = [[left stringByAppendingString:right] hashWithAlgorithm:hashAlgo error:&error];
-			if (error) goto done;
-			
-			[nextLevel addObject:[hash lowercaseHexString]];
+		if (level == ZDC_MERKLE_MAX_LEVELS)
+		{
+			errMsg = @"Proof exceeds maximum tree depth";
+			goto done;
+		}
 		
-			// Maybe go to the next level of the tree.
-			//
-			if ((queue.count == 0) && (nextLevel.count >= 2))
-			{
-				NSMutableArray *temp = queue;
-				[temp removeAllObjects];
+		NSDictionary *node = merkle[current];
+		NSDictionary *parent = nil;
 		
-				queue = nextLevel;
-				nextLevel = temp;
+		if ([node isKindOfClass:[NSDictionary class]])
+		{
+			NSString *parentHash = node[@"parent"];
+			if ([parentHash isKindOfClass:[NSString class]]) {
+				parent = merkle[parentHash];
 			}
 		}
-	}
-	
-	{ // scoping
 		
-		NSString *calculatedRoot = [nextLevel firstObject] ?: [queue firstObject];
-		NSString *reportedRoot = [self rootHash];
+		if (![parent isKindOfClass:[NSDictionary class]])
+		{
+			errMsg = [NSString stringWithFormat:@"File is missing node/parent for hash (%@)", current];
+			goto done;
+		}
 		
-		if (![calculatedRoot isEqual:reportedRoot])
+		NSString *left = parent[@"left"];
+		NSString *right = parent[@"right"];
+		
+		BOOL isLeft = [left isKindOfClass:[NSString class]] && [left isEqualToString:current];
+		BOOL isRight = [right isKindOfClass:[NSString class]] && [right isEqualToString:current];
+		
+		if (isLeft)
 		{
-			errMsg = [NSString stringWithFormat:
-				@"Calculated root (%@) doesn't match file root (%@)", calculatedRoot, reportedRoot];
+			if (!ZDCMerkleParseHex(right, hashSize, sibling)) {
+				errMsg = @"File contains invalid node hash";
+				goto done;
+			}
+			if (!ZDCMerkleHashPair(hashAlgo, hash, sibling, hashSize, hash)) {
+				errMsg = @"Error hashing node";
+				goto done;
+			}
+		}
+		else if (isRight)
+		{
+			if (!ZDCMerkleParseHex(left, hashSize, sibling)) {
+				errMsg = @"File contains invalid node hash";
+				goto done;
+			}
+			if (!ZDCMerkleHashPair(hashAlgo, sibling, hash, hashSize, hash)) {
+				errMsg = @"Error hashing node";
+				goto done;
+			}
+		}
+		else
+		{
+			errMsg = [NSString stringWithFormat:@"Parent node doesn't reference child hash (%@)", current];
+			goto done;
 		}
 	}
 	
@@ -273,9 +483,14 @@ done:
 	if (errMsg)
 	{
 		error = [NSError errorWithClass:[self class] code:0 description:errMsg];
+		pubKey = nil;
+		keyID = nil;
 	}
 	
+	if (outPubKey) *outPubKey = pubKey;
+	if (outKeyID) *outKeyID = keyID;
 	if (outError) *outError = error;
+	
 	return (error == nil);
 }
 
@@ -315,43 +530,97 @@ done:
  */
 - (BOOL)getPubKey:(NSString **)outPubKey
             keyID:(NSString **)outKeyID
+        forUserID:(NSString *)userID
+{
+	NSString *value = [self valueForUserID:userID];
+	if (value == nil)
+	{
+		if (outPubKey) *outPubKey = nil;
+		if (outKeyID) *outKeyID = nil;
+		return NO;
+	}
+	
+	return [self getPubKey:outPubKey keyID:outKeyID fromValue:value forUserID:userID];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Utilities
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (BOOL)getHashAlgorithm:(HASH_Algorithm *)outHashAlgo size:(size_t *)outHashSize
+{
+	NSDictionary *merkle = file[@"merkle"];
+	NSString *hashName = merkle[@"hashalgo"];
+	
+	HASH_Algorithm hashAlgo = kHASH_Algorithm_Invalid;
+	size_t hashSize = 0;
+	
+	if ([hashName isKindOfClass:[NSString class]])
+	{
+		if ([hashName isEqualToString:@"sha256"])
+		{
+			hashAlgo = kHASH_Algorithm_SHA256;
+			hashSize = 256 / 8;
+		}
+		else if ([hashName isEqualToString:@"sha512"])
+		{
+			hashAlgo = kHASH_Algorithm_SHA512;
+			hashSize = 512 / 8;
+		}
+	}
+	
+	*outHashAlgo = hashAlgo;
+	*outHashSize = hashSize;
+	
+	return (hashAlgo != kHASH_Algorithm_Invalid);
+}
+
+- (nullable NSString *)valueForUserID:(NSString *)userID
+{
+	NSDictionary *lookup = file[@"lookup"];
+	NSNumber *idxNum = lookup[userID];
+	
+	if (idxNum == nil) {
+		return nil;
+	}
+	
+	NSUInteger idx = [idxNum unsignedIntegerValue];
+	NSArray<NSString *> *values = file[@"values"];
+	
+	if (idx < values.count) {
+		return values[idx];
+	} else {
+		return nil;
+	}
+}
+
+- (BOOL)getPubKey:(NSString **)outPubKey
+            keyID:(NSString **)outKeyID
+        fromValue:(NSString *)jsonStr
         forUserID:(NSString *)inUserID
 {
 	NSString *pubKey = nil;
 	NSString *keyID = nil;
 	
-	NSDictionary *lookup = file[@"lookup"];
-	NSNumber *idxNum = lookup[inUserID];
+	NSData *jsonData = [jsonStr dataUsingEncoding:NSUTF8StringEncoding];
 	
-	if (idxNum != nil)
+	id jsonDict = [NSJSONSerialization JSONObjectWithData:jsonData options:0 error:nil];
+	if ([jsonDict isKindOfClass:[NSDictionary class]])
 	{
-		NSUInteger idx = [idxNum unsignedIntegerValue];
-		NSArray<NSString *> *values = file[@"values"];
+		NSString *userID = jsonDict[@"userID"];
 		
-		if (idx < values.count)
+		if ([userID isEqual:inUserID])
 		{
-			NSString *jsonStr = values[idx];
-			NSData *jsonData = [jsonStr dataUsingEncoding:NSUTF8StringEncoding];
+			id value;
 			
-			id jsonDict = [NSJSONSerialization JSONObjectWithData:jsonData options:0 error:nil];
-			if ([jsonDict isKindOfClass:[NSDictionary class]])
-			{
-				NSString *userID = jsonDict[@"userID"];
+			value = jsonDict[@"pubKey"];
+			if ([value isKindOfClass:[NSString class]]) {
+				pubKey = (NSString *)value;
+			}
 				
-				if ([userID isEqual:inUserID])
-				{
-					id value;
-					
-					value = jsonDict[@"pubKey"];
-					if ([value isKindOfClass:[NSString class]]) {
-						pubKey = (NSString *)value;
-					}
-					
-					value = jsonDict[@"keyID"];
-					if ([value isKindOfClass:[NSString class]]) {
-						keyID = (NSString *)value;
-					}
-				}
+			value = jsonDict[@"keyID"];
+			if ([value isKindOfClass:[NSString class]]) {
+				keyID = (NSString *)value;
 			}
 		}
 	}
@@ -47,6 +47,8 @@ NS_ASSUME_NONNULL_BEGIN
 // YapDatabase collection constants
 //
 
+/** Name of collection in YapDatabase. All ZeroDark collection constants start with "ZDC" */
+extern NSString *const kZDCCollection_BlockchainProofs;
 /** Name of collection in YapDatabase. All ZeroDark collection constants start with "ZDC" */
 extern NSString *const kZDCCollection_CachedResponse;
 /** Name of collection in YapDatabase. All ZeroDark collection constants start with "ZDC" */
@@ -54,6 +56,10 @@ extern NSString *const kZDCCollection_CloudNodes;
 /** Name of collection in YapDatabase. All ZeroDark collection constants start with "ZDC" */
 extern NSString *const kZDCCollection_Nodes;
 /** Name of collection in YapDatabase. All ZeroDark collection constants start with "ZDC" */
+extern NSString *const kZDCCollection_NodeMeta;
+/** Name of collection in YapDatabase. All ZeroDark collection constants start with "ZDC" */
+extern NSString *const kZDCCollection_NodeStats;
+/** Name of collection in YapDatabase. All ZeroDark collection constants start with "ZDC" */
 extern NSString *const kZDCCollection_Prefs;
 /** Name of collection in YapDatabase. All ZeroDark collection constants start with "ZDC" */
 extern NSString *const kZDCCollection_PublicKeys;
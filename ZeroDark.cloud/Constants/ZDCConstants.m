@@ -11,9 +11,12 @@
 
 // YapDatabase collection constants
 
+/* extern */ NSString *const kZDCCollection_BlockchainProofs = @"ZDCBlockchainProofs";
 /* extern */ NSString *const kZDCCollection_CachedResponse  = @"ZDCCachedResponse";
 /* extern */ NSString *const kZDCCollection_CloudNodes      = @"ZDCCloudNodes";
 /* extern */ NSString *const kZDCCollection_Nodes           = @"ZDCNodes";
+/* extern */ NSString *const kZDCCollection_NodeMeta        = @"ZDCNodeMeta";
+/* extern */ NSString *const kZDCCollection_NodeStats       = @"ZDCNodeStats";
 /* extern */ NSString *const kZDCCollection_Prefs           = @"ZDCPrefs";
 /* extern */ NSString *const kZDCCollection_PublicKeys      = @"ZDCPublicKeys";
 /* extern */ NSString *const kZDCCollection_PullState       = @"ZDCSyncState";
@@ -13,6 +13,7 @@
 #import "Auth0ProviderManager.h"
 #import "ZDCBlockchainManager.h"
 #import "AWSCredentialsManager.h"
+#import "ZDCCloudHeaderCache.h"
 #import "ZDCCryptoTools.h"
 #import "ZDCInternalPreferences.h"
 #import "ZDCNetworkTools.h"
@@ -27,6 +28,7 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, readonly) Auth0APIManager * auth0APIManager;
 
 @property (nonatomic, readonly, nullable) AWSCredentialsManager      * awsCredentialsManager;
+@property (nonatomic, readonly, nullable) ZDCCloudHeaderCache        * cloudHeaderCache;
 @property (nonatomic, readonly, nullable) ZDCSessionManager          * sessionManager;
 @property (nonatomic, readonly, nullable) ZDCNetworkTools            * networkTools;
 @property (nonatomic, readonly, nullable) Auth0ProviderManager       * auth0ProviderManager;
@@ -0,0 +1,96 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Tracing levels.
+ *
+ * The level is decided at compile time (via ZDC_TRACE_LEVEL).
+ * Trace points above the compiled level are removed entirely by the compiler,
+ * including the evaluation of their parameters.
+ */
+#define ZDC_TRACE_LEVEL_OFF     0
+#define ZDC_TRACE_LEVEL_COARSE  1 // Major phases: network requests, database commits, entire pulls
+#define ZDC_TRACE_LEVEL_FINE    2 // Sub-phases: preparation, encryption, individual change items
+
+#ifndef ZDC_TRACE_LEVEL
+  #if DEBUG
+    #define ZDC_TRACE_LEVEL ZDC_TRACE_LEVEL_COARSE
+  #else
+    #define ZDC_TRACE_LEVEL ZDC_TRACE_LEVEL_OFF
+  #endif
+#endif
+
+/**
+ * Records a single trace event into the ring buffer.
+ *
+ * This is lock-free & allocation-free, and safe to call from any thread.
+ * You generally want to use the macros below instead of calling this function directly.
+ *
+ * @param phase
+ *   The Chrome trace event phase: 'b' (begin), 'e' (end), or 'n' (instant).
+ *
+ * @param category
+ *   Must be a string literal (or otherwise never deallocated). E.g. "push"
+ *
+ * @param name
+ *   Must be a string literal (or otherwise never deallocated). E.g. "put"
+ *
+ * @param traceID
+ *   The correlation ID, which ties together all the spans for a single operation.
+ *   Use ZDCTraceIDForUUID() or ZDCTraceIDForString().
+ */
+extern void ZDCTraceRecord(char phase, const char *category, const char *name, uint64_t traceID);
+
+/** Returns a correlation ID for the given uuid. E.g. ZDCCloudOperation.uuid */
+extern uint64_t ZDCTraceIDForUUID(NSUUID *_Nullable uuid);
+
+/** Returns a correlation ID for the given string. E.g. ZDCPullState.pullID */
+extern uint64_t ZDCTraceIDForString(NSString *_Nullable string);
+
+#define ZDC_TRACE_MAYBE(lvl, ph, cat, nm, tid) \
+        do { if ((lvl) <= ZDC_TRACE_LEVEL) ZDCTraceRecord((ph), (cat), (nm), (tid)); } while(0)
+
+/**
+ * Spans are asynchronous: they may begin & end on different threads.
+ * A span is identified by its (category, name, traceID) tuple.
+ */
+#define ZDCTraceBegin(lvl, cat, nm, tid)   ZDC_TRACE_MAYBE(lvl, 'b', cat, nm, tid)
+#define ZDCTraceEnd(lvl, cat, nm, tid)     ZDC_TRACE_MAYBE(lvl, 'e', cat, nm, tid)
+#define ZDCTraceInstant(lvl, cat, nm, tid) ZDC_TRACE_MAYBE(lvl, 'n', cat, nm, tid)
+
+/**
+ * Provides access to the recorded trace events.
+ *
+ * Events are stored in a fixed-size ring buffer, so only the most recent events are available.
+ * The dump is in the Chrome trace event format, which can be opened in chrome://tracing or ui.perfetto.dev.
+ */
+@interface ZDCTracing : NSObject
+
+/**
+ * Returns YES if tracing was compiled in (ZDC_TRACE_LEVEL > ZDC_TRACE_LEVEL_OFF).
+ */
++ (BOOL)isEnabled;
+
+/**
+ * Returns the recorded events as JSON, in the Chrome trace event format.
+ */
++ (NSData *)chromeTraceData;
+
+/**
+ * Writes the recorded events to the given file, in the Chrome trace event format.
+ */
++ (BOOL)writeChromeTraceToURL:(NSURL *)url error:(NSError *_Nullable *_Nullable)errPtr;
+
+@end
+
+NS_ASSUME_NONNULL_END
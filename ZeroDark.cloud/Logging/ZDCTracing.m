@@ -0,0 +1,190 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCTracing.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Must be a power of 2.
+ */
+#define ZDC_TRACE_BUFFER_SIZE (1 << 14)
+
+typedef struct {
+	
+	// Sequence number of the event stored in this slot (plus one).
+	// Zero means the slot is being written.
+	_Atomic(uint64_t) seq;
+	
+	uint64_t timestamp; // nanoseconds, monotonic
+	uint64_t traceID;
+	uint64_t threadID;
+	
+	const char *category;
+	const char *name;
+	
+	char phase;
+	
+} ZDCTraceEvent;
+
+static ZDCTraceEvent trace_buffer[ZDC_TRACE_BUFFER_SIZE];
+static _Atomic(uint64_t) trace_nextIndex = 0;
+
+/**
+ * See header file for description.
+ */
+void ZDCTraceRecord(char phase, const char *category, const char *name, uint64_t traceID)
+{
+	uint64_t idx = atomic_fetch_add_explicit(&trace_nextIndex, 1, memory_order_relaxed);
+	ZDCTraceEvent *event = &trace_buffer[idx & (ZDC_TRACE_BUFFER_SIZE - 1)];
+	
+	// Seqlock style:
+	// - mark the slot as being written
+	// - write the fields
+	// - publish the slot with the new sequence number
+	//
+	// A reader that sees the same (non-zero) sequence number before & after copying the fields
+	// knows it got a consistent snapshot.
+	
+	atomic_store_explicit(&event->seq, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	
+	uint64_t threadID = 0;
+	pthread_threadid_np(NULL, &threadID);
+	
+	event->timestamp = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+	event->traceID = traceID;
+	event->threadID = threadID;
+	event->category = category;
+	event->name = name;
+	event->phase = phase;
+	
+	atomic_store_explicit(&event->seq, idx + 1, memory_order_release);
+}
+
+/**
+ * See header file for description.
+ */
+uint64_t ZDCTraceIDForUUID(NSUUID *uuid)
+{
+	if (uuid == nil) return 0;
+	
+	uuid_t bytes;
+	[uuid getUUIDBytes:bytes];
+	
+	uint64_t hi = 0;
+	uint64_t lo = 0;
+	memcpy(&hi, bytes, sizeof(hi));
+	memcpy(&lo, bytes + sizeof(hi), sizeof(lo));
+	
+	return (hi ^ lo);
+}
+
+/**
+ * See header file for description.
+ */
+uint64_t ZDCTraceIDForString(NSString *string)
+{
+	if (string == nil) return 0;
+	
+	// FNV-1a (64-bit)
+	
+	uint64_t hash = 14695981039346656037ULL;
+	
+	const char *str = [string UTF8String];
+	for (const char *c = str; *c; c++)
+	{
+		hash ^= (uint8_t)*c;
+		hash *= 1099511628211ULL;
+	}
+	
+	return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCTracing
+
++ (BOOL)isEnabled
+{
+	return (ZDC_TRACE_LEVEL > ZDC_TRACE_LEVEL_OFF);
+}
+
+/**
+ * See header file for description.
+ */
++ (NSData *)chromeTraceData
+{
+	uint64_t endIdx = atomic_load_explicit(&trace_nextIndex, memory_order_acquire);
+	uint64_t startIdx = (endIdx > ZDC_TRACE_BUFFER_SIZE) ? (endIdx - ZDC_TRACE_BUFFER_SIZE) : 0;
+	
+	NSNumber *pid = @(getpid());
+	NSMutableArray<NSDictionary*> *traceEvents = [NSMutableArray arrayWithCapacity:(NSUInteger)(endIdx - startIdx)];
+	
+	for (uint64_t idx = startIdx; idx < endIdx; idx++)
+	{
+		ZDCTraceEvent *slot = &trace_buffer[idx & (ZDC_TRACE_BUFFER_SIZE - 1)];
+		
+		uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		if (seq != (idx + 1))
+		{
+			continue; // being written, or already overwritten
+		}
+		
+		ZDCTraceEvent event;
+		event.timestamp = slot->timestamp;
+		event.traceID   = slot->traceID;
+		event.threadID  = slot->threadID;
+		event.category  = slot->category;
+		event.name      = slot->name;
+		event.phase     = slot->phase;
+		
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq)
+		{
+			continue; // overwritten while we were copying it
+		}
+		
+		// Chrome trace timestamps are in microseconds
+		
+		[traceEvents addObject:@{
+			@"name" : @(event.name ?: ""),
+			@"cat"  : @(event.category ?: ""),
+			@"ph"   : [NSString stringWithFormat:@"%c", event.phase],
+			@"ts"   : @((double)event.timestamp / 1000.0),
+			@"pid"  : pid,
+			@"tid"  : @(event.threadID),
+			@"id"   : [NSString stringWithFormat:@"0x%016llx", (unsigned long long)event.traceID]
+		}];
+	}
+	
+	NSDictionary *json = @{
+		@"traceEvents"     : traceEvents,
+		@"displayTimeUnit" : @"ms"
+	};
+	
+	return [NSJSONSerialization dataWithJSONObject:json options:0 error:nil] ?: [NSData data];
+}
+
+/**
+ * See header file for description.
+ */
++ (BOOL)writeChromeTraceToURL:(NSURL *)url error:(NSError **)errPtr
+{
+	NSData *data = [self chromeTraceData];
+	
+	return [data writeToURL:url options:NSDataWritingAtomic error:errPtr];
+}
+
+@end
@@ -24,6 +24,37 @@ typedef NS_ENUM(NSInteger, AWSCredentialsErrorCode) {
 	AWSCredentialsErrorCode_InvalidServerResponse
 };
 
+/**
+ * A snapshot of the credential refresh counters.
+ */
+@interface AWSCredentialsManagerMetrics : NSObject
+
+/** The number of times credentials were fetched from the server (includes failed attempts). */
+@property (nonatomic, assign, readonly) uint64_t refreshCount;
+
+/** The number of refreshes that were performed proactively (before the credentials expired). */
+@property (nonatomic, assign, readonly) uint64_t proactiveRefreshCount;
+
+/** The number of refreshes that failed. */
+@property (nonatomic, assign, readonly) uint64_t failedRefreshCount;
+
+/**
+ * The number of times a caller (e.g. the push or pull manager) had to wait for a refresh,
+ * because the cached credentials had already expired.
+ */
+@property (nonatomic, assign, readonly) uint64_t stallCount;
+
+/** The duration of the most recent refresh (in seconds). */
+@property (nonatomic, assign, readonly) NSTimeInterval lastRefreshLatency;
+
+/** The average duration of a refresh (in seconds). */
+@property (nonatomic, assign, readonly) NSTimeInterval averageRefreshLatency;
+
+/** The longest duration of a refresh (in seconds). */
+@property (nonatomic, assign, readonly) NSTimeInterval maxRefreshLatency;
+
+@end
+
 /**
  * Most of the ZeroDark REST API's require valid AWS credentials.
  *
@@ -33,7 +64,11 @@ typedef NS_ENUM(NSInteger, AWSCredentialsErrorCode) {
  * The temporary credentials are only valid for a short period of time (a few hours).
  *
  * This manager is responsible for caching these temporary credentials,
- * and automatically refreshing them on demand.
+ * and automatically refreshing them.
+ *
+ * Credentials are refreshed in the background a few minutes before they expire,
+ * so that callers don't have to wait on the network for them.
+ * All refreshes for a given user are single-flight: concurrent callers share the same in-flight refresh.
  */
 @interface AWSCredentialsManager : NSObject
 
@@ -93,6 +128,15 @@ typedef NS_ENUM(NSInteger, AWSCredentialsErrorCode) {
                        completionQueue:(nullable dispatch_queue_t)completionQueue
                        completionBlock:(void (^)(NSDictionary *_Nullable delegation, NSError *_Nullable error))completionBlock;
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Metrics
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns a snapshot of the refresh counters (latency, stalls, etc).
+ */
+- (AWSCredentialsManagerMetrics *)metrics;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Utilities
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -8,6 +8,7 @@
 #import "ZDCAsyncCompletionDispatch.h"
 #import "ZDCLocalUser.h"
 #import "ZDCLocalUserAuth.h"
+#import "ZDCLogging.h"
 #import "ZeroDarkCloudPrivate.h"
 
 // Categories
@@ -15,12 +16,89 @@
 #import "NSError+Auth0API.h"
 #import "NSError+ZeroDark.h"
 
+// Log Levels: off, error, warning, info, verbose
+// Log Flags : trace
+#if DEBUG
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#else
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#endif
+#pragma unused(zdcLogLevel)
+
+/**
+ * Credentials are considered expired if they expire within this amount of time.
+ * (This gives the request time to reach the server before the credentials actually expire.)
+ */
+#define EXPIRATION_BUFFER 30.0 // seconds
+
+/**
+ * The credentials are refreshed in the background this long before they expire.
+ * The temporary credentials are typically valid for an hour,
+ * so this is long enough to ride out a slow network, without refreshing too often.
+ */
+#define PROACTIVE_REFRESH_LEAD 300.0 // seconds
+
+/**
+ * If a proactive refresh fails (e.g. no network), we'll try again after this delay
+ * (assuming the credentials haven't expired by then).
+ */
+#define PROACTIVE_REFRESH_RETRY 30.0 // seconds
+
+/**
+ * Proactive refreshes are only performed for users whose credentials were requested within this amount of time.
+ * Otherwise an idle app would keep refreshing (hitting the server once per hour, per user) forever.
+ *
+ * If the credentials go unused, we stop refreshing them.
+ * And the next request simply waits for an on-demand refresh.
+ */
+#define PROACTIVE_REFRESH_IDLE_TIMEOUT 600.0 // seconds
+
+@interface AWSCredentialsManagerMetrics ()
+
+@property (nonatomic, assign, readwrite) uint64_t refreshCount;
+@property (nonatomic, assign, readwrite) uint64_t proactiveRefreshCount;
+@property (nonatomic, assign, readwrite) uint64_t failedRefreshCount;
+@property (nonatomic, assign, readwrite) uint64_t stallCount;
+@property (nonatomic, assign, readwrite) NSTimeInterval lastRefreshLatency;
+@property (nonatomic, assign, readwrite) NSTimeInterval averageRefreshLatency;
+@property (nonatomic, assign, readwrite) NSTimeInterval maxRefreshLatency;
+
+@end
+
+@implementation AWSCredentialsManagerMetrics
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:
+	  @"<AWSCredentialsManagerMetrics: refreshes=%llu (proactive=%llu, failed=%llu) stalls=%llu"
+	  @" latency: last=%.3f avg=%.3f max=%.3f>",
+	  self.refreshCount, self.proactiveRefreshCount, self.failedRefreshCount, self.stallCount,
+	  self.lastRefreshLatency, self.averageRefreshLatency, self.maxRefreshLatency];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 @implementation AWSCredentialsManager
 {
 	__weak ZeroDarkCloud *zdc;
 	
 	ZDCAsyncCompletionDispatch *pendingRequests;
+	
+	dispatch_queue_t refreshQueue;
+	NSMutableDictionary<NSString *, NSDate *> *scheduledRefreshes; // must be accessed from within refreshQueue
+	NSMutableDictionary<NSString *, NSDate *> *lastRequestDates;   // must be accessed from within refreshQueue
+	
+	uint64_t refreshCount;                  // must be accessed from within refreshQueue
+	uint64_t proactiveRefreshCount;         // must be accessed from within refreshQueue
+	uint64_t failedRefreshCount;            // must be accessed from within refreshQueue
+	uint64_t stallCount;                    // must be accessed from within refreshQueue
+	NSTimeInterval lastRefreshLatency;      // must be accessed from within refreshQueue
+	NSTimeInterval totalRefreshLatency;     // must be accessed from within refreshQueue
+	NSTimeInterval maxRefreshLatency;       // must be accessed from within refreshQueue
 }
 
 - (instancetype)init
@@ -34,6 +112,10 @@
 	{
 		zdc = inOwner;
 		pendingRequests = [[ZDCAsyncCompletionDispatch alloc] init];
+		
+		refreshQueue = dispatch_queue_create("AWSCredentialsManager.refresh", DISPATCH_QUEUE_SERIAL);
+		scheduledRefreshes = [[NSMutableDictionary alloc] init];
+		lastRequestDates = [[NSMutableDictionary alloc] init];
 	}
 	return self;
 }
@@ -64,6 +146,14 @@
 		return;
 	}
 	
+	// Remember the credentials are in use, so they'll be refreshed proactively.
+	//
+	NSDate *now = [NSDate date];
+	dispatch_async(refreshQueue, ^{
+		
+		self->lastRequestDates[userID] = now;
+	});
+	
 	NSString *requestKey = [NSString stringWithFormat:@"%@-%@", NSStringFromSelector(_cmd), userID];
 	
 	NSUInteger requestCount =
@@ -150,108 +240,93 @@
 		__strong typeof(self) strongSelf = weakSelf;
 		if (!strongSelf) return;
 		
-		// Sanity check: localUser is configured
-		if (!localUser || ![localUser hasCompletedActivation])
-		{
-			Fail([strongSelf missingInvalidUserError:@"The localUser has completed activation."]);
+		if (![strongSelf sanityCheckLocalUser:localUser auth:auth userID:userID failure:Fail]) {
 			return;
 		}
 		
-		// Sanity check: localUserAuth is non-nil
-		if (!auth || ![auth isKindOfClass:[ZDCLocalUserAuth class]])
-		{
-			Fail([strongSelf missingInvalidUserError:@"No matching ZDCLocalUserAuth for userID."]);
-			return;
-		}
-
-		// Sanity check: localUserAuth has non-nil refresh_token
-		if (!auth.auth0_refreshToken)
-		{
-			NSError *noRefreshTokensError = [strongSelf noRefreshTokensError];
-			
-			if (!localUser.accountNeedsA0Token)
-			{
-				[strongSelf setNeedsRefreshTokenForUser: userID
-				                        completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
-				                        completionBlock:^
-				{
-					Fail(noRefreshTokensError);
-				}];
-			}
-			else
-			{
-				Fail(noRefreshTokensError);
-			}
-			
-			return;
-		}
-
-		NSDate *nowPlusBuffer = [[NSDate date] dateByAddingTimeInterval:30.0];
+		NSDate *nowPlusBuffer = [[NSDate date] dateByAddingTimeInterval:EXPIRATION_BUFFER];
 		
 		// Check for unexpired credentials
 		//
 		if (auth.aws_expiration && [auth.aws_expiration isAfter:nowPlusBuffer])
 		{
 			Succeed(auth);
+			
+			// Make sure we refresh the credentials before they expire,
+			// so the next request doesn't have to wait for them.
+			//
+			[strongSelf scheduleProactiveRefreshForUserID:userID expiration:auth.aws_expiration];
 			return;
 		}
 		
-		BOOL needsRefreshIDToken = YES;
-		
-		// Check for unexpired idToken
+		// The caller has to wait for the credentials to be refreshed.
+		// This is what the proactive refresh is designed to prevent.
 		//
-		if (auth.auth0_idToken)
-		{
-			NSDate *expiration = [JWTUtilities expireDateFromJWTString:auth.auth0_idToken error:nil];
-			if (expiration && [expiration isAfter:nowPlusBuffer])
-			{
-				needsRefreshIDToken = NO;
-			}
-		}
+		dispatch_async(strongSelf->refreshQueue, ^{
 		
-		dispatch_queue_t backgroundQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+			strongSelf->stallCount++;
+		});
 		
-		if (needsRefreshIDToken)
+		[strongSelf refreshCredentialsForUserID: userID
+		                            isProactive: NO
+		                        completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
+		                        completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
 		{
-			[strongSelf refreshIDTokenForUserID: userID
-			                   withRefreshToken: auth.auth0_refreshToken
-			                    completionQueue: backgroundQueue
-			                    completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
+			if (error)
+				Fail(error);
+			else
+				Succeed(auth);
+		}];
+	}];
+}
+
+/**
+ * Performs the sanity checks required before the user's credentials can be used (or refreshed).
+ *
+ * If a check fails, the failure block is invoked (possibly asynchronously), and NO is returned.
+ */
+- (BOOL)sanityCheckLocalUser:(ZDCLocalUser *)localUser
+                        auth:(ZDCLocalUserAuth *)auth
+                      userID:(NSString *)userID
+                     failure:(void (^)(NSError *error))Fail
+{
+	// Sanity check: localUser is configured
+	if (!localUser || ![localUser hasCompletedActivation])
+	{
+		Fail([self missingInvalidUserError:@"The localUser has completed activation."]);
+		return NO;
+	}
+	
+	// Sanity check: localUserAuth is non-nil
+	if (!auth || ![auth isKindOfClass:[ZDCLocalUserAuth class]])
+	{
+		Fail([self missingInvalidUserError:@"No matching ZDCLocalUserAuth for userID."]);
+		return NO;
+	}
+	
+	// Sanity check: localUserAuth has non-nil refresh_token
+	if (!auth.auth0_refreshToken)
+	{
+		NSError *noRefreshTokensError = [self noRefreshTokensError];
+		
+		if (!localUser.accountNeedsA0Token)
+		{
+			[self setNeedsRefreshTokenForUser: userID
+			                  completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
+			                  completionBlock:^
 			{
-				if (error)
-				{
-					Fail(error);
-					return;
-				}
-				
-				[weakSelf refreshAWSCredentialsForUserID: userID
-				                                 idToken: auth.auth0_idToken
-				                                   stage: localUser.aws_stage
-				                         completionQueue: backgroundQueue
-				                         completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
-				{
-					if (error)
-						Fail(error);
-					else
-						Succeed(auth);
-				}];
+				Fail(noRefreshTokensError);
 			}];
 		}
 		else
 		{
-			[strongSelf refreshAWSCredentialsForUserID: userID
-			                                   idToken: auth.auth0_idToken
-			                                     stage: localUser.aws_stage
-			                           completionQueue: backgroundQueue
-			                           completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
-			{
-				if (error)
-					Fail(error);
-				else
-					Succeed(auth);
-			}];
+			Fail(noRefreshTokensError);
 		}
-	}];
+		
+		return NO;
+	}
+	
+	return YES;
 }
 
 /**
@@ -262,6 +337,8 @@
                    completionQueue:(dispatch_queue_t)completionQueue
                    completionBlock:(dispatch_block_t)completionBlock
 {
+	[self cancelProactiveRefreshForUserID:userID];
+	
 	ZDCDatabaseManager *databaseManager = zdc.databaseManager;
 	[databaseManager.rwDatabaseConnection asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 
@@ -348,6 +425,334 @@
 #pragma mark Refresh
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Refreshes the user's credentials (idToken, if needed, followed by the AWS credentials).
+ *
+ * This is single-flight: if a refresh for the user is already in-flight (whether it was started on-demand,
+ * or proactively), then the <completionQueue, completionBlock> is simply added to the existing refresh.
+ *
+ * If `isProactive` is YES, and the credentials aren't close to expiring (e.g. because they were already
+ * refreshed by somebody else), then the existing credentials are returned without hitting the network.
+ */
+- (void)refreshCredentialsForUserID:(NSString *)userID
+                        isProactive:(BOOL)isProactive
+                    completionQueue:(dispatch_queue_t)completionQueue
+                    completionBlock:(void (^)(ZDCLocalUserAuth *auth, NSError *error))completionBlock
+{
+	NSParameterAssert(userID != nil);
+	NSParameterAssert(completionBlock != nil);
+	
+	NSString *requestKey = [NSString stringWithFormat:@"%@-%@", NSStringFromSelector(_cmd), userID];
+	
+	NSUInteger requestCount =
+	  [pendingRequests pushCompletionQueue: completionQueue
+	                       completionBlock: completionBlock
+	                                forKey: requestKey];
+	
+	if (requestCount > 1)
+	{
+		// There's a previous refresh currently in-flight.
+		// The <completionQueue, completionBlock> have been added to the existing request's list.
+		return;
+	}
+	
+	[self refreshCredentialsForUserID:userID isProactive:isProactive requestKey:requestKey];
+}
+
+- (void)refreshCredentialsForUserID:(NSString *)userID
+                        isProactive:(BOOL)isProactive
+                         requestKey:(NSString *)requestKey
+{
+	__weak typeof(self) weakSelf = self;
+	
+	__block CFAbsoluteTime startTime = 0;
+	__block NSDate *previousExpiration = nil;
+	
+	void (^InvokeCompletionBlocks)(ZDCLocalUserAuth*, NSError*) = ^(ZDCLocalUserAuth *auth, NSError *error){
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (!strongSelf) return;
+		
+		if (startTime > 0)
+		{
+			// We actually hit the network
+			
+			NSTimeInterval latency = CFAbsoluteTimeGetCurrent() - startTime;
+			[strongSelf recordRefreshWithLatency:latency isProactive:isProactive success:(error == nil)];
+		}
+		
+		// Note: These only get scheduled if the credentials are still in use.
+		// So an idle app stops refreshing after PROACTIVE_REFRESH_IDLE_TIMEOUT.
+		
+		if (auth.aws_expiration)
+		{
+			[strongSelf scheduleProactiveRefreshForUserID:userID expiration:auth.aws_expiration];
+		}
+		else if (error && isProactive && ![error.domain isEqualToString:[NSError domainForClass:[strongSelf class]]])
+		{
+			// Probably a network error. So try again shortly (while the current credentials are still valid).
+			// Errors from our own sanity checks (e.g. missing refreshToken) won't be fixed by trying again.
+			
+			NSDate *retryDate = [NSDate dateWithTimeIntervalSinceNow:PROACTIVE_REFRESH_RETRY];
+			NSDate *lastRetryDate = [previousExpiration dateByAddingTimeInterval:-EXPIRATION_BUFFER];
+			
+			if (lastRetryDate && [retryDate isBefore:lastRetryDate])
+			{
+				[strongSelf scheduleProactiveRefreshForUserID:userID fireDate:retryDate];
+			}
+		}
+		
+		NSArray<dispatch_queue_t> * completionQueues = nil;
+		NSArray<id>               * completionBlocks = nil;
+		[strongSelf->pendingRequests popCompletionQueues: &completionQueues
+		                                completionBlocks: &completionBlocks
+		                                          forKey: requestKey];
+		
+		for (NSUInteger i = 0; i < completionBlocks.count; i++)
+		{
+			dispatch_queue_t completionQueue = completionQueues[i];
+			void (^completionBlock)(ZDCLocalUserAuth *auth, NSError *error) = completionBlocks[i];
+			
+			dispatch_async(completionQueue, ^{ @autoreleasepool {
+				
+				completionBlock(auth, error);
+			}});
+		}
+	};
+	
+	__block ZDCLocalUser *localUser = nil;
+	__block ZDCLocalUserAuth *auth = nil;
+	
+	ZDCDatabaseManager *databaseManager = zdc.databaseManager;
+	[databaseManager.roDatabaseConnection asyncReadWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		localUser = [transaction objectForKey:userID inCollection:kZDCCollection_Users];
+		auth = [transaction objectForKey:userID inCollection:kZDCCollection_UserAuth];
+		
+	} completionQueue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) completionBlock:^{
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (!strongSelf) return;
+		
+		void (^Fail)(NSError*) = ^(NSError *error) {
+			InvokeCompletionBlocks(nil, error);
+		};
+		
+		if (![strongSelf sanityCheckLocalUser:localUser auth:auth userID:userID failure:Fail]) {
+			return;
+		}
+		
+		previousExpiration = auth.aws_expiration;
+		
+		// If this is a proactive refresh, we refresh everything that expires within the lead time.
+		// Otherwise the idToken may expire shortly after we've used it to fetch the new AWS credentials.
+		
+		NSTimeInterval buffer = isProactive ? PROACTIVE_REFRESH_LEAD : EXPIRATION_BUFFER;
+		NSDate *nowPlusBuffer = [[NSDate date] dateByAddingTimeInterval:buffer];
+		
+		if (auth.aws_expiration && [auth.aws_expiration isAfter:nowPlusBuffer])
+		{
+			// The credentials were refreshed since the request was made.
+			InvokeCompletionBlocks(auth, nil);
+			return;
+		}
+		
+		ZDCLogVerbose(@"Refreshing AWS credentials for user: %@ (proactive: %@)", userID, (isProactive ? @"YES" : @"NO"));
+		
+		BOOL needsRefreshIDToken = YES;
+		
+		// Check for unexpired idToken
+		//
+		if (auth.auth0_idToken)
+		{
+			NSDate *expiration = [JWTUtilities expireDateFromJWTString:auth.auth0_idToken error:nil];
+			if (expiration && [expiration isAfter:nowPlusBuffer])
+			{
+				needsRefreshIDToken = NO;
+			}
+		}
+		
+		startTime = CFAbsoluteTimeGetCurrent();
+		dispatch_queue_t backgroundQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+		
+		if (needsRefreshIDToken)
+		{
+			[strongSelf refreshIDTokenForUserID: userID
+			                   withRefreshToken: auth.auth0_refreshToken
+			                    completionQueue: backgroundQueue
+			                    completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
+			{
+				if (error)
+				{
+					Fail(error);
+					return;
+				}
+				
+				[weakSelf refreshAWSCredentialsForUserID: userID
+				                                 idToken: auth.auth0_idToken
+				                                   stage: localUser.aws_stage
+				                         completionQueue: backgroundQueue
+				                         completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
+				{
+					InvokeCompletionBlocks(auth, error);
+				}];
+			}];
+		}
+		else
+		{
+			[strongSelf refreshAWSCredentialsForUserID: userID
+			                                   idToken: auth.auth0_idToken
+			                                     stage: localUser.aws_stage
+			                           completionQueue: backgroundQueue
+			                           completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
+			{
+				InvokeCompletionBlocks(auth, error);
+			}];
+		}
+	}];
+}
+
+/**
+ * Schedules a proactive refresh (PROACTIVE_REFRESH_LEAD seconds before the given expiration).
+ * If a refresh is already scheduled for the user, at the same time, this method does nothing.
+ *
+ * Nothing is scheduled unless the user's credentials were requested recently (see PROACTIVE_REFRESH_IDLE_TIMEOUT).
+ */
+- (void)scheduleProactiveRefreshForUserID:(NSString *)userID expiration:(NSDate *)expiration
+{
+	NSDate *fireDate = [expiration dateByAddingTimeInterval:-PROACTIVE_REFRESH_LEAD];
+	
+	[self scheduleProactiveRefreshForUserID:userID fireDate:fireDate];
+}
+
+- (void)scheduleProactiveRefreshForUserID:(NSString *)userID fireDate:(NSDate *)fireDate
+{
+	__weak typeof(self) weakSelf = self;
+	
+	dispatch_async(refreshQueue, ^{ @autoreleasepool {
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (!strongSelf) return;
+		
+		if (![strongSelf _isRecentlyUsed:userID]) {
+			return;
+		}
+		
+		NSDate *existing = strongSelf->scheduledRefreshes[userID];
+		if (existing && [existing isEqualToDate:fireDate]) {
+			return;
+		}
+		
+		strongSelf->scheduledRefreshes[userID] = fireDate;
+		
+		NSTimeInterval delay = MAX(0.0, [fireDate timeIntervalSinceNow]);
+		dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC));
+		
+		dispatch_after(when, strongSelf->refreshQueue, ^{ @autoreleasepool {
+			
+			__strong typeof(self) strongSelf = weakSelf;
+			if (!strongSelf) return;
+			
+			// Skip if the refresh was rescheduled (or cancelled) in the meantime.
+			if (![strongSelf->scheduledRefreshes[userID] isEqualToDate:fireDate]) {
+				return;
+			}
+			strongSelf->scheduledRefreshes[userID] = nil;
+			
+			// Skip if the credentials haven't been used in a while.
+			// The next request will trigger an on-demand refresh (and proactive refreshes will resume).
+			if (![strongSelf _isRecentlyUsed:userID])
+			{
+				ZDCLogVerbose(@"Skipping proactive refresh of AWS credentials (idle) for user: %@", userID);
+				return;
+			}
+			
+			[strongSelf refreshCredentialsForUserID: userID
+			                            isProactive: YES
+			                        completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
+			                        completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
+			{
+				if (error) {
+					ZDCLogInfo(@"Proactive refresh of AWS credentials failed: %@", error);
+				}
+			}];
+		}});
+	}});
+}
+
+/**
+ * Returns YES if the user's credentials were requested within the last PROACTIVE_REFRESH_IDLE_TIMEOUT seconds.
+ * Must be invoked on `refreshQueue`.
+ */
+- (BOOL)_isRecentlyUsed:(NSString *)userID
+{
+	NSDate *lastRequestDate = lastRequestDates[userID];
+	if (lastRequestDate == nil) {
+		return NO;
+	}
+	
+	return ([lastRequestDate timeIntervalSinceNow] > -PROACTIVE_REFRESH_IDLE_TIMEOUT);
+}
+
+- (void)cancelProactiveRefreshForUserID:(NSString *)userID
+{
+	__weak typeof(self) weakSelf = self;
+	
+	dispatch_async(refreshQueue, ^{
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (!strongSelf) return;
+		
+		strongSelf->scheduledRefreshes[userID] = nil;
+	});
+}
+
+- (void)recordRefreshWithLatency:(NSTimeInterval)latency isProactive:(BOOL)isProactive success:(BOOL)success
+{
+	__weak typeof(self) weakSelf = self;
+	
+	dispatch_async(refreshQueue, ^{
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (!strongSelf) return;
+		
+		strongSelf->refreshCount++;
+		
+		if (isProactive) {
+			strongSelf->proactiveRefreshCount++;
+		}
+		if (!success) {
+			strongSelf->failedRefreshCount++;
+		}
+		
+		strongSelf->lastRefreshLatency = latency;
+		strongSelf->totalRefreshLatency += latency;
+		strongSelf->maxRefreshLatency = MAX(strongSelf->maxRefreshLatency, latency);
+	});
+}
+
+/**
+ * See header file for description.
+ */
+- (AWSCredentialsManagerMetrics *)metrics
+{
+	AWSCredentialsManagerMetrics *metrics = [[AWSCredentialsManagerMetrics alloc] init];
+	
+	dispatch_sync(refreshQueue, ^{
+		
+		metrics.refreshCount = self->refreshCount;
+		metrics.proactiveRefreshCount = self->proactiveRefreshCount;
+		metrics.failedRefreshCount = self->failedRefreshCount;
+		metrics.stallCount = self->stallCount;
+		metrics.lastRefreshLatency = self->lastRefreshLatency;
+		metrics.averageRefreshLatency =
+		  (self->refreshCount > 0) ? (self->totalRefreshLatency / (double)self->refreshCount) : 0.0;
+		metrics.maxRefreshLatency = self->maxRefreshLatency;
+	});
+	
+	return metrics;
+}
+
 /**
  * Performs the following:
  *
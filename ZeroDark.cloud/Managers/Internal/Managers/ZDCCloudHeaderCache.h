@@ -0,0 +1,60 @@
+/**
+ * ZeroDark.cloud
+ * 
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+#import "ZDCCloudDataInfo.h"
+#import "ZDCNode.h"
+
+@class ZeroDarkCloud;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A shared cache of decrypted DATA file headers, keyed by eTag.
+ *
+ * The header tells us the size of each section in the cloud file (metadata, thumbnail & data),
+ * along with the thumbnail hash. Without it, we can't issue a range request for the metadata or thumbnail.
+ *
+ * Since the eTag identifies the exact (encrypted) bytes of the file,
+ * a header is valid for as long as the eTag matches, regardless of which node (or node copy) it's accessed through.
+ *
+ * The cache has 2 layers:
+ * - an in-memory cache (keyed by eTag)
+ * - the persistent `node.cloudDataInfo` (which is only valid if `node.eTag_data` matches)
+ *
+ * It's populated by the DownloadManager (whenever a header is downloaded & decrypted),
+ * and by the PushManager (whenever a DATA file is uploaded).
+ */
+@interface ZDCCloudHeaderCache : NSObject
+
+- (instancetype)initWithOwner:(ZeroDarkCloud *)owner;
+
+/**
+ * Returns the header for the node's current DATA file (i.e. matching `node.eTag_data`),
+ * or nil if the header isn't known.
+ */
+- (nullable ZDCCloudDataInfo *)headerForNode:(ZDCNode *)node;
+
+/**
+ * Returns the cached header for the given eTag (in-memory layer only).
+ */
+- (nullable ZDCCloudDataInfo *)headerForETag:(NSString *)eTag;
+
+/**
+ * Adds the header to the in-memory layer.
+ *
+ * The caller is responsible for updating `node.cloudDataInfo` (if appropriate),
+ * since that needs to happen within the caller's transaction.
+ */
+- (void)addHeader:(ZDCCloudDataInfo *)header;
+
+@end
+
+NS_ASSUME_NONNULL_END
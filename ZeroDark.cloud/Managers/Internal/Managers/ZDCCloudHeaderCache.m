@@ -0,0 +1,114 @@
+/**
+ * ZeroDark.cloud
+ * 
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCCloudHeaderCache.h"
+
+#import "ZeroDarkCloud.h"
+
+// Libraries
+#import <YapDatabase/YapCache.h>
+
+/**
+ * Each entry is tiny (a handful of integers + eTag),
+ * so we can afford to remember the headers for a large directory of thumbnails.
+ */
+#define HEADER_CACHE_LIMIT 2048
+
+@implementation ZDCCloudHeaderCache {
+@private
+	
+	__weak ZeroDarkCloud *zdc;
+	
+	dispatch_queue_t cacheQueue;
+	YapCache<NSString*, ZDCCloudDataInfo*> *headerCache; // must access through cacheQueue
+}
+
+- (instancetype)init
+{
+	return nil; // To access this class use: owner.cloudHeaderCache (This class is internal)
+}
+
+- (instancetype)initWithOwner:(ZeroDarkCloud *)inOwner
+{
+	if ((self = [super init]))
+	{
+		zdc = inOwner;
+		cacheQueue = dispatch_queue_create("ZDCCloudHeaderCache", DISPATCH_QUEUE_SERIAL);
+		
+		headerCache = [[YapCache alloc] initWithCountLimit:HEADER_CACHE_LIMIT];
+	#ifndef NS_BLOCK_ASSERTIONS
+		headerCache.allowedKeyClasses = [NSSet setWithObject:[NSString class]];
+		headerCache.allowedObjectClasses = [NSSet setWithObject:[ZDCCloudDataInfo class]];
+	#endif
+	}
+	return self;
+}
+
+/**
+ * See header file for description.
+ */
+- (nullable ZDCCloudDataInfo *)headerForNode:(ZDCNode *)node
+{
+	NSString *eTag = node.eTag_data;
+	if (eTag == nil) {
+		return nil;
+	}
+	
+	ZDCCloudDataInfo *header = [self headerForETag:eTag];
+	if (header) {
+		return header;
+	}
+	
+	// Fallback to the persistent layer.
+	
+	header = node.cloudDataInfo;
+	if (header && [header.eTag isEqualToString:eTag])
+	{
+		[self addHeader:header];
+		return header;
+	}
+	
+	return nil;
+}
+
+/**
+ * See header file for description.
+ */
+- (nullable ZDCCloudDataInfo *)headerForETag:(NSString *)eTag
+{
+	if (eTag == nil) {
+		return nil;
+	}
+	
+	__block ZDCCloudDataInfo *header = nil;
+	dispatch_sync(cacheQueue, ^{
+		
+		header = [self->headerCache objectForKey:eTag];
+	});
+	
+	return header;
+}
+
+/**
+ * See header file for description.
+ */
+- (void)addHeader:(ZDCCloudDataInfo *)header
+{
+	NSString *eTag = header.eTag;
+	if (eTag.length == 0) {
+		return;
+	}
+	
+	dispatch_sync(cacheQueue, ^{
+		
+		[self->headerCache setObject:header forKey:eTag];
+	});
+}
+
+@end
@@ -46,6 +46,22 @@ NS_ASSUME_NONNULL_BEGIN
                        usingPublicKey:(ZDCPublicKey *)pubKey
                                 error:(NSError *_Nullable *_Nullable)errorOut;
 
+/**
+ * Batch version of `wrapSymmetricKey:usingPublicKey:error:`.
+ *
+ * Wraps every key in the array using the same public key (e.g. when granting a user access to an entire subtree).
+ * The work is spread across multiple threads, and the pubKey is only parsed once per thread.
+ *
+ * This method doesn't require any state, so it may be used from within database extensions.
+ *
+ * @return
+ *   An array of wrapped keys, in the same order as the given symKeys.
+ *   Or nil if an error occurs, in which case the errorOut parameter will be set (if non-null).
+ */
++ (nullable NSArray<NSData*> *)wrapSymmetricKeys:(NSArray<NSData*> *)symKeys
+                                  usingPublicKey:(ZDCPublicKey *)pubKey
+                                           error:(NSError *_Nullable *_Nullable)errorOut;
+
 /**
  * Decrypts the given data using the corresponding private key.
  * This is the inverse of the `wrapKey:usingPubKey:transaction:error:` method.
@@ -60,6 +76,18 @@ NS_ASSUME_NONNULL_BEGIN
                         usingPrivateKey:(ZDCPublicKey *)privKey
                                   error:(NSError *_Nullable *_Nullable)errorOut;
 
+/**
+ * Unwrapping a key requires a public key decryption, which is expensive.
+ * So `unwrapSymmetricKey:usingPrivateKey:error:` caches its results in a bounded in-memory cache,
+ * keyed by a hash of the wrapped blob (and the private key that was used).
+ * The cached keys are themselves encrypted, using an ephemeral key that never leaves memory.
+ * (The cache itself is never written to disk.)
+ *
+ * This method is invoked automatically (via Ext_Hooks_PrivateKeys) when a localUser's private key
+ * is changed or removed, such as when the localUser is deleted.
+ */
+- (void)flushUnwrappedKeyCache;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Cloud RCRD
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -99,6 +127,18 @@ NS_ASSUME_NONNULL_BEGIN
                            encryptionKey:(NSData *)encryptionKey
                              transaction:(YapDatabaseReadWriteTransaction *)transaction;
 
+/**
+ * Decodes the raw content of a RCRD file, for use with `parseCloudRcrdDict:localUserID:transaction:`.
+ *
+ * This is cheaper than NSJSONSerialization, as only the sections that parseCloudRcrdDict uses are decoded.
+ * Unknown sections are validated, but skipped without allocating anything.
+ *
+ * @return
+ *   A dictionary containing the known top-level sections of the RCRD,
+ *   or nil if the data isn't a valid JSON dictionary.
+ */
++ (nullable NSDictionary *)decodeCloudRcrdData:(NSData *)data error:(NSError *_Nullable *_Nullable)outError;
+
 /**
  * Parses & decrypts information from the given JSON dict.
  *
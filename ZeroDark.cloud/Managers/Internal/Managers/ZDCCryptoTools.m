@@ -10,21 +10,31 @@
 #import "ZDCCryptoTools.h"
 
 #import "ZDCConstantsPrivate.h"
+#import "ZDCJSONStreamDecoder.h"
 #import "ZDCNodePrivate.h"
 #import "ZeroDarkCloudPrivate.h"
 
 // Categories
+#import "NSData+S4.h"
 #import "NSData+ZeroDark.h"
 #import "NSError+S4.h"
 #import "NSError+ZeroDark.h"
 #import "NSMutableDictionary+ZeroDark.h"
 #import "NSString+ZeroDark.h"
 
+#import <YapDatabase/YapCache.h>
+
 /**
  * Current version of JSON file, as supported by this framework.
  */
 static NSUInteger const kZDCCloudRcrdCurrentVersion = 3;
 
+/**
+ * Maximum number of entries in the unwrapped key cache.
+ * Each entry is tiny (a hash + an encrypted 64 byte key), so this can be fairly generous.
+ */
+#define UNWRAPPED_KEY_CACHE_LIMIT 2048
+
 
 @interface ZDCMissingInfo ()
 
@@ -88,10 +98,102 @@ static NSUInteger const kZDCCloudRcrdCurrentVersion = 3;
 #pragma mark -
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Extracts the top-level sections of a RCRD file that `parseCloudRcrdDict:` understands.
+ * Everything else is skipped without being materialized.
+ */
+@interface ZDCCloudRcrdSectionDecoder : NSObject <ZDCJSONStreamDecoderDelegate>
+
+@property (nonatomic, readonly) NSMutableDictionary *sections;
+@property (nonatomic, readonly) BOOL isDictionary;
+
+@end
+
+@implementation ZDCCloudRcrdSectionDecoder {
+	
+	NSString *key;
+}
+
+@synthesize sections = sections;
+@synthesize isDictionary = isDictionary;
+
+- (instancetype)init
+{
+	if ((self = [super init]))
+	{
+		sections = [[NSMutableDictionary alloc] initWithCapacity:8];
+	}
+	return self;
+}
+
++ (NSSet<NSString *> *)knownSections
+{
+	static NSSet<NSString *> *knownSections = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		
+		knownSections = [NSSet setWithObjects:
+		  kZDCCloudRcrd_Version,
+		  kZDCCloudRcrd_FileID,
+		  kZDCCloudRcrd_Sender,
+		  kZDCCloudRcrd_Keys,
+		  kZDCCloudRcrd_Children,
+		  kZDCCloudRcrd_Meta,
+		  kZDCCloudRcrd_Data,
+		  kZDCCloudRcrd_BurnDate, nil];
+	});
+	
+	return knownSections;
+}
+
+- (void)jsonDecoderDidBeginObject:(ZDCJSONStreamDecoder *)decoder
+{
+	if (decoder.depth == 1) {
+		isDictionary = YES;
+	}
+}
+
+- (void)jsonDecoderDidEndObject:(ZDCJSONStreamDecoder *)decoder {}
+- (void)jsonDecoderDidBeginArray:(ZDCJSONStreamDecoder *)decoder {}
+- (void)jsonDecoderDidEndArray:(ZDCJSONStreamDecoder *)decoder {}
+
+- (void)jsonDecoder:(ZDCJSONStreamDecoder *)decoder didDecodeKey:(NSString *)inKey
+{
+	if ([[[self class] knownSections] containsObject:inKey])
+	{
+		// Sections such as `keys` & `children` are stored as-is (as dictionaries) in the ZDCCloudRcrd.
+		key = inKey;
+		[decoder captureValue];
+	}
+	else
+	{
+		key = nil;
+		[decoder skipValue];
+	}
+}
+
+- (void)jsonDecoder:(ZDCJSONStreamDecoder *)decoder didDecodeValue:(id)value
+{
+	if (key && decoder.depth == 1) {
+		sections[key] = value;
+	}
+	key = nil;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 @implementation ZDCCryptoTools {
 @private
 	
 	__weak ZeroDarkCloud *zdc;
+	
+	dispatch_queue_t unwrapCacheQueue;
+	YapCache<NSData*, NSData*> *unwrapCache; // must be accessed from within unwrapCacheQueue
+	NSData *unwrapCacheKey;                  // random per-process key, used to encrypt cached values
 }
 
 - (instancetype)initWithOwner:(ZeroDarkCloud *)inOwner
@@ -99,10 +201,61 @@ static NSUInteger const kZDCCloudRcrdCurrentVersion = 3;
 	if ((self = [super init]))
 	{
 		zdc = inOwner;
+		
+		unwrapCacheQueue = dispatch_queue_create("ZDCCryptoTools-unwrapCache", DISPATCH_QUEUE_SERIAL);
+		
+		unwrapCache = [[YapCache alloc] initWithCountLimit:UNWRAPPED_KEY_CACHE_LIMIT];
+		unwrapCache.allowedKeyClasses = [NSSet setWithObject:[NSData class]];
+		unwrapCache.allowedObjectClasses = [NSSet setWithObject:[NSData class]];
+		
+		// The cached (unwrapped) keys are never stored in cleartext.
+		// They're encrypted using an ephemeral key that only lives in memory for the lifetime of this instance.
+		//
+		unwrapCacheKey = [NSData s4RandomBytes:64]; // 2FISH256
 	}
 	return self;
 }
 
+/**
+ * Wraps the symKey using an already parsed pubKey context.
+ * Parsing the pubKey JSON is non-trivial, so batch operations parse it once & reuse the context.
+ */
+static S4Err WrapSymmetricKeyWithContext(NSData *symKey, S4KeyContextRef pubKeyCtx, NSData **dataOut)
+{
+	S4Err err = kS4Err_NoErr;
+	S4KeyContextRef symKeyCtx = kInvalidS4KeyContextRef;
+	
+	uint8_t *data = NULL;
+	size_t dataLen = 0;
+	
+	Cipher_Algorithm algo = kCipher_Algorithm_Invalid;
+	
+	// create a S4 key for the cloud key
+	switch(symKey.length * 8)
+	{
+		case  256 : algo = kCipher_Algorithm_3FISH256; break;
+		case  512 : algo = kCipher_Algorithm_3FISH512; break;
+		case 1024 : algo = kCipher_Algorithm_3FISH1024; break;
+		default   : RETERR(kS4Err_BadParams);
+	}
+	
+	err = S4Key_NewTBC(algo, symKey.bytes, &symKeyCtx); CKERR;
+	
+	// encode the symKe to the pubKey
+	err = S4Key_SerializeToS4Key(symKeyCtx, pubKeyCtx, &data, &dataLen); CKERR;
+	
+	*dataOut = [[NSData alloc] initWithBytesNoCopy:data length:dataLen freeWhenDone:YES];
+	
+done:
+	
+	if (S4KeyContextRefIsValid(symKeyCtx))
+	{
+		S4Key_Free(symKeyCtx);
+	}
+	
+	return err;
+}
+
 /**
  * Encrypts the given key using the public key.
  * To decrypt the result will require the private key.
@@ -119,12 +272,6 @@ static NSUInteger const kZDCCloudRcrdCurrentVersion = 3;
 	
 	size_t keyCount = 0;
 	S4KeyContextRef *pubKeyCtxs = NULL;
-	S4KeyContextRef symKeyCtx = kInvalidS4KeyContextRef;
-	
-	uint8_t *data = NULL;
-	size_t dataLen = 0;
-	
-	Cipher_Algorithm algo = kCipher_Algorithm_Invalid;
 	
 	if (symKey == nil)
 	{
@@ -148,21 +295,7 @@ static NSUInteger const kZDCCloudRcrdCurrentVersion = 3;
 	
 	ASSERTERR(keyCount == 1, kS4Err_SelfTestFailed);
 	
-	// create a S4 key for the cloud key
-	switch(symKey.length * 8)
-	{
-		case  256 : algo = kCipher_Algorithm_3FISH256; break;
-		case  512 : algo = kCipher_Algorithm_3FISH512; break;
-		case 1024 : algo = kCipher_Algorithm_3FISH1024; break;
-		default   : RETERR(kS4Err_BadParams);
-	}
-	
-	err = S4Key_NewTBC(algo, symKey.bytes, &symKeyCtx); CKERR;
-
-	// encode the symKe to the pubKey
-	err = S4Key_SerializeToS4Key(symKeyCtx, pubKeyCtxs[0], &data, &dataLen); CKERR;
-	
-	dataOut = [[NSData alloc] initWithBytesNoCopy:data length:dataLen freeWhenDone:YES];
+	err = WrapSymmetricKeyWithContext(symKey, pubKeyCtxs[0], &dataOut); CKERR;
 	
 done:
 	
@@ -174,11 +307,6 @@ done:
 		}
 		XFREE(pubKeyCtxs);
 	}
-
-	if (S4KeyContextRefIsValid(symKeyCtx))
-	{
-		S4Key_Free(symKeyCtx);
-	}
 	
 	if (IsS4Err(err)) {
 		error = [NSError errorWithS4Error:err];
@@ -188,6 +316,116 @@ done:
 	return dataOut;
 }
 
+/**
+ * See header file for description.
+ */
++ (nullable NSArray<NSData*> *)wrapSymmetricKeys:(NSArray<NSData*> *)symKeys
+                                  usingPublicKey:(ZDCPublicKey *)pubKey
+                                           error:(NSError *_Nullable *_Nullable)errorOut
+{
+	if (pubKey == nil)
+	{
+		NSError *error = [NSError errorWithClass: [self class]
+		                                    code: 400
+		                             description: @"Bad parameter: pubKey is nil"];
+		
+		if (errorOut) *errorOut = error;
+		return nil;
+	}
+	
+	const NSUInteger count = symKeys.count;
+	if (count == 0)
+	{
+		if (errorOut) *errorOut = nil;
+		return @[];
+	}
+	
+	// Each wrap requires an ECC operation, so we spread the work across all available cores.
+	// Every chunk parses the pubKey JSON exactly once, and then reuses that context for every key in the chunk.
+	// (We don't share a single context across threads, as S4 key contexts aren't documented as thread-safe.)
+	
+	const NSUInteger minKeysPerChunk = 16;
+	const NSUInteger maxChunks = MAX((NSUInteger)1, [[NSProcessInfo processInfo] activeProcessorCount]);
+	
+	NSUInteger chunkCount = (count + minKeysPerChunk - 1) / minKeysPerChunk;
+	chunkCount = MIN(chunkCount, maxChunks);
+	
+	const NSUInteger keysPerChunk = (count + chunkCount - 1) / chunkCount;
+	
+	NSMutableArray<NSArray<NSData*>*> *chunkResults = [NSMutableArray arrayWithCapacity:chunkCount];
+	for (NSUInteger i = 0; i < chunkCount; i++) {
+		[chunkResults addObject:@[]];
+	}
+	
+	__block S4Err firstErr = kS4Err_NoErr;
+	NSObject *lock = [[NSObject alloc] init];
+	
+	NSString *pubKeyJSON = pubKey.pubKeyJSON;
+	
+	dispatch_apply(chunkCount, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t chunkIdx) { @autoreleasepool {
+		
+		S4Err err = kS4Err_NoErr;
+		
+		size_t keyCount = 0;
+		S4KeyContextRef *pubKeyCtxs = NULL;
+		
+		NSUInteger start = chunkIdx * keysPerChunk;
+		NSUInteger end = MIN(start + keysPerChunk, count);
+		
+		NSMutableArray<NSData*> *wrappedKeys = [NSMutableArray arrayWithCapacity:(end - start)];
+		
+		err = S4Key_DeserializeKeys((uint8_t *)pubKeyJSON.UTF8String,
+		                                       pubKeyJSON.UTF8LengthInBytes,
+		                                       &keyCount, &pubKeyCtxs); CKERR;
+		
+		ASSERTERR(keyCount == 1, kS4Err_SelfTestFailed);
+		
+		for (NSUInteger i = start; i < end; i++)
+		{
+			NSData *wrappedKey = nil;
+			err = WrapSymmetricKeyWithContext(symKeys[i], pubKeyCtxs[0], &wrappedKey); CKERR;
+			
+			[wrappedKeys addObject:wrappedKey];
+		}
+		
+	done:
+		
+		if (pubKeyCtxs)
+		{
+			if (S4KeyContextRefIsValid(pubKeyCtxs[0]))
+			{
+				S4Key_Free(pubKeyCtxs[0]);
+			}
+			XFREE(pubKeyCtxs);
+		}
+		
+		@synchronized(lock)
+		{
+			if (IsS4Err(err)) {
+				if (!IsS4Err(firstErr)) firstErr = err;
+			}
+			else {
+				chunkResults[chunkIdx] = wrappedKeys;
+			}
+		}
+	}});
+	
+	if (IsS4Err(firstErr))
+	{
+		if (errorOut) *errorOut = [NSError errorWithS4Error:firstErr];
+		return nil;
+	}
+	
+	NSMutableArray<NSData*> *results = [NSMutableArray arrayWithCapacity:count];
+	for (NSArray<NSData*> *wrappedKeys in chunkResults)
+	{
+		[results addObjectsFromArray:wrappedKeys];
+	}
+	
+	if (errorOut) *errorOut = nil;
+	return results;
+}
+
 /**
  * Decrypts the given data using the corresponding private key.
  * This is the inverse of the `wrapKey:usingPubKey:transaction:error:` method.
@@ -218,6 +456,7 @@ done:
 	void *keyData = NULL;
 	size_t keyDataLen = 0;
 	
+	NSData *cacheKey = nil;
 	NSData *data = nil;
 	
 	if (symKeyWrappedData == nil)
@@ -242,6 +481,17 @@ done:
 		goto done;
 	}
 	
+	// Public key decryption is expensive.
+	// And we often unwrap the exact same blob multiple times (e.g. re-fetching an unchanged RCRD during a pull).
+	// So check the cache first.
+	
+	cacheKey = [self unwrapCacheKeyForWrappedData:symKeyWrappedData privKey:privKey];
+	if (cacheKey)
+	{
+		data = [self cachedUnwrappedKeyForCacheKey:cacheKey];
+		if (data) goto done;
+	}
+	
 	// create a S4 key context for the private key
 	err = S4Key_DeserializeKeys((uint8_t *)privKey.privKeyJSON.UTF8String,
 	                                       privKey.privKeyJSON.UTF8LengthInBytes,
@@ -272,6 +522,10 @@ done:
 	err = S4Key_GetAllocatedProperty(symKey, kS4KeyProp_KeyData, NULL, &keyData, &keyDataLen); CKERR;
 	data = [[NSData alloc] initWithBytesNoCopy:keyData length:keyDataLen freeWhenDone:YES];
 	
+	if (cacheKey) {
+		[self cacheUnwrappedKey:data forCacheKey:cacheKey];
+	}
+	
 done:
 	
 	if (S4KeyContextRefIsValid(symKey)) {
@@ -306,6 +560,70 @@ done:
 	return data;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Unwrapped Key Cache
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The cache key is a hash of the wrapped blob, combined with the privKey that was used to unwrap it.
+ * So the same blob unwrapped with a different private key (e.g. different localUser) won't collide.
+ */
+- (nullable NSData *)unwrapCacheKeyForWrappedData:(NSData *)symKeyWrappedData privKey:(ZDCPublicKey *)privKey
+{
+	NSMutableData *buffer = [NSMutableData dataWithCapacity:(symKeyWrappedData.length + 64)];
+	[buffer appendData:[privKey.uuid dataUsingEncoding:NSUTF8StringEncoding]];
+	[buffer appendData:symKeyWrappedData];
+	
+	NSError *error = nil;
+	NSData *hash = [buffer hashWithAlgorithm:kHASH_Algorithm_SHA256 error:&error];
+	
+	return error ? nil : hash;
+}
+
+- (nullable NSData *)cachedUnwrappedKeyForCacheKey:(NSData *)cacheKey
+{
+	__block NSData *encrypted = nil;
+	dispatch_sync(unwrapCacheQueue, ^{
+		
+		encrypted = [unwrapCache objectForKey:cacheKey];
+	});
+	
+	if (encrypted == nil) {
+		return nil;
+	}
+	
+	NSError *error = nil;
+	NSData *decrypted = [encrypted decryptedDataWithSymmetricKey:unwrapCacheKey error:&error];
+	
+	return error ? nil : decrypted;
+}
+
+- (void)cacheUnwrappedKey:(NSData *)unwrappedKey forCacheKey:(NSData *)cacheKey
+{
+	NSError *error = nil;
+	NSData *encrypted = [unwrappedKey encryptedDataWithSymmetricKey:unwrapCacheKey error:&error];
+	
+	if (error || encrypted == nil) {
+		return;
+	}
+	
+	dispatch_sync(unwrapCacheQueue, ^{
+		
+		[unwrapCache setObject:encrypted forKey:cacheKey];
+	});
+}
+
+/**
+ * See header file for description.
+ */
+- (void)flushUnwrappedKeyCache
+{
+	dispatch_sync(unwrapCacheQueue, ^{
+		
+		[unwrapCache removeAllObjects];
+	});
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Cloud RCRD
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -754,6 +1072,27 @@ done:
 	return count;
 }
 
+/**
+ * See header file for description.
+ */
++ (nullable NSDictionary *)decodeCloudRcrdData:(NSData *)data error:(NSError *_Nullable *_Nullable)outError
+{
+	ZDCCloudRcrdSectionDecoder *sectionDecoder = [[ZDCCloudRcrdSectionDecoder alloc] init];
+	ZDCJSONStreamDecoder *decoder = [[ZDCJSONStreamDecoder alloc] initWithDelegate:sectionDecoder];
+	
+	[decoder appendData:data];
+	[decoder finish];
+	
+	NSError *error = decoder.error;
+	if (error == nil && !sectionDecoder.isDictionary)
+	{
+		error = [NSError errorWithClass:[self class] code:0 description:@"RCRD file is not a JSON dictionary"];
+	}
+	
+	if (outError) *outError = error;
+	return error ? nil : [sectionDecoder.sections copy];
+}
+
 /**
  * See header file for description.
  */
@@ -154,8 +154,8 @@
 		accountNeedsA0Token = YES;
 	}
 	
-	YapDatabaseConnection *rwConnection = zdc.databaseManager.internal_rwConnection;
-	[rwConnection asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	ZDCDatabaseWriteCoalescer *writeCoalescer = zdc.databaseManager.internal_writeCoalescer;
+	[writeCoalescer asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 	
 		ZDCLocalUser *user = [transaction objectForKey:userID inCollection:kZDCCollection_Users];
 		user = [user copy];
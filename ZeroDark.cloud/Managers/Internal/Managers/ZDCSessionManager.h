@@ -12,8 +12,10 @@ NS_ASSUME_NONNULL_BEGIN
 /**
  * The SessionManager manages NSURLSession's for the framework.
  *
- * Each localUser gets their own network session.
- * On iOS, there are are actually two sessions per user: background & foreground session.
+ * All localUsers share a single foreground session (and thus a single connection pool),
+ * so that an app signed into multiple accounts doesn't perform redundant TLS handshakes
+ * with the same S3 & API gateway hosts.
+ * On iOS, each user additionally gets their own background session.
  *
  * The primary task of the SessionManager is to handle the complicated parts of NSURLSession.
  *
@@ -59,6 +61,21 @@ NS_ASSUME_NONNULL_BEGIN
                withTask:(NSURLSessionTask *)task
               inSession:(NSURLSession *)session;
 
+/**
+ * Registers a block to receive the response body of a data task incrementally, as each chunk arrives.
+ * This allows large responses to be decoded while they're still downloading (e.g. ZDCChangeFeedDecoder).
+ * Must be invoked before the task is resumed.
+ *
+ * For such tasks, the session's response serializer is bypassed:
+ * the completionHandler receives the raw NSData as the responseObject (which the caller may ignore).
+ *
+ * The block is invoked serially, on a background thread, for every chunk (regardless of the status code).
+ * It's automatically released when the task completes.
+ */
+- (void)associateDataHandler:(void (^)(NSURLResponse *response, NSData *data))dataHandler
+                    withTask:(NSURLSessionDataTask *)task
+                   inSession:(NSURLSession *)session;
+
 /**
  * Forwarded through the system:
  * AppDelegate -> ZeroDarkCloud -> ZDCSessionManager
@@ -8,13 +8,17 @@
 #import "ZDCDownloadManagerPrivate.h"
 #import "ZDCLocalUser.h"
 #import "ZDCLogging.h"
+#import "ZDCMetricsManagerPrivate.h"
+#import "ZDCPollContext.h"
 #import "ZDCPushManagerPrivate.h"
 #import "ZDCSessionInfo.h"
 #import "ZDCSessionUserInfo.h"
 #import "ZDCTaskContext.h"
+#import "ZDCTouchContext.h"
 #import "ZeroDarkCloudPrivate.h"
 
 #import <YapDatabase/YapDatabase.h>
+#import <objc/runtime.h>
 
 // Log Levels: off, error, warning, info, verbose
 // Log Flags : trace
@@ -30,6 +34,19 @@
 static NSString *const kSessionDescriptionPrefix_Background = @"bg";
 static NSString *const kSessionDescriptionPrefix_Foreground = @"fg";
 
+/**
+ * The localUserID component of the shared (foreground) session's identifier.
+ */
+static NSString *const kSharedSessionUserID = @"*";
+
+/**
+ * The shared session multiplexes requests over HTTP/2 when the server supports it,
+ * in which case this limit doesn't matter much. But the S3 endpoints only speak HTTP/1.1,
+ * so this is the maximum number of (pipelined) requests to a single bucket that can be in-flight at once.
+ * Any tasks beyond this limit are queued by NSURLSession until a connection becomes available.
+ */
+static NSUInteger const kSharedSessionMaxConnectionsPerHost = 6;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark -
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -76,6 +93,84 @@ static NSString *const kSessionDescriptionPrefix_Foreground = @"fg";
 #pragma mark -
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * See `associateDataHandler:withTask:inSession:`.
+ *
+ * This is attached directly to the task (as an associated object).
+ * So looking it up for each chunk doesn't require a trip through the queue (or building a storage key).
+ */
+@interface ZDCSessionDataHandler : NSObject
+
+@property (nonatomic, copy, readwrite) void (^block)(NSURLResponse *response, NSData *data);
+
+/** Only accessed from the session's (serial) delegate queue. */
+@property (nonatomic, assign, readwrite) BOOL didRegisterResponse;
+
+@end
+
+@implementation ZDCSessionDataHandler
+
+@end
+
+static char kDataHandlerKey;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface ZDCSessionManager ()
+
+- (BOOL)consumeStreamedResponse:(NSURLResponse *)response;
+
+@end
+
+/**
+ * Wraps the standard S3ResponseSerialization.
+ *
+ * Tasks with an associated dataHandler have already had their response body consumed (incrementally).
+ * So for those we skip the redundant decoding (e.g. NSJSONSerialization), and just return the raw data.
+ */
+@interface ZDCSessionResponseSerializer : AFHTTPResponseSerializer
+
+- (instancetype)initWithSessionManager:(ZDCSessionManager *)owner;
+
+@end
+
+@implementation ZDCSessionResponseSerializer {
+	
+	__weak ZDCSessionManager *owner;
+	AFCompoundResponseSerializer *serializer;
+}
+
+- (instancetype)initWithSessionManager:(ZDCSessionManager *)inOwner
+{
+	if ((self = [super init]))
+	{
+		owner = inOwner;
+		serializer = [S3ResponseSerialization serializer];
+	}
+	return self;
+}
+
+- (id)responseObjectForResponse:(NSURLResponse *)response
+                           data:(NSData *)data
+                          error:(NSError *__autoreleasing *)error
+{
+	if ([owner consumeStreamedResponse:response])
+	{
+		// Validates the status code, and returns the data as-is.
+		return [super responseObjectForResponse:response data:data error:error];
+	}
+	
+	return [serializer responseObjectForResponse:response data:data error:error];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 @implementation ZDCSessionManager
 {
 	__weak ZeroDarkCloud *zdc;
@@ -88,7 +183,11 @@ static NSString *const kSessionDescriptionPrefix_Foreground = @"fg";
 	NSMutableDictionary<NSString *, ZDCSessionInfo *> * sessionDict;
 	NSMutableDictionary<NSString *, ZDCSessionInfo *> * staleSessionDict;
 	
+	AFURLSessionManager *sharedSession;
+	dispatch_queue_t sharedSessionQueue;
+	
 	NSMutableDictionary<NSString *, ZDCSessionStorageItem *> *storage;
+	NSHashTable<NSURLResponse *> *streamedResponses;
 
 #if TARGET_OS_IPHONE
 	BOOL isReadyForStorage;
@@ -121,6 +220,11 @@ static NSString *const kSessionDescriptionPrefix_Foreground = @"fg";
 		staleSessionDict = [[NSMutableDictionary alloc] initWithCapacity:2];
 		
 		storage = [[NSMutableDictionary alloc] initWithCapacity:16];
+		streamedResponses = [NSHashTable hashTableWithOptions:
+		  (NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality)];
+		
+		sharedSessionQueue = dispatch_queue_create("SessionManager.shared", DISPATCH_QUEUE_SERIAL);
+		
 	#if TARGET_OS_IPHONE
 		pending = [[NSMutableDictionary alloc] initWithCapacity:4];
 		
@@ -236,13 +340,15 @@ static NSString *const kSessionDescriptionPrefix_Foreground = @"fg";
 			if (sessionInfo)
 			{
 			#if TARGET_OS_IPHONE
-				[sessionInfo.foregroundSession invalidateSessionCancelingTasks:YES];
 				[sessionInfo.backgroundSession invalidateSessionCancelingTasks:YES];
-			#else
-				[sessionInfo.session invalidateSessionCancelingTasks:YES];
 			#endif
 			}
 		}
+		
+		// The shared session is used by every user, so we can't invalidate it.
+		// Instead we cancel the tasks that belong to the deleted user(s).
+		
+		[self cancelSharedSessionTasksForLocalUserIDs:[NSSet setWithArray:missingUserIDs]];
 	
 		[sessionDict removeObjectsForKeys:missingUserIDs];
 		[staleSessionDict removeObjectsForKeys:missingUserIDs];
@@ -372,23 +478,32 @@ done:
 		{
 			dispatch_queue_t sessionQueue = dispatch_queue_create([userID UTF8String], DISPATCH_QUEUE_SERIAL);
 			
+			// All users share the same foreground session (and thus the same connection pool).
+			// So a user's requests to the API gateway (or a bucket another user is also syncing with)
+			// don't have to pay for their own TCP+TLS handshakes.
+			
+			if (sharedSession == nil)
+			{
+				sharedSession = [self createSessionForLocalUserID:nil isBackground:NO];
+				sharedSession.completionQueue = sharedSessionQueue;
+				
+				[self configureSession:sharedSession isBackground:NO withUserInfo:nil];
+			}
+			
 		#if TARGET_OS_IPHONE
 			
-			AFURLSessionManager *fgSession = [self createSessionForLocalUserID:userID isBackground:NO];
-			AFURLSessionManager *bgSession = [self createSessionForLocalUserID:userID isBackground:YES];
+			// Background sessions can't be shared.
+			// The OS relaunches the app for a particular session identifier (which includes the localUserID).
 			
-			fgSession.completionQueue = sessionQueue;
+			AFURLSessionManager *bgSession = [self createSessionForLocalUserID:userID isBackground:YES];
 			bgSession.completionQueue = sessionQueue;
 			
-			sessionInfo = [[ZDCSessionInfo alloc] initWithForegroundSession: fgSession
+			sessionInfo = [[ZDCSessionInfo alloc] initWithForegroundSession: sharedSession
 			                                              backgroundSession: bgSession
 			                                                          queue: sessionQueue];
 		#else
 			
-			AFURLSessionManager *session = [self createSessionForLocalUserID:userID isBackground:NO];
-			session.completionQueue = sessionQueue;
-			
-			sessionInfo = [[ZDCSessionInfo alloc] initWithSession:session queue:sessionQueue];
+			sessionInfo = [[ZDCSessionInfo alloc] initWithSession:sharedSession queue:sessionQueue];
 			
 		#endif
 			
@@ -455,15 +570,13 @@ done:
 				ZDCSessionInfo *originalInfo = sessionDict[userID];
 				if (originalInfo)
 				{
+				#if TARGET_OS_IPHONE
 					if (originalInfo.userInfo == nil)
 					{
-					#if TARGET_OS_IPHONE
-						[self configureSession:originalInfo.foregroundSession isBackground:NO  withUserInfo:userInfo];
+						// The shared (foreground) session was configured when it was created.
 						[self configureSession:originalInfo.backgroundSession isBackground:YES withUserInfo:userInfo];
-					#else
-						[self configureSession:originalInfo.session isBackground:NO withUserInfo:userInfo];
-					#endif
 					}
+				#endif
 					
 					originalInfo.userInfo = userInfo;
 				}
@@ -478,18 +591,21 @@ done:
 
 /**
  * Creates the session object, and sets up universal configuration.
- * CloudService specific configuration occurs in '
+ * CloudService specific configuration occurs in 'configureSession:isBackground:withUserInfo:'.
+ *
+ * Pass a nil localUserID to create the shared (foreground) session.
  */
-- (AFURLSessionManager *)createSessionForLocalUserID:(NSString *)localUserID
+- (AFURLSessionManager *)createSessionForLocalUserID:(nullable NSString *)localUserID
                                         isBackground:(BOOL)isBackgroundSession
 {
 	ZDCLogAutoTrace();
+	NSParameterAssert(localUserID != nil || !isBackgroundSession);
 	
 	// Note: The session identifier (for background sessions) MUST be the localUserID.
 	// We depend on this being true in 'handleEventsForBackgroundURLSession:'.
 	
 	NSString *const sessionIdentifier =
-	  [self sessionIdentifierForLocalUserID: localUserID
+	  [self sessionIdentifierForLocalUserID: (localUserID ?: kSharedSessionUserID)
 	                           isBackground: isBackgroundSession];
 	
 	NSURLSessionConfiguration *sessionConfig;
@@ -498,8 +614,15 @@ done:
 	else
 		sessionConfig = [NSURLSessionConfiguration defaultSessionConfiguration];
 	
+	// HTTP/2 is negotiated automatically (via ALPN) by NSURLSession.
+	// Pipelining only applies to HTTP/1.1 connections (e.g. S3).
+	
 	sessionConfig.HTTPShouldUsePipelining = YES;
 	
+	if (!isBackgroundSession) {
+		sessionConfig.HTTPMaximumConnectionsPerHost = kSharedSessionMaxConnectionsPerHost;
+	}
+	
 	NSMutableDictionary *customHeaders = [NSMutableDictionary dictionaryWithCapacity:1];
 	
 	NSString *userAgent = [self userAgent];
@@ -528,6 +651,11 @@ done:
 		[self migrateDataTask:dataTask toDownloadTask:downloadTask inSession:session];
 	}];
 	
+	[session setDataTaskDidReceiveDataBlock:^(NSURLSession *session, NSURLSessionDataTask *dataTask, NSData *data){
+		
+		[self dataTask:dataTask inSession:session didReceiveData:data];
+	}];
+	
 	[session setDownloadTaskDidFinishDownloadingBlock:
 	  ^NSURL *(NSURLSession *session, NSURLSessionDownloadTask *downloadTask, NSURL *fileURL)
 	{
@@ -542,6 +670,14 @@ done:
 		[self taskDidComplete:task inSession:session withError:error localUserID:localUserID];
 	}];
 	
+#if AF_CAN_INCLUDE_SESSION_TASK_METRICS
+	[session setTaskDidFinishCollectingMetricsBlock:
+	  ^(NSURLSession *session, NSURLSessionTask *task, NSURLSessionTaskMetrics *metrics)
+	{
+		[self->zdc.metricsManager recordTask:task metrics:metrics];
+	}];
+#endif
+	
 #if TARGET_OS_IPHONE
 	if (isBackgroundSession)
 	{
@@ -557,19 +693,20 @@ done:
 }
 
 /**
- * This method is called exactly once.
- * It is called when the session is matched to userInfo for the first time.
+ * This method is called exactly once per session.
+ * For background sessions, it is called when the session is matched to userInfo for the first time.
+ * For the shared session, it is called when the session is created (with a nil userInfo).
  *
  * We may use this in the future as a hook to allow the ZeroDarkCloudDelegate
- * to customize the session on a per-user basis.
+ * to customize the (background) session on a per-user basis.
  */
 - (void)configureSession:(AFURLSessionManager *)session
             isBackground:(BOOL)isBackgroundSession
-            withUserInfo:(ZDCSessionUserInfo *)userInfo
+            withUserInfo:(nullable ZDCSessionUserInfo *)userInfo
 {
 	ZDCLogAutoTrace();
 	
-	session.responseSerializer = [S3ResponseSerialization serializer];
+	session.responseSerializer = [[ZDCSessionResponseSerializer alloc] initWithSessionManager:self];
 }
 
 /**
@@ -596,6 +733,67 @@ done:
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Shared Session
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The shared session is used by every user.
+ * So for its tasks, we have to extract the localUserID from the associated context.
+ */
+- (nullable NSString *)localUserIDForContext:(ZDCObject *)context
+{
+	if ([context isKindOfClass:[ZDCTaskContext class]])
+	{
+		return [(ZDCTaskContext *)context localUserID];
+	}
+	else if ([context isKindOfClass:[ZDCDownloadContext class]])
+	{
+		return [(ZDCDownloadContext *)context localUserID];
+	}
+	else if ([context isKindOfClass:[ZDCPollContext class]])
+	{
+		return [(ZDCPollContext *)context taskContext].localUserID;
+	}
+	else if ([context isKindOfClass:[ZDCTouchContext class]])
+	{
+		return [(ZDCTouchContext *)context pollContext].taskContext.localUserID;
+	}
+	
+	return nil;
+}
+
+/**
+ * Cancels the tasks in the shared session that have an associated context belonging to one of the given users.
+ *
+ * Tasks that use completionHandler blocks (e.g. REST API requests) don't have a context.
+ * Those are allowed to complete normally, and the handlers will discover the user has been deleted.
+ */
+- (void)cancelSharedSessionTasksForLocalUserIDs:(NSSet<NSString *> *)localUserIDs
+{
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be invoked within queue");
+	
+	NSURLSession *session = sharedSession.session;
+	if (session == nil || localUserIDs.count == 0) return;
+	
+	[session getAllTasksWithCompletionHandler:^(NSArray<__kindof NSURLSessionTask *> *tasks) {
+		
+		dispatch_async(queue, ^{ @autoreleasepool {
+			
+			for (NSURLSessionTask *task in tasks)
+			{
+				NSString *key = [self storageKeyForTask:task inSession:session];
+				NSString *localUserID = [self localUserIDForContext:storage[key].context];
+				
+				if (localUserID && [localUserIDs containsObject:localUserID])
+				{
+					[task cancel];
+				}
+			}
+		}});
+	}];
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Session Delegate
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -603,7 +801,7 @@ done:
 - (NSURL *)downloadTaskDidFinishDownloading:(NSURLSessionDownloadTask *)downloadTask
                                   inSession:(NSURLSession *)session
                                withLocation:(NSURL *)fileURL
-                                localUserID:(NSString *)localUserID
+                                localUserID:(nullable NSString *)localUserID
 {
 	__block NSURL *result = nil;
 	__block ZDCSessionStorageItem *storageItem = nil;
@@ -614,7 +812,10 @@ done:
 
 	#if TARGET_OS_IPHONE
 		
-		if (isReadyForStorage && ![localUserIDsPendingRestore containsObject:localUserID])
+		// Note: The shared session (nil localUserID) doesn't survive an app relaunch,
+		// so it never has any tasks to restore.
+		
+		if (localUserID == nil || (isReadyForStorage && ![localUserIDsPendingRestore containsObject:localUserID]))
 		{
 			storageItem = [self storageItemForTask:downloadTask inSession:session];
 		}
@@ -646,10 +847,67 @@ done:
 	return result;
 }
 
+/**
+ * Forwards the chunk to the task's dataHandler (if there is one).
+ */
+- (void)dataTask:(NSURLSessionDataTask *)dataTask inSession:(NSURLSession *)session didReceiveData:(NSData *)data
+{
+	ZDCSessionDataHandler *dataHandler = objc_getAssociatedObject(dataTask, &kDataHandlerKey);
+	if (dataHandler == nil) {
+		return;
+	}
+	
+	NSURLResponse *response = dataTask.response;
+		
+	if (!dataHandler.didRegisterResponse && response)
+	{
+		// Once per task: note that the body is being consumed here,
+		// so the response serializer won't decode it again.
+		
+		dataHandler.didRegisterResponse = YES;
+	
+		dispatch_sync(queue, ^{
+		#pragma clang diagnostic push
+		#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+			
+			[streamedResponses addObject:response];
+			
+		#pragma clang diagnostic pop
+		});
+	}
+	
+	dataHandler.block(response, data);
+}
+
+/**
+ * Invoked by ZDCSessionResponseSerializer.
+ * Returns YES if the response body was already consumed by a dataHandler.
+ */
+- (BOOL)consumeStreamedResponse:(NSURLResponse *)response
+{
+	if (response == nil) return NO;
+	
+	__block BOOL wasStreamed = NO;
+	
+	dispatch_sync(queue, ^{
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		wasStreamed = [streamedResponses containsObject:response];
+		if (wasStreamed) {
+			[streamedResponses removeObject:response];
+		}
+		
+	#pragma clang diagnostic pop
+	});
+	
+	return wasStreamed;
+}
+
 - (void)taskDidComplete:(NSURLSessionTask *)task
               inSession:(NSURLSession *)session
               withError:(NSError *)error
-            localUserID:(NSString *)localUserID
+            localUserID:(nullable NSString *)localUserID
 {
 	__block ZDCSessionStorageItem *storageItem = nil;
 	
@@ -659,7 +917,10 @@ done:
 
 	#if TARGET_OS_IPHONE
 		
-		if (isReadyForStorage && ![localUserIDsPendingRestore containsObject:localUserID])
+		// Note: The shared session (nil localUserID) doesn't survive an app relaunch,
+		// so it never has any tasks to restore.
+		
+		if (localUserID == nil || (isReadyForStorage && ![localUserIDsPendingRestore containsObject:localUserID]))
 		{
 			storageItem = [self storageItemForTask:task inSession:session];
 		}
@@ -686,19 +947,33 @@ done:
 	
 	if (storageItem && storageItem.context)
 	{
-		ZDCSessionInfo *sessionInfo = [self sessionInfoForUserID:localUserID];
-		
-		[self notifyTaskDidComplete: task
-		                  inSession: session
-		                  withError: error
-		                    context: storageItem.context
-		          downloadedFileURL: storageItem.downloadedFileURL
-		                sessionInfo: sessionInfo];
+		if (localUserID == nil) {
+			localUserID = [self localUserIDForContext:storageItem.context];
+		}
+		
+		if (localUserID)
+		{
+			ZDCSessionInfo *sessionInfo = [self sessionInfoForUserID:localUserID];
+			
+			[self notifyTaskDidComplete: task
+			                  inSession: session
+			                  withError: error
+			                    context: storageItem.context
+			          downloadedFileURL: storageItem.downloadedFileURL
+			                sessionInfo: sessionInfo];
+		}
+		else
+		{
+			ZDCLogWarn(@"Unable to determine localUserID for task context: %@", storageItem.context);
+		}
 	}
 	
 	if (storageItem) {
 		[self removeStorageItem:storageItem forTask:task inSession:session];
 	}
+	
+	// Release the dataHandler (if any)
+	objc_setAssociatedObject(task, &kDataHandlerKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
 }
 
 #if TARGET_OS_IPHONE
@@ -984,13 +1259,14 @@ done:
 	// We need to tell the OS that we're done processing events from a background session.
 	// However, we may have outstanding database operations (due to processing the results).
 	//
-	// So let's flush the rwDatabaseConnection being used by the PushManager & PullManager first.
+	// So let's flush the writes being performed by the PushManager & PullManager first.
+	// (This includes the writes still waiting in the coalescer.)
 	// And then we'll notify the OS that we're done.
 	
-	YapDatabaseConnection *rwConnection = [zdc.databaseManager internal_rwConnection];
+	ZDCDatabaseWriteCoalescer *writeCoalescer = [zdc.databaseManager internal_writeCoalescer];
 	dispatch_queue_t concurrentQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
 	
-	[rwConnection flushTransactionsWithCompletionQueue:concurrentQueue completionBlock:^{
+	[writeCoalescer flushWithCompletionQueue:concurrentQueue completionBlock:^{
 		
 		[zdc invokeCompletionHandlerForBackgroundURLSession:session.configuration.identifier];
 	}];
@@ -1121,6 +1397,26 @@ done:
 		dispatch_sync(queue, block);
 }
 
+/**
+ * Registers a block to receive the response body of a data task incrementally, as each chunk arrives.
+ * The block is released when the task completes.
+**/
+- (void)associateDataHandler:(void (^)(NSURLResponse *response, NSData *data))dataHandler
+                    withTask:(NSURLSessionDataTask *)task
+                   inSession:(NSURLSession *)session
+{
+	if (task == nil) return;
+	if (session == nil) return;
+	
+	ZDCSessionDataHandler *handler = [[ZDCSessionDataHandler alloc] init];
+	handler.block = dataHandler;
+	
+	// Note: The task hasn't been resumed yet.
+	// So this is guaranteed to be visible from the session's delegate queue when the first chunk arrives.
+		
+	objc_setAssociatedObject(task, &kDataHandlerKey, handler, OBJC_ASSOCIATION_RETAIN);
+}
+
 - (NSInputStream *)streamForTask:(NSURLSessionTask *)task inSession:(NSURLSession *)session
 {
 	if (task == nil) return nil;
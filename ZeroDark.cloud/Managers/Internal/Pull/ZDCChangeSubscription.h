@@ -0,0 +1,73 @@
+/**
+ * ZeroDark.cloud Framework
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+@class ZeroDarkCloud;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Watches the server's change feed for a localUser, and reports when the server has changes we don't.
+ *
+ * It uses the existing `/pull/{change_token}` API, where change_token is our latestChangeID_local:
+ *
+ * - Requests ask the server to hold the connection open until a change arrives (long-polling).
+ *   When the server does so, the next request is sent as soon as the previous one returns,
+ *   so changes are noticed as they happen.
+ *
+ * - If the server responds right away with nothing new (i.e. it doesn't hold the request),
+ *   the subscription falls back to polling. The interval starts small (right after a detected change),
+ *   and doubles each time nothing has changed, up to `maxIdleInterval`.
+ *
+ * The subscription doesn't pull anything itself.
+ * It stops, and invokes the changeBlock, and the owner (ZDCSyncManager) is expected to start a pull.
+ * The owner restarts the subscription once the pull completes.
+ *
+ * If the server's response already contains the changes, they're stored in the ZDCChangeList
+ * (before the changeBlock is invoked), so the pull can process them without downloading them again.
+ */
+@interface ZDCChangeSubscription : NSObject
+
+- (instancetype)initWithOwner:(ZeroDarkCloud *)owner
+                  localUserID:(NSString *)localUserID
+                       treeID:(NSString *)treeID
+                  changeQueue:(dispatch_queue_t)changeQueue
+                  changeBlock:(dispatch_block_t)changeBlock;
+
+@property (nonatomic, copy, readonly) NSString *localUserID;
+@property (nonatomic, copy, readonly) NSString *treeID;
+
+/**
+ * The maximum amount of time between requests, when the server isn't holding requests open.
+ * The default value is 15 minutes.
+ */
+@property (atomic, assign, readwrite) NSTimeInterval maxIdleInterval;
+
+/**
+ * Returns YES if the subscription has been started (and hasn't since stopped).
+ */
+@property (atomic, assign, readonly) BOOL isRunning;
+
+/**
+ * Starts (or restarts) the subscription.
+ *
+ * The idle interval is preserved across restarts, so the polling backoff keeps building while nothing changes.
+ * It's only reset when the subscription itself detects a change.
+ */
+- (void)start;
+
+/**
+ * Stops the subscription, cancelling any in-flight request.
+ */
+- (void)stop;
+
+@end
+
+NS_ASSUME_NONNULL_END
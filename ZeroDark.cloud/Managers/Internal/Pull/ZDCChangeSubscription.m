@@ -0,0 +1,508 @@
+/**
+ * ZeroDark.cloud Framework
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCChangeSubscription.h"
+
+#import "AWSSignature.h"
+#import "ZDCChangeList.h"
+#import "ZDCLogging.h"
+#import "ZDCPullManagerPrivate.h"
+#import "ZDCRestManager.h"
+#import "ZeroDarkCloudPrivate.h"
+
+// Categories
+#import "NSURLResponse+ZeroDark.h"
+
+// Log Levels: off, error, warn, info, verbose
+// Log Flags : trace
+#if DEBUG && robbie_hanson
+  static const int zdcLogLevel = ZDCLogLevelInfo;
+#elif DEBUG
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#else
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#endif
+#pragma unused(zdcLogLevel)
+
+/**
+ * How long we ask the server to hold a request open.
+ * API Gateway enforces a 29 second integration timeout, so this must stay below that.
+ */
+static NSTimeInterval const ZDCLongPollWait = 25.0;
+
+/**
+ * If the server takes at least this long to respond (with nothing new),
+ * we assume it's holding requests open for us.
+ */
+static NSTimeInterval const ZDCLongPollThreshold = ZDCLongPollWait * 0.5;
+
+static NSTimeInterval const ZDCMinIdleInterval = 5.0;
+static NSTimeInterval const ZDCDefaultMaxIdleInterval = 60 * 15; // 15 minutes
+
+@interface ZDCChangeSubscription ()
+@property (atomic, assign, readwrite) BOOL isRunning;
+@end
+
+
+@implementation ZDCChangeSubscription {
+	
+	__weak ZeroDarkCloud *zdc;
+	
+	dispatch_queue_t queue;
+	void *IsOnQueueKey;
+	
+	dispatch_queue_t changeQueue;
+	dispatch_block_t changeBlock;
+	
+	// The following variables must be accessed from within the queue.
+	
+	NSUInteger generation; // incremented on every start/stop, to invalidate stale callbacks
+	NSURLSessionDataTask *task;
+	
+	NSTimeInterval idleInterval;
+	NSUInteger failCount;
+	BOOL serverHoldsRequests;
+}
+
+@synthesize localUserID = localUserID;
+@synthesize treeID = treeID;
+@synthesize maxIdleInterval = maxIdleInterval;
+@synthesize isRunning = isRunning;
+
+- (instancetype)initWithOwner:(ZeroDarkCloud *)owner
+                  localUserID:(NSString *)inLocalUserID
+                       treeID:(NSString *)inTreeID
+                  changeQueue:(dispatch_queue_t)inChangeQueue
+                  changeBlock:(dispatch_block_t)inChangeBlock
+{
+	NSParameterAssert(owner != nil);
+	NSParameterAssert(inLocalUserID != nil);
+	NSParameterAssert(inTreeID != nil);
+	NSParameterAssert(inChangeQueue != nil);
+	NSParameterAssert(inChangeBlock != nil);
+	
+	if ((self = [super init]))
+	{
+		zdc = owner;
+		
+		localUserID = [inLocalUserID copy];
+		treeID = [inTreeID copy];
+		
+		queue = dispatch_queue_create("ZDCChangeSubscription", DISPATCH_QUEUE_SERIAL);
+		
+		IsOnQueueKey = &IsOnQueueKey;
+		dispatch_queue_set_specific(queue, IsOnQueueKey, IsOnQueueKey, NULL);
+		
+		changeQueue = inChangeQueue;
+		changeBlock = [inChangeBlock copy];
+		
+		maxIdleInterval = ZDCDefaultMaxIdleInterval;
+		
+		idleInterval = ZDCMinIdleInterval;
+		serverHoldsRequests = YES; // until proven otherwise
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[task cancel];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Start & Stop
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * See header file for description.
+ */
+- (void)start
+{
+	ZDCLogAutoTrace();
+	
+	dispatch_block_t block = ^{ @autoreleasepool {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		[self cancelTask];
+		
+		generation++;
+		self.isRunning = YES;
+		
+		// We just finished a pull, so we're up-to-date.
+		// If the server holds requests open, we can start waiting for the next change right away.
+		// Otherwise, wait for the current idleInterval before asking again.
+		//
+		// Note: We don't reset the idleInterval (or failCount) here.
+		// Pulls are also triggered by push notifications, app activation, etc.
+		// And if every one of those reset the interval, the backoff would never build.
+		// The idleInterval is only reset when we detect a change ourselves.
+		
+		if (serverHoldsRequests)
+			[self pollForGeneration:generation];
+		else
+			[self schedulePollAfter:idleInterval];
+		
+	#pragma clang diagnostic pop
+	}};
+	
+	if (dispatch_get_specific(IsOnQueueKey))
+		block();
+	else
+		dispatch_async(queue, block);
+}
+
+/**
+ * See header file for description.
+ */
+- (void)stop
+{
+	ZDCLogAutoTrace();
+	
+	dispatch_block_t block = ^{ @autoreleasepool {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		[self cancelTask];
+		
+		generation++;
+		self.isRunning = NO;
+		
+	#pragma clang diagnostic pop
+	}};
+	
+	if (dispatch_get_specific(IsOnQueueKey))
+		block();
+	else
+		dispatch_async(queue, block);
+}
+
+- (void)cancelTask
+{
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	if (task)
+	{
+		[task cancel];
+		task = nil;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Polling
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)schedulePollAfter:(NSTimeInterval)delay
+{
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	const NSUInteger scheduledGeneration = generation;
+	
+	__weak typeof(self) weakSelf = self;
+	dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), queue, ^{ @autoreleasepool {
+		
+		[weakSelf pollForGeneration:scheduledGeneration];
+	}});
+}
+
+- (void)pollForGeneration:(NSUInteger)pollGeneration
+{
+	ZDCLogAutoTrace();
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	if (pollGeneration != generation) {
+		return; // stopped or restarted since this poll was scheduled
+	}
+	
+	__block NSString *latestChangeToken_local = nil;
+	
+	__weak typeof(self) weakSelf = self;
+	[zdc.databaseManager.roDatabaseConnection asyncReadWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (strongSelf == nil) return;
+		
+		ZDCChangeList *pullInfo = [transaction objectForKey:strongSelf->localUserID inCollection:kZDCCollection_PullState];
+		latestChangeToken_local = pullInfo.latestChangeID_local;
+		
+	} completionQueue:queue completionBlock:^{
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (strongSelf == nil) return;
+		
+		if (pollGeneration != strongSelf->generation) {
+			return;
+		}
+		
+		if (latestChangeToken_local.length == 0)
+		{
+			// We've never completed a pull, so there's nothing to subscribe to.
+			[strongSelf didDetectChanges:nil since:nil latest:nil generation:pollGeneration];
+			return;
+		}
+		
+		[strongSelf sendRequestWithChangeToken:latestChangeToken_local generation:pollGeneration];
+	}];
+}
+
+- (void)sendRequestWithChangeToken:(NSString *)latestChangeToken_local generation:(NSUInteger)requestGeneration
+{
+	ZDCLogAutoTrace();
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	__weak typeof(self) weakSelf = self;
+	[zdc.awsCredentialsManager getAWSCredentialsForUser: localUserID
+	                                    completionQueue: queue
+	                                    completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
+	{
+		__strong typeof(self) strongSelf = weakSelf;
+		if (strongSelf == nil) return;
+		
+		if (requestGeneration != strongSelf->generation) {
+			return;
+		}
+		
+		if (error)
+		{
+			// Auth failures are surfaced (to the user) by the PullManager.
+			// All we do here is back off.
+			
+			[strongSelf didFailForGeneration:requestGeneration];
+			return;
+		}
+		
+		ZeroDarkCloud *owner = strongSelf->zdc;
+		
+		ZDCSessionInfo *sessionInfo = [owner.sessionManager sessionInfoForUserID:strongSelf->localUserID];
+	#if TARGET_OS_IPHONE
+		AFURLSessionManager *session = sessionInfo.foregroundSession;
+	#else
+		AFURLSessionManager *session = sessionInfo.session;
+	#endif
+		ZDCSessionUserInfo *userInfo = sessionInfo.userInfo;
+		
+		AWSRegion region = userInfo.region;
+		NSString *stage = userInfo.stage;
+		if (!stage)
+		{
+		#ifdef AWS_STAGE // See PrefixHeader.pch
+			stage = AWS_STAGE;
+		#else
+			stage = @"prod";
+		#endif
+		}
+		
+		NSString *path = [NSString stringWithFormat:@"/pull/%@", latestChangeToken_local];
+		
+		NSURLComponents *urlComponents = [owner.restManager apiGatewayForRegion:region stage:stage path:path];
+		urlComponents.queryItems = @[
+			[NSURLQueryItem queryItemWithName:@"wait" value:[NSString stringWithFormat:@"%d", (int)ZDCLongPollWait]]
+		];
+		
+		NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[urlComponents URL]];
+		request.HTTPMethod = @"GET";
+		request.timeoutInterval = ZDCLongPollWait + 15.0;
+		
+		[AWSSignature signRequest:request
+		               withRegion:region
+		                  service:AWSService_APIGateway
+		              accessKeyID:auth.aws_accessKeyID
+		                   secret:auth.aws_secret
+		                  session:auth.aws_session];
+		
+		NSDate *requestStart = [NSDate date];
+		
+		NSURLSessionDataTask *dataTask =
+		  [session dataTaskWithRequest: request
+		                uploadProgress: nil
+		              downloadProgress: nil
+		             completionHandler:^(NSURLResponse *urlResponse, id responseObject, NSError *error)
+		{
+			NSTimeInterval elapsed = [[NSDate date] timeIntervalSinceDate:requestStart];
+			
+			__strong typeof(self) subscription = weakSelf;
+			if (subscription == nil) return;
+			
+			dispatch_async(subscription->queue, ^{ @autoreleasepool {
+				
+				[subscription processResponse: urlResponse
+				           responseObject: responseObject
+				                    error: error
+				                  elapsed: elapsed
+				  latestChangeToken_local: latestChangeToken_local
+				               generation: requestGeneration];
+			}});
+		}];
+		
+		strongSelf->task = dataTask;
+		[dataTask resume];
+	}];
+}
+
+- (void)processResponse:(NSURLResponse *)urlResponse
+         responseObject:(id)responseObject
+                  error:(NSError *)error
+                elapsed:(NSTimeInterval)elapsed
+latestChangeToken_local:(NSString *)latestChangeToken_local
+             generation:(NSUInteger)requestGeneration
+{
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	if (requestGeneration != generation) {
+		return; // cancelled
+	}
+	
+	task = nil;
+	
+	NSInteger statusCode = urlResponse.httpStatusCode;
+	if (error || statusCode != 200)
+	{
+		ZDCLogVerbose(@"[%@] API-Gateway: /pull/{change_token}?wait: status(%ld) err: %@",
+		              localUserID, (long)statusCode, error);
+		
+		[self didFailForGeneration:requestGeneration];
+		return;
+	}
+	
+	NSString *latestChangeToken_remote = nil;
+	NSMutableArray<ZDCChangeItem *> *changes = nil;
+	
+	if ([responseObject isKindOfClass:[NSDictionary class]])
+	{
+		NSDictionary *response = (NSDictionary *)responseObject;
+		
+		id value = response[@"latest_change_token"];
+		if ([value isKindOfClass:[NSString class]]) {
+			latestChangeToken_remote = (NSString *)value;
+		}
+		
+		value = response[@"changes"];
+		if ([value isKindOfClass:[NSArray class]])
+		{
+			NSArray *items = (NSArray *)value;
+			changes = [NSMutableArray arrayWithCapacity:items.count];
+			
+			for (id item in items)
+			{
+				if ([item isKindOfClass:[NSDictionary class]])
+				{
+					ZDCChangeItem *change = [ZDCChangeItem parseChangeInfo:(NSDictionary *)item];
+					if (change) {
+						[changes addObject:change];
+					}
+				}
+			}
+		}
+	}
+	
+	if (latestChangeToken_remote == nil)
+	{
+		[self didFailForGeneration:requestGeneration];
+		return;
+	}
+	
+	failCount = 0;
+	
+	if (changes.count > 0 || ![latestChangeToken_remote isEqualToString:latestChangeToken_local])
+	{
+		[self didDetectChanges: changes
+		                 since: latestChangeToken_local
+		                latest: latestChangeToken_remote
+		            generation: requestGeneration];
+		return;
+	}
+	
+	// Nothing new
+	
+	serverHoldsRequests = (elapsed >= ZDCLongPollThreshold);
+	
+	if (serverHoldsRequests)
+	{
+		idleInterval = ZDCMinIdleInterval;
+		[self pollForGeneration:requestGeneration];
+	}
+	else
+	{
+		[self schedulePollAfter:idleInterval];
+		idleInterval = MIN(idleInterval * 2.0, self.maxIdleInterval);
+	}
+}
+
+- (void)didFailForGeneration:(NSUInteger)failGeneration
+{
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	if (failGeneration != generation) {
+		return;
+	}
+	
+	task = nil;
+	failCount++;
+	
+	NSTimeInterval delay = [zdc.networkTools exponentialBackoffForFailCount:failCount];
+	delay = MAX(delay, idleInterval);
+	delay = MIN(delay, self.maxIdleInterval);
+	
+	[self schedulePollAfter:delay];
+}
+
+/**
+ * @param changes
+ *   The changes the server returned along with the response (if any).
+ *
+ * @param latestChangeToken_local
+ *   The changeToken we sent to the server (i.e. the changes are since this token).
+ *
+ * @param latestChangeToken_remote
+ *   The latest changeToken on the server.
+ */
+- (void)didDetectChanges:(nullable NSArray<ZDCChangeItem *> *)changes
+                   since:(nullable NSString *)latestChangeToken_local
+                  latest:(nullable NSString *)latestChangeToken_remote
+              generation:(NSUInteger)changeGeneration
+{
+	ZDCLogAutoTrace();
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	if (changeGeneration != generation) {
+		return;
+	}
+	
+	// We're done until the owner has pulled the changes, and restarts us.
+	// Changes tend to arrive in bursts, so go back to polling frequently.
+	
+	generation++;
+	self.isRunning = NO;
+	
+	idleInterval = ZDCMinIdleInterval;
+	
+	// If the response contains everything up to the server's latest changeToken,
+	// we hand the changes to the PullManager (via the ZDCChangeList), so the pull doesn't download them again.
+	//
+	// Otherwise (e.g. the server truncated the list), the pull fetches them itself,
+	// since it would have to go back to the server for the remainder anyway.
+	
+	NSString *lastChangeID = [[changes lastObject] uuid];
+	
+	if (lastChangeID && [lastChangeID isEqualToString:latestChangeToken_remote])
+	{
+		[zdc.pullManager processFetchedChanges: changes
+		                                 since: latestChangeToken_local
+		                                latest: latestChangeToken_remote
+		                        forLocalUserID: localUserID
+		                       completionQueue: changeQueue
+		                       completionBlock: changeBlock];
+	}
+	else
+	{
+		dispatch_async(changeQueue, changeBlock);
+	}
+}
+
+@end
@@ -0,0 +1,81 @@
+/**
+ * ZeroDark.cloud Framework
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+#import "AWSRegions.h"
+
+@class ZeroDarkCloud;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * @param stagingStatus
+ *   The status dictionary for the requestID (as returned by the server), if available.
+ *   If the server hasn't processed the staged request yet, this will be nil (or have a zero status).
+ *
+ * @param httpStatusCode
+ *   The HTTP status code of the (shared) poll request.
+ *
+ * @param error
+ *   Non-nil if the poll request failed due to a network error.
+ *   Errors from the server are reported via the httpStatusCode.
+ */
+typedef void (^ZDCPollAggregatorCompletion)(NSDictionary *_Nullable stagingStatus,
+                                            NSInteger httpStatusCode,
+                                            NSError *_Nullable error);
+
+/**
+ * After a put, move, delete (etc), the PushManager polls the server to find out whether the staged request
+ * has been processed. Rather than sending a request per operation, all in-flight polls for the same
+ * user & region are gathered (for a short window) and sent as a single multipoll: `POST /poll-request`.
+ *
+ * The aggregator also learns how long the server typically takes to process a staged request,
+ * which the PushManager uses to schedule the first poll. This is done by adjusting the delay
+ * according to the outcome of first polls: it shrinks a little on every hit, and grows on every miss.
+ * So the delay settles at the point where most (~80%) first polls find the request processed.
+ */
+@interface ZDCPollAggregator : NSObject
+
+- (instancetype)initWithOwner:(ZeroDarkCloud *)owner;
+
+/**
+ * Enqueues a status check for the given requestID.
+ * The completionBlock is invoked once the multipoll that includes it completes.
+ *
+ * @param isFirstPoll
+ *   Pass YES if this is the first poll for the staged request.
+ *   The outcome is used to adjust the `firstPollDelay`.
+ */
+- (void)pollRequestID:(NSString *)requestID
+          localUserID:(NSString *)localUserID
+               region:(AWSRegion)region
+          isFirstPoll:(BOOL)isFirstPoll
+      completionQueue:(dispatch_queue_t)completionQueue
+      completionBlock:(ZDCPollAggregatorCompletion)completionBlock;
+
+/**
+ * How long to wait (after the staged request has been uploaded) before polling for the first time.
+ */
+@property (atomic, readonly) NSTimeInterval firstPollDelay;
+
+#pragma mark Metrics
+
+/** The number of multipoll requests sent to the server. */
+@property (atomic, readonly) uint64_t pollRequestCount;
+
+/** The number of status checks performed (i.e. requestIDs included across all multipoll requests). */
+@property (atomic, readonly) uint64_t statusCheckCount;
+
+/** The number of status checks that found the staged request unprocessed (and thus had to poll again). */
+@property (atomic, readonly) uint64_t wastedStatusCheckCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
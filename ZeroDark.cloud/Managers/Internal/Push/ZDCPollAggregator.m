@@ -0,0 +1,499 @@
+/**
+ * ZeroDark.cloud Framework
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCPollAggregator.h"
+
+#import "AWSPayload.h"
+#import "AWSSignature.h"
+#import "ZDCConstantsPrivate.h"
+#import "ZDCDirectoryManager.h"
+#import "ZDCLogging.h"
+#import "ZDCMetricsManagerPrivate.h"
+#import "ZDCRestManager.h"
+#import "ZeroDarkCloudPrivate.h"
+
+// Categories
+#import "NSError+Auth0API.h"
+#import "NSURLResponse+ZeroDark.h"
+
+// Log Levels: off, error, warn, info, verbose
+// Log Flags : trace
+#if DEBUG && robbie_hanson
+  static const int zdcLogLevel = ZDCLogLevelInfo;
+#elif DEBUG
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#else
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#endif
+#pragma unused(zdcLogLevel)
+
+/**
+ * How long we gather status checks before sending the multipoll.
+ * Operations that finish staging at about the same time (e.g. during a bulk upload) share a request.
+ */
+static NSTimeInterval const ZDCPollBatchWindow = 0.1;
+
+/**
+ * The maximum number of requestIDs in a single multipoll.
+ * If a batch fills up, it's sent immediately.
+ */
+static NSUInteger const ZDCPollBatchMaxCount = 100;
+
+static NSTimeInterval const ZDCFirstPollDelayInitial = 1.0;
+static NSTimeInterval const ZDCFirstPollDelayMin     = 0.25;
+static NSTimeInterval const ZDCFirstPollDelayMax     = 15.0;
+
+// With these factors, the delay is stable when ~80% of first polls are hits:
+// 0.8 * ln(0.95) + 0.2 * ln(1.25) ≈ 0
+//
+static double const ZDCFirstPollDelayHitFactor  = 0.95;
+static double const ZDCFirstPollDelayMissFactor = 1.25;
+
+/**
+ * The names of the counters reported to the MetricsManager.
+ */
+static NSString *const ZDCMetric_PollRequests       = @"push: poll requests";
+static NSString *const ZDCMetric_StatusChecks       = @"push: poll status checks";
+static NSString *const ZDCMetric_WastedStatusChecks = @"push: poll wasted status checks";
+
+static NSInteger ZDCStagingStatusCode(NSDictionary *stagingStatus)
+{
+	id value = stagingStatus[@"status"];
+	
+	if ([value isKindOfClass:[NSNumber class]])
+		return [(NSNumber *)value integerValue];
+	else if ([value isKindOfClass:[NSString class]])
+		return [(NSString *)value integerValue];
+	else
+		return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface ZDCPollWaiter : NSObject
+
+@property (nonatomic, assign, readwrite) BOOL isFirstPoll;
+@property (nonatomic, strong, readwrite) dispatch_queue_t completionQueue;
+@property (nonatomic, copy, readwrite) ZDCPollAggregatorCompletion completionBlock;
+
+@end
+
+@implementation ZDCPollWaiter
+@end
+
+@interface ZDCPollBatch : NSObject
+
+@property (nonatomic, copy, readwrite) NSString *localUserID;
+@property (nonatomic, assign, readwrite) AWSRegion region;
+
+// key   : requestID
+// value : list of waiters (usually just one)
+//
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSString*, NSMutableArray<ZDCPollWaiter*>*> *waiters;
+
+@end
+
+@implementation ZDCPollBatch
+
+@synthesize waiters = waiters;
+
+- (instancetype)init
+{
+	if ((self = [super init]))
+	{
+		waiters = [[NSMutableDictionary alloc] init];
+	}
+	return self;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCPollAggregator {
+	
+	__weak ZeroDarkCloud *zdc;
+	
+	dispatch_queue_t queue;
+	
+	// The following variables must be accessed from within the queue.
+	
+	NSMutableDictionary<NSString*, ZDCPollBatch*> *pendingBatches; // key: localUserID|region
+	
+	NSTimeInterval firstPollDelay;
+	
+	uint64_t pollRequestCount;
+	uint64_t statusCheckCount;
+	uint64_t wastedStatusCheckCount;
+}
+
+- (instancetype)initWithOwner:(ZeroDarkCloud *)owner
+{
+	if ((self = [super init]))
+	{
+		zdc = owner;
+		
+		queue = dispatch_queue_create("ZDCPollAggregator", DISPATCH_QUEUE_SERIAL);
+		pendingBatches = [[NSMutableDictionary alloc] init];
+		
+		firstPollDelay = ZDCFirstPollDelayInitial;
+	}
+	return self;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Accessors
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (NSTimeInterval)firstPollDelay
+{
+	__block NSTimeInterval result = 0;
+	dispatch_sync(queue, ^{
+		result = self->firstPollDelay;
+	});
+	
+	return result;
+}
+
+- (uint64_t)pollRequestCount
+{
+	__block uint64_t result = 0;
+	dispatch_sync(queue, ^{
+		result = self->pollRequestCount;
+	});
+	
+	return result;
+}
+
+- (uint64_t)statusCheckCount
+{
+	__block uint64_t result = 0;
+	dispatch_sync(queue, ^{
+		result = self->statusCheckCount;
+	});
+	
+	return result;
+}
+
+- (uint64_t)wastedStatusCheckCount
+{
+	__block uint64_t result = 0;
+	dispatch_sync(queue, ^{
+		result = self->wastedStatusCheckCount;
+	});
+	
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Batching
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * See header file for description.
+ */
+- (void)pollRequestID:(NSString *)requestID
+          localUserID:(NSString *)localUserID
+               region:(AWSRegion)region
+          isFirstPoll:(BOOL)isFirstPoll
+      completionQueue:(dispatch_queue_t)completionQueue
+      completionBlock:(ZDCPollAggregatorCompletion)completionBlock
+{
+	NSParameterAssert(requestID != nil);
+	NSParameterAssert(localUserID != nil);
+	NSParameterAssert(completionQueue != nil);
+	NSParameterAssert(completionBlock != nil);
+	
+	ZDCPollWaiter *waiter = [[ZDCPollWaiter alloc] init];
+	waiter.isFirstPoll = isFirstPoll;
+	waiter.completionQueue = completionQueue;
+	waiter.completionBlock = completionBlock;
+	
+	NSString *batchKey = [NSString stringWithFormat:@"%@|%ld", localUserID, (long)region];
+	
+	dispatch_async(queue, ^{ @autoreleasepool {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		ZDCPollBatch *batch = pendingBatches[batchKey];
+		if (batch == nil)
+		{
+			batch = [[ZDCPollBatch alloc] init];
+			batch.localUserID = localUserID;
+			batch.region = region;
+			
+			pendingBatches[batchKey] = batch;
+			
+			__weak typeof(self) weakSelf = self;
+			dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(ZDCPollBatchWindow * NSEC_PER_SEC)), queue, ^{
+				
+				[weakSelf flushBatch:batch forKey:batchKey];
+			});
+		}
+		
+		NSMutableArray<ZDCPollWaiter*> *waitersForRequestID = batch.waiters[requestID];
+		if (waitersForRequestID == nil)
+		{
+			waitersForRequestID = [[NSMutableArray alloc] initWithCapacity:1];
+			batch.waiters[requestID] = waitersForRequestID;
+		}
+		[waitersForRequestID addObject:waiter];
+		
+		if (batch.waiters.count >= ZDCPollBatchMaxCount)
+		{
+			[self flushBatch:batch forKey:batchKey];
+		}
+		
+	#pragma clang diagnostic pop
+	}});
+}
+
+/**
+ * Must be invoked from within the queue.
+ */
+- (void)flushBatch:(ZDCPollBatch *)batch forKey:(NSString *)batchKey
+{
+	if (pendingBatches[batchKey] != batch)
+	{
+		return; // already flushed (filled up before the window expired)
+	}
+	
+	[pendingBatches removeObjectForKey:batchKey];
+	pollRequestCount++;
+	
+	[zdc.metricsManager incrementCounter:ZDCMetric_PollRequests by:1];
+	
+	[self sendBatch:batch];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Networking
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)sendBatch:(ZDCPollBatch *)batch
+{
+	ZDCLogAutoTrace();
+	
+	NSString *localUserID = batch.localUserID;
+	NSArray<NSString*> *requestIDs = [batch.waiters allKeys];
+	
+	NSDictionary *json_dict = @{
+		@"request_ids": requestIDs
+	};
+	
+	NSError *json_error = nil;
+	NSData *json_data = [NSJSONSerialization dataWithJSONObject:json_dict options:0 error:&json_error];
+	
+	if (json_error) {
+		ZDCLogError(@"JSON serialization error: %@", json_error);
+	}
+	
+	__weak typeof(self) weakSelf = self;
+	[zdc.awsCredentialsManager getAWSCredentialsForUser: localUserID
+	                                    completionQueue: queue
+	                                    completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
+	{
+		__strong typeof(self) strongSelf = weakSelf;
+		if (strongSelf == nil) return;
+		
+		if (error)
+		{
+			if ([error.auth0API_error isEqualToString:kAuth0Error_RateLimit])
+			{
+				// Auth0 is just rate limiting us.
+				// Normal path will automatically execute exponential backoff.
+			}
+			else
+			{
+				// Auth0 is indicating our account may have been removed.
+				[strongSelf->zdc.networkTools handleAuthFailureForUser:localUserID withError:error];
+			}
+			
+			[strongSelf batch:batch didCompleteWithStatusCode:0 error:error responseObject:nil];
+			return;
+		}
+		
+		ZeroDarkCloud *owner = strongSelf->zdc;
+		ZDCSessionInfo *sessionInfo = [owner.sessionManager sessionInfoForUserID:localUserID];
+		
+	#if TARGET_OS_IPHONE
+		AFURLSessionManager *session = sessionInfo.backgroundSession;
+	#else
+		AFURLSessionManager *session = sessionInfo.session;
+	#endif
+		ZDCSessionUserInfo *userInfo = sessionInfo.userInfo;
+		
+		NSString *stage = userInfo.stage;
+		if (!stage)
+		{
+		#ifdef AWS_STAGE // See PrefixHeader.pch
+			stage = AWS_STAGE;
+		#else
+			stage = @"prod";
+		#endif
+		}
+		
+		NSString *path = @"/poll-request";
+		NSURLComponents *urlComponents = [owner.restManager apiGatewayForRegion:batch.region stage:stage path:path];
+		
+		NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[urlComponents URL]];
+		request.HTTPMethod = @"POST";
+		
+		[AWSSignature signRequest: request
+		               withRegion: batch.region
+		                  service: AWSService_APIGateway
+		              accessKeyID: auth.aws_accessKeyID
+		                   secret: auth.aws_secret
+		                  session: auth.aws_session
+		               payloadSig: [AWSPayload signatureForPayload:json_data]];
+		
+		void (^completionHandler)(NSURLResponse *, id, NSError *) =
+		^(NSURLResponse *response, id responseObject, NSError *error) {
+			
+			NSInteger statusCode = response.httpStatusCode;
+			if (response && error)
+			{
+				error = nil; // we only care about non-server-response errors
+			}
+			
+			__strong typeof(self) strongSelf = weakSelf;
+			if (strongSelf == nil) return;
+			
+			dispatch_async(strongSelf->queue, ^{ @autoreleasepool {
+				
+				[strongSelf batch:batch didCompleteWithStatusCode:statusCode error:error responseObject:responseObject];
+			}});
+		};
+		
+	#if TARGET_OS_IPHONE
+		
+		// Background NSURLSession's don't support data tasks !
+		//
+		// So we write the data to a temporary location on disk, in order to use a file task.
+		
+		NSString *fileName = [[NSUUID UUID] UUIDString];
+		
+		NSURL *tempDir = [ZDCDirectoryManager tempDirectoryURL];
+		NSURL *tempFileURL = [tempDir URLByAppendingPathComponent:fileName isDirectory:NO];
+		
+		NSError *fileError = nil;
+		[json_data writeToURL:tempFileURL options:0 error:&fileError];
+		
+		if (fileError)
+		{
+			ZDCLogError(@"Error writing multipoll data (%@): %@", tempFileURL.path, fileError);
+		}
+		
+		NSURLSessionUploadTask *task =
+		  [session uploadTaskWithRequest: request
+		                        fromFile: tempFileURL
+		                        progress: nil
+		               completionHandler:^(NSURLResponse *response, id responseObject, NSError *error)
+		{
+			[[NSFileManager defaultManager] removeItemAtURL:tempFileURL error:nil];
+			completionHandler(response, responseObject, error);
+		}];
+		
+	#else // macOS
+		
+		NSURLSessionUploadTask *task =
+		  [session uploadTaskWithRequest: request
+		                        fromData: json_data
+		                        progress: nil
+		               completionHandler: completionHandler];
+		
+	#endif
+		
+		[task resume];
+	}];
+}
+
+/**
+ * Must be invoked from within the queue.
+ */
+- (void)batch:(ZDCPollBatch *)batch
+didCompleteWithStatusCode:(NSInteger)httpStatusCode
+        error:(NSError *)error
+responseObject:(id)responseObject
+{
+	NSDictionary *results = nil;
+	if (!error && httpStatusCode == 200 && [responseObject isKindOfClass:[NSDictionary class]])
+	{
+		results = (NSDictionary *)responseObject;
+	}
+	
+	__block uint64_t statusChecks = 0;
+	__block uint64_t wastedStatusChecks = 0;
+	
+	[batch.waiters enumerateKeysAndObjectsUsingBlock:
+	  ^(NSString *requestID, NSMutableArray<ZDCPollWaiter*> *waiters, BOOL *stop)
+	{
+		NSDictionary *stagingStatus = nil;
+		
+		if (results)
+		{
+			id value = results[requestID];
+			if ([value isKindOfClass:[NSDictionary class]]) {
+				stagingStatus = (NSDictionary *)value;
+			}
+			
+			BOOL isProcessed = (ZDCStagingStatusCode(stagingStatus) != 0);
+			
+			statusChecks++;
+			if (!isProcessed) {
+				wastedStatusChecks++;
+			}
+			
+			for (ZDCPollWaiter *waiter in waiters)
+			{
+				if (waiter.isFirstPoll) {
+					[self adjustFirstPollDelay:isProcessed];
+				}
+			}
+		}
+		
+		for (ZDCPollWaiter *waiter in waiters)
+		{
+			ZDCPollAggregatorCompletion completionBlock = waiter.completionBlock;
+			
+			dispatch_async(waiter.completionQueue, ^{ @autoreleasepool {
+				
+				completionBlock(stagingStatus, httpStatusCode, error);
+			}});
+		}
+	}];
+	
+	statusCheckCount += statusChecks;
+	wastedStatusCheckCount += wastedStatusChecks;
+	
+	ZDCMetricsManager *metricsManager = zdc.metricsManager;
+	[metricsManager incrementCounter:ZDCMetric_StatusChecks by:statusChecks];
+	[metricsManager incrementCounter:ZDCMetric_WastedStatusChecks by:wastedStatusChecks];
+}
+
+/**
+ * Must be invoked from within the queue.
+ */
+- (void)adjustFirstPollDelay:(BOOL)wasHit
+{
+	NSTimeInterval delay = firstPollDelay;
+	
+	if (wasHit)
+		delay *= ZDCFirstPollDelayHitFactor;
+	else
+		delay *= ZDCFirstPollDelayMissFactor;
+	
+	firstPollDelay = MAX(ZDCFirstPollDelayMin, MIN(delay, ZDCFirstPollDelayMax));
+}
+
+@end
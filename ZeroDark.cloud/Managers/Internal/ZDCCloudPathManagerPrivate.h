@@ -0,0 +1,34 @@
+/**
+ * ZeroDark.cloud
+ * 
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCCloudPathManager.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface ZDCCloudPathManager (Private)
+
+/**
+ * Derives the cloudName for a node with the given name, and a parent with the given dirSalt.
+ *
+ * Results are memoized (in a bounded in-memory cache), so repeated calls skip the KDF.
+ */
+- (NSString *)cloudNameForName:(NSString *)name withParentDirSalt:(NSData *)parentDirSalt;
+
+/**
+ * Batch version of `cloudNameForName:withParentDirSalt:`.
+ *
+ * @return
+ *   A dictionary of the form: { name => cloudName }
+ */
+- (NSDictionary<NSString*, NSString*> *)cloudNamesForNames:(NSArray<NSString*> *)names
+                                         withParentDirSalt:(NSData *)parentDirSalt;
+
+@end
+
+NS_ASSUME_NONNULL_END
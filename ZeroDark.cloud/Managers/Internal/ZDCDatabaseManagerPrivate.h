@@ -9,6 +9,7 @@
 
 #import "ZDCDatabaseManager.h"
 #import "ZeroDarkCloud.h"
+#import "ZDCDatabaseWriteCoalescer.h"
 
 @interface ZDCDatabaseManager (Private)
 
@@ -38,8 +39,16 @@
  *
  * By queueing our own (internal) read-write transactions into a separate connection,
  * we ensure we aren't starving the user's own transactions.
+ *
+ * The coalescer owns this internal connection, and ALL internal writes must go through it:
+ * - Small updates (e.g. per-node pull/push/download updates) use `asyncReadWriteWithBlock:`,
+ *   and are committed in batches. This dramatically reduces the number of sqlite commits
+ *   (and change notifications) during a large pull.
+ * - Everything else uses `asyncUncoalescedReadWriteWithBlock:`, and gets its own transaction.
+ *
+ * Either way, writes are committed in the order in which they were submitted.
  */
-- (YapDatabaseConnection *)internal_rwConnection;
+- (ZDCDatabaseWriteCoalescer *)internal_writeCoalescer;
 
 /**
  * The PushManager & PullManager need to perform various decryption routines within a transaction.
@@ -48,6 +57,12 @@
  */
 - (YapDatabaseConnection *)internal_decryptConnection;
 
+/**
+ * Same as `-cloudExtNameForUserID:treeID:`.
+ * For use by classes that don't have access to the ZeroDarkCloud instance (e.g. ZDCNodeManager).
+ */
++ (NSString *)cloudExtNameForUserID:(NSString *)localUserID treeID:(NSString *)treeID;
+
 /**
  * The list of {localUserID, treeID} tuples that currently have a ZDCCloud extension registered.
  */
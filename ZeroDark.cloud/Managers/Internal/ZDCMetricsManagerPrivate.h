@@ -0,0 +1,92 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCMetricsManager.h"
+#import "ZDCHostConnectionStats.h"
+#import "ZeroDarkCloud.h"
+
+#include <time.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Returns a monotonic timestamp (in nanoseconds), suitable for measuring durations.
+ */
+static inline uint64_t ZDCMetricsNow(void)
+{
+	return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+/**
+ * The bucket layout of the latency histograms (values are in microseconds).
+ *
+ * Values below 32 each get their own bucket.
+ * Above that, every power-of-2 range is split into 16 linear sub-buckets.
+ * Values above 2^36 - 1 are clamped into the last bucket (index 527).
+ */
+extern NSUInteger ZDCHistogramBucketIndex(uint64_t value);
+
+/**
+ * Returns the value reported for the given bucket (the middle of its range).
+ */
+extern uint64_t ZDCHistogramBucketMidpoint(NSUInteger index);
+
+@interface ZDCMetricsManager (Private)
+
+- (instancetype)initWithOwner:(ZeroDarkCloud *)owner;
+
+/**
+ * Records a single event for the given metric.
+ *
+ * @param duration
+ *   The duration of the event, in nanoseconds.
+ */
+- (void)recordDuration:(uint64_t)duration
+                 bytes:(uint64_t)bytes
+                failed:(BOOL)failed
+             forMetric:(NSString *)name;
+
+/**
+ * Convenience method: the duration is calculated as `ZDCMetricsNow() - startTime`.
+ */
+- (void)recordDurationSince:(uint64_t)startTime failed:(BOOL)failed forMetric:(NSString *)name;
+
+/**
+ * Increments a counter (a metric without any durations).
+ * Counters are included in the snapshot, with only the count set.
+ */
+- (void)incrementCounter:(NSString *)name by:(uint64_t)amount;
+
+/**
+ * Forwarded from ZDCSessionManager.
+ * Records a completed REST or S3 request, using the task's request to determine the metric.
+ */
+- (void)recordTask:(NSURLSessionTask *)task metrics:(NSURLSessionTaskMetrics *)metrics;
+
+/**
+ * Returns a snapshot of the connection statistics for each host contacted so far (gathered by `recordTask:metrics:`),
+ * sorted by host.
+ *
+ * This is the source used by `exportSnapshotToURL:error:`.
+ */
+- (NSArray<ZDCHostConnectionStats*> *)hostConnectionStats;
+
+/**
+ * The crypto streams don't know which ZeroDarkCloud instance they're working for.
+ * So encryption/decryption throughput is tracked process-wide, and included in every snapshot.
+ * (Each instance reports the counts since its own last `reset`.)
+ *
+ * These methods are lock-free, and safe to call from any thread.
+ */
++ (void)recordEncryptedBytes:(uint64_t)bytes duration:(uint64_t)duration;
++ (void)recordDecryptedBytes:(uint64_t)bytes duration:(uint64_t)duration;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,87 @@
+/**
+ * ZeroDark.cloud
+ * 
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCNodeManager.h"
+#import "ZDCNodeMeta.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface ZDCNodeManager (Private)
+
+/**
+ * Computes the values for the `Ext_Index_Paths` secondary index,
+ * by walking the parent chain of the node (i.e. without consulting the index).
+ *
+ * Returns nil if the node isn't attached to a trunk (e.g. detached nodes),
+ * in which case the node shouldn't be indexed.
+ *
+ * Pointees don't get a lookup value, since they share the path of their pointer.
+ */
+- (nullable NSDictionary<NSString*, NSString*> *)pathIndexValuesForNode:(ZDCNode *)node
+                                                            transaction:(YapDatabaseReadTransaction *)transaction;
+
+/**
+ * Returns the currently indexed (encoded) path for the given node,
+ * or nil if the node isn't indexed, or if the `Ext_Index_Paths` extension isn't ready.
+ */
+- (nullable NSString *)indexedPathStringForNodeID:(NSString *)nodeID
+                                      transaction:(YapDatabaseReadTransaction *)transaction;
+
+/**
+ * Invoked (via the `Ext_Hooks_NodeStats` extension) whenever a node is inserted, modified or removed.
+ * Applies the corresponding delta to the ZDCNodeStats of every ancestor.
+ *
+ * @param oldNode
+ *   The node as it was before the change (nil if inserted).
+ *
+ * @param newNode
+ *   The node as it is after the change (nil if removed).
+ */
+- (void)updateStatsWithOldNode:(nullable ZDCNode *)oldNode
+                       newNode:(nullable ZDCNode *)newNode
+                   transaction:(YapDatabaseReadWriteTransaction *)transaction;
+
+/**
+ * Invoked by ZDCCloudTransaction when a node gains its first queued put operation (+1),
+ * or loses its last one (-1). Applies the delta to the pendingUploadCount of every ancestor.
+ */
+- (void)applyPendingUploadDelta:(int64_t)pendingUploadCountDelta
+                      forNodeID:(NSString *)nodeID
+                    transaction:(YapDatabaseReadWriteTransaction *)transaction;
+
+/**
+ * Populates the ZDCNodeStats for every node in the database, if it hasn't been done already.
+ * (e.g. the first launch after upgrading to a version of the framework that supports node stats)
+ */
+- (void)rebuildStatsIfNeeded:(YapDatabaseReadWriteTransaction *)transaction;
+
+/**
+ * Returns the ZDCNodeMeta for the given node.
+ *
+ * This is usually read from kZDCCollection_NodeMeta.
+ * But if it's missing (e.g. it hasn't been populated yet), it's derived from the node itself.
+ *
+ * Returns nil if the node doesn't exist.
+ */
+- (nullable ZDCNodeMeta *)metaForNodeID:(NSString *)nodeID transaction:(YapDatabaseReadTransaction *)transaction;
+
+/**
+ * Derives a fresh ZDCNodeMeta from the given node (i.e. without consulting kZDCCollection_NodeMeta).
+ */
+- (ZDCNodeMeta *)makeMetaForNode:(ZDCNode *)node transaction:(YapDatabaseReadTransaction *)transaction;
+
+/**
+ * Populates the ZDCNodeMeta for every node in the database, if it hasn't been done already.
+ * (e.g. the first launch after upgrading to a version of the framework that supports node meta)
+ */
+- (void)rebuildMetaIfNeeded:(YapDatabaseReadWriteTransaction *)transaction;
+
+@end
+
+NS_ASSUME_NONNULL_END
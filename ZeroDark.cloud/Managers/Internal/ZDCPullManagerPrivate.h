@@ -10,6 +10,7 @@
 #import "ZDCPullManager.h"
 #import "ZeroDarkCloud.h"
 #import "ZDCPushInfo.h"
+#import "ZDCChangeItem.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -22,6 +23,20 @@ NS_ASSUME_NONNULL_BEGIN
                 completionQueue:(nullable dispatch_queue_t)completionQueue
                 completionBlock:(void (^)(BOOL needsPull))completionBlock;
 
+/**
+ * Forwarded from ZDCChangeSubscription.
+ *
+ * Stores changes (that the subscription received from the server) in the ZDCChangeList,
+ * so the next pull can process them without fetching them again.
+ * We do NOT start any pull operations here.
+ */
+- (void)processFetchedChanges:(NSArray<ZDCChangeItem *> *)changes
+                        since:(NSString *)latestChangeToken_local
+                       latest:(NSString *)latestChangeToken_remote
+               forLocalUserID:(NSString *)localUserID
+              completionQueue:(nullable dispatch_queue_t)completionQueue
+              completionBlock:(nullable dispatch_block_t)completionBlock;
+
 @end
 
 NS_ASSUME_NONNULL_END
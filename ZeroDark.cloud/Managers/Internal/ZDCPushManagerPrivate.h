@@ -10,6 +10,7 @@
 #import "ZDCPushManager.h"
 #import "ZeroDarkCloud.h"
 
+#import "ZDCPollAggregator.h"
 #import "ZDCPollContext.h"
 #import "ZDCPushInfo.h"
 #import "ZDCTaskContext.h"
@@ -21,6 +22,11 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (instancetype)initWithOwner:(ZeroDarkCloud *)owner;
 
+/**
+ * Batches poll requests for staged operations, and tracks the related metrics.
+ */
+@property (nonatomic, readonly) ZDCPollAggregator *pollAggregator;
+
 /** Forwarded from ZeroDarkCloud. */
 - (void)processPushNotification:(ZDCPushInfo *)pushInfo;
 
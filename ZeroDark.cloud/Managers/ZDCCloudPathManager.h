@@ -199,6 +199,25 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (nullable NSString *)cloudNameForNode:(ZDCNode *)node transaction:(YapDatabaseReadTransaction *)transaction;
 
+/**
+ * Calculates & returns the cloudName for every direct child of the given node.
+ *
+ * This is faster than invoking `cloudNameForNode:transaction:` for each child,
+ * as the parent's dirSalt only needs to be fetched once.
+ *
+ * @param parent
+ *   The parent node. Must have a dirSalt value.
+ *
+ * @param transaction
+ *   A transaction is required to read from the database.
+ *
+ * @return
+ *   A dictionary of the form: { nodeID => cloudName }.
+ *   Children for which a cloudName cannot be derived (e.g. node.name is nil) are omitted.
+ */
+- (NSDictionary<NSString*, NSString*> *)cloudNamesForChildrenOfNode:(ZDCNode *)parent
+                                                        transaction:(YapDatabaseReadTransaction *)transaction;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -7,7 +7,7 @@
  * API Reference : https://apis.zerodark.cloud
 **/
 
-#import "ZDCCloudPathManager.h"
+#import "ZDCCloudPathManagerPrivate.h"
 
 #import "ZDCLogging.h"
 #import "ZDCNodeManager.h"
@@ -16,6 +16,9 @@
 #import "NSString+S4.h"
 #import "NSString+ZeroDark.h"
 
+// Libraries
+#import <YapDatabase/YapCache.h>
+
 // Log Levels: off, error, warn, info, verbose
 // Log Flags : trace
 #if DEBUG
@@ -24,7 +27,73 @@
   static const int zdcLogLevel = ZDCLogLevelWarning;
 #endif
 
-@implementation ZDCCloudPathManager
+#define CLOUD_NAME_CACHE_LIMIT 4096
+
+/**
+ * Key for the cloudName cache: (parentDirSalt, normalizedName) tuple.
+ *
+ * Since the dirSalt is part of the key, a cached cloudName can never be stale.
+ * Entries for old dirSalts simply age out of the cache (CLOUD_NAME_CACHE_LIMIT).
+ */
+@interface ZDCCloudNameCacheKey : NSObject <NSCopying>
+
+- (instancetype)initWithDirSalt:(NSData *)dirSalt normalizedName:(NSString *)normalizedName;
+
+@property (nonatomic, readonly) NSData *dirSalt;
+@property (nonatomic, readonly) NSString *normalizedName;
+
+@end
+
+@implementation ZDCCloudNameCacheKey {
+	NSUInteger _hash;
+}
+
+@synthesize dirSalt = _dirSalt;
+@synthesize normalizedName = _normalizedName;
+
+- (instancetype)initWithDirSalt:(NSData *)dirSalt normalizedName:(NSString *)normalizedName
+{
+	if ((self = [super init]))
+	{
+		_dirSalt = [dirSalt copy];
+		_normalizedName = [normalizedName copy];
+		_hash = _dirSalt.hash ^ _normalizedName.hash;
+	}
+	return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	return self; // immutable
+}
+
+- (NSUInteger)hash
+{
+	return _hash;
+}
+
+- (BOOL)isEqual:(id)object
+{
+	if (![object isKindOfClass:[ZDCCloudNameCacheKey class]]) return NO;
+	
+	__unsafe_unretained ZDCCloudNameCacheKey *another = (ZDCCloudNameCacheKey *)object;
+	
+	return (_hash == another->_hash)
+	    && [_normalizedName isEqualToString:another->_normalizedName]
+	    && [_dirSalt isEqualToData:another->_dirSalt];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCCloudPathManager {
+	
+	dispatch_queue_t cacheQueue;
+	YapCache<ZDCCloudNameCacheKey*, NSString*> *cloudNameCache; // must be accessed from within cacheQueue
+}
 
 static ZDCCloudPathManager *sharedInstance = nil;
 
@@ -42,6 +111,21 @@ static ZDCCloudPathManager *sharedInstance = nil;
 	return sharedInstance;
 }
 
+- (instancetype)init
+{
+	if ((self = [super init]))
+	{
+		cacheQueue = dispatch_queue_create("ZDCCloudPathManager.cacheQueue", DISPATCH_QUEUE_SERIAL);
+		
+		cloudNameCache = [[YapCache alloc] initWithCountLimit:CLOUD_NAME_CACHE_LIMIT];
+	#ifndef NS_BLOCK_ASSERTIONS
+		cloudNameCache.allowedKeyClasses = [NSSet setWithObject:[ZDCCloudNameCacheKey class]];
+		cloudNameCache.allowedObjectClasses = [NSSet setWithObject:[NSString class]];
+	#endif
+	}
+	return self;
+}
+
 /**
  * See header file for description.
  * Or view the api's online (for both Swift & Objective-C):
@@ -262,18 +346,165 @@ static ZDCCloudPathManager *sharedInstance = nil;
 	return [self cloudNameForName:node.name withParentDirSalt:parentDirSalt];
 }
 
+/**
+ * See header file for description.
+ * Or view the api's online (for both Swift & Objective-C):
+ * https://apis.zerodark.cloud/Classes/ZDCCloudPathManager.html
+ */
+- (NSDictionary<NSString*, NSString*> *)cloudNamesForChildrenOfNode:(ZDCNode *)parent
+                                                        transaction:(YapDatabaseReadTransaction *)transaction
+{
+	NSMutableDictionary<NSString*, NSString*> *results = [NSMutableDictionary dictionary];
+	
+	NSData *parentDirSalt = parent.dirSalt;
+	if (parent.uuid == nil || parentDirSalt == nil) {
+		ZDCLogWarn(@"Cannot derive cloudNames for children of node(%@): missing uuid or dirSalt", parent.name);
+		return results;
+	}
+	
+	NSMutableDictionary<NSString*, NSMutableArray<NSString*>*> *nodeIDsByName = [NSMutableDictionary dictionary];
+	
+	[[ZDCNodeManager sharedInstance] enumerateNodesWithParentID: parent.uuid
+	                                                transaction: transaction
+	                                                 usingBlock:^(ZDCNode *node, BOOL *stop)
+	{
+		if (node.explicitCloudName)
+		{
+			results[node.uuid] = node.explicitCloudName;
+		}
+		else if (node.name)
+		{
+			NSMutableArray<NSString*> *nodeIDs = nodeIDsByName[node.name];
+			if (nodeIDs == nil)
+			{
+				nodeIDs = [NSMutableArray arrayWithCapacity:1];
+				nodeIDsByName[node.name] = nodeIDs;
+			}
+			[nodeIDs addObject:node.uuid];
+		}
+	}];
+	
+	NSDictionary<NSString*, NSString*> *cloudNames =
+	  [self cloudNamesForNames:[nodeIDsByName allKeys] withParentDirSalt:parentDirSalt];
+	
+	[nodeIDsByName enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSArray<NSString*> *nodeIDs, BOOL *stop) {
+		
+		NSString *cloudName = cloudNames[name];
+		if (cloudName)
+		{
+			for (NSString *nodeID in nodeIDs) {
+				results[nodeID] = cloudName;
+			}
+		}
+	}];
+	
+	return results;
+}
+
+/**
+ * The treesystem is case-insensitive.
+ * See discussion here for details & explanation:
+ * https://zerodarkcloud.readthedocs.io/en/latest/client/tree/
+ */
+static NSString* NormalizedName(NSString *name)
+{
+	return [name lowercaseString];
+}
+
+static NSString* DeriveCloudName(NSString *normalizedName, NSData *parentDirSalt)
+{
+	return [normalizedName KDFWithSeedKey:parentDirSalt label:@"file_salt_label"];
+}
+
 /**
  * Private method - declared in ZDCCloudPathManagerPrivate.h
  */
 - (NSString *)cloudNameForName:(NSString *)name withParentDirSalt:(NSData *)parentDirSalt
 {
-	// The treesystem is case-insensitive.
-	// See discussion here for details & explanation:
-	// https://zerodarkcloud.readthedocs.io/en/latest/client/tree/
-	//
-	NSString *nameToHash = [name lowercaseString];
+	ZDCCloudNameCacheKey *cacheKey =
+	  [[ZDCCloudNameCacheKey alloc] initWithDirSalt:parentDirSalt normalizedName:NormalizedName(name)];
+	
+	__block NSString *cloudName = nil;
+	dispatch_sync(cacheQueue, ^{
+		
+		cloudName = [self->cloudNameCache objectForKey:cacheKey];
+	});
+	
+	if (cloudName == nil)
+	{
+		// Perform the KDF outside the cacheQueue, so we don't block other threads.
+		
+		cloudName = DeriveCloudName(cacheKey.normalizedName, parentDirSalt);
+		if (cloudName)
+		{
+			dispatch_sync(cacheQueue, ^{
+				
+				[self->cloudNameCache setObject:cloudName forKey:cacheKey];
+			});
+		}
+	}
+	
+	return cloudName;
+}
+
+/**
+ * Private method - declared in ZDCCloudPathManagerPrivate.h
+ */
+- (NSDictionary<NSString*, NSString*> *)cloudNamesForNames:(NSArray<NSString*> *)names
+                                         withParentDirSalt:(NSData *)parentDirSalt
+{
+	NSMutableDictionary<NSString*, NSString*> *results = [NSMutableDictionary dictionaryWithCapacity:names.count];
+	
+	NSMutableArray<ZDCCloudNameCacheKey*> *cacheKeys = [NSMutableArray arrayWithCapacity:names.count];
+	for (NSString *name in names)
+	{
+		[cacheKeys addObject:[[ZDCCloudNameCacheKey alloc] initWithDirSalt:parentDirSalt
+		                                                    normalizedName:NormalizedName(name)]];
+	}
+	
+	NSMutableIndexSet *misses = [NSMutableIndexSet indexSet];
+	
+	dispatch_sync(cacheQueue, ^{
+		
+		[cacheKeys enumerateObjectsUsingBlock:^(ZDCCloudNameCacheKey *cacheKey, NSUInteger idx, BOOL *stop) {
+			
+			NSString *cloudName = [self->cloudNameCache objectForKey:cacheKey];
+			if (cloudName) {
+				results[names[idx]] = cloudName;
+			} else {
+				[misses addIndex:idx];
+			}
+		}];
+	});
+	
+	if (misses.count == 0) {
+		return results;
+	}
+	
+	NSMutableDictionary<ZDCCloudNameCacheKey*, NSString*> *derived =
+	  [NSMutableDictionary dictionaryWithCapacity:misses.count];
+	
+	[misses enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+		
+		ZDCCloudNameCacheKey *cacheKey = cacheKeys[idx];
+		
+		NSString *cloudName = DeriveCloudName(cacheKey.normalizedName, parentDirSalt);
+		if (cloudName)
+		{
+			results[names[idx]] = cloudName;
+			derived[cacheKey] = cloudName;
+		}
+	}];
+	
+	dispatch_sync(cacheQueue, ^{
+		
+		[derived enumerateKeysAndObjectsUsingBlock:^(ZDCCloudNameCacheKey *cacheKey, NSString *cloudName, BOOL *stop) {
+			
+			[self->cloudNameCache setObject:cloudName forKey:cacheKey];
+		}];
+	});
 	
-	return [nameToHash KDFWithSeedKey:parentDirSalt label:@"file_salt_label"];
+	return results;
 }
 
 @end
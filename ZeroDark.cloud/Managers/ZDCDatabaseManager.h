@@ -100,6 +100,49 @@ extern NSString *const Ext_Index_Nodes;
  */
 extern NSString *const Ext_Index_Users;
 
+/**
+ * YapDatabase extension of type: YapDatabaseSecondaryIndex <br/>
+ * Access via: `transaction.ext(Ext_Index_Paths) as? YapDatabaseSecondaryIndexTransaction`
+ *
+ * Indexes ZDCNode's by their (normalized) treesystem path, scoped to the {localUserID, treeID} tuple.
+ * Used by `ZDCNodeManager` to implement `pathForNode:` & `findNodeWithPath:` as a single lookup.
+ */
+extern NSString *const Ext_Index_Paths;
+
+/**
+ * YapDatabase extension of type: YapDatabaseHooks <br/>
+ *
+ * Keeps `Ext_Index_Paths` up-to-date when a node is inserted, renamed or moved (or its pointee changes),
+ * by re-indexing all the descendants of the node (including grafted subtrees).
+ */
+extern NSString *const Ext_Hooks_Paths;
+
+/**
+ * YapDatabase extension of type: YapDatabaseHooks <br/>
+ *
+ * Keeps the ZDCNodeStats (stored in kZDCCollection_NodeStats) up-to-date,
+ * by applying a delta to every ancestor whenever a node is inserted, modified or removed.
+ * The deltas are batched, and written when the transaction commits.
+ */
+extern NSString *const Ext_Hooks_NodeStats;
+
+/**
+ * YapDatabase extension of type: YapDatabaseHooks <br/>
+ *
+ * Keeps the ZDCNodeMeta (stored in kZDCCollection_NodeMeta) up-to-date,
+ * by writing it just before a node is inserted or modified (and removing it with the node).
+ * The node views & indexes read the meta instead of the full node.
+ */
+extern NSString *const Ext_Hooks_NodeMeta;
+
+/**
+ * YapDatabase extension of type: YapDatabaseHooks <br/>
+ *
+ * Flushes the unwrapped node key cache (in ZDCCryptoTools) whenever a localUser's private key
+ * is removed or replaced, such as when the localUser is deleted.
+ */
+extern NSString *const Ext_Hooks_PrivateKeys;
+
 
 /**
  * YapDatabase extension of type: YapDatabaseAutoView <br/>
@@ -190,6 +233,15 @@ extern NSString *const Index_Nodes_Column_PointeeID;
 /** Secondary Index column name for: `Ext_Index_Users` */
 extern NSString *const Index_Users_Column_RandomUUID;
 
+/** Secondary Index column name for: `Ext_Index_Paths` */
+extern NSString *const Index_Paths_Column_NodeID;
+
+/** Secondary Index column name for: `Ext_Index_Paths` */
+extern NSString *const Index_Paths_Column_Path;
+
+/** Secondary Index column name for: `Ext_Index_Paths` */
+extern NSString *const Index_Paths_Column_Lookup;
+
 /**
  * ZeroDarkCloud requires a database for atomic operations.
  * YapDatabase is used as it's the most performant and highly-concurrent.
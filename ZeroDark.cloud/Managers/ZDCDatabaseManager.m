@@ -9,16 +9,22 @@
 
 #import "ZDCDatabaseManagerPrivate.h"
 
+#import "ZDCBinarySerializer.h"
 #import "ZDCConstants.h"
 #import "ZDCCachedResponse.h"
+#import "ZDCCloudPathManagerPrivate.h"
 #import "ZDCCloudPrivate.h"
 #import "ZDCLocalUserPrivate.h"
 #import "ZDCLocalUserManagerPrivate.h"
 #import "ZDCLogging.h"
+#import "ZDCMetricsManagerPrivate.h"
+#import "ZDCNodeManagerPrivate.h"
 #import "ZDCNodePrivate.h"
+#import "ZDCNodeStatsHooks.h"
 #import "ZDCTask.h"
 #import "ZDCUserPrivate.h"
 #import "ZDCSplitKey.h"
+#import "ZeroDarkCloudPrivate.h"
 
 #import "NSURLResponse+ZeroDark.h"
 
@@ -35,6 +41,13 @@
   static const int zdcLogLevel = ZDCLogLevelWarning;
 #endif
 
+/**
+ * Settings for the internal_writeCoalescer.
+ * A batch is committed after this amount of time, or once it contains this many blocks (whichever comes first).
+ */
+#define WRITE_COALESCER_WINDOW         0.05 // in seconds
+#define WRITE_COALESCER_MAX_BATCH_SIZE 250
+
 NSString *const UIDatabaseConnectionWillUpdateNotification = @"UIDatabaseConnectionWillUpdateNotification";
 NSString *const UIDatabaseConnectionDidUpdateNotification  = @"UIDatabaseConnectionDidUpdateNotification";
 NSString *const kNotificationsKey = @"notifications";
@@ -42,6 +55,11 @@ NSString *const kNotificationsKey = @"notifications";
 NSString *const Ext_Relationship              = @"ZeroDark:graph";
 NSString *const Ext_Index_Nodes               = @"ZeroDark:idx_nodes";
 NSString *const Ext_Index_Users               = @"ZeroDark:idx_users";
+NSString *const Ext_Index_Paths               = @"ZeroDark:idx_paths";
+NSString *const Ext_Hooks_Paths               = @"ZeroDark:hooks_paths";
+NSString *const Ext_Hooks_NodeStats           = @"ZeroDark:hooks_nodeStats";
+NSString *const Ext_Hooks_NodeMeta            = @"ZeroDark:hooks_nodeMeta";
+NSString *const Ext_Hooks_PrivateKeys         = @"ZeroDark:hooks_privateKeys";
 NSString *const Ext_View_LocalUsers           = @"ZeroDark:localUsers";
 NSString *const Ext_View_Treesystem_Name      = @"ZeroDark:fsName";
 NSString *const Ext_View_Treesystem_CloudName = @"ZeroDark:fsCloudName";
@@ -60,6 +78,10 @@ NSString *const Index_Nodes_Column_PointeeID  = @"pointeeID";
 
 NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 
+NSString *const Index_Paths_Column_NodeID     = @"nodeID";
+NSString *const Index_Paths_Column_Path       = @"path";
+NSString *const Index_Paths_Column_Lookup     = @"lookup";
+
 
 @implementation ZDCDatabaseManager {
 	
@@ -67,8 +89,8 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 	dispatch_queue_t serialQueue;
 	
 	YapDatabaseConnection *_internal_roConnection;
-	YapDatabaseConnection *_internal_rwConnection;
 	YapDatabaseConnection *_internal_decryptConnection;
+	ZDCDatabaseWriteCoalescer *_internal_writeCoalescer;
 	
 	YapDatabaseActionManager *actionManager;
 	
@@ -155,31 +177,45 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 
 /**
  * For internal use only (by the ZeroDarkCloud Framework).
+ *
+ * Note: The internal read-write connection is intentionally only accessible via the coalescer.
+ * This ensures all internal writes are committed in the order in which they were submitted.
  */
-- (YapDatabaseConnection *)internal_rwConnection
+- (ZDCDatabaseWriteCoalescer *)internal_writeCoalescer
 {
-	__block YapDatabaseConnection *connection = nil;
+	__block ZDCDatabaseWriteCoalescer *coalescer = nil;
 	
 	dispatch_sync(serialQueue, ^{ @autoreleasepool {
 	#pragma clang diagnostic push
 	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
 		
-		if (_internal_rwConnection == nil)
+		if (_internal_writeCoalescer == nil)
 		{
-			_internal_rwConnection = [database newConnection];
-			_internal_rwConnection.name = @"ZeroDarkCloud.Internal.rwConnection";
+			YapDatabaseConnection *rwConnection = [database newConnection];
+			rwConnection.name = @"ZeroDarkCloud.Internal.rwConnection";
 			
 		#if DEBUG
-			_internal_rwConnection.permittedTransactions = YDB_AnyReadWriteTransaction;
+			rwConnection.permittedTransactions = YDB_AnyReadWriteTransaction;
 		#endif
+			
+			_internal_writeCoalescer =
+			  [[ZDCDatabaseWriteCoalescer alloc] initWithConnection: rwConnection
+			                                                 window: WRITE_COALESCER_WINDOW
+			                                           maxBatchSize: WRITE_COALESCER_MAX_BATCH_SIZE];
+			
+			__weak ZDCMetricsManager *metricsManager = zdc.metricsManager;
+			_internal_writeCoalescer.commitObserver = ^(uint64_t duration, NSUInteger batchSize) {
+				
+				[metricsManager recordDuration:duration bytes:0 failed:NO forMetric:@"db: write"];
+			};
 		}
 		
-		connection = _internal_rwConnection;
+		coalescer = _internal_writeCoalescer;
 		
 	#pragma clang diagnostic pop
 	}});
 	
-	return connection;
+	return coalescer;
 }
 
 /**
@@ -219,12 +255,16 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
  * The serializer block converts objects into encrypted data blobs.
  *
  * (All of the objects used by the ZeroDarkCloud framework support the NSCoding protocol.)
+ *
+ * Our most frequently read objects (nodes, users, changeLists, etc) are written using ZDCBinarySerializer,
+ * which is considerably smaller & faster to decode than a keyed archive.
+ * Everything else falls back to NSKeyedArchiver.
  */
 - (YapDatabaseSerializer)databaseSerializer
 {
 	YapDatabaseSerializer serializer = ^(NSString *collection, NSString *key, id object){
 		
-		return [NSKeyedArchiver archivedDataWithRootObject:object];
+		return [ZDCBinarySerializer serializeObject:object];
 	};
 	
 	return serializer;
@@ -234,12 +274,15 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
  * The deserializer block converts encrypted data blobs back into objects.
  *
  * (All of the objects used by the ZeroDarkCloud framework support the NSCoding protocol.)
+ *
+ * Handles both the compact binary format & legacy keyed archives.
+ * Legacy rows are migrated lazily, the next time they're written.
  */
 - (YapDatabaseDeserializer)databaseDeserializer
 {
 	YapDatabaseDeserializer deserializer = ^(NSString *collection, NSString *key, NSData *data){
 		
-		id object = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+		id object = [ZDCBinarySerializer deserializeData:data];
 		if ([object isKindOfClass:[ZDCObject class]])
 		{
 			[(ZDCObject *)object makeImmutable];
@@ -316,9 +359,12 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 	YapDatabasePostSanitizer postSanitizer = [self databasePostSanitizer];
 	
 	NSArray<NSString*> *collections = @[
+		kZDCCollection_BlockchainProofs,
 		kZDCCollection_CachedResponse,
 		kZDCCollection_CloudNodes,
 		kZDCCollection_Nodes,
+		kZDCCollection_NodeMeta,
+		kZDCCollection_NodeStats,
 		kZDCCollection_Prefs,
 		kZDCCollection_PublicKeys,
 		kZDCCollection_PullState,
@@ -382,11 +428,26 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 	                                    readOnlyConnection: [roConnectionPool connection]
 	                                   readWriteConnection: rwDatabaseConnection];
 	
+	// Populate the node meta (no-op if already done).
+	//
+	// The node views & indexes read the meta instead of the node.
+	// So this must run before they're registered, or they'd be populated from missing metas.
+	
+	[rwDatabaseConnection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[ZDCNodeManager sharedInstance] rebuildMetaIfNeeded:transaction];
+	}];
+	
 	// Setup all the extensions
 	
 	[self setupRelationship];
+	[self setupHooks_NodeMeta]; // must be registered before the node views & indexes
+	[self setupHooks_NodeStats];
 	[self setupIndex_Nodes];
 	[self setupIndex_Users];
+	[self setupHooks_Paths];
+	[self setupIndex_Paths];
+	[self setupHooks_PrivateKeys];
 	[self setupView_LocalUsers];
 	[self setupView_Treesystem_Name];
 	[self setupView_Treesystem_CloudName];
@@ -464,25 +525,27 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 	// - ZDCNode.cloudID
 	// - ZDCNode.dirPrefix
 	// - ZDCNode.pointeeID
+	//
+	// Values are read from the ZDCNodeMeta (see Ext_Hooks_NodeMeta), so populating the index doesn't decode full nodes.
 	
 	YapDatabaseSecondaryIndexSetup *setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
 	[setup addColumn:Index_Nodes_Column_CloudID   withType:YapDatabaseSecondaryIndexTypeText];
 	[setup addColumn:Index_Nodes_Column_DirPrefix withType:YapDatabaseSecondaryIndexTypeText];
 	[setup addColumn:Index_Nodes_Column_PointeeID withType:YapDatabaseSecondaryIndexTypeText];
 	
-	YapDatabaseSecondaryIndexHandler *handler = [YapDatabaseSecondaryIndexHandler withObjectBlock:
-	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict,
-	      NSString *collection, NSString *key, id object)
+	YapDatabaseSecondaryIndexHandler *handler =
+	  [YapDatabaseSecondaryIndexHandler withOptions: YapDatabaseBlockInvokeDefaultForBlockTypeWithObject
+	                                       keyBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key)
 	{
-		NSAssert([object isKindOfClass:[ZDCNode class]], @"Invalid class detected !");
-		__unsafe_unretained ZDCNode *node = (ZDCNode *)object;
+		ZDCNodeMeta *meta = [[ZDCNodeManager sharedInstance] metaForNodeID:key transaction:transaction];
 		
-		dict[Index_Nodes_Column_CloudID] = node.cloudID;
-		dict[Index_Nodes_Column_DirPrefix] = node.dirPrefix;
-		dict[Index_Nodes_Column_PointeeID] = node.pointeeID;
+		dict[Index_Nodes_Column_CloudID] = meta.cloudID;
+		dict[Index_Nodes_Column_DirPrefix] = meta.dirPrefix;
+		dict[Index_Nodes_Column_PointeeID] = meta.pointeeID;
 	}];
 	
-	NSString *const versionTag = @"2019-07-17"; // <-- change me if you modify handler block
+	NSString *const versionTag = @"2019-11-12"; // <-- change me if you modify handler block
 	
 	NSSet *whitelist = [NSSet setWithObject:kZDCCollection_Nodes];
 	
@@ -556,6 +619,464 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 }
 
 
+- (void)setupHooks_NodeMeta
+{
+	ZDCLogAutoTrace();
+	
+	//
+	// HOOKS - NODE META
+	//
+	// Writes the ZDCNodeMeta for a node just BEFORE the node itself is inserted/modified.
+	// The node views & indexes (which are registered after this extension) read the meta instead of the node.
+	//
+	// IMPORTANT: This extension must be registered BEFORE the node views & indexes.
+	
+	YapDatabaseHooks *ext = [[YapDatabaseHooks alloc] init];
+	ext.allowedCollections = [[YapWhitelistBlacklist alloc] initWithWhitelist:[NSSet setWithObject:kZDCCollection_Nodes]];
+	
+	ext.willModifyRow = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSString *key,
+	                      YapProxyObject *proxyObject, YapProxyObject *proxyMetadata,
+	                      YapDatabaseHooksBitMask flags)
+	{
+		ZDCNodeMeta *oldMeta = [transaction objectForKey:key inCollection:kZDCCollection_NodeMeta];
+		
+		if ((flags & YapDatabaseHooksUpdatedRow) && !(flags & YapDatabaseHooksChangedObject))
+		{
+			// The node was touched (e.g. by Ext_Hooks_Paths when its parent arrived).
+			// The only thing that could have changed is the treeID, which is inherited from the parent.
+			
+			if ([oldMeta isKindOfClass:[ZDCNodeMeta class]] && oldMeta.treeID) return;
+		}
+		
+		__unsafe_unretained ZDCNode *node = (ZDCNode *)proxyObject.realObject;
+		if (![node isKindOfClass:[ZDCNode class]]) return;
+		
+		ZDCNodeMeta *newMeta = [[ZDCNodeManager sharedInstance] makeMetaForNode:node transaction:transaction];
+		
+		if (![newMeta isEqual:oldMeta]) {
+			[transaction setObject:newMeta forKey:key inCollection:kZDCCollection_NodeMeta];
+		}
+	};
+	
+	ext.didRemoveRow = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSString *key) {
+		
+		[transaction removeObjectForKey:key inCollection:kZDCCollection_NodeMeta];
+	};
+	
+	ext.didRemoveRows = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSArray<NSString*> *keys) {
+		
+		[transaction removeObjectsForKeys:keys inCollection:kZDCCollection_NodeMeta];
+	};
+	
+	ext.didRemoveAllRows = ^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeAllObjectsInCollection:kZDCCollection_NodeMeta];
+	};
+	
+	NSString *const extName = Ext_Hooks_NodeMeta;
+	[database asyncRegisterExtension: ext
+	                        withName: extName
+	                 completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
+	                 completionBlock:^(BOOL ready)
+	{
+		if (!ready) {
+			ZDCLogError(@"Error registering \"%@\" !!!", extName);
+		}
+	}];
+}
+
+- (void)setupHooks_NodeStats
+{
+	ZDCLogAutoTrace();
+	
+	//
+	// HOOKS - NODE STATS
+	//
+	// Maintains aggregate statistics (descendant count, total size, etc) for every node's subtree.
+	// Each change to a node is applied as a delta to the stats of each of its ancestors,
+	// so the cost is proportional to the depth of the node, not the size of the tree.
+	// The deltas are accumulated by ZDCNodeStatsHooks, and each ancestor is written once, when the transaction commits.
+	//
+	// Readwrite transactions are serialized, so it's safe to stash the old node
+	// between the willModifyRow & didModifyRow callbacks.
+	
+	NSMutableDictionary<NSString*, ZDCNode*> *oldNodes = [NSMutableDictionary dictionary];
+	
+	ZDCNodeStatsHooks *ext = [[ZDCNodeStatsHooks alloc] init];
+	ext.allowedCollections = [[YapWhitelistBlacklist alloc] initWithWhitelist:[NSSet setWithObject:kZDCCollection_Nodes]];
+	
+	ext.willModifyRow = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSString *key,
+	                      YapProxyObject *proxyObject, YapProxyObject *proxyMetadata,
+	                      YapDatabaseHooksBitMask flags)
+	{
+		if ((flags & YapDatabaseHooksUpdatedRow) && !(flags & YapDatabaseHooksChangedObject)) return;
+		
+		ZDCNode *oldNode = [transaction objectForKey:key inCollection:collection];
+		if ([oldNode isKindOfClass:[ZDCNode class]]) {
+			oldNodes[key] = oldNode;
+		}
+	};
+	
+	ext.didModifyRow = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSString *key,
+	                     YapProxyObject *proxyObject, YapProxyObject *proxyMetadata,
+	                     YapDatabaseHooksBitMask flags)
+	{
+		ZDCNode *oldNode = oldNodes[key];
+		[oldNodes removeObjectForKey:key];
+		
+		if ((flags & YapDatabaseHooksUpdatedRow) && !(flags & YapDatabaseHooksChangedObject)) return;
+		
+		ZDCNode *newNode = (ZDCNode *)proxyObject.realObject;
+		if (![newNode isKindOfClass:[ZDCNode class]]) return;
+		
+		[[ZDCNodeManager sharedInstance] updateStatsWithOldNode:oldNode newNode:newNode transaction:transaction];
+	};
+	
+	ext.willRemoveRow = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSString *key) {
+		
+		ZDCNode *oldNode = [transaction objectForKey:key inCollection:collection];
+		if (![oldNode isKindOfClass:[ZDCNode class]]) return;
+		
+		[[ZDCNodeManager sharedInstance] updateStatsWithOldNode:oldNode newNode:nil transaction:transaction];
+	};
+	
+	ext.willRemoveRows = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSArray<NSString*> *keys) {
+		
+		ZDCNodeManager *nodeManager = [ZDCNodeManager sharedInstance];
+		for (NSString *key in keys)
+		{
+			ZDCNode *oldNode = [transaction objectForKey:key inCollection:collection];
+			if (![oldNode isKindOfClass:[ZDCNode class]]) continue;
+			
+			[nodeManager updateStatsWithOldNode:oldNode newNode:nil transaction:transaction];
+		}
+	};
+	
+	ext.willRemoveAllRows = ^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[(ZDCNodeStatsHooksTransaction *)[transaction ext:Ext_Hooks_NodeStats] discardAllPendingDeltas];
+		[transaction removeAllObjectsInCollection:kZDCCollection_NodeStats];
+	};
+	
+	NSString *const extName = Ext_Hooks_NodeStats;
+	[database asyncRegisterExtension: ext
+	                        withName: extName
+	                 completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
+	                 completionBlock:^(BOOL ready)
+	{
+		if (!ready) {
+			ZDCLogError(@"Error registering \"%@\" !!!", extName);
+		}
+	}];
+}
+
+- (void)setupHooks_Paths
+{
+	ZDCLogAutoTrace();
+	
+	//
+	// HOOKS - PATHS
+	//
+	// The path of a node depends on the name & parentID of every one of its ancestors.
+	// So when a node is renamed or moved, the indexed path of every descendant becomes stale.
+	// Similarly, a node that's inserted before its parent (or a pointee inserted before its pointer)
+	// isn't attached to a trunk yet, and so its descendants aren't indexed until the ancestor arrives.
+	//
+	// We detect these situations here, and touch all the descendants (following pointers into grafted subtrees),
+	// which causes Ext_Index_Paths to re-run its handler for each of them.
+	//
+	// Only the name, parentID & pointeeID affect the index, so every other write is ignored.
+	// And an inserted node only needs its descendants touched if it already has children (or a pointee).
+	//
+	// The old node is stashed between callbacks (see setupHooks_NodeStats).
+	
+	NSMutableDictionary<NSString*, ZDCNode*> *oldNodes = [NSMutableDictionary dictionary];
+	
+	void (^TouchSubtree)(NSString*, YapDatabaseReadWriteTransaction*) =
+	^(NSString *rootNodeID, YapDatabaseReadWriteTransaction *transaction)
+	{
+		ZDCNodeManager *nodeManager = [ZDCNodeManager sharedInstance];
+		
+		NSMutableSet<NSString*> *visited = [NSMutableSet set];
+		NSMutableArray<NSString*> *pending = [NSMutableArray arrayWithObject:rootNodeID];
+		
+		while (pending.count > 0)
+		{
+			NSString *nodeID = [pending lastObject];
+			[pending removeLastObject];
+			
+			if ([visited containsObject:nodeID]) continue;
+			[visited addObject:nodeID];
+			
+			void (^TouchNode)(NSString*) = ^(NSString *touchNodeID){
+				
+				[transaction touchObjectForKey:touchNodeID inCollection:kZDCCollection_Nodes];
+				
+				// The pointee's path is derived from the pointer's path.
+				NSString *pointeeID = [nodeManager metaForNodeID:touchNodeID transaction:transaction].pointeeID;
+				if (pointeeID) {
+					[pending addObject:pointeeID];
+				}
+			};
+			
+			if (![nodeID isEqualToString:rootNodeID]) {
+				TouchNode(nodeID);
+			}
+			
+			[nodeManager recursiveEnumerateNodeIDsWithParentID: nodeID
+			                                       transaction: transaction
+			                                        usingBlock:
+			^(NSString *descendentNodeID, NSArray<NSString *> *pathFromParent, BOOL *recurseInto, BOOL *stop) {
+				
+				TouchNode(descendentNodeID);
+			}];
+		}
+	};
+	
+	YapDatabaseHooks *ext = [[YapDatabaseHooks alloc] init];
+	ext.allowedCollections = [[YapWhitelistBlacklist alloc] initWithWhitelist:[NSSet setWithObject:kZDCCollection_Nodes]];
+	
+	ext.willModifyRow = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSString *key,
+	                      YapProxyObject *proxyObject, YapProxyObject *proxyMetadata,
+	                      YapDatabaseHooksBitMask flags)
+	{
+		if (!(flags & YapDatabaseHooksUpdatedRow)) return;
+		if (!(flags & YapDatabaseHooksChangedObject)) return;
+		
+		ZDCNode *oldNode = [transaction objectForKey:key inCollection:collection];
+		if ([oldNode isKindOfClass:[ZDCNode class]]) {
+			oldNodes[key] = oldNode;
+		}
+	};
+	
+	ext.didModifyRow = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSString *key,
+	                     YapProxyObject *proxyObject, YapProxyObject *proxyMetadata,
+	                     YapDatabaseHooksBitMask flags)
+	{
+		ZDCNode *oldNode = oldNodes[key];
+		[oldNodes removeObjectForKey:key];
+		
+		if ((flags & YapDatabaseHooksUpdatedRow) && !(flags & YapDatabaseHooksChangedObject)) return;
+		
+		__unsafe_unretained ZDCNode *node = (ZDCNode *)proxyObject.realObject;
+		if (![node isKindOfClass:[ZDCNode class]]) return;
+		
+		NSString *oldPointeeID = oldNode.pointeeID;
+		BOOL pointeeChanged = (oldPointeeID != node.pointeeID) && ![oldPointeeID isEqualToString:node.pointeeID];
+		
+		BOOL touchChildren = NO;
+		if (oldNode)
+		{
+			// Renamed or moved
+			
+			BOOL nameChanged = (oldNode.name != node.name) && ![oldNode.name isEqualToString:node.name];
+			BOOL parentChanged = (oldNode.parentID != node.parentID) && ![oldNode.parentID isEqualToString:node.parentID];
+			
+			touchChildren = nameChanged || parentChanged;
+		}
+		else
+		{
+			// Inserted after (some of) its children
+			
+			touchChildren = [[ZDCNodeManager sharedInstance] hasChildren:node transaction:transaction];
+		}
+		
+		if (pointeeChanged && oldPointeeID)
+		{
+			// The old pointee (and its subtree) is no longer grafted here.
+			[transaction touchObjectForKey:oldPointeeID inCollection:kZDCCollection_Nodes];
+			TouchSubtree(oldPointeeID, transaction);
+		}
+		
+		if (node.pointeeID && (pointeeChanged || touchChildren))
+		{
+			[transaction touchObjectForKey:node.pointeeID inCollection:kZDCCollection_Nodes];
+			TouchSubtree(node.pointeeID, transaction);
+		}
+		
+		if (touchChildren) {
+			TouchSubtree(node.uuid, transaction);
+		}
+	};
+	
+	NSString *const extName = Ext_Hooks_Paths;
+	[database asyncRegisterExtension: ext
+	                        withName: extName
+	                 completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
+	                 completionBlock:^(BOOL ready)
+	{
+		if (!ready) {
+			ZDCLogError(@"Error registering \"%@\" !!!", extName);
+		}
+	}];
+}
+
+- (void)setupHooks_PrivateKeys
+{
+	ZDCLogAutoTrace();
+	
+	//
+	// HOOKS - PRIVATE KEYS
+	//
+	// ZDCCryptoTools caches the node keys it unwraps with a localUser's private key.
+	// When a private key is removed or replaced (e.g. the localUser is deleted, or its key is changed),
+	// the unwrapped keys shouldn't linger in memory. So we flush the cache once the transaction commits.
+	
+	__weak ZeroDarkCloud *weakOwner = zdc;
+	
+	void (^FlushOnCommit)(YapDatabaseReadWriteTransaction *) = ^(YapDatabaseReadWriteTransaction *transaction){
+		
+		dispatch_queue_t bgQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+		[transaction addCompletionQueue:bgQueue completionBlock:^{
+			
+			[weakOwner.cryptoTools flushUnwrappedKeyCache];
+		}];
+	};
+	
+	BOOL (^IsPrivateKeyRow)(YapDatabaseReadWriteTransaction *, NSString *, NSString *) =
+	  ^BOOL (YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSString *key)
+	{
+		if ([collection isEqualToString:kZDCCollection_PublicKeys])
+		{
+			ZDCPublicKey *key_old = [transaction objectForKey:key inCollection:collection];
+			return ([key_old isKindOfClass:[ZDCPublicKey class]] && key_old.isPrivateKey);
+		}
+		else
+		{
+			ZDCUser *user_old = [transaction objectForKey:key inCollection:collection];
+			return ([user_old isKindOfClass:[ZDCUser class]] && user_old.isLocal);
+		}
+	};
+	
+	NSSet *whitelist = [NSSet setWithObjects:kZDCCollection_PublicKeys, kZDCCollection_Users, nil];
+	
+	YapDatabaseHooks *ext = [[YapDatabaseHooks alloc] init];
+	ext.allowedCollections = [[YapWhitelistBlacklist alloc] initWithWhitelist:whitelist];
+	
+	ext.willModifyRow = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSString *key,
+	                      YapProxyObject *proxyObject, YapProxyObject *proxyMetadata,
+	                      YapDatabaseHooksBitMask flags)
+	{
+		if (!(flags & YapDatabaseHooksUpdatedRow)) return;
+		if (!(flags & YapDatabaseHooksChangedObject)) return;
+		
+		if ([collection isEqualToString:kZDCCollection_PublicKeys])
+		{
+			if (IsPrivateKeyRow(transaction, collection, key)) {
+				FlushOnCommit(transaction);
+			}
+		}
+		else
+		{
+			ZDCUser *user_old = [transaction objectForKey:key inCollection:collection];
+			if (![user_old isKindOfClass:[ZDCUser class]] || !user_old.isLocal) return;
+			
+			__unsafe_unretained ZDCUser *user_new = (ZDCUser *)proxyObject.realObject;
+			if (![user_new isKindOfClass:[ZDCUser class]]
+			 || !user_new.isLocal
+			 || ![user_new.publicKeyID isEqualToString:user_old.publicKeyID])
+			{
+				FlushOnCommit(transaction);
+			}
+		}
+	};
+	
+	ext.willRemoveRow = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSString *key) {
+		
+		if (IsPrivateKeyRow(transaction, collection, key)) {
+			FlushOnCommit(transaction);
+		}
+	};
+	
+	ext.willRemoveRows = ^(YapDatabaseReadWriteTransaction *transaction, NSString *collection, NSArray<NSString*> *keys) {
+		
+		for (NSString *key in keys)
+		{
+			if (IsPrivateKeyRow(transaction, collection, key)) {
+				FlushOnCommit(transaction);
+				break;
+			}
+		}
+	};
+	
+	ext.willRemoveAllRows = ^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		FlushOnCommit(transaction);
+	};
+	
+	NSString *const extName = Ext_Hooks_PrivateKeys;
+	[database asyncRegisterExtension: ext
+	                        withName: extName
+	                 completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
+	                 completionBlock:^(BOOL ready)
+	{
+		if (!ready) {
+			ZDCLogError(@"Error registering \"%@\" !!!", extName);
+		}
+	}];
+}
+
+- (void)setupIndex_Paths
+{
+	ZDCLogAutoTrace();
+	
+	//
+	// SECONDARY INDEX - PATHS
+	//
+	// Indexes the following:
+	// - ZDCNode.uuid
+	// - path (as returned by `-[ZDCNodeManager pathForNode:transaction:]`)
+	// - lookup (localUserID + treeID + normalized path)
+	//
+	// Nodes that aren't attached to a trunk (e.g. detached nodes) aren't indexed.
+	
+	YapDatabaseSecondaryIndexSetup *setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
+	[setup addColumn:Index_Paths_Column_NodeID withType:YapDatabaseSecondaryIndexTypeText];
+	[setup addColumn:Index_Paths_Column_Path   withType:YapDatabaseSecondaryIndexTypeText];
+	[setup addColumn:Index_Paths_Column_Lookup withType:YapDatabaseSecondaryIndexTypeText];
+	
+	YapDatabaseSecondaryIndexHandler *handler = [YapDatabaseSecondaryIndexHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict,
+	      NSString *collection, NSString *key, id object)
+	{
+		NSAssert([object isKindOfClass:[ZDCNode class]], @"Invalid class detected !");
+		__unsafe_unretained ZDCNode *node = (ZDCNode *)object;
+		
+		NSDictionary *values = [[ZDCNodeManager sharedInstance] pathIndexValuesForNode:node transaction:transaction];
+		if (values) {
+			[dict addEntriesFromDictionary:values];
+		}
+	}];
+	
+	NSString *version = @"2019-11-19"; // <-- change me if you modify handler block
+	NSString *locale = [[NSLocale currentLocale] localeIdentifier]; // because of localized path normalization
+	
+	NSString *versionTag = [NSString stringWithFormat:@"%@-%@", version, locale];
+	
+	NSSet *whitelist = [NSSet setWithObject:kZDCCollection_Nodes];
+	
+	YapDatabaseSecondaryIndexOptions *options = [[YapDatabaseSecondaryIndexOptions alloc] init];
+	options.allowedCollections = [[YapWhitelistBlacklist alloc] initWithWhitelist:whitelist];
+	
+	YapDatabaseSecondaryIndex *ext =
+	  [[YapDatabaseSecondaryIndex alloc] initWithSetup: setup
+	                                           handler: handler
+	                                        versionTag: versionTag
+	                                           options: options];
+	
+	NSString *const extName = Ext_Index_Paths;
+	[database asyncRegisterExtension: ext
+	                        withName: extName
+	                 completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
+	                 completionBlock:^(BOOL ready)
+	{
+		if (!ready) {
+			ZDCLogError(@"Error registering \"%@\" !!!", extName);
+		}
+	}];
+}
+
+
 - (void)setupView_LocalUsers
 {
 	ZDCLogAutoTrace();
@@ -635,18 +1156,22 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 	//   - group(parentDirectoryID) -> values(files and sub-directories in given directory)
 	//
 	//   ^Sorting is done according to ZDCNode.name (cleartext name)
+	//
+	// The blocks operate on the ZDCNodeMeta (see Ext_Hooks_NodeMeta), which has a precomputed sort key for the name.
+	// So comparing against neighbors doesn't require decoding them, and usually skips the localized comparison.
 	
-	YapDatabaseViewGrouping *grouping = [YapDatabaseViewGrouping withObjectBlock:
-		^NSString *(YapDatabaseReadTransaction *transaction, NSString *collection, NSString *key, id object)
+	YapDatabaseViewGrouping *grouping =
+	  [YapDatabaseViewGrouping withOptions: YapDatabaseBlockInvokeDefaultForBlockTypeWithObject
+	                              keyBlock:
+		^NSString *(YapDatabaseReadTransaction *transaction, NSString *collection, NSString *key)
 	{
 		// Don't forget to change `version` (below) if you modify this block.
 		//
 		
-		NSAssert([object isKindOfClass:[ZDCNode class]], @"Invalid class detected !");
-		__unsafe_unretained ZDCNode *node = (ZDCNode *)object;
+		ZDCNodeMeta *meta = [[ZDCNodeManager sharedInstance] metaForNodeID:key transaction:transaction];
 		
 		// Sanity checks:
-		if (node.name == nil)
+		if (meta.name == nil)
 		{
 			// Apple's documentation for 'localizedCaseInsensitiveCompare' (used in the sorting block) states:
 			//
@@ -661,25 +1186,29 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 		// Detached nodes have a special parentID: "<localUserID>|<treeID>|detached".
 		// Container nodes don't have a parentID.
 		//
-		return node.parentID;
+		return meta.parentID;
 		//
 		// Don't forget to change `version` (below) if you modify this block.
 	}];
 	
-	YapDatabaseViewSorting *sorting = [YapDatabaseViewSorting withObjectBlock:
+	YapDatabaseViewSorting *sorting =
+	  [YapDatabaseViewSorting withOptions: YapDatabaseBlockInvokeDefaultForBlockTypeWithObject
+	                             keyBlock:
 		^(YapDatabaseReadTransaction *transaction, NSString *group,
-		    NSString *collection1, NSString *key1, id obj1,
-		    NSString *collection2, NSString *key2, id obj2)
+		    NSString *collection1, NSString *key1,
+		    NSString *collection2, NSString *key2)
 	{
 		// Don't forget to change `version` (below) if you modify this block.
 		//
 		
-		__unsafe_unretained ZDCNode *node1 = (ZDCNode *)obj1;
-		__unsafe_unretained ZDCNode *node2 = (ZDCNode *)obj2;
+		ZDCNodeManager *nodeManager = [ZDCNodeManager sharedInstance];
+		
+		ZDCNodeMeta *meta1 = [nodeManager metaForNodeID:key1 transaction:transaction];
+		ZDCNodeMeta *meta2 = [nodeManager metaForNodeID:key2 transaction:transaction];
 		
-		NSComparisonResult result = [node1.name localizedCaseInsensitiveCompare:node2.name];
+		NSComparisonResult result = [meta1 compareName:meta2];
 		if (result == NSOrderedSame) {
-			result = [node1.uuid compare:node2.uuid]; // name collision may occur in non-root containers.
+			result = [key1 compare:key2]; // name collision may occur in non-root containers.
 		}
 		
 		return result;
@@ -687,7 +1216,7 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 		// Don't forget to change `version` (below) if you modify this block.
 	}];
 	
-	NSString *version = @"2019-01-30"; // <---------- change me if you modify grouping or sorting block <----------
+	NSString *version = @"2019-11-20"; // <---------- change me if you modify grouping or sorting block <----------
 	NSString *locale = [[NSLocale currentLocale] localeIdentifier]; // because of localized name comparison
 	
 	NSString *versionTag = [NSString stringWithFormat:@"%@-%@", version, locale];
@@ -728,16 +1257,20 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 	//   - group(parentID) -> values(direct children of the given parent)
 	//
 	//   ^Sorting is done according to node's cloudName.
+	//
+	// The blocks operate on the ZDCNodeMeta (see Ext_Hooks_NodeMeta) of the node & its parent,
+	// so comparing against neighbors doesn't require decoding them.
 	
-	YapDatabaseViewGrouping *grouping = [YapDatabaseViewGrouping withObjectBlock:
-		^NSString *(YapDatabaseReadTransaction *transaction, NSString *collection, NSString *key, id object)
+	YapDatabaseViewGrouping *grouping =
+	  [YapDatabaseViewGrouping withOptions: YapDatabaseBlockInvokeDefaultForBlockTypeWithObject
+	                              keyBlock:
+		^NSString *(YapDatabaseReadTransaction *transaction, NSString *collection, NSString *key)
 	{
 		// Don't forget to change `version` (below) if you modify this block.
 		//
-		NSAssert([object isKindOfClass:[ZDCNode class]], @"Invalid class detected !");
-		__unsafe_unretained ZDCNode *node = (ZDCNode *)object;
+		ZDCNodeMeta *meta = [[ZDCNodeManager sharedInstance] metaForNodeID:key transaction:transaction];
 		
-		NSString *cloudName = [[ZDCCloudPathManager sharedInstance] cloudNameForNode:node transaction:transaction];
+		NSString *cloudName = [ZDCDatabaseManager cloudNameForMeta:meta transaction:transaction];
 		if (cloudName == nil)
 		{
 			// Apple's documentation for 'compare:' (used in the sorting block) states:
@@ -753,29 +1286,31 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 		// Detached nodes have a special parentID: "<localUserID>|<treeID>|detached".
 		// Container nodes don't have a parentID.
 		//
-		return node.parentID;
+		return meta.parentID;
 		//
 		// Don't forget to change `version` (below) if you modify this block.
 	}];
 	
-	YapDatabaseViewSorting *sorting = [YapDatabaseViewSorting withObjectBlock:
+	YapDatabaseViewSorting *sorting =
+	  [YapDatabaseViewSorting withOptions: YapDatabaseBlockInvokeDefaultForBlockTypeWithObject
+	                             keyBlock:
 		^(YapDatabaseReadTransaction *transaction, NSString *group,
-		    NSString *collection1, NSString *key1, id obj1,
-		    NSString *collection2, NSString *key2, id obj2)
+		    NSString *collection1, NSString *key1,
+		    NSString *collection2, NSString *key2)
 	{
 		// Don't forget to change `version` (below) if you modify this block.
 		//
-		__unsafe_unretained ZDCNode *node1 = (ZDCNode *)obj1;
-		__unsafe_unretained ZDCNode *node2 = (ZDCNode *)obj2;
+		ZDCNodeManager *nodeManager = [ZDCNodeManager sharedInstance];
 		
-		ZDCCloudPathManager *cloudPathManager = [ZDCCloudPathManager sharedInstance];
+		ZDCNodeMeta *meta1 = [nodeManager metaForNodeID:key1 transaction:transaction];
+		ZDCNodeMeta *meta2 = [nodeManager metaForNodeID:key2 transaction:transaction];
 		
-		NSString *cloudName1 = [cloudPathManager cloudNameForNode:node1 transaction:transaction];
-		NSString *cloudName2 = [cloudPathManager cloudNameForNode:node2 transaction:transaction];
+		NSString *cloudName1 = [ZDCDatabaseManager cloudNameForMeta:meta1 transaction:transaction];
+		NSString *cloudName2 = [ZDCDatabaseManager cloudNameForMeta:meta2 transaction:transaction];
 		
 		NSComparisonResult result = [cloudName1 compare:cloudName2];
 		if (result == NSOrderedSame) {
-			result = [node1.uuid compare:node2.uuid];
+			result = [key1 compare:key2];
 		}
 		
 		return result;
@@ -783,7 +1318,7 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 		// Don't forget to change `version` (below) if you modify this block.
 	}];
 	
-	NSString *versionTag = @"2019-03-05"; // <---------- change me if you modify grouping or sorting block <----------
+	NSString *versionTag = @"2019-11-12"; // <---------- change me if you modify grouping or sorting block <----------
 	
 	NSSet *whitelist = [NSSet setWithObject:kZDCCollection_Nodes];
 	
@@ -821,12 +1356,16 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 	//
 	// Note:
 	// This view is the parent view for other filteredViews.
+	//
+	// Grouping uses the ZDCNodeMeta (see Ext_Hooks_NodeMeta), which already knows the node's treeID.
+	// So we don't have to walk up to the trunk node for every insert.
 	
-	YapDatabaseViewGrouping *grouping = [YapDatabaseViewGrouping withObjectBlock:
-	    ^NSString *(YapDatabaseReadTransaction *transaction, NSString *collection, NSString *key, id object)
+	YapDatabaseViewGrouping *grouping =
+	  [YapDatabaseViewGrouping withOptions: YapDatabaseBlockInvokeDefaultForBlockTypeWithObject
+	                              keyBlock:
+	    ^NSString *(YapDatabaseReadTransaction *transaction, NSString *collection, NSString *key)
 	{
-		NSAssert([object isKindOfClass:[ZDCNode class]], @"Invalid class detected !");
-		__unsafe_unretained ZDCNode *node = (ZDCNode *)object;
+		ZDCNodeMeta *meta = [[ZDCNodeManager sharedInstance] metaForNodeID:key transaction:transaction];
 		
 		// IMPORTANT: This is a utility view which is used by MANY other utility methods.
 		// For example:
@@ -844,28 +1383,23 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 		// If you need filtering, you may NOT do it here.
 		// You MUST do it in a child extension.
 		
-		if (node.parentID == nil) return nil; // exclude trunk nodes
-		
-		ZDCTrunkNode *trunkNode =
-		  [[ZDCNodeManager sharedInstance] trunkNodeForNode:node transaction:transaction];
+		if (meta.parentID == nil) return nil; // exclude trunk nodes
+		if (meta.treeID == nil) return nil;   // exclude nodes not attached to a trunk
 		
-		if (trunkNode == nil) return nil;
-		
-		return [ZDCDatabaseManager groupForLocalUserID:node.localUserID treeID:trunkNode.treeID];
+		return [ZDCDatabaseManager groupForLocalUserID:meta.localUserID treeID:meta.treeID];
 	}];
 	
-	YapDatabaseViewSorting *sorting = [YapDatabaseViewSorting withObjectBlock:
+	YapDatabaseViewSorting *sorting =
+	  [YapDatabaseViewSorting withOptions: YapDatabaseBlockInvokeDefaultForBlockTypeWithObject
+	                             keyBlock:
 	    ^(YapDatabaseReadTransaction *transaction, NSString *group,
-	      NSString *collection1, NSString *key1, id obj1,
-	      NSString *collection2, NSString *key2, id obj2)
+	      NSString *collection1, NSString *key1,
+	      NSString *collection2, NSString *key2)
 	{
-		__unsafe_unretained ZDCNode *node1 = (ZDCNode *)obj1;
-		__unsafe_unretained ZDCNode *node2 = (ZDCNode *)obj2;
-		
-		return [node1.uuid compare:node2.uuid];
+		return [key1 compare:key2]; // key == node.uuid
 	}];
 	
-	NSString *versionTag = @"2019-01-30"; // <---------- change me if you modify grouping or sorting block <----------
+	NSString *versionTag = @"2019-11-12"; // <---------- change me if you modify grouping or sorting block <----------
 	
 	NSSet *whitelist = [NSSet setWithObject:kZDCCollection_Nodes];
 	
@@ -1203,12 +1737,48 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
 	// The actionManager was inititalized in a suspended state.
 	//
 	[actionManager resume];
+	
+	// Populate the node stats (no-op if already done).
+	// The node meta was populated before the extensions were registered.
+	//
+	[rwDatabaseConnection asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[ZDCNodeManager sharedInstance] rebuildStatsIfNeeded:transaction];
+	}];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark View Utilities
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * For use within:
+ * - Ext_View_Treesystem_CloudName
+ *
+ * Equivalent to `-[ZDCCloudPathManager cloudNameForNode:transaction:]`,
+ * but uses the ZDCNodeMeta of the node & its parent.
+ */
++ (nullable NSString *)cloudNameForMeta:(nullable ZDCNodeMeta *)meta
+                            transaction:(YapDatabaseReadTransaction *)transaction
+{
+	if (meta.explicitCloudName) {
+		return meta.explicitCloudName;
+	}
+	
+	NSString *parentID = meta.parentID;
+	if (meta.name == nil || parentID == nil) {
+		return nil;
+	}
+	
+	ZDCNodeMeta *parentMeta = [[ZDCNodeManager sharedInstance] metaForNodeID:parentID transaction:transaction];
+	NSData *parentDirSalt = parentMeta.dirSalt;
+	if (parentDirSalt == nil) {
+		return nil;
+	}
+	
+	return [[ZDCCloudPathManager sharedInstance] cloudNameForName:meta.name withParentDirSalt:parentDirSalt];
+}
+
 /**
  * For use within:
  * - Ext_View_Flat
@@ -1533,6 +2103,14 @@ NSString *const Index_Users_Column_RandomUUID = @"random_uuid";
  * A separate ZDCCloud instance must be registered for every <localUserID, appID> tuple.
 **/
 - (NSString *)cloudExtNameForUserID:(NSString *)localUserID treeID:(NSString *)appID
+{
+	return [[self class] cloudExtNameForUserID:localUserID treeID:appID];
+}
+
+/**
+ * See ZDCDatabaseManagerPrivate.h for description.
+ */
++ (NSString *)cloudExtNameForUserID:(NSString *)localUserID treeID:(NSString *)appID
 {
 	// Example: "ZeroDark:cloud_z55tqmfr9kix1p1gntotqpwkacpuoyno_com.4th-a.storm4"
 	// 
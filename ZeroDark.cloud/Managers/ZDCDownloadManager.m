@@ -13,12 +13,14 @@
 #import "S3Request.h"
 #import "ZDCAsyncCompletionDispatch.h"
 #import "ZDCConstantsPrivate.h"
+#import "ZDCDatabaseManagerPrivate.h"
 #import "ZDCDownloadContext.h"
 #import "ZDCLogging.h"
 #import "ZDCProgress.h"
 #import "ZDCNodePrivate.h"
 #import "ZDCProgressManagerPrivate.h"
 #import "ZDCNetworkTools.h"
+#import "ZDCTracing.h"
 #import "ZDCUserSearchManager.h"
 #import "ZeroDarkCloudPrivate.h"
 
@@ -212,10 +214,17 @@ static NSUInteger const kMaxFailCount = 8;
                         completionQueue:(dispatch_queue_t)completionQueue
                         completionBlock:(dispatch_block_t)completionBlock
 {
+	// Make the header available to other requests (for this eTag) immediately,
+	// rather than waiting for the database commit.
+	[zdc.cloudHeaderCache addHeader:info];
+	
 	__weak typeof(self) weakSelf = self;
 	
-	YapDatabaseConnection *rwConnection = zdc.databaseManager.rwDatabaseConnection;
-	[rwConnection asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	// Downloads tend to complete in bursts (e.g. thumbnails for a directory),
+	// so we let the coalescer merge these small updates into a single commit.
+	//
+	ZDCDatabaseWriteCoalescer *writeCoalescer = [zdc.databaseManager internal_writeCoalescer];
+	[writeCoalescer asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		ZDCNode *updatedNode = [transaction objectForKey:nodeID inCollection:kZDCCollection_Nodes];
 		if (updatedNode == nil) return; // from block
@@ -271,12 +280,10 @@ static NSUInteger const kMaxFailCount = 8;
 {
 	ZDCLogAutoTrace();
 	
-	ZDCCloudDataInfo *upToDateHeader = nil;
-	if ([node.cloudDataInfo.eTag isEqual:node.eTag_data])
-	{
-		upToDateHeader = node.cloudDataInfo;
-	}
+	// The header may have been learned via a different copy of the node (or a different request),
+	// so we check the shared cache, and not just `node.cloudDataInfo`.
 	
+	ZDCCloudDataInfo *upToDateHeader = [zdc.cloudHeaderCache headerForNode:node];
 	if (upToDateHeader)
 	{
 		// Nothing to download - we already have the header
@@ -1132,24 +1139,20 @@ static NSUInteger const kMaxFailCount = 8;
 	
 	const size_t headerSize = sizeof(ZDCCloudFileHeader);
 	
-	NSUInteger byteOffset_data_start = 0;
-	NSUInteger byteOffset_data_end = 0;
-	
-	if (requestingMetadata)
-	{
-		byteOffset_data_start = headerSize;
-		byteOffset_data_end = byteOffset_data_start + (NSUInteger)header.metadataSize;
-		
-		if (requestingThumbnail) {
-			byteOffset_data_end += header.thumbnailSize;
-		}
+	NSRange range_data;
+	if (requestingMetadata && requestingThumbnail) {
+		range_data = NSUnionRange(header.metadataRange, header.thumbnailRange);
 	}
-	else
-	{
-		byteOffset_data_start = headerSize + (NSUInteger)header.metadataSize;
-		byteOffset_data_end = byteOffset_data_start + (NSUInteger)header.thumbnailSize;
+	else if (requestingMetadata) {
+		range_data = header.metadataRange;
+	}
+	else {
+		range_data = header.thumbnailRange;
 	}
 	
+	NSUInteger byteOffset_data_start = range_data.location;
+	NSUInteger byteOffset_data_end = NSMaxRange(range_data);
+	
 	// In order to decrypt the data, we need to follow the following rules:
 	//
 	// #1. The data must start on a tweak block boundry.
@@ -1171,7 +1174,7 @@ static NSUInteger const kMaxFailCount = 8;
 	if ((byteOffset_data_end % node.encryptionKey.length) != 0) {
 		cipherBlockIndex++;
 	}
-	byteOffset_request_end = cipherBlockIndex * kZDCNode_TweakBlockSizeInBytes;
+	byteOffset_request_end = cipherBlockIndex * node.encryptionKey.length;
 	
 	if (byteOffset_request_start == 0)
 	{
@@ -1589,11 +1592,14 @@ static NSUInteger const kMaxFailCount = 8;
 			[encryptedData appendData:prefix];
 			[encryptedData appendData:responseData];
 			
+			// Only the requested sections were downloaded.
+			// So don't attempt to read the thumbnail section unless it was requested.
+			
 			[CloudFile2CleartextInputStream decryptCloudFileData: encryptedData
 			                                   withEncryptionKey: node.encryptionKey
 			                                              header: nil
 			                                         rawMetadata: &metadata
-			                                        rawThumbnail: &thumbnail
+			                                        rawThumbnail: (requestingThumbnail ? &thumbnail : NULL)
 			                                               error: &error];
 			if (error) {
 				failBlock(error);
@@ -1617,21 +1623,15 @@ static NSUInteger const kMaxFailCount = 8;
 			
 			if (requestingMetadata && (header.metadataSize > 0))
 			{
-				NSRange range = (NSRange){
-					.location = (NSUInteger)(headerSize + header.metadataSize)
-					          - context.range_request.location,
-					.length = (NSUInteger)header.metadataSize
-				};
+				NSRange range = header.metadataRange;
+				range.location -= context.range_request.location;
 				
 				metadata = [decryptedData subdataWithRange:range];
 			}
 			if (requestingThumbnail && (header.thumbnailSize > 0))
 			{
-				NSRange range = (NSRange){
-					.location = (NSUInteger)(headerSize + header.metadataSize + header.thumbnailSize)
-					          - context.range_request.location,
-					.length = (NSUInteger)header.thumbnailSize
-				};
+				NSRange range = header.thumbnailRange;
+				range.location -= context.range_request.location;
 				
 				thumbnail = [decryptedData subdataWithRange:range];
 			}
@@ -1843,6 +1843,8 @@ static NSUInteger const kMaxFailCount = 8;
 		return ticket;
 	}
 	
+	ZDCTraceBegin(ZDC_TRACE_LEVEL_COARSE, "download", "data", ZDCTraceIDForString(node.uuid));
+	
 	dispatch_queue_t concurrentQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
 	__weak typeof(self) weakSelf = self;
 	__block ZDCCloudLocator *cloudLocator = nil;
@@ -1982,6 +1984,7 @@ static NSUInteger const kMaxFailCount = 8;
                      auth:(ZDCLocalUserAuth *)auth
 {
 	ZDCLogAutoTrace();
+	ZDCTraceBegin(ZDC_TRACE_LEVEL_FINE, "download", "request", ZDCTraceIDForString(node.uuid));
 	
 #if TARGET_OS_IPHONE
 	BOOL canBackground = context.options.canDownloadWhileInBackground;
@@ -2128,6 +2131,8 @@ static NSUInteger const kMaxFailCount = 8;
 	
 	NSString *const nodeID = context.nodeID;
 	
+	ZDCTraceEnd(ZDC_TRACE_LEVEL_FINE, "download", "request", ZDCTraceIDForString(nodeID));
+	
 	__weak typeof(self) weakSelf = self;
 	
 	void (^failBlock)(NSError *) = ^(NSError *error) { @autoreleasepool {
@@ -2348,6 +2353,8 @@ static NSUInteger const kMaxFailCount = 8;
 {
 	NSString *const downloadKey = [nodeID copy];
 	
+	ZDCTraceEnd(ZDC_TRACE_LEVEL_COARSE, "download", "data", ZDCTraceIDForString(nodeID));
+	
 	dispatch_sync(downloadQueue, ^{ @autoreleasepool {
 	#pragma clang diagnostic push
 	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
@@ -2368,6 +2375,8 @@ static NSUInteger const kMaxFailCount = 8;
 {
 	NSString *const downloadKey = [nodeID copy];
 	
+	ZDCTraceEnd(ZDC_TRACE_LEVEL_COARSE, "download", "data", ZDCTraceIDForString(nodeID));
+	
 	dispatch_sync(downloadQueue, ^{ @autoreleasepool {
 	#pragma clang diagnostic push
 	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
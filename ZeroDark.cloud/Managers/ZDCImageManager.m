@@ -13,6 +13,7 @@
 #import "ZDCDatabaseManagerPrivate.h"
 #import "ZDCDownloadManagerPrivate.h"
 #import "ZDCLogging.h"
+#import "ZeroDarkCloudPrivate.h"
 
 // Categories
 #import "NSError+ZeroDark.h"
@@ -320,7 +321,17 @@
 	{
 		if (options.downloadIfMarkedAsNeedsDownload && nodeIsMarkedAsNeedsDownload)
 		{
-			requiresDownload = YES; // version in DiskManager is out-of-date
+			if ([self isThumbnail:export unchangedForNode:node])
+			{
+				// The node's data changed, but the thumbnail didn't.
+				// So the version in DiskManager is still up-to-date.
+				
+				[self unmarkNodeThumbnailAsNeedsDownload:node];
+			}
+			else
+			{
+				requiresDownload = YES; // version in DiskManager is out-of-date
+			}
 		}
 	}
 	else
@@ -449,6 +460,48 @@
 	return downloadTicket;
 }
 
+/**
+ * It's common for a node's data to change, while the thumbnail remains the same.
+ * (E.g. modifying the second page of a document.)
+ *
+ * If we know the headers for both the thumbnail in the DiskManager, and the node's current DATA file,
+ * then we can compare the thumbnail hashes, and skip the download.
+ */
+- (BOOL)isThumbnail:(ZDCDiskExport *)export unchangedForNode:(ZDCNode *)node
+{
+	if (export.eTag == nil) {
+		return NO;
+	}
+	
+	ZDCCloudDataInfo *diskHeader = [zdc.cloudHeaderCache headerForETag:export.eTag];
+	ZDCCloudDataInfo *cloudHeader = [zdc.cloudHeaderCache headerForNode:node];
+	
+	if (diskHeader == nil || cloudHeader == nil) {
+		return NO;
+	}
+	
+	return (diskHeader.thumbnailSize == cloudHeader.thumbnailSize)
+	    && (diskHeader.thumbnailxxHash64 == cloudHeader.thumbnailxxHash64);
+}
+
+- (void)unmarkNodeThumbnailAsNeedsDownload:(ZDCNode *)node
+{
+	NSString *eTag = node.eTag_data;
+	
+	__weak ZeroDarkCloud *_zdc = zdc;
+	
+	YapDatabaseConnection *rwConnection = zdc.databaseManager.rwDatabaseConnection;
+	[rwConnection asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		ZDCCloudTransaction *cloudTransaction =
+		  [_zdc cloudTransaction:transaction forLocalUserID:node.localUserID];
+		
+		[cloudTransaction unmarkNodeAsNeedsDownload: node.uuid
+		                                 components: ZDCNodeComponents_Thumbnail
+		                              ifETagMatches: eTag];
+	}];
+}
+
 /**
  * See header file for description.
  */
@@ -0,0 +1,109 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * An immutable snapshot of a single metric.
+ *
+ * Latencies are recorded into a log-linear (HDR-style) histogram,
+ * so percentiles are accurate to within ~3% of the actual value.
+ */
+@interface ZDCMetricStats : NSObject
+
+/**
+ * The name of the metric. For example:
+ * - "rest: GET /users/info/*"
+ * - "s3: PUT"
+ * - "pull: fetchChanges"
+ * - "push: put"
+ * - "push: poll requests" (a counter, i.e. only the count is set)
+ * - "db: write"
+ * - "crypto: encrypt"
+ */
+@property (nonatomic, copy, readonly) NSString *name;
+
+/** The number of recorded events. */
+@property (nonatomic, assign, readonly) uint64_t count;
+
+/** The number of recorded events that failed (e.g. network error, or HTTP status >= 400). */
+@property (nonatomic, assign, readonly) uint64_t failureCount;
+
+/** The total number of bytes transferred/processed (if applicable). */
+@property (nonatomic, assign, readonly) uint64_t totalBytes;
+
+/** The sum of all recorded durations. */
+@property (nonatomic, assign, readonly) NSTimeInterval totalDuration;
+
+@property (nonatomic, assign, readonly) NSTimeInterval minLatency;
+@property (nonatomic, assign, readonly) NSTimeInterval maxLatency;
+@property (nonatomic, assign, readonly) NSTimeInterval meanLatency;
+
+/**
+ * Returns the latency at the given percentile.
+ *
+ * @param percentile
+ *   A value between 0 and 100. E.g. 99.0 for p99.
+ */
+- (NSTimeInterval)latencyAtPercentile:(double)percentile;
+
+@property (nonatomic, readonly) NSTimeInterval p50;
+@property (nonatomic, readonly) NSTimeInterval p90;
+@property (nonatomic, readonly) NSTimeInterval p99;
+
+/** totalBytes / totalDuration, in MB/s (or zero if not applicable). */
+@property (nonatomic, readonly) double megabytesPerSecond;
+
+/** A JSON compatible representation of the stats. */
+- (NSDictionary<NSString*, id> *)dictionaryRepresentation;
+
+@end
+
+/**
+ * The MetricsManager aggregates latency & throughput statistics for the sync system:
+ *
+ * - REST API requests (per endpoint)
+ * - S3 requests (per HTTP verb)
+ * - pull phases
+ * - push operations (per operation type), and the number of poll requests & status checks
+ * - database write transactions
+ * - encryption & decryption throughput
+ *
+ * All statistics are kept in memory, and are reset when the app is relaunched.
+ * Use `exportSnapshotToURL:error:` to persist them, e.g. to attach to a support request.
+ */
+@interface ZDCMetricsManager : NSObject
+
+/**
+ * Returns a snapshot of all the metrics recorded so far.
+ *
+ * - key   : metric name
+ * - value : stats for the metric
+ */
+- (NSDictionary<NSString*, ZDCMetricStats*> *)snapshot;
+
+/**
+ * Writes a snapshot of all the metrics (as JSON) to the given file.
+ */
+- (BOOL)exportSnapshotToURL:(NSURL *)url error:(NSError *_Nullable *_Nullable)errPtr;
+
+/**
+ * Discards all the metrics recorded so far.
+ *
+ * Encryption & decryption throughput is tracked process-wide (shared by every ZeroDarkCloud instance).
+ * Resetting only affects this instance's snapshots: they report the crypto throughput since the reset.
+ * Other instances are unaffected.
+ */
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,711 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCMetricsManagerPrivate.h"
+
+#import "ZDCHostConnectionStats.h"
+#import "ZDCLogging.h"
+
+// Categories
+#import "NSURLResponse+ZeroDark.h"
+
+#include <stdatomic.h>
+
+// Log Levels: off, error, warn, info, verbose
+// Log Flags : trace
+#if DEBUG
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#else
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#endif
+#pragma unused(zdcLogLevel)
+
+/**
+ * Histogram layout (values are in microseconds):
+ *
+ * - values below 32 each get their own bucket
+ * - above that, every power-of-2 range is split into 16 linear sub-buckets
+ *
+ * So the relative error is at most 1/16 (and ~3% on average).
+ * Values above 2^36 microseconds (~19 hours) are clamped.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS   5
+#define HISTOGRAM_SUB_BUCKET_COUNT  (1 << HISTOGRAM_SUB_BUCKET_BITS)       // 32
+#define HISTOGRAM_SUB_BUCKET_HALF   (HISTOGRAM_SUB_BUCKET_COUNT / 2)       // 16
+#define HISTOGRAM_MAX_VALUE         ((1ULL << 36) - 1)
+#define HISTOGRAM_BUCKET_COUNT      528
+
+NSUInteger ZDCHistogramBucketIndex(uint64_t value)
+{
+	if (value > HISTOGRAM_MAX_VALUE) {
+		value = HISTOGRAM_MAX_VALUE;
+	}
+	
+	if (value < HISTOGRAM_SUB_BUCKET_COUNT) {
+		return (NSUInteger)value;
+	}
+	
+	int msb = 63 - __builtin_clzll(value);
+	int shift = msb - HISTOGRAM_SUB_BUCKET_BITS + 1;
+	uint64_t sub = value >> shift; // [16, 31]
+	
+	return (NSUInteger)(HISTOGRAM_SUB_BUCKET_COUNT + ((shift - 1) * HISTOGRAM_SUB_BUCKET_HALF) + (sub - HISTOGRAM_SUB_BUCKET_HALF));
+}
+
+uint64_t ZDCHistogramBucketMidpoint(NSUInteger index)
+{
+	if (index < HISTOGRAM_SUB_BUCKET_COUNT) {
+		return index;
+	}
+	
+	NSUInteger offset = index - HISTOGRAM_SUB_BUCKET_COUNT;
+	int shift = (int)(offset / HISTOGRAM_SUB_BUCKET_HALF) + 1;
+	uint64_t sub = (offset % HISTOGRAM_SUB_BUCKET_HALF) + HISTOGRAM_SUB_BUCKET_HALF;
+	
+	uint64_t lower = sub << shift;
+	uint64_t upper = ((sub + 1) << shift) - 1;
+	
+	return lower + ((upper - lower) / 2);
+}
+
+// Process-wide crypto counters (see header file)
+
+static _Atomic(uint64_t) encrypt_count    = 0;
+static _Atomic(uint64_t) encrypt_bytes    = 0;
+static _Atomic(uint64_t) encrypt_duration = 0;
+
+static _Atomic(uint64_t) decrypt_count    = 0;
+static _Atomic(uint64_t) decrypt_bytes    = 0;
+static _Atomic(uint64_t) decrypt_duration = 0;
+
+typedef struct {
+	uint64_t count;
+	uint64_t bytes;
+	uint64_t duration; // nanoseconds
+} ZDCCryptoCounters;
+
+static ZDCCryptoCounters LoadEncryptCounters(void)
+{
+	return (ZDCCryptoCounters){
+		.count    = atomic_load_explicit(&encrypt_count, memory_order_relaxed),
+		.bytes    = atomic_load_explicit(&encrypt_bytes, memory_order_relaxed),
+		.duration = atomic_load_explicit(&encrypt_duration, memory_order_relaxed)
+	};
+}
+
+static ZDCCryptoCounters LoadDecryptCounters(void)
+{
+	return (ZDCCryptoCounters){
+		.count    = atomic_load_explicit(&decrypt_count, memory_order_relaxed),
+		.bytes    = atomic_load_explicit(&decrypt_bytes, memory_order_relaxed),
+		.duration = atomic_load_explicit(&decrypt_duration, memory_order_relaxed)
+	};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface ZDCMetric : NSObject {
+@public
+	
+	uint64_t count;
+	uint64_t failureCount;
+	uint64_t totalBytes;
+	uint64_t totalDuration; // microseconds
+	uint64_t min;           // microseconds
+	uint64_t max;           // microseconds
+	
+	uint64_t buckets[HISTOGRAM_BUCKET_COUNT];
+}
+@end
+
+@implementation ZDCMetric
+@end
+
+@interface ZDCMetricStats ()
+
+- (instancetype)initWithName:(NSString *)name metric:(ZDCMetric *)metric;
+
+- (instancetype)initWithName:(NSString *)name
+                       count:(uint64_t)count
+                  totalBytes:(uint64_t)totalBytes
+               totalDuration:(uint64_t)totalDuration;
+
+@end
+
+@implementation ZDCMetricStats {
+	
+	NSData *buckets; // nil for throughput-only metrics
+}
+
+@synthesize name = name;
+@synthesize count = count;
+@synthesize failureCount = failureCount;
+@synthesize totalBytes = totalBytes;
+@synthesize totalDuration = totalDuration;
+@synthesize minLatency = minLatency;
+@synthesize maxLatency = maxLatency;
+
+- (instancetype)initWithName:(NSString *)inName metric:(ZDCMetric *)metric
+{
+	if ((self = [super init]))
+	{
+		name = [inName copy];
+		count = metric->count;
+		failureCount = metric->failureCount;
+		totalBytes = metric->totalBytes;
+		totalDuration = (double)metric->totalDuration / (double)USEC_PER_SEC;
+		minLatency = (double)metric->min / (double)USEC_PER_SEC;
+		maxLatency = (double)metric->max / (double)USEC_PER_SEC;
+		
+		buckets = [NSData dataWithBytes:metric->buckets length:sizeof(metric->buckets)];
+	}
+	return self;
+}
+
+- (instancetype)initWithName:(NSString *)inName
+                       count:(uint64_t)inCount
+                  totalBytes:(uint64_t)inTotalBytes
+               totalDuration:(uint64_t)inTotalDuration
+{
+	if ((self = [super init]))
+	{
+		name = [inName copy];
+		count = inCount;
+		totalBytes = inTotalBytes;
+		totalDuration = (double)inTotalDuration / (double)NSEC_PER_SEC;
+	}
+	return self;
+}
+
+- (NSTimeInterval)meanLatency
+{
+	if (count == 0) return 0;
+	
+	return totalDuration / (double)count;
+}
+
+/**
+ * See header file for description.
+ */
+- (NSTimeInterval)latencyAtPercentile:(double)percentile
+{
+	if (buckets == nil || count == 0) return 0;
+	
+	percentile = MAX(0.0, MIN(percentile, 100.0));
+	
+	uint64_t target = (uint64_t)ceil((percentile / 100.0) * (double)count);
+	if (target == 0) {
+		target = 1;
+	}
+	
+	const uint64_t *values = (const uint64_t *)buckets.bytes;
+	uint64_t cumulative = 0;
+	
+	for (NSUInteger i = 0; i < HISTOGRAM_BUCKET_COUNT; i++)
+	{
+		cumulative += values[i];
+		if (cumulative >= target)
+		{
+			NSTimeInterval latency = (double)ZDCHistogramBucketMidpoint(i) / (double)USEC_PER_SEC;
+			
+			return MAX(minLatency, MIN(latency, maxLatency));
+		}
+	}
+	
+	return maxLatency;
+}
+
+- (NSTimeInterval)p50
+{
+	return [self latencyAtPercentile:50.0];
+}
+
+- (NSTimeInterval)p90
+{
+	return [self latencyAtPercentile:90.0];
+}
+
+- (NSTimeInterval)p99
+{
+	return [self latencyAtPercentile:99.0];
+}
+
+- (double)megabytesPerSecond
+{
+	if (totalBytes == 0 || totalDuration <= 0) return 0;
+	
+	return ((double)totalBytes / (1024.0 * 1024.0)) / totalDuration;
+}
+
+/**
+ * See header file for description.
+ */
+- (NSDictionary<NSString*, id> *)dictionaryRepresentation
+{
+	NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:12];
+	
+	dict[@"count"] = @(count);
+	dict[@"failures"] = @(failureCount);
+	dict[@"bytes"] = @(totalBytes);
+	dict[@"total_ms"] = @(totalDuration * 1000.0);
+	
+	if (buckets)
+	{
+		dict[@"min_ms"]  = @(minLatency * 1000.0);
+		dict[@"max_ms"]  = @(maxLatency * 1000.0);
+		dict[@"mean_ms"] = @(self.meanLatency * 1000.0);
+		dict[@"p50_ms"]  = @(self.p50 * 1000.0);
+		dict[@"p90_ms"]  = @(self.p90 * 1000.0);
+		dict[@"p99_ms"]  = @(self.p99 * 1000.0);
+	}
+	
+	if (totalBytes > 0) {
+		dict[@"mb_per_sec"] = @(self.megabytesPerSecond);
+	}
+	
+	return dict;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<ZDCMetricStats %@: count=%llu p50=%.1fms p99=%.1fms>",
+	          name, count, (self.p50 * 1000.0), (self.p99 * 1000.0)];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCMetricsManager {
+	
+	__weak ZeroDarkCloud *zdc;
+	
+	dispatch_queue_t queue;
+	
+	// Must only be accessed from within the queue.
+	NSMutableDictionary<NSString*, ZDCMetric*> *metrics;
+	NSMutableDictionary<NSString*, ZDCHostConnectionStats*> *hostStats;
+	NSMutableDictionary<NSString*, NSNumber*> *counters;
+	
+	// The process-wide crypto counters, as of the last reset.
+	// Snapshots report the difference, so resetting one instance doesn't affect the others.
+	// Must only be accessed from within the queue.
+	ZDCCryptoCounters encryptBaseline;
+	ZDCCryptoCounters decryptBaseline;
+}
+
+- (instancetype)init
+{
+	return nil; // To access this class use: ZeroDarkCloud.metricsManager
+}
+
+- (instancetype)initWithOwner:(ZeroDarkCloud *)inOwner
+{
+	if ((self = [super init]))
+	{
+		zdc = inOwner;
+		
+		queue = dispatch_queue_create("ZDCMetricsManager", DISPATCH_QUEUE_SERIAL);
+		metrics = [[NSMutableDictionary alloc] init];
+		hostStats = [[NSMutableDictionary alloc] init];
+		counters = [[NSMutableDictionary alloc] init];
+	}
+	return self;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Recording
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * See header file for description.
+ */
+- (void)recordDuration:(uint64_t)duration
+                 bytes:(uint64_t)bytes
+                failed:(BOOL)failed
+             forMetric:(NSString *)name
+{
+	if (name == nil) return;
+	
+	uint64_t value = duration / NSEC_PER_USEC;
+	
+	dispatch_async(queue, ^{ @autoreleasepool {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		ZDCMetric *metric = metrics[name];
+		if (metric == nil)
+		{
+			metric = [[ZDCMetric alloc] init];
+			metric->min = UINT64_MAX;
+			
+			metrics[name] = metric;
+		}
+		
+		metric->count++;
+		metric->totalBytes += bytes;
+		metric->totalDuration += value;
+		metric->min = MIN(metric->min, value);
+		metric->max = MAX(metric->max, value);
+		metric->buckets[ZDCHistogramBucketIndex(value)]++;
+		
+		if (failed) {
+			metric->failureCount++;
+		}
+		
+	#pragma clang diagnostic pop
+	}});
+}
+
+/**
+ * See header file for description.
+ */
+- (void)incrementCounter:(NSString *)name by:(uint64_t)amount
+{
+	if (name == nil || amount == 0) return;
+	
+	dispatch_async(queue, ^{ @autoreleasepool {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		counters[name] = @([counters[name] unsignedLongLongValue] + amount);
+		
+	#pragma clang diagnostic pop
+	}});
+}
+
+/**
+ * See header file for description.
+ */
+- (void)recordDurationSince:(uint64_t)startTime failed:(BOOL)failed forMetric:(NSString *)name
+{
+	uint64_t now = ZDCMetricsNow();
+	uint64_t duration = (now > startTime) ? (now - startTime) : 0;
+	
+	[self recordDuration:duration bytes:0 failed:failed forMetric:name];
+}
+
+/**
+ * See header file for description.
+ */
+- (void)recordTask:(NSURLSessionTask *)task metrics:(NSURLSessionTaskMetrics *)taskMetrics
+{
+	NSURLRequest *request = task.originalRequest ?: task.currentRequest;
+	NSString *name = [self metricNameForRequest:request];
+	
+	if (name == nil) return;
+	
+	NSTimeInterval seconds = taskMetrics.taskInterval.duration;
+	uint64_t duration = (uint64_t)(MAX(0.0, seconds) * NSEC_PER_SEC);
+	
+	uint64_t bytes = 0;
+	if (task.countOfBytesSent > 0) {
+		bytes += (uint64_t)task.countOfBytesSent;
+	}
+	if (task.countOfBytesReceived > 0) {
+		bytes += (uint64_t)task.countOfBytesReceived;
+	}
+	
+	BOOL failed = (task.error != nil) || (task.response.httpStatusCode >= 400);
+	
+	[self recordDuration:duration bytes:bytes failed:failed forMetric:name];
+	[self recordConnectionsForTaskMetrics:taskMetrics];
+}
+
+/**
+ * Updates the per-host connection stats (connection reuse, TLS handshakes, HTTP/2)
+ * from the individual request/response transactions of a completed task.
+ */
+- (void)recordConnectionsForTaskMetrics:(NSURLSessionTaskMetrics *)taskMetrics
+{
+	NSArray<NSURLSessionTaskTransactionMetrics *> *transactions = taskMetrics.transactionMetrics;
+	if (transactions.count == 0) return;
+	
+	dispatch_async(queue, ^{ @autoreleasepool {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		for (NSURLSessionTaskTransactionMetrics *transaction in transactions)
+		{
+			if (transaction.resourceFetchType != NSURLSessionTaskMetricsResourceFetchTypeNetworkLoad) {
+				continue;
+			}
+			
+			NSString *host = transaction.request.URL.host;
+			if (host == nil) continue;
+			
+			ZDCHostConnectionStats *stats = hostStats[host];
+			if (stats == nil)
+			{
+				stats = [[ZDCHostConnectionStats alloc] initWithHost:host];
+				hostStats[host] = stats;
+			}
+			
+			stats.requestCount++;
+			
+			if (transaction.isReusedConnection) {
+				stats.reusedConnectionCount++;
+			}
+			else if (transaction.secureConnectionStartDate) {
+				stats.tlsHandshakeCount++;
+			}
+			
+			if ([transaction.networkProtocolName isEqualToString:@"h2"]) {
+				stats.http2Count++;
+			}
+		}
+		
+	#pragma clang diagnostic pop
+	}});
+}
+
+/**
+ * Maps a request to its metric name:
+ *
+ * - API Gateway : "rest: GET /users/info/*"  (the stage is removed, and identifiers are replaced with '*')
+ * - S3          : "s3: PUT"
+ * - other       : "http: host"
+ */
+- (nullable NSString *)metricNameForRequest:(NSURLRequest *)request
+{
+	NSURL *url = request.URL;
+	NSString *host = url.host;
+	
+	if (host == nil) return nil;
+	
+	NSString *method = request.HTTPMethod ?: @"GET";
+	
+	if ([host rangeOfString:@".execute-api."].location != NSNotFound)
+	{
+		NSArray<NSString*> *components = [url.path componentsSeparatedByString:@"/"];
+		NSMutableArray<NSString*> *normalized = [NSMutableArray arrayWithCapacity:components.count];
+		
+		BOOL isStage = YES;
+		for (NSString *component in components)
+		{
+			if (component.length == 0) continue;
+			if (isStage) {
+				isStage = NO;
+				continue;
+			}
+			
+			[normalized addObject:([self isIdentifierPathComponent:component] ? @"*" : component)];
+		}
+		
+		return [NSString stringWithFormat:@"rest: %@ /%@", method, [normalized componentsJoinedByString:@"/"]];
+	}
+	else if ([host hasSuffix:@".amazonaws.com"] && [host rangeOfString:@"s3"].location != NSNotFound)
+	{
+		return [NSString stringWithFormat:@"s3: %@", method];
+	}
+	else
+	{
+		return [NSString stringWithFormat:@"http: %@", host];
+	}
+}
+
+/**
+ * Path components such as userIDs, requestIDs & change tokens would make every request its own metric.
+ */
+- (BOOL)isIdentifierPathComponent:(NSString *)component
+{
+	if (component.length >= 16) return YES;
+	
+	NSCharacterSet *letters = [NSCharacterSet characterSetWithCharactersInString:
+	  @"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ-_"];
+	
+	return ([component rangeOfCharacterFromSet:[letters invertedSet]].location != NSNotFound);
+}
+
+/**
+ * See header file for description.
+ */
++ (void)recordEncryptedBytes:(uint64_t)bytes duration:(uint64_t)duration
+{
+	atomic_fetch_add_explicit(&encrypt_count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&encrypt_bytes, bytes, memory_order_relaxed);
+	atomic_fetch_add_explicit(&encrypt_duration, duration, memory_order_relaxed);
+}
+
+/**
+ * See header file for description.
+ */
++ (void)recordDecryptedBytes:(uint64_t)bytes duration:(uint64_t)duration
+{
+	atomic_fetch_add_explicit(&decrypt_count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&decrypt_bytes, bytes, memory_order_relaxed);
+	atomic_fetch_add_explicit(&decrypt_duration, duration, memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Snapshots
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * See header file for description.
+ */
+- (NSDictionary<NSString*, ZDCMetricStats*> *)snapshot
+{
+	NSMutableDictionary<NSString*, ZDCMetricStats*> *snapshot = [NSMutableDictionary dictionary];
+	
+	__block ZDCCryptoCounters encrypted;
+	__block ZDCCryptoCounters decrypted;
+	
+	dispatch_sync(queue, ^{ @autoreleasepool {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		[metrics enumerateKeysAndObjectsUsingBlock:^(NSString *name, ZDCMetric *metric, BOOL *stop) {
+			
+			snapshot[name] = [[ZDCMetricStats alloc] initWithName:name metric:metric];
+		}];
+		
+		[counters enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSNumber *count, BOOL *stop) {
+			
+			snapshot[name] =
+			  [[ZDCMetricStats alloc] initWithName: name
+			                                 count: [count unsignedLongLongValue]
+			                            totalBytes: 0
+			                         totalDuration: 0];
+		}];
+		
+		encrypted = LoadEncryptCounters();
+		decrypted = LoadDecryptCounters();
+		
+		encrypted.count    -= MIN(encrypted.count,    encryptBaseline.count);
+		encrypted.bytes    -= MIN(encrypted.bytes,    encryptBaseline.bytes);
+		encrypted.duration -= MIN(encrypted.duration, encryptBaseline.duration);
+		
+		decrypted.count    -= MIN(decrypted.count,    decryptBaseline.count);
+		decrypted.bytes    -= MIN(decrypted.bytes,    decryptBaseline.bytes);
+		decrypted.duration -= MIN(decrypted.duration, decryptBaseline.duration);
+		
+	#pragma clang diagnostic pop
+	}});
+	
+	if (encrypted.count > 0)
+	{
+		snapshot[@"crypto: encrypt"] =
+		  [[ZDCMetricStats alloc] initWithName: @"crypto: encrypt"
+		                                 count: encrypted.count
+		                            totalBytes: encrypted.bytes
+		                         totalDuration: encrypted.duration];
+	}
+	
+	if (decrypted.count > 0)
+	{
+		snapshot[@"crypto: decrypt"] =
+		  [[ZDCMetricStats alloc] initWithName: @"crypto: decrypt"
+		                                 count: decrypted.count
+		                            totalBytes: decrypted.bytes
+		                         totalDuration: decrypted.duration];
+	}
+	
+	return snapshot;
+}
+
+/**
+ * See header file for description.
+ */
+- (NSArray<ZDCHostConnectionStats*> *)hostConnectionStats
+{
+	__block NSMutableArray<ZDCHostConnectionStats*> *result = nil;
+	
+	dispatch_sync(queue, ^{ @autoreleasepool {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		result = [NSMutableArray arrayWithCapacity:hostStats.count];
+		
+		for (ZDCHostConnectionStats *stats in [hostStats objectEnumerator])
+		{
+			[result addObject:[stats copy]];
+		}
+		
+	#pragma clang diagnostic pop
+	}});
+	
+	[result sortUsingComparator:^NSComparisonResult(ZDCHostConnectionStats *a, ZDCHostConnectionStats *b) {
+		
+		return [a.host compare:b.host];
+	}];
+	
+	return result;
+}
+
+/**
+ * See header file for description.
+ */
+- (BOOL)exportSnapshotToURL:(NSURL *)url error:(NSError **)errPtr
+{
+	NSDictionary<NSString*, ZDCMetricStats*> *snapshot = [self snapshot];
+	
+	NSMutableDictionary *metricsDict = [NSMutableDictionary dictionaryWithCapacity:snapshot.count];
+	[snapshot enumerateKeysAndObjectsUsingBlock:^(NSString *name, ZDCMetricStats *stats, BOOL *stop) {
+		
+		metricsDict[name] = [stats dictionaryRepresentation];
+	}];
+	
+	NSMutableDictionary *hostsDict = [NSMutableDictionary dictionary];
+	for (ZDCHostConnectionStats *stats in [self hostConnectionStats])
+	{
+		hostsDict[stats.host] = [stats dictionaryRepresentation];
+	}
+	
+	NSDictionary *json = @{
+		@"timestamp" : @([[NSDate date] timeIntervalSince1970]),
+		@"metrics"   : metricsDict,
+		@"hosts"     : hostsDict
+	};
+	
+	NSError *error = nil;
+	NSData *data = [NSJSONSerialization dataWithJSONObject: json
+	                                               options: NSJSONWritingPrettyPrinted
+	                                                 error: &error];
+	
+	if (data) {
+		[data writeToURL:url options:NSDataWritingAtomic error:&error];
+	}
+	
+	if (error) {
+		ZDCLogWarn(@"Error exporting metrics: %@", error);
+	}
+	
+	if (errPtr) *errPtr = error;
+	return (error == nil);
+}
+
+/**
+ * See header file for description.
+ */
+- (void)reset
+{
+	dispatch_sync(queue, ^{
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		[metrics removeAllObjects];
+		[hostStats removeAllObjects];
+		[counters removeAllObjects];
+		
+		// The crypto counters are shared by every instance, so we don't clear them.
+		// We just start counting from their current values.
+		
+		encryptBaseline = LoadEncryptCounters();
+		decryptBaseline = LoadDecryptCounters();
+		
+	#pragma clang diagnostic pop
+	});
+}
+
+@end
@@ -15,6 +15,7 @@
 #import "ZDCCloud.h"
 #import "ZDCCloudRcrd.h"
 #import "ZDCNode.h"
+#import "ZDCNodeStats.h"
 #import "ZDCPublicKey.h"
 #import "ZDCTreesystemPath.h"
 #import "ZDCTrunkNode.h"
@@ -302,6 +303,27 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)hasChildren:(ZDCNode *)node transaction:(YapDatabaseReadTransaction *)transaction;
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Subtree Stats
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns aggregate statistics for all the descendants of the given node.
+ * (e.g. number of descendants, total cloud size, number pending upload, etc)
+ *
+ * The stats are maintained incrementally by the framework, so this is a single database lookup,
+ * regardless of the size of the subtree. Great for folder badges & sync progress UI.
+ *
+ * If the given node is a pointer, the stats for the target node are returned.
+ *
+ * @param node
+ *   The node you're interested in.
+ *
+ * @param transaction
+ *   A database transaction - allows the method to read from the database.
+ */
+- (ZDCNodeStats *)statsForNode:(ZDCNode *)node transaction:(YapDatabaseReadTransaction *)transaction;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Find Nodes
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -7,14 +7,17 @@
  * API Reference : https://apis.zerodark.cloud
 **/
 
-#import "ZDCNodeManager.h"
+#import "ZDCNodeManagerPrivate.h"
 
 #import "ZDCCloudNodeManager.h"
+#import "ZDCCloudOperation.h"
 #import "ZDCCloudPathManager.h"
-#import "ZDCDatabaseManager.h"
+#import "ZDCCloudPrivate.h"
+#import "ZDCDatabaseManagerPrivate.h"
 #import "ZDCLocalUser.h"
 #import "ZDCLogging.h"
 #import "ZDCNodePrivate.h"
+#import "ZDCNodeStatsHooks.h"
 #import "ZDCPublicKey.h"
 #import "ZDCTreesystemPath.h"
 #import "ZDCTrunkNode.h"
@@ -43,6 +46,12 @@
 #endif
 #pragma unused(zdcLogLevel)
 
+/**
+ * Separator used when encoding paths for the Ext_Index_Paths extension.
+ * Node names may contain '/', so we use the ASCII "unit separator" instead.
+ */
+static NSString *const kPathIndexSeparator = @"\x1f";
+
 @implementation ZDCNodeManager
 
 static ZDCNodeManager *sharedInstance = nil;
@@ -223,15 +232,13 @@ static ZDCNodeManager *sharedInstance = nil;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * See header file for description.
- * Or view the api's online (for both Swift & Objective-C):
- * https://apis.zerodark.cloud/Classes/ZDCRestManager.html
+ * Calculates the path by walking the parent chain (one database lookup per level).
+ * This is used to populate the Ext_Index_Paths extension, and as a fallback when the extension isn't ready.
  */
-- (ZDCTreesystemPath *)pathForNode:(ZDCNode *)node transaction:(YapDatabaseReadTransaction *)transaction
+- (ZDCTreesystemPath *)_walkPathForNode:(ZDCNode *)node
+                            transaction:(YapDatabaseReadTransaction *)transaction
+                              trunkNode:(ZDCTrunkNode *_Nullable *_Nullable)outTrunkNode
 {
-	ZDCLogAutoTrace();
-	NSParameterAssert(transaction != nil);
-	
 	ZDCTrunkNode *trunkNode = nil;
 	NSMutableArray<NSString *> *pathComponents = [NSMutableArray arrayWithCapacity:8];
 	
@@ -246,7 +253,7 @@ static ZDCNodeManager *sharedInstance = nil;
 		{
 			if (![node.parentID hasSuffix:@"|graft"])
 			{
-				[pathComponents insertObject:(node.name ?: @"") atIndex:0];
+				[pathComponents addObject:(node.name ?: @"")];
 			}
 		}
 		else
@@ -273,12 +280,191 @@ static ZDCNodeManager *sharedInstance = nil;
 	
 	ZDCTreesystemTrunk trunk = (trunkNode ? trunkNode.trunk : ZDCTreesystemTrunk_Detached);
 	
+	// We appended components while walking up the tree (cheaper than repeated inserts at index 0).
+	// So the components are in reverse order.
+	
+	NSArray<NSString *> *orderedComponents = [[pathComponents reverseObjectEnumerator] allObjects];
+	
 	ZDCTreesystemPath *path =
-	  [[ZDCTreesystemPath alloc] initWithPathComponents: pathComponents
+	  [[ZDCTreesystemPath alloc] initWithPathComponents: orderedComponents
 	                                              trunk: trunk];
+	
+	if (outTrunkNode) *outTrunkNode = trunkNode;
 	return path;
 }
 
+/**
+ * See header file for description.
+ * Or view the api's online (for both Swift & Objective-C):
+ * https://apis.zerodark.cloud/Classes/ZDCRestManager.html
+ */
+- (ZDCTreesystemPath *)pathForNode:(ZDCNode *)node transaction:(YapDatabaseReadTransaction *)transaction
+{
+	ZDCLogAutoTrace();
+	NSParameterAssert(transaction != nil);
+	
+	if (node.uuid && ![node isKindOfClass:[ZDCTrunkNode class]] && [self isNodeUnmodified:node transaction:transaction])
+	{
+		// Use the path index for best performance (single sqlite lookup).
+		
+		NSString *pathString = [self indexedPathStringForNodeID:node.uuid transaction:transaction];
+		if (pathString)
+		{
+			ZDCTreesystemPath *path = [self pathFromIndexedPathString:pathString];
+			if (path) {
+				return path;
+			}
+		}
+	}
+	
+	// Backup Plan:
+	//
+	// The index extension isn't ready yet (it must be still initializing / updating),
+	// or the node isn't indexed (e.g. detached node, or node not yet in database).
+	
+	return [self _walkPathForNode:node transaction:transaction trunkNode:NULL];
+}
+
+/**
+ * The path index reflects what's stored in the database.
+ * But callers sometimes ask for the path of a modified copy (e.g. a renamed node that hasn't been saved yet).
+ */
+- (BOOL)isNodeUnmodified:(ZDCNode *)node transaction:(YapDatabaseReadTransaction *)transaction
+{
+	ZDCNode *storedNode = [transaction objectForKey:node.uuid inCollection:kZDCCollection_Nodes];
+	
+	if (storedNode == node) return YES;
+	if (storedNode == nil) return NO;
+	
+	BOOL sameName = (node.name == storedNode.name) || [node.name isEqualToString:storedNode.name];
+	BOOL sameParent = (node.parentID == storedNode.parentID) || [node.parentID isEqualToString:storedNode.parentID];
+	
+	return sameName && sameParent;
+}
+
+/**
+ * Encodes a path for storage in Ext_Index_Paths.
+ *
+ * Format: trunk + (separator + component)*
+ */
+- (NSString *)indexedPathStringForPath:(ZDCTreesystemPath *)path
+{
+	NSMutableString *result = [NSMutableString stringWithCapacity:64];
+	[result appendString:NSStringFromTreesystemTrunk(path.trunk)];
+	
+	for (NSString *component in path.pathComponents)
+	{
+		[result appendString:kPathIndexSeparator];
+		[result appendString:component];
+	}
+	
+	return result;
+}
+
+/**
+ * Inverse of `indexedPathStringForPath:`
+ */
+- (nullable ZDCTreesystemPath *)pathFromIndexedPathString:(NSString *)pathString
+{
+	NSArray<NSString *> *components = [pathString componentsSeparatedByString:kPathIndexSeparator];
+	if (components.count == 0) {
+		return nil;
+	}
+	
+	ZDCTreesystemTrunk trunk = TreesystemTrunkFromString(components[0]);
+	NSArray<NSString *> *pathComponents = [components subarrayWithRange:NSMakeRange(1, components.count - 1)];
+	
+	return [[ZDCTreesystemPath alloc] initWithPathComponents:pathComponents trunk:trunk];
+}
+
+/**
+ * Returns the value for the Index_Paths_Column_Lookup column.
+ *
+ * Node names are compared using `localizedCaseInsensitiveCompare:` throughout the framework.
+ * So we normalize the path in a manner that matches this (as closely as possible).
+ */
+- (NSString *)pathLookupForPathString:(NSString *)pathString
+                          localUserID:(NSString *)localUserID
+                               treeID:(NSString *)treeID
+{
+	NSString *normalized = [[pathString precomposedStringWithCanonicalMapping] localizedLowercaseString];
+	
+	return [NSString stringWithFormat:@"%@|%@|%@", localUserID, treeID, normalized];
+}
+
+/**
+ * See ZDCNodeManagerPrivate.h for description.
+ */
+- (nullable NSDictionary<NSString*, NSString*> *)pathIndexValuesForNode:(ZDCNode *)node
+                                                            transaction:(YapDatabaseReadTransaction *)transaction
+{
+	if (node.uuid == nil || [node isKindOfClass:[ZDCTrunkNode class]]) {
+		return nil;
+	}
+	
+	ZDCTrunkNode *trunkNode = nil;
+	ZDCTreesystemPath *path = [self _walkPathForNode:node transaction:transaction trunkNode:&trunkNode];
+	
+	if (trunkNode == nil || trunkNode.localUserID == nil || trunkNode.treeID == nil) {
+		return nil;
+	}
+	
+	NSString *pathString = [self indexedPathStringForPath:path];
+	
+	if ([node.parentID hasSuffix:@"|graft"])
+	{
+		// A pointee has the same path as its pointer.
+		// And `findNodeWithPath:` must return the pointer (not the pointee) when the path ends in a pointer.
+		// So the pointee is only indexed by nodeID (for `pathForNode:`), and not by lookup.
+		
+		return @{
+			Index_Paths_Column_NodeID : node.uuid,
+			Index_Paths_Column_Path   : pathString
+		};
+	}
+	
+	NSString *lookup = [self pathLookupForPathString: pathString
+	                                     localUserID: trunkNode.localUserID
+	                                          treeID: trunkNode.treeID];
+	
+	return @{
+		Index_Paths_Column_NodeID : node.uuid,
+		Index_Paths_Column_Path   : pathString,
+		Index_Paths_Column_Lookup : lookup
+	};
+}
+
+/**
+ * See ZDCNodeManagerPrivate.h for description.
+ */
+- (nullable NSString *)indexedPathStringForNodeID:(NSString *)nodeID
+                                      transaction:(YapDatabaseReadTransaction *)transaction
+{
+	YapDatabaseSecondaryIndexTransaction *secondaryIndexTransaction = [transaction ext:Ext_Index_Paths];
+	if (secondaryIndexTransaction == nil) {
+		return nil;
+	}
+	
+	// WHERE nodeID = ?
+	
+	NSString *queryString = [NSString stringWithFormat:@"WHERE %@ = ?", Index_Paths_Column_NodeID];
+	YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:queryString, nodeID];
+	
+	__block NSString *pathString = nil;
+	
+	[secondaryIndexTransaction enumerateIndexedValuesInColumn: Index_Paths_Column_Path
+	                                            matchingQuery: query
+	                                               usingBlock:^(id indexedValue, BOOL *stop)
+	{
+		if ([indexedValue isKindOfClass:[NSString class]]) {
+			pathString = (NSString *)indexedValue;
+		}
+		*stop = YES;
+	}];
+	
+	return pathString;
+}
+
 /**
  * See header file for description.
  * Or view the api's online (for both Swift & Objective-C):
@@ -736,10 +922,15 @@ static ZDCNodeManager *sharedInstance = nil;
 		// Translation from computer science lingo:
 		// "This lookup is very fast because it only requires fetching a few objects from the database."
 		
-		YapDatabaseViewFind *find = [YapDatabaseViewFind withObjectBlock:
-		  ^(NSString *collection, NSString *key, id object)
+		// The find block must use the exact same comparison as the sorting block (see ZDCNodeMeta).
+		// Otherwise the binary search may take a wrong turn & miss the node.
+		//
+		NSData *collationKey = [ZDCNodeMeta collationKeyForName:nodeName];
+		
+		YapDatabaseViewFind *find = [YapDatabaseViewFind withKeyBlock:
+		  ^(NSString *collection, NSString *key)
 		{
-			__unsafe_unretained ZDCNode *node = (ZDCNode *)object;
+			ZDCNodeMeta *meta = [self metaForNodeID:key transaction:transaction];
 			
 			// IMPORTANT: YapDatabaseViewFind must match the sortingBlock such that:
 			//
@@ -755,7 +946,7 @@ static ZDCNodeManager *sharedInstance = nil;
 			//   findBlock(C) => NSOrderedSame
 			//   findBlock(D) => NSOrderedSame
 			
-			return [node.name localizedCaseInsensitiveCompare:nodeName];
+			return [meta compareName:nodeName collationKey:collationKey];
 		}];
 		
 		// binary search performance !!!
@@ -854,10 +1045,52 @@ static ZDCNodeManager *sharedInstance = nil;
 	
 	if (path.isTrunk)
 	{
-		node = [transaction objectForKey:containerID inCollection:kZDCCollection_Nodes];
+		return [transaction objectForKey:containerID inCollection:kZDCCollection_Nodes];
+	}
+	
+	YapDatabaseSecondaryIndexTransaction *secondaryIndexTransaction = [transaction ext:Ext_Index_Paths];
+	if (secondaryIndexTransaction)
+	{
+		// Use the path index for best performance (single sqlite lookup).
+		//
+		// WHERE lookup = ?
+		
+		NSString *lookup = [self pathLookupForPathString: [self indexedPathStringForPath:path]
+		                                     localUserID: localUserID
+		                                          treeID: treeID];
+		
+		NSString *queryString = [NSString stringWithFormat:@"WHERE %@ = ?", Index_Paths_Column_Lookup];
+		YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:queryString, lookup];
+		
+		__block ZDCNode *matchingNode = nil;
+		
+		[secondaryIndexTransaction enumerateKeysAndObjectsMatchingQuery:query usingBlock:
+		    ^(NSString *collection, NSString *key, id object, BOOL *stop)
+		{
+			// Name collisions may occur in non-root containers.
+			// The treesystem view sorts collisions by uuid, so we do the same to match `findNodeWithName:`.
+			//
+			// Note: Pointees aren't included in the lookup column (they share the path of their pointer).
+			// So if the path ends in a pointer, the pointer is what we find here.
+			
+			__unsafe_unretained ZDCNode *candidate = (ZDCNode *)object;
+			
+			if (matchingNode == nil || [candidate.uuid compare:matchingNode.uuid] == NSOrderedAscending) {
+				matchingNode = candidate;
+			}
+		}];
+		
+		node = matchingNode;
 	}
 	else
 	{
+		// Backup Plan
+		//
+		// The path index extension isn't ready yet (it must be still initializing / updating).
+		// Once it's registered, Ext_Hooks_Paths keeps it up-to-date, so a miss means the node doesn't exist.
+		//
+		// Walk down the tree, one level at a time (slower but functional).
+		
 		NSString *parentID = containerID;
 		
 		for (NSString *filename in path.pathComponents)
@@ -1394,6 +1627,425 @@ static ZDCNodeManager *sharedInstance = nil;
 	return matchingNode;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Subtree Stats
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Key used within kZDCCollection_NodeStats to record that the stats have been fully populated.
+ * Change the value if the stats calculation changes, and they'll be rebuilt on next launch.
+ */
+static NSString *const kNodeStats_RebuildKey   = @"|rebuild|";
+static NSString *const kNodeStats_RebuildValue = @"2019-11-26";
+
+/**
+ * See header file for description.
+ * Or view the api's online (for both Swift & Objective-C):
+ * https://apis.zerodark.cloud/Classes/ZDCNodeManager.html
+ */
+- (ZDCNodeStats *)statsForNode:(ZDCNode *)node transaction:(YapDatabaseReadTransaction *)transaction
+{
+	ZDCLogAutoTrace();
+	NSParameterAssert(transaction != nil);
+	
+	node = [self targetNodeForNode:node transaction:transaction]; // follow pointer(s)
+	
+	if (node.uuid == nil) {
+		return [[ZDCNodeStats alloc] init];
+	}
+	
+	return [self currentStatsForNodeID:node.uuid transaction:transaction] ?: [[ZDCNodeStats alloc] init];
+}
+
+/**
+ * Returns the stored stats for the node, with any changes made within the current transaction applied.
+ * (Changes are written to kZDCCollection_NodeStats when the transaction commits. See ZDCNodeStatsHooks.)
+ */
+- (nullable ZDCNodeStats *)currentStatsForNodeID:(NSString *)nodeID transaction:(YapDatabaseReadTransaction *)transaction
+{
+	ZDCNodeStats *stats = [transaction objectForKey:nodeID inCollection:kZDCCollection_NodeStats];
+	
+	ZDCNodeStatsHooksTransaction *statsTransaction = [transaction ext:Ext_Hooks_NodeStats];
+	if ([statsTransaction isKindOfClass:[ZDCNodeStatsHooksTransaction class]]) {
+		stats = [statsTransaction statsByApplyingPendingDeltaToStats:stats forNodeID:nodeID];
+	}
+	
+	return stats;
+}
+
+/**
+ * Returns YES if the push queue contains a put operation for the node.
+ */
+- (BOOL)hasPendingUploadForNodeID:(NSString *)nodeID transaction:(YapDatabaseReadTransaction *)transaction
+{
+	ZDCNodeMeta *meta = [self metaForNodeID:nodeID transaction:transaction];
+	if (meta.localUserID == nil || meta.treeID == nil) {
+		return NO;
+	}
+	
+	NSString *extName = [ZDCDatabaseManager cloudExtNameForUserID:meta.localUserID treeID:meta.treeID];
+	ZDCCloudTransaction *cloudTransaction = [transaction ext:extName];
+	
+	return [cloudTransaction hasPendingPutOperationForNodeID:nodeID];
+}
+	
+/**
+ * See ZDCNodeManagerPrivate.h for description.
+ */
+- (void)applyPendingUploadDelta:(int64_t)pendingUploadCountDelta
+                      forNodeID:(NSString *)nodeID
+                    transaction:(YapDatabaseReadWriteTransaction *)transaction
+{
+	// If the node isn't in the database (yet / anymore), there's nothing to do.
+	// The node's own pending upload is added to (or removed from) its ancestors when it's inserted (or removed).
+			
+	ZDCNodeMeta *meta = [self metaForNodeID:nodeID transaction:transaction];
+	if (meta == nil) return;
+	
+	[self applyStatsDeltaToParentID: meta.parentID
+	                descendantCount: 0
+	                 totalCloudSize: 0
+	             pendingUploadCount: pendingUploadCountDelta
+	                   lastModified: nil
+	                    transaction: transaction];
+}
+
+/**
+ * Applies the given deltas to the stats of the node with the given ID, and all of its ancestors.
+ * Walking stops at the first ancestor that doesn't exist (e.g. already deleted, or a graft/detached parentID).
+ *
+ * The deltas are accumulated by the Ext_Hooks_NodeStats extension, and written when the transaction commits.
+ */
+- (void)applyStatsDeltaToParentID:(NSString *)parentID
+                  descendantCount:(int64_t)descendantCountDelta
+                   totalCloudSize:(int64_t)totalCloudSizeDelta
+               pendingUploadCount:(int64_t)pendingUploadCountDelta
+                     lastModified:(nullable NSDate *)lastModified
+                      transaction:(YapDatabaseReadWriteTransaction *)transaction
+{
+	if (descendantCountDelta == 0 && totalCloudSizeDelta == 0 && pendingUploadCountDelta == 0 && lastModified == nil) {
+		return;
+	}
+	
+	ZDCNodeStatsHooksTransaction *statsTransaction = [transaction ext:Ext_Hooks_NodeStats];
+	
+	while (parentID)
+	{
+		ZDCNodeMeta *parent = [self metaForNodeID:parentID transaction:transaction];
+		if (parent == nil) break;
+		
+		if (statsTransaction)
+		{
+			[statsTransaction addDescendantCount: descendantCountDelta
+			                      totalCloudSize: totalCloudSizeDelta
+			                  pendingUploadCount: pendingUploadCountDelta
+			                        lastModified: lastModified
+			                           forNodeID: parentID];
+		}
+		else
+		{
+			ZDCNodeStats *stats = [transaction objectForKey:parentID inCollection:kZDCCollection_NodeStats];
+			if (stats == nil) {
+				stats = [[ZDCNodeStats alloc] init];
+			}
+		
+			stats = [stats statsByAddingDescendantCount: descendantCountDelta
+			                             totalCloudSize: totalCloudSizeDelta
+			                         pendingUploadCount: pendingUploadCountDelta
+			                               lastModified: lastModified];
+		
+			[transaction setObject:stats forKey:parentID inCollection:kZDCCollection_NodeStats];
+		}
+		
+		parentID = parent.parentID;
+	}
+}
+
+static uint64_t NodeStats_CloudSize(ZDCNode *node)
+{
+	ZDCCloudDataInfo *info = node.cloudDataInfo;
+	return info ? (info.metadataSize + info.thumbnailSize + info.dataSize) : 0;
+}
+
+/**
+ * See ZDCNodeManagerPrivate.h for description.
+ */
+- (void)updateStatsWithOldNode:(nullable ZDCNode *)oldNode
+                       newNode:(nullable ZDCNode *)newNode
+                   transaction:(YapDatabaseReadWriteTransaction *)transaction
+{
+	if ([oldNode isKindOfClass:[ZDCTrunkNode class]] || [newNode isKindOfClass:[ZDCTrunkNode class]]) {
+		return; // trunk nodes don't have a parent
+	}
+	
+	NSString *nodeID = newNode.uuid ?: oldNode.uuid;
+	if (nodeID == nil) return;
+	
+	// Stats for the node's own subtree (these don't change as a result of this modification).
+	ZDCNodeStats *subtree = [self currentStatsForNodeID:nodeID transaction:transaction];
+	
+	if (oldNode && newNode && [oldNode.parentID isEqualToString:newNode.parentID])
+	{
+		// Node was modified in place (not moved).
+		// Only the node's own contribution may have changed.
+		
+		int64_t sizeDelta = (int64_t)NodeStats_CloudSize(newNode) - (int64_t)NodeStats_CloudSize(oldNode);
+		
+		NSDate *lastModified = nil;
+		if (newNode.lastModified && ![newNode.lastModified isEqualToDate:oldNode.lastModified]) {
+			lastModified = newNode.lastModified;
+		}
+		
+		[self applyStatsDeltaToParentID: newNode.parentID
+		                descendantCount: 0
+		                 totalCloudSize: sizeDelta
+		             pendingUploadCount: 0
+		                   lastModified: lastModified
+		                    transaction: transaction];
+		return;
+	}
+	
+	// The node's own pending upload (if any) moves along with its subtree.
+	uint64_t pendingUploadCount = subtree.pendingUploadCount;
+	if ([self hasPendingUploadForNodeID:nodeID transaction:transaction]) {
+		pendingUploadCount++;
+	}
+	
+	if (oldNode)
+	{
+		// Node was removed, or moved away from its old parent.
+		// Remove the node (and its entire subtree) from the old ancestors.
+		
+		[self applyStatsDeltaToParentID: oldNode.parentID
+		                descendantCount: -(int64_t)(1 + subtree.descendantCount)
+		                 totalCloudSize: -(int64_t)(NodeStats_CloudSize(oldNode) + subtree.totalCloudSize)
+		             pendingUploadCount: -(int64_t)pendingUploadCount
+		                   lastModified: nil
+		                    transaction: transaction];
+	}
+	
+	if (newNode)
+	{
+		// Node was inserted, or moved to a new parent.
+		// Add the node (and its entire subtree) to the new ancestors.
+		
+		NSDate *lastModified = newNode.lastModified;
+		if (subtree.lastModified && (lastModified == nil || [subtree.lastModified isAfter:lastModified])) {
+			lastModified = subtree.lastModified;
+		}
+		
+		[self applyStatsDeltaToParentID: newNode.parentID
+		                descendantCount: (int64_t)(1 + subtree.descendantCount)
+		                 totalCloudSize: (int64_t)(NodeStats_CloudSize(newNode) + subtree.totalCloudSize)
+		             pendingUploadCount: (int64_t)pendingUploadCount
+		                   lastModified: lastModified
+		                    transaction: transaction];
+	}
+	else
+	{
+		// Node was removed.
+		// If it had children, they're either already gone, or about to be removed (relationship cascade).
+		// Either way, they'll stop walking when they hit the missing parent.
+		
+		[transaction removeObjectForKey:nodeID inCollection:kZDCCollection_NodeStats];
+		[(ZDCNodeStatsHooksTransaction *)[transaction ext:Ext_Hooks_NodeStats] discardPendingDeltaForNodeID:nodeID];
+	}
+}
+
+/**
+ * See ZDCNodeManagerPrivate.h for description.
+ */
+- (void)rebuildStatsIfNeeded:(YapDatabaseReadWriteTransaction *)transaction
+{
+	ZDCLogAutoTrace();
+	
+	id marker = [transaction objectForKey:kNodeStats_RebuildKey inCollection:kZDCCollection_NodeStats];
+	if ([marker isKindOfClass:[NSString class]] && [marker isEqualToString:kNodeStats_RebuildValue]) {
+		return;
+	}
+	
+	ZDCLogInfo(@"Rebuilding node stats...");
+	
+	[transaction removeAllObjectsInCollection:kZDCCollection_NodeStats];
+	
+	// Accumulate in memory first, so that each ancestor is only written once.
+	
+	NSMutableDictionary<NSString*, ZDCNodeStats*> *allStats = [NSMutableDictionary dictionary];
+	
+	[transaction enumerateKeysAndObjectsInCollection: kZDCCollection_Nodes
+	                                      usingBlock:^(NSString *key, id object, BOOL *stop)
+	{
+		__unsafe_unretained ZDCNode *node = (ZDCNode *)object;
+		if ([node isKindOfClass:[ZDCTrunkNode class]]) return; // continue
+		
+		uint64_t size = NodeStats_CloudSize(node);
+		uint64_t pending = [self hasPendingUploadForNodeID:key transaction:transaction] ? 1 : 0;
+		NSDate *lastModified = node.lastModified;
+		
+		NSString *parentID = node.parentID;
+		while (parentID)
+		{
+			ZDCNode *parent = [transaction objectForKey:parentID inCollection:kZDCCollection_Nodes];
+			if (parent == nil) break;
+			
+			ZDCNodeStats *stats = allStats[parentID] ?: [[ZDCNodeStats alloc] init];
+			allStats[parentID] =
+			  [stats statsByAddingDescendantCount: 1
+			                       totalCloudSize: (int64_t)size
+			                   pendingUploadCount: (int64_t)pending
+			                         lastModified: lastModified];
+			
+			parentID = parent.parentID;
+		}
+	}];
+	
+	[allStats enumerateKeysAndObjectsUsingBlock:^(NSString *nodeID, ZDCNodeStats *stats, BOOL *stop) {
+		
+		[transaction setObject:stats forKey:nodeID inCollection:kZDCCollection_NodeStats];
+	}];
+	
+	[transaction setObject:kNodeStats_RebuildValue forKey:kNodeStats_RebuildKey inCollection:kZDCCollection_NodeStats];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Node Meta
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Key used within kZDCCollection_NodeMeta to record that the metas have been fully populated.
+ * Change the value if ZDCNodeMeta changes, and they'll be rebuilt on next launch.
+ */
+static NSString *const kNodeMeta_RebuildKey   = @"|rebuild|";
+static NSString *const kNodeMeta_RebuildValue = @"2019-11-12";
+
+/**
+ * See ZDCNodeManagerPrivate.h for description.
+ */
+- (nullable ZDCNodeMeta *)metaForNodeID:(NSString *)nodeID transaction:(YapDatabaseReadTransaction *)transaction
+{
+	ZDCNodeMeta *meta = [transaction objectForKey:nodeID inCollection:kZDCCollection_NodeMeta];
+	if ([meta isKindOfClass:[ZDCNodeMeta class]]) {
+		return meta;
+	}
+	
+	ZDCNode *node = [transaction objectForKey:nodeID inCollection:kZDCCollection_Nodes];
+	if (node == nil) {
+		return nil;
+	}
+	
+	return [self makeMetaForNode:node transaction:transaction];
+}
+
+/**
+ * See ZDCNodeManagerPrivate.h for description.
+ */
+- (ZDCNodeMeta *)makeMetaForNode:(ZDCNode *)node transaction:(YapDatabaseReadTransaction *)transaction
+{
+	NSString *treeID = [self treeIDForNode:node knownMetas:nil transaction:transaction];
+	
+	return [[ZDCNodeMeta alloc] initWithNode:node treeID:treeID];
+}
+
+/**
+ * Returns the treeID for the given node.
+ *
+ * This is called on every node write, so we avoid walking all the way up to the trunk.
+ * The treeID is either encoded in the parentID (grafted nodes), or inherited from the parent's meta.
+ * Only if the parent's meta is missing do we fall back to the full trunk walk.
+ *
+ * @param knownMetas
+ *   Metas that have been computed but not yet written to kZDCCollection_NodeMeta (used during a rebuild).
+ */
+- (nullable NSString *)treeIDForNode:(ZDCNode *)node
+                          knownMetas:(nullable NSDictionary<NSString*, ZDCNodeMeta*> *)knownMetas
+                         transaction:(YapDatabaseReadTransaction *)transaction
+{
+	if ([node isKindOfClass:[ZDCTrunkNode class]]) {
+		return [(ZDCTrunkNode *)node treeID];
+	}
+	
+	NSString *parentID = node.parentID;
+	if (parentID == nil) {
+		return nil;
+	}
+	
+	if ([parentID hasSuffix:@"|graft"])
+	{
+		NSString *treeID = nil;
+		[ZDCNode getLocalUserID:NULL treeID:&treeID fromParentID:parentID];
+		
+		return treeID;
+	}
+	
+	ZDCNodeMeta *parentMeta = knownMetas[parentID];
+	if (parentMeta == nil) {
+		parentMeta = [transaction objectForKey:parentID inCollection:kZDCCollection_NodeMeta];
+	}
+	
+	if ([parentMeta isKindOfClass:[ZDCNodeMeta class]] && parentMeta.treeID) {
+		return parentMeta.treeID;
+	}
+	
+	ZDCTrunkNode *trunkNode = [self trunkNodeForNode:node transaction:transaction];
+	return trunkNode.treeID;
+}
+
+/**
+ * See ZDCNodeManagerPrivate.h for description.
+ */
+- (void)rebuildMetaIfNeeded:(YapDatabaseReadWriteTransaction *)transaction
+{
+	ZDCLogAutoTrace();
+	
+	id marker = [transaction objectForKey:kNodeMeta_RebuildKey inCollection:kZDCCollection_NodeMeta];
+	if ([marker isKindOfClass:[NSString class]] && [marker isEqualToString:kNodeMeta_RebuildValue]) {
+		return;
+	}
+	
+	ZDCLogInfo(@"Rebuilding node meta...");
+	
+	[transaction removeAllObjectsInCollection:kZDCCollection_NodeMeta];
+	
+	// Accumulate in memory first (can't mutate the database during enumeration).
+	
+	// Parents are processed before their children,
+	// so each node inherits its treeID from its parent's meta (instead of walking up to the trunk).
+	
+	NSMutableDictionary<NSString*, ZDCNodeMeta*> *allMeta = [NSMutableDictionary dictionary];
+	
+	[transaction enumerateKeysAndObjectsInCollection: kZDCCollection_Nodes
+	                                      usingBlock:^(NSString *key, id object, BOOL *stop)
+	{
+		if (allMeta[key]) return; // already processed as an ancestor
+		
+		NSMutableArray<ZDCNode*> *lineage = [NSMutableArray array];
+		
+		ZDCNode *node = (ZDCNode *)object;
+		while (node && allMeta[node.uuid] == nil)
+		{
+			[lineage addObject:node];
+			
+			if ([node isKindOfClass:[ZDCTrunkNode class]] || [node.parentID hasSuffix:@"|graft"]) {
+				break;
+			}
+			node = [transaction objectForKey:node.parentID inCollection:kZDCCollection_Nodes];
+		}
+		
+		for (ZDCNode *ancestor in [lineage reverseObjectEnumerator])
+		{
+			NSString *treeID = [self treeIDForNode:ancestor knownMetas:allMeta transaction:transaction];
+			allMeta[ancestor.uuid] = [[ZDCNodeMeta alloc] initWithNode:ancestor treeID:treeID];
+		}
+	}];
+	
+	[allMeta enumerateKeysAndObjectsUsingBlock:^(NSString *nodeID, ZDCNodeMeta *meta, BOOL *stop) {
+		
+		[transaction setObject:meta forKey:nodeID inCollection:kZDCCollection_NodeMeta];
+	}];
+	
+	[transaction setObject:kNodeMeta_RebuildValue forKey:kNodeMeta_RebuildKey inCollection:kZDCCollection_NodeMeta];
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Lists
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -19,7 +19,9 @@
 #import "ZDCConstantsPrivate.h"
 #import "ZDCDatabaseManagerPrivate.h"
 #import "ZDCLogging.h"
+#import "ZDCMetricsManagerPrivate.h"
 #import "ZDCNodePrivate.h"
+#import "ZDCChangeFeedDecoder.h"
 #import "ZDCChangeList.h"
 #import "ZDCPullItem.h"
 #import "ZDCPullStateManager.h"
@@ -29,6 +31,7 @@
 #import "ZDCProxyList.h"
 #import "ZDCRestManager.h"
 #import "ZDCSyncManagerPrivate.h"
+#import "ZDCTracing.h"
 #import "ZeroDarkCloudPrivate.h"
 
 // Categories
@@ -102,9 +105,9 @@ static NSUInteger const kMaxFailCount = 8;
 	return [zdc.databaseManager internal_roConnection];
 }
 
-- (YapDatabaseConnection *)rwConnection
+- (ZDCDatabaseWriteCoalescer *)writeCoalescer
 {
-	return [zdc.databaseManager internal_rwConnection];
+	return [zdc.databaseManager internal_writeCoalescer];
 }
 
 - (YapDatabaseConnection *)decryptConnection
@@ -230,7 +233,7 @@ static NSUInteger const kMaxFailCount = 8;
 	
 	__block BOOL needsPull = NO;
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		NSString *change_userID   = pushInfo.localUserID;
 		NSString *change_oldID    = pushInfo.changeID_old;
@@ -315,6 +318,42 @@ static NSUInteger const kMaxFailCount = 8;
 	}];
 }
 
+/**
+ * Forwarded from ZDCChangeSubscription.
+ *
+ * Our job here is to update the ZDCChangeList with the changes the subscription already downloaded.
+ * We do NOT start any pull operations here.
+ */
+- (void)processFetchedChanges:(NSArray<ZDCChangeItem *> *)changes
+                        since:(NSString *)latestChangeToken_local
+                       latest:(NSString *)latestChangeToken_remote
+               forLocalUserID:(NSString *)localUserID
+              completionQueue:(nullable dispatch_queue_t)completionQueue
+              completionBlock:(nullable dispatch_block_t)completionBlock
+{
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		ZDCChangeList *pullInfo = [transaction objectForKey:localUserID inCollection:kZDCCollection_PullState];
+		
+		if (![pullInfo.latestChangeID_local isEqualToString:latestChangeToken_local])
+		{
+			// Our changeToken moved while the subscription's request was in flight
+			// (e.g. we fast-forwarded due to a locally triggered push).
+			// So we can't be sure where these changes fit. The pull will fetch them itself.
+			
+			return; // from transaction block
+		}
+		
+		pullInfo = [pullInfo copy];
+		[pullInfo didFetchChanges: changes
+		                    since: latestChangeToken_local
+		                   latest: latestChangeToken_remote];
+		
+		[transaction setObject:pullInfo forKey:localUserID inCollection:kZDCCollection_PullState];
+		
+	} completionQueue:completionQueue completionBlock:completionBlock];
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Pull Logic
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -325,6 +364,9 @@ static NSUInteger const kMaxFailCount = 8;
 - (void)startPullWithPullState:(ZDCPullState *)pullState
 {
 	ZDCLogTrace(@"[%@] StartPull", pullState.localUserID);
+	ZDCTraceBegin(ZDC_TRACE_LEVEL_COARSE, "pull", "pull", ZDCTraceIDForString(pullState.pullID));
+	
+	uint64_t pullStartTime = ZDCMetricsNow();
 	
 	[zdc.syncManager notifyPullStartedForLocalUserID: pullState.localUserID
 	                                          treeID: pullState.treeID];
@@ -346,6 +388,11 @@ static NSUInteger const kMaxFailCount = 8;
 	^(YapDatabaseReadWriteTransaction *transaction, ZDCPullTaskResult *result) { @autoreleasepool {
 		
 		ZDCLogTrace(@"[%@] FinishPull: %@", pullState.localUserID, result);
+		ZDCTraceEnd(ZDC_TRACE_LEVEL_COARSE, "pull", "pull", ZDCTraceIDForString(pullState.pullID));
+		
+		[self->zdc.metricsManager recordDurationSince: pullStartTime
+		                                       failed: (result.pullResult != ZDCPullResult_Success)
+		                                    forMetric: @"pull: total"];
 		
 		NSAssert(result != nil, @"Bad parameter for block: ZDCPullTaskResult");
 		if (result.pullResult == ZDCPullResult_Success) {
@@ -456,7 +503,7 @@ static NSUInteger const kMaxFailCount = 8;
 				// We processed all the pending changes we received,
 				// and there are no indications of more pending changes on the server.
 				
-				[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+				[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 					
 					finalCompletionBlock(transaction, [ZDCPullTaskResult success]);
 				}];
@@ -513,6 +560,7 @@ static NSUInteger const kMaxFailCount = 8;
 		else
 		{
 			ZDCLogTrace(@"[%@] StartFullPull", pullState.localUserID);
+			ZDCTraceInstant(ZDC_TRACE_LEVEL_FINE, "pull", "fullPull", ZDCTraceIDForString(pullState.pullID));
 			
 			// Start full pull algorithm.
 			//
@@ -540,13 +588,18 @@ static NSUInteger const kMaxFailCount = 8;
           finalCompletion:(ZDCPullTaskCompletion)finalCompletionBlock
 {
 	ZDCLogTrace(@"[%@] FetchChanges", pullState.localUserID);
+	ZDCTraceBegin(ZDC_TRACE_LEVEL_COARSE, "pull", "fetchChanges", ZDCTraceIDForString(pullState.pullID));
+	
+	uint64_t fetchStartTime = ZDCMetricsNow();
 	
 	__block NSURLSessionDataTask *task = nil;
+	__block ZDCChangeFeedDecoder *feedDecoder = nil;
 	
 	void (^processingBlock)(NSURLResponse *, id, NSError *) =
 	^(NSURLResponse *urlResponse, id responseObject, NSError *error) { @autoreleasepool {
 		
 		[pullState removeTask:task];
+		ZDCTraceEnd(ZDC_TRACE_LEVEL_COARSE, "pull", "fetchChanges", ZDCTraceIDForString(pullState.pullID));
 		
 		// Certain errors should not be tried again.
 		// These include:
@@ -554,6 +607,10 @@ static NSUInteger const kMaxFailCount = 8;
 		
 		NSInteger statusCode = urlResponse.httpStatusCode;
 		
+		[self->zdc.metricsManager recordDurationSince: fetchStartTime
+		                                       failed: (error != nil || statusCode >= 400)
+		                                    forMetric: @"pull: fetchChanges"];
+		
 		if (urlResponse && error)
 		{
 			NSData *data = error.userInfo[AFNetworkingOperationFailingURLResponseDataErrorKey];
@@ -607,36 +664,20 @@ static NSUInteger const kMaxFailCount = 8;
 		}
 		
 		NSString *latestChangeToken_remote = nil;
-		NSMutableArray<ZDCChangeItem *> *changes = nil;
+		NSArray<ZDCChangeItem *> *changes = nil;
 		
-		if ([responseObject isKindOfClass:[NSDictionary class]])
+		// The response body was decoded incrementally (as it arrived) by the feedDecoder.
+		// So the responseObject is just the raw data.
+		
+		if ([feedDecoder finish])
 		{
-			NSDictionary *response = (NSDictionary *)responseObject;
-			
-			id value = response[@"latest_change_token"];
-			if ([value isKindOfClass:[NSString class]])
-			{
-				latestChangeToken_remote = (NSString *)value;
-			}
-			
-			value = response[@"changes"];
-			if ([value isKindOfClass:[NSArray class]])
-			{
-				NSArray *rawChanges = (NSArray *)value;
-				
-				changes = [NSMutableArray arrayWithCapacity:rawChanges.count];
-				
-				for (NSDictionary *dict in rawChanges)
-				{
-					if ([dict isKindOfClass:[NSDictionary class]])
-					{
-						ZDCChangeItem *change = [ZDCChangeItem parseChangeInfo:dict];
-						if (change) {
-							[changes addObject:change];
-						}
-					}
-				}
-			}
+			latestChangeToken_remote = feedDecoder.latestChangeToken;
+			changes = feedDecoder.changes;
+		}
+		else if (feedDecoder.error)
+		{
+			ZDCLogError(@"[%@] API-Gateway: /pull/{change_token}: bad response: %@",
+			            pullState.localUserID, feedDecoder.error);
 		}
 		
 		if (latestChangeToken_remote == nil)
@@ -709,7 +750,7 @@ static NSUInteger const kMaxFailCount = 8;
 		
 		if (isUpToDate)
 		{
-			[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 				
 				finalCompletionBlock(transaction, [ZDCPullTaskResult success]);
 			}];
@@ -718,7 +759,7 @@ static NSUInteger const kMaxFailCount = 8;
 		{
 			__block ZDCChangeList *pullInfo = nil;
 			
-			[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 				
 				pullInfo = [[ZDCChangeList alloc] initWithLatestChangeID_remote:latestChangeToken_remote];
 				
@@ -737,7 +778,7 @@ static NSUInteger const kMaxFailCount = 8;
 		{
 			__block ZDCChangeList *pullInfo = nil;
 			
-			[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 				
 				pullInfo = [transaction objectForKey:pullState.localUserID inCollection:kZDCCollection_PullState];
 				
@@ -840,6 +881,20 @@ static NSUInteger const kMaxFailCount = 8;
 			                   downloadProgress: nil
 			                  completionHandler: processingBlock];
 			
+			// Large change feeds are decoded as they arrive,
+			// rather than waiting for the full body and then running it through NSJSONSerialization.
+			
+			ZDCChangeFeedDecoder *decoder = [[ZDCChangeFeedDecoder alloc] init];
+			feedDecoder = decoder;
+			
+			[zdc.sessionManager associateDataHandler:^(NSURLResponse *response, NSData *data) {
+				
+				if (response.httpStatusCode == 200) {
+					[decoder appendData:data];
+				}
+				
+			} withTask:task inSession:session.session];
+			
 			// Only start the task ([task resume]) if sync hasn't been cancelled.
 			
 			if (![pullStateManager isPullCancelled:pullState])
@@ -877,6 +932,8 @@ static NSUInteger const kMaxFailCount = 8;
 {
 	NSString *command = change.command;
 	
+	ZDCTraceInstant(ZDC_TRACE_LEVEL_FINE, "pull", "change", ZDCTraceIDForString(pullState.pullID));
+	
 	if ([command isEqualToString:@"put-if-match"])
 	{
 		[self processPendingChange_PutIfMatch: change
@@ -1036,7 +1093,10 @@ static NSUInteger const kMaxFailCount = 8;
 		}];
 	}};
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	// The quick pull processes the pending changes one at a time (each one waits for the previous commit).
+	// So there's nothing to batch with, and coalescing would only add the window's delay to every change.
+	//
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		ZDCNode *node = nil;
 		ZDCCloudNode *cloudNode = nil;
@@ -1326,7 +1386,7 @@ static NSUInteger const kMaxFailCount = 8;
 		                                      finalCompletionBlock: finalCompletion];
 	}
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 	
 		ZDCNode *node = nil;
 		ZDCCloudNode *cloudNode = nil;
@@ -1659,7 +1719,7 @@ static NSUInteger const kMaxFailCount = 8;
 		}];
 	}};
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 	
 		ZDCNode *node = nil;
 		ZDCNode *dstParentNode = nil;
@@ -1860,7 +1920,7 @@ static NSUInteger const kMaxFailCount = 8;
 		return;
 	}
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		ZDCNode *node = nil;
 		ZDCCloudNode *cloudNode = nil;
@@ -2046,7 +2106,7 @@ static NSUInteger const kMaxFailCount = 8;
 	
 	__block ZDCChangeList *pullInfo = nil;
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		pullInfo = [transaction objectForKey:localUserID inCollection:kZDCCollection_PullState];
 		
@@ -2081,7 +2141,7 @@ static NSUInteger const kMaxFailCount = 8;
 	NSString *const localUserID = pullState.localUserID;
 	ZDCLogTrace(@"[%@] FallbackToFullPull", localUserID);
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		[transaction removeObjectForKey:localUserID inCollection:kZDCCollection_PullState];
 		
@@ -2218,7 +2278,7 @@ static NSUInteger const kMaxFailCount = 8;
 		
 		__block ZDCChangeList *pullInfo = nil;
 		
-		[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 			
 			if ([pullStateManager isPullCancelled:pullState])
 			{
@@ -2747,7 +2807,7 @@ static NSUInteger const kMaxFailCount = 8;
 	NSParameterAssert(pullState != nil);
 	NSParameterAssert(nodeCompletion != nil);
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		if ([pullStateManager isPullCancelled:pullState])
 		{
@@ -2876,6 +2936,26 @@ static NSUInteger const kMaxFailCount = 8;
 		  [[ZDCNodeManager sharedInstance] parentNodeIDsForNode:node transaction:transaction];
 		parents = [parents arrayByAddingObject:node.uuid];
 		
+		// Derive the cloudName of every known child up front.
+		// The directory's dirSalt only needs to be fetched once this way,
+		// and most of the listed items can be matched without querying the database.
+		
+		ZDCNode *const dirNode = [[ZDCNodeManager sharedInstance] targetNodeForNode:node transaction:transaction];
+		
+		NSMutableDictionary<NSString*, NSString*> *childIDsByCloudName = [NSMutableDictionary dictionary];
+		if (dirNode.dirSalt)
+		{
+			NSDictionary<NSString*, NSString*> *cloudNames =
+			  [[ZDCCloudPathManager sharedInstance] cloudNamesForChildrenOfNode:dirNode transaction:transaction];
+			
+			[cloudNames enumerateKeysAndObjectsUsingBlock:^(NSString *childID, NSString *cloudName, BOOL *stop) {
+				
+				if (childIDsByCloudName[cloudName] == nil) {
+					childIDsByCloudName[cloudName] = childID;
+				}
+			}];
+		}
+		
 		S3ObjectInfo *nodeRcrd = nil;
 		S3ObjectInfo *nodeData = nil;
 	
@@ -2909,13 +2989,25 @@ static NSUInteger const kMaxFailCount = 8;
 			// 2. We have a matching ZDCCloudNode, but not a matching S4Node because we deleted it.
 			//    (i.e. we have a delete-node operation in the queue for the item)
 			
-			ZDCNode *node =
-			  [[ZDCNodeManager sharedInstance] findNodeWithCloudPath: rcrdCloudPath
-			                                                  bucket: bucket
-			                                                  region: region
-			                                             localUserID: pullState.localUserID
-			                                                  treeID: pullState.treeID
-			                                             transaction: transaction];
+			ZDCNode *node = nil;
+			
+			if ([rcrdCloudPath.dirPrefix isEqualToString:dirNode.dirPrefix])
+			{
+				NSString *childID = childIDsByCloudName[[rcrdCloudPath fileNameWithExt:nil]];
+				if (childID) {
+					node = [transaction objectForKey:childID inCollection:kZDCCollection_Nodes];
+				}
+			}
+			
+			if (node == nil)
+			{
+				node = [[ZDCNodeManager sharedInstance] findNodeWithCloudPath: rcrdCloudPath
+				                                                       bucket: bucket
+				                                                       region: region
+				                                                  localUserID: pullState.localUserID
+				                                                       treeID: pullState.treeID
+				                                                  transaction: transaction];
+			}
 			
 			if (node == nil)
 			{
@@ -3284,7 +3376,7 @@ static NSUInteger const kMaxFailCount = 8;
 	//
 	Step3 = ^(ZDCCloudPath *cloudPath, ZDCCloudRcrd *cloudRcrd, NSString *eTag, NSDate *lastModified){ @autoreleasepool {
 		
-		[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 			
 			if ([pullStateManager isPullCancelled:pullState])
 			{
@@ -3560,7 +3652,7 @@ static NSUInteger const kMaxFailCount = 8;
 		
 		__weak id<ZeroDarkCloudDelegate> delegate = zdc.delegate;
 		
-		[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 			
 			ZDCNodeManager *nodeManager = [ZDCNodeManager sharedInstance];
 			ZDCCloudTransaction *const cloudTransaction = [self cloudTransaction:transaction forPullState:pullState];
@@ -3663,7 +3755,7 @@ static NSUInteger const kMaxFailCount = 8;
 			}
 		}
 		
-		[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 			
 			completionBlock(transaction, [ZDCPullTaskResult success]);
 		}];
@@ -3783,7 +3875,7 @@ static NSUInteger const kMaxFailCount = 8;
 			return;
 		}
 		
-		[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		[[self writeCoalescer] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 			
 			if ([pullStateManager isPullCancelled:pullState])
 			{
@@ -3835,7 +3927,7 @@ static NSUInteger const kMaxFailCount = 8;
 				                  transaction: transaction];
 			}
 			
-		}]; // end: [[self rwConnection] asyncReadWriteWithBlock:...]
+		}]; // end: [[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:...]
 		
 	}]; // end: [self fetchRcrd:...]
 }
@@ -5201,7 +5293,7 @@ static NSUInteger const kMaxFailCount = 8;
 			responseData = (NSData *)responseObject;
 			
 			NSError *error = nil;
-			jsonDict = [NSJSONSerialization JSONObjectWithData:(NSData *)responseObject options:0 error:&error];
+			jsonDict = [ZDCCryptoTools decodeCloudRcrdData:responseData error:&error];
 			
 			if (error)
 			{
@@ -5320,6 +5412,9 @@ static NSUInteger const kMaxFailCount = 8;
 **/
 - (void)fetchUnknownUsers:(ZDCPullState *)pullState
 {
+	// Note: The UserManager coalesces these requests into batches.
+	// So this results in 1 round-trip per batch, not 1 per user.
+	
 	for (NSString *remoteUserID in pullState.unknownUserIDs)
 	{
 		[zdc.userManager fetchUserWithID: remoteUserID
@@ -19,17 +19,21 @@
 #import "ZDCConstantsPrivate.h"
 #import "ZDCDatabaseManagerPrivate.h"
 #import "ZDCLogging.h"
+#import "ZDCMetricsManagerPrivate.h"
 #import "ZDCNodePrivate.h"
 #import "ZDCDataPromisePrivate.h"
 #import "ZDCMultipollContext.h"
+#import "ZDCPollAggregator.h"
 #import "ZDCPollContext.h"
 #import "ZDCChangeList.h"
 #import "ZDCTaskContext.h"
 #import "ZDCTouchContext.h"
+#import "ZDCTracing.h"
 #import "ZeroDarkCloudPrivate.h"
 
 // Categories
 #import "NSData+AWSUtilities.h"
+#import "NSData+S4.h"
 #import "NSDate+ZeroDark.h"
 #import "NSError+Auth0API.h"
 #import "NSError+ZeroDark.h"
@@ -157,6 +161,10 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	// and must only be accessed from within the `serialQueue`.
 	//
 	NSMutableSet<NSUUID *> *recentlySkipped;
+	
+	// Batches poll requests (for staged operations) into multipolls.
+	//
+	ZDCPollAggregator *pollAggregator;
 }
 
 #pragma clang diagnostic push
@@ -176,6 +184,8 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		serialQueue     = dispatch_queue_create("ZDCPushManager.serial", DISPATCH_QUEUE_SERIAL);
 		concurrentQueue = dispatch_queue_create("ZDCPushManager.concurrent", DISPATCH_QUEUE_CONCURRENT);
 		
+		pollAggregator = [[ZDCPollAggregator alloc] initWithOwner:inOwner];
+		
 		[[NSNotificationCenter defaultCenter] addObserver: self
 		                                         selector: @selector(didSkipOperations:)
 		                                             name: ZDCSkippedOperationsNotification
@@ -193,14 +203,19 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 #pragma mark Accessors
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+- (ZDCPollAggregator *)pollAggregator
+{
+	return pollAggregator;
+}
+
 - (YapDatabaseConnection *)roConnection
 {
 	return [zdc.databaseManager internal_roConnection];
 }
 
-- (YapDatabaseConnection *)rwConnection
+- (ZDCDatabaseWriteCoalescer *)writeCoalescer
 {
-	return [zdc.databaseManager internal_rwConnection];
+	return [zdc.databaseManager internal_writeCoalescer];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -412,6 +427,35 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	return statusCode;
 }
 
+/**
+ * Records the end-to-end latency of the operation (from the first time it was started, until the server
+ * processed the staged request), under the metric "push: <type>".
+ *
+ * A non-200 pollStatus (e.g. the server rejected the request) counts as a failure.
+ */
+- (void)recordMetricsForOperation:(ZDCCloudOperation *)operation pollStatus:(NSDictionary *)pollStatus
+{
+	uint64_t startTime = operation.ephemeralInfo.metrics_startTime;
+	if (startTime == 0) return;
+	
+	NSString *metric = nil;
+	switch (operation.type)
+	{
+		case ZDCCloudOperationType_Put        : metric = @"push: put";        break;
+		case ZDCCloudOperationType_Move       : metric = @"push: move";       break;
+		case ZDCCloudOperationType_DeleteLeaf : metric = @"push: deleteLeaf"; break;
+		case ZDCCloudOperationType_DeleteNode : metric = @"push: deleteNode"; break;
+		case ZDCCloudOperationType_CopyLeaf   : metric = @"push: copyLeaf";   break;
+		default                               : return;
+	}
+	
+	BOOL failed = ([self statusCodeFromPollStatus:pollStatus] != 200);
+	[zdc.metricsManager recordDurationSince:startTime failed:failed forMetric:metric];
+	
+	// If the operation gets restarted (e.g. to resolve a conflict), the next attempt is measured separately.
+	operation.ephemeralInfo.metrics_startTime = 0;
+}
+
 /**
  * The pollStatus comes from the ZeroDark.cloud servers.
  * It's a dictionary with a pre-defined format.
@@ -888,6 +932,10 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	__unsafe_unretained ZDCCloudOperation *operation = (ZDCCloudOperation *)op;
 	__unsafe_unretained ZDCCloudOperation_EphemeralInfo *ephemeralInfo = operation.ephemeralInfo;
 
+	if (ephemeralInfo.metrics_startTime == 0) {
+		ephemeralInfo.metrics_startTime = ZDCMetricsNow();
+	}
+
 	if (ephemeralInfo.touchContext)
 	{
 		[self startTouchWithContext:ephemeralInfo.touchContext pipeline:pipeline];
@@ -1022,7 +1070,9 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	
 	if (!operation) return;
 	if (!pollContext) return;
-	if (![pollContext atomicMarkCompleted]) return;
+	if (![self markPollCompleted:pollContext]) return;
+	
+	[self recordMetricsForOperation:operation pollStatus:requestInfo.status];
 	
 	ZDCLogVerbose(@"Short-circuit poll for operation %@: %ld",
 	             request_id,
@@ -1327,6 +1377,21 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	ZDCLogAutoTrace();
 	NSAssert(operation.type == ZDCCloudOperationType_Put, @"Invalid operation type");
 	
+	// Every exit path must end the open span exactly once:
+	// - "prepare" ends when a continuation block begins "encrypt", or when we bail out before that.
+	// - "encrypt" ends in startPutOperation:withContext:, or when we bail out before that.
+	
+	const uint64_t traceID = ZDCTraceIDForUUID(operation.uuid);
+	
+	ZDCTraceBegin(ZDC_TRACE_LEVEL_FINE, "push", "prepare", traceID);
+	
+	void (^endPrepare)(void) = ^{
+		ZDCTraceEnd(ZDC_TRACE_LEVEL_FINE, "push", "prepare", traceID);
+	};
+	void (^endEncrypt)(void) = ^{
+		ZDCTraceEnd(ZDC_TRACE_LEVEL_FINE, "push", "encrypt", traceID);
+	};
+	
 	// Create context with boilerplate values
 	
 	ZDCTaskContext *const context = [[ZDCTaskContext alloc] initWithOperation:operation];
@@ -1341,6 +1406,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	{
 		ZDCLogWarn(@"Skipping PUT operation: invalid op.cloudLocator: %@", operation.cloudLocator);
 		
+		endPrepare();
 		[self skipOperationWithContext:context];
 		return;
 	}
@@ -1350,8 +1416,12 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	void (^continueWithFileData)(NSData *) =
 		^(NSData *fileData){ @autoreleasepool
 	{
+		endPrepare();
+		ZDCTraceBegin(ZDC_TRACE_LEVEL_FINE, "push", "encrypt", traceID);
+		
 		if (fileData == nil)
 		{
+			endEncrypt();
 			[self skipOperationWithContext:context];
 			return;
 		}
@@ -1394,8 +1464,12 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	void (^continueWithFileURL)(NSURL*) =
 		^(NSURL *fileURL){ @autoreleasepool
 	{
+		endPrepare();
+		ZDCTraceBegin(ZDC_TRACE_LEVEL_FINE, "push", "encrypt", traceID);
+		
 		if (fileURL == nil)
 		{
+			endEncrypt();
 			[self skipOperationWithContext:context];
 			return;
 		}
@@ -1413,6 +1487,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		{
 			if ([self isFileModifiedDuringReadError:error])
 			{
+				endEncrypt();
 				[self retryOperationWithContext:context];
 			}
 			else if (sha256HashInLowercaseHex)
@@ -1422,6 +1497,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			}
 			else
 			{
+				endEncrypt();
 				[self skipOperationWithContext:context];
 			}
 		}];
@@ -1430,8 +1506,12 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	void (^continueWithFileStream)(Cleartext2CloudFileInputStream *) =
 		^(Cleartext2CloudFileInputStream *fileStream){ @autoreleasepool
 	{
+		endPrepare();
+		ZDCTraceBegin(ZDC_TRACE_LEVEL_FINE, "push", "encrypt", traceID);
+		
 		if (fileStream == nil)
 		{
+			endEncrypt();
 			[self skipOperationWithContext:context];
 			return;
 		}
@@ -1451,6 +1531,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			
 			if ([self isFileModifiedDuringReadError:error])
 			{
+				endEncrypt();
 				[self retryOperationWithContext:context];
 			}
 			else if (fileURL && sha256Hash)
@@ -1460,6 +1541,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			}
 			else
 			{
+				endEncrypt();
 				[self skipOperationWithContext:context];
 			}
 		}];
@@ -1476,6 +1558,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		{
 			if ([self isFileModifiedDuringReadError:error])
 			{
+				endEncrypt();
 				[self retryOperationWithContext:context];
 			}
 			else if (sha256HashInLowercaseHex)
@@ -1487,6 +1570,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			}
 			else
 			{
+				endEncrypt();
 				[self skipOperationWithContext:context];
 			}
 		}];
@@ -1558,10 +1642,12 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		{
 			ZDCLogWarn(@"Error creating PUT operation: %@: %@", operation.cloudLocator.cloudPath, error);
 			
+			endPrepare();
 			[self skipOperationWithContext:context];
 		}
 		else if (missingInfo)
 		{
+			endPrepare();
 			if (missingInfo.missingKeys.count > 0) {
 				[self fixMissingKeysForNodeID:operation.nodeID operation:operation];
 			}
@@ -1674,6 +1760,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 				ZDCLogWarn(@"Delegate failed to create data for PUT operation: %@", operation.cloudLocator.cloudPath);
 			}
 			
+			endPrepare();
 			[self skipOperationWithContext:context];
 			return;
 		}
@@ -1700,6 +1787,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			
 			[self resolveAsyncDataForOperation:operation];
 			[[self pipelineForContext:context] setStatusAsPendingForOperationWithUUID:context.operationUUID];
+			endPrepare();
 			return;
 		}
 		
@@ -1720,6 +1808,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			// The method is preparing the operation for multipart mode.
 			// It will continue the operation when its finished.
 			
+			endPrepare();
 			return;
 		}
 		
@@ -1741,6 +1830,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			                        completionBlock:^(ZDCCryptoFile *cryptoFile, NSError *error)
 			{
 				if (error) {
+					endPrepare();
 					[self skipOperationWithContext:context];
 				}
 				else {
@@ -1762,6 +1852,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			                                    error: &error];
 			
 			if (error) {
+				endPrepare();
 				[self skipOperationWithContext:context];
 			}
 			else {
@@ -1874,10 +1965,12 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 					{
 						if ([self isFileModifiedDuringReadError:error])
 						{
+							endPrepare();
 							[self retryOperationWithContext:context];
 						}
 						else
 						{
+							endPrepare();
 							[self skipOperationWithContext:context];
 						}
 					}
@@ -1901,6 +1994,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		{
 			ZDCLogWarn(@"Delegate returned bad data for PUT operation: %@", operation.cloudLocator.cloudPath);
 			
+			endPrepare();
 			[self skipOperationWithContext:context];
 		}
 	}
@@ -1910,6 +2004,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		NSAssert(NO, @"Unrecognized putType !");
 	#else
 		ZDCLogError(@"Unrecognized putType !");
+		endPrepare();
 		[self skipOperationWithContext:context];
 	#endif
 	}
@@ -1921,6 +2016,9 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	ZDCLogAutoTrace();
 	NSAssert(operation.type == ZDCCloudOperationType_Put, @"Invalid operation type");
 	
+	ZDCTraceEnd(ZDC_TRACE_LEVEL_FINE, "push", "encrypt", ZDCTraceIDForUUID(operation.uuid));
+	ZDCTraceBegin(ZDC_TRACE_LEVEL_COARSE, "push", "put", ZDCTraceIDForUUID(operation.uuid));
+	
 	[zdc.awsCredentialsManager getAWSCredentialsForUser: context.localUserID
 	                                    completionQueue: concurrentQueue
 	                                    completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
@@ -2074,6 +2172,8 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	
 	[self unstashContext:context];
 	
+	ZDCTraceEnd(ZDC_TRACE_LEVEL_COARSE, "push", "put", ZDCTraceIDForUUID(context.operationUUID));
+	
 	NSURLResponse *response = task.response;
 	YapDatabaseCloudCorePipeline *pipeline = [self pipelineForContext:context];
 	ZDCCloudOperation *operation = [self operationForContext:context];
@@ -2380,7 +2480,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 				 forOperationWithUUID: operation.uuid
 				              context: kZDCContext_Conflict];
 				
-				[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+				[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 					
 					NSString *extName = [self extNameForContext:context];
 					ZDCCloudTransaction *ext = [transaction ext:extName];
@@ -2446,7 +2546,9 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	__block ZDCNode *node = nil;
 	__block BOOL needsTriggerPull = NO;
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	ZDCTraceBegin(ZDC_TRACE_LEVEL_COARSE, "push", "commit", ZDCTraceIDForUUID(operation.uuid));
+	
+	[[self writeCoalescer] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		// Update node (if operation was node related)
 		
@@ -2487,6 +2589,24 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 				{
 					node.lastModified_data = lastModified;
 				}
+				
+				// We know the header of the file we just uploaded.
+				// So there's no need to download it later (e.g. to fetch the thumbnail).
+				
+				NSValue *headerValue = operation.ephemeralInfo.cloudFileHeader;
+				if (headerValue && eTag)
+				{
+					ZDCCloudFileHeader header;
+					[headerValue getValue:&header];
+					
+					ZDCCloudDataInfo *cloudDataInfo =
+					  [[ZDCCloudDataInfo alloc] initWithCloudFileHeader: header
+					                                               eTag: eTag
+					                                       lastModified: (lastModified ?: [NSDate date])];
+					
+					node.cloudDataInfo = cloudDataInfo;
+					[zdc.cloudHeaderCache addHeader:cloudDataInfo];
+				}
 			}
 			
 			[transaction setObject:node forKey:node.uuid inCollection:kZDCCollection_Nodes];
@@ -2533,6 +2653,8 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			
 	} completionQueue:concurrentQueue completionBlock:^{
 		
+		ZDCTraceEnd(ZDC_TRACE_LEVEL_COARSE, "push", "commit", ZDCTraceIDForUUID(operation.uuid));
+		
 		[zdc.progressManager removeUploadProgressForOperationUUID:operation.uuid withSuccess:YES];
 		
 		if (needsTriggerPull) {
@@ -3409,7 +3531,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		// Store the uploadID in the database,
 		// and then we can re-queue the operation (which will trigger the upload of parts).
 		
-		[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 			
 			S3Response *response = nil;
 			if ([responseObject isKindOfClass:[S3Response class]])
@@ -3450,7 +3572,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	}
 	else if (context.multipart_abort)
 	{
-		[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 			
 			NSString *extName = [self extNameForContext:context];
 			ZDCCloudTransaction *ext = [transaction ext:extName];
@@ -3482,7 +3604,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		
 		NSString *eTag = [response eTag];
 		
-		[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 			
 			NSString *extName = [self extNameForContext:context];
 			ZDCCloudTransaction *ext = [transaction ext:extName];
@@ -4062,7 +4184,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		eTag = pollContext.eTag;
 	}
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		// Update node
 		
@@ -4464,7 +4586,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		lastModified = [self dateFromJavascriptTimestamp:status_info[@"ts"]];
 	}
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		// Delete corresponding ZDCCloudNode's from database.
 		
@@ -4936,7 +5058,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		lastModified = [self dateFromJavascriptTimestamp:status_info[@"ts"]];
 	}
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		// Delete corresponding ZDCCloudNode's from database.
 		
@@ -5683,7 +5805,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	
 	BOOL opSuccessful = (statusCode == 200);
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		// Update node (if needed)
 		
@@ -5798,122 +5920,72 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	
 	if (operation == nil)
 	{
+		[self markPollCompleted:pollContext];
 		[self skipOperationWithContext:context];
 		return;
 	}
 	
-	// Start the polling process.
+	// The server needs a moment to process the staged request.
+	// Polling immediately is almost always a wasted request.
+	// So we wait for (roughly) the amount of time the server has recently been taking.
 	
-	[zdc.awsCredentialsManager getAWSCredentialsForUser: context.localUserID
-	                                    completionQueue: concurrentQueue
-	                                    completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
+	if (pollContext.pollCount == 0 && !pollContext.didDelayFirstPoll)
 	{
-		if (error)
-		{
-			if ([error.auth0API_error isEqualToString:kAuth0Error_RateLimit])
-			{
-				// Auth0 is just rate limiting us.
-				// Normal path will automatically execute exponential backoff.
-			}
-			else
-			{
-				// Auth0 is indicating our account may have been removed.
-				[zdc.networkTools handleAuthFailureForUser:context.localUserID withError:error];
-			}
-			
-			[self pollDidComplete:nil inSession:nil withError:error context:pollContext responseObject:nil];
-			return;
-		}
-		
-		ZDCSessionInfo *sessionInfo = [zdc.sessionManager sessionInfoForUserID:context.localUserID];
-		
-	#if TARGET_OS_IPHONE
-		AFURLSessionManager *session = sessionInfo.backgroundSession;
-	#else
-		AFURLSessionManager *session = sessionInfo.session;
-	#endif
-		ZDCSessionUserInfo *userInfo = sessionInfo.userInfo;
-		
-		AWSRegion region = operation.cloudLocator.region;
-		NSString *stage = userInfo.stage;
-		if (!stage)
-		{
-		#ifdef AWS_STAGE // See PrefixHeader.pch
-			stage = AWS_STAGE;
-		#else
-			stage = @"prod";
-		#endif
-		}
-		
-		NSString *path = [NSString stringWithFormat:@"/poll-request/%@", [self requestIDForOperation:operation]];
-		
-		NSURLComponents *urlComponents = [zdc.restManager apiGatewayForRegion:region stage:stage path:path];
-		
-		NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[urlComponents URL]];
-		request.HTTPMethod = @"GET";
-		
-		[AWSSignature signRequest: request
-		               withRegion: region
-		                  service: AWSService_APIGateway
-		              accessKeyID: auth.aws_accessKeyID
-		                   secret: auth.aws_secret
-		                  session: auth.aws_session];
-		
-	#if TARGET_OS_IPHONE
-		
-		// Background NSURLSession's don't really support data tasks.
-		//
-		// So we have to download the tiny response to a file instead.
-		
-		NSURLSessionDownloadTask *task =
-		  [session downloadTaskWithRequest: request
-		                          progress: nil
-		                       destination: nil
-							  completionHandler: nil];
-		
-	#else
-		
-		__block NSURLSessionDataTask *task = nil;
-		task = [session dataTaskWithRequest: request
-		                     uploadProgress: nil
-		                   downloadProgress: nil
-		                  completionHandler:^(NSURLResponse *response, id responseObject, NSError *error)
-		{
-			[self pollDidComplete: task
-			            inSession: session.session
-			            withError: error
-			              context: pollContext
-			       responseObject: responseObject];
-		}];
+		pollContext.didDelayFirstPoll = YES;
 		
-	#endif
+		ZDCTraceBegin(ZDC_TRACE_LEVEL_COARSE, "push", "poll", ZDCTraceIDForUUID(context.operationUUID));
 		
-		[self stashContext:pollContext];
+		NSTimeInterval delay = [pollAggregator firstPollDelay];
+		NSDate *holdDate = [NSDate dateWithTimeIntervalSinceNow:delay];
+		NSString *ctx = NSStringFromClass([self class]);
 		
-		if (operation.ephemeralInfo.abortRequested)
-		{
-			operation.ephemeralInfo.abortRequested = NO;
-			[self pollDidComplete: task
-			            inSession: session.session
-			            withError: [self cancelledError]
-			              context: pollContext
-			       responseObject: nil];
-		}
-		else
-		{
-		#if TARGET_OS_IPHONE
-			[zdc.sessionManager associateContext:pollContext withTask:task inSession:session.session];
-		#else
-			// When SessionManager gets called for the completion of a dataTask,
-			// it's not given the `responseObject`, which we need in this case.
-			// So we're handling the completion manually.
-		#endif
+		[pipeline setHoldDate:holdDate forOperationWithUUID:context.operationUUID context:ctx];
+		[pipeline setStatusAsPendingForOperationWithUUID:context.operationUUID];
+		return;
+	}
+	
+	// Start the polling process.
+	//
+	// The request is batched with any other in-flight polls (for the same user & region),
+	// and sent as a single multipoll.
+	
+	pollContext.pollCount = pollContext.pollCount + 1;
+	BOOL isFirstPoll = (pollContext.pollCount == 1);
+	
+	[self stashContext:pollContext];
+	
+	if (operation.ephemeralInfo.abortRequested)
+	{
+		operation.ephemeralInfo.abortRequested = NO;
 			
-			[task resume];
-		}
+		[self unstashContext:pollContext];
+		[self pollDidCompleteWithStatusCode: 0
+		                              error: [self cancelledError]
+		                            context: pollContext
+		                      stagingStatus: nil];
+		return;
+	}
+		
+	[pollAggregator pollRequestID: [self requestIDForOperation:operation]
+	                  localUserID: context.localUserID
+	                       region: operation.cloudLocator.region
+	                  isFirstPoll: isFirstPoll
+	              completionQueue: concurrentQueue
+	              completionBlock:^(NSDictionary *stagingStatus, NSInteger httpStatusCode, NSError *error)
+	{
+		[self unstashContext:pollContext];
+		[self pollDidCompleteWithStatusCode: httpStatusCode
+		                              error: error
+		                            context: pollContext
+		                      stagingStatus: stagingStatus];
 	}];
 }
 
+/**
+ * Invoked when a (non-batched) poll request completes.
+ * These are only sent by previous versions of the framework,
+ * but on iOS the background session may deliver the results after an upgrade.
+ */
 - (void)pollDidComplete:(NSURLSessionTask *)task
               inSession:(NSURLSession *)session
               withError:(nullable NSError *)error
@@ -5925,10 +5997,6 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	[self unstashContext:pollContext];
 	
 	NSURLResponse *response = task.response;
-	ZDCTaskContext *context = pollContext.taskContext;
-	YapDatabaseCloudCorePipeline *pipeline = [self pipelineForContext:context];
-	ZDCCloudOperation *operation = [self operationForContext:context];
-	
 	NSInteger httpStatusCode = response.httpStatusCode;
 	
 	if (response && error)
@@ -5936,6 +6004,29 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		error = nil; // we only care about non-server-response errors
 	}
 	
+	NSDictionary *stagingStatus = nil;
+	if ([responseObject isKindOfClass:[NSDictionary class]])
+	{
+		stagingStatus = (NSDictionary *)responseObject;
+	}
+	
+	[self pollDidCompleteWithStatusCode: httpStatusCode
+	                              error: error
+	                            context: pollContext
+	                      stagingStatus: stagingStatus];
+}
+
+- (void)pollDidCompleteWithStatusCode:(NSInteger)httpStatusCode
+                                error:(nullable NSError *)error
+                              context:(ZDCPollContext *)pollContext
+                        stagingStatus:(nullable NSDictionary *)stagingStatus
+{
+	ZDCLogAutoTrace();
+	
+	ZDCTaskContext *context = pollContext.taskContext;
+	YapDatabaseCloudCorePipeline *pipeline = [self pipelineForContext:context];
+	ZDCCloudOperation *operation = [self operationForContext:context];
+	
 	// Known status codes:
 	//
 	// 200 - Success : underlying status was fetched from redis
@@ -5978,13 +6069,10 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		return;
 	}
 	
-	NSDictionary *stagingStatus = nil;
 	NSInteger stagingStatusCode = 0;
 	
-	if ([responseObject isKindOfClass:[NSDictionary class]])
+	if (stagingStatus)
 	{
-		stagingStatus = (NSDictionary *)responseObject;
-		
 		id value = stagingStatus[@"status"];
 		
 		if ([value isKindOfClass:[NSNumber class]])
@@ -6070,13 +6158,14 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	
 	[operation.ephemeralInfo polling_didSucceed];
 	
-	if (![pollContext atomicMarkCompleted])
+	if (![self markPollCompleted:pollContext])
 	{
 		// Already processed (poll request vs push notification)
 		return;
 	}
 	
 	operation.ephemeralInfo.pollContext = nil;
+	[self recordMetricsForOperation:operation pollStatus:stagingStatus];
 	
 	switch(operation.type)
 	{
@@ -6113,6 +6202,27 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	}
 }
 
+/**
+ * Polling may finish via the poll response, via a push notification, or by being abandoned.
+ * This marks the pollContext as completed, and ends the "poll" span (begun in startPollWithContext:pipeline:).
+ * Since only the first invocation succeeds, the span is ended exactly once.
+ *
+ * Returns NO if polling had already completed.
+ */
+- (BOOL)markPollCompleted:(ZDCPollContext *)pollContext
+{
+	if (![pollContext atomicMarkCompleted]) {
+		return NO;
+	}
+	
+	if (pollContext.didDelayFirstPoll) // <- the span is begun along with the first poll delay
+	{
+		ZDCTraceEnd(ZDC_TRACE_LEVEL_COARSE, "push", "poll", ZDCTraceIDForUUID(pollContext.taskContext.operationUUID));
+	}
+	
+	return YES;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Multipoll
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -6510,6 +6620,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	
 	if (operation == nil)
 	{
+		[self markPollCompleted:touchContext.pollContext];
 		[self skipOperationWithContext:context];
 		return;
 	}
@@ -6716,6 +6827,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 				@"statusCode": @(statusCode)
 			};
 			
+			[self markPollCompleted:touchContext.pollContext];
 			[self failOperationWithContext:context errorInfo:errorInfo stopSyncingNode:YES];
 			return;
 		}
@@ -7191,7 +7303,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	
 	// Operation succeeded
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		// Mark operation as complete
 		
@@ -7673,6 +7785,20 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	uint64_t cloudFileSize = 0;
 	Cleartext2CloudFileInputStream *cloudStream = nil;
 	
+	// The header of the cloud file we're going to upload.
+	// Once the upload completes, this gets added to the header cache (keyed by the new eTag),
+	// so fetching the metadata or thumbnail doesn't require downloading the header first.
+	
+	ZDCCloudFileHeader header;
+	bzero(&header, sizeof(header));
+	
+	header.magic = kZDCCloudFileContextMagic;
+	header.metadataSize = rawMetadata.length;
+	header.thumbnailSize = rawThumbnail.length;
+	header.thumbnailxxHash64 = (rawThumbnail.length > 0) ? [rawThumbnail xxHash64] : 0;
+	
+	BOOL hasDataSize = NO;
+	
 	if (nodeData.data || nodeData.cleartextFileURL)
 	{
 		uint64_t clearFileSize = 0;
@@ -7680,6 +7806,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		if (nodeData.data)
 		{
 			clearFileSize = nodeData.data.length;
+			hasDataSize = YES;
 		}
 		else
 		{
@@ -7689,9 +7816,12 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			if ([fileURL getResourceValue:&number forKey:NSURLFileSizeKey error:nil])
 			{
 				clearFileSize = [number unsignedLongLongValue];
+				hasDataSize = YES;
 			}
 		}
 		
+		header.dataSize = clearFileSize;
+		
 		if ((clearFileSize + rawMetadata.length + rawThumbnail.length) >= multipart_minCloudFileSize)
 		{
 			// Looks like we want to use multipart.
@@ -7721,15 +7851,39 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	else if (nodeData.cryptoFile.fileFormat == ZDCCryptoFileFormat_CloudFile)
 	{
 		NSURL *fileURL = nodeData.cryptoFile.fileURL;
-		uint64_t maxClearFileSize = 0;
 		
-		NSNumber *number = nil;
-		if ([fileURL getResourceValue:&number forKey:NSURLFileSizeKey error:nil])
+		// The data section's size is stored in the file's header.
+		// Reading it only requires decrypting the first block.
+		
+		ZDCCloudFileHeader fileHeader;
+		bzero(&fileHeader, sizeof(fileHeader));
+		
+		hasDataSize =
+		  [CloudFile2CleartextInputStream decryptCloudFileURL: fileURL
+		                                    withEncryptionKey: nodeData.cryptoFile.encryptionKey
+		                                               header: &fileHeader
+		                                          rawMetadata: NULL
+		                                         rawThumbnail: NULL
+		                                                error: NULL];
+		
+		uint64_t clearFileSize = 0;
+		if (hasDataSize)
 		{
-			maxClearFileSize = [number unsignedLongLongValue];
+			clearFileSize = fileHeader.dataSize;
+			header.dataSize = clearFileSize;
+		}
+		else
+		{
+			// Fallback to the size of the (encrypted) file, which is an upper bound.
+			
+			NSNumber *number = nil;
+			if ([fileURL getResourceValue:&number forKey:NSURLFileSizeKey error:nil])
+			{
+				clearFileSize = [number unsignedLongLongValue];
+			}
 		}
 		
-		if ((maxClearFileSize + rawMetadata.length + rawThumbnail.length) >= multipart_minCloudFileSize)
+		if ((clearFileSize + rawMetadata.length + rawThumbnail.length) >= multipart_minCloudFileSize)
 		{
 			// Looks like we want to use multipart.
 			// Calculate the exact cloudFileSize.
@@ -7747,6 +7901,10 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			cloudStream.rawMetadata = rawMetadata;
 			cloudStream.rawThumbnail = rawThumbnail;
 			
+			if (hasDataSize) {
+				cloudStream.cleartextFileSize = @(clearFileSize);
+			}
+			
 			[cloudStream open];
 			
 			cloudFileSize = [cloudStream.encryptedFileSize unsignedLongLongValue];
@@ -7782,9 +7940,23 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 			[cloudStream open];
 			
 			cloudFileSize = [cloudStream.encryptedFileSize unsignedLongLongValue];
+			
+			if (cloudStream.cleartextFileSize)
+			{
+				header.dataSize = [cloudStream.cleartextFileSize unsignedLongLongValue];
+				hasDataSize = YES;
+			}
 		}
 	}
 	
+	ZDCCloudOperation *operation = [self operationForContext:context];
+	
+	if (hasDataSize) {
+		operation.ephemeralInfo.cloudFileHeader = [NSValue valueWithBytes:&header objCType:@encode(ZDCCloudFileHeader)];
+	} else {
+		operation.ephemeralInfo.cloudFileHeader = nil;
+	}
+	
 	if (cloudFileSize < multipart_minCloudFileSize)
 	{
 		return NO;
@@ -7794,7 +7966,6 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	//
 	// This needs to remain constant for all related multipart operations.
 	
-	ZDCCloudOperation *operation = [self operationForContext:context];
 	operation.ephemeralInfo.multipartData = nodeData;
 	
 	NSString *stagingPath =
@@ -7875,7 +8046,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 		multipartInfo.checksums = chunkChecksums;
 		multipartInfo.duplicateOpUUIDs = context.duplicateOpUUIDs;
 		
-		[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 			
 			NSString *extName = [self extNameForContext:context];
 			ZDCCloudTransaction *ext = [transaction ext:extName];
@@ -8297,7 +8468,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	
 	__block BOOL opModified = NO;
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		NSString *extName = [self extNameForOperation:operation];
 		ZDCCloudTransaction *ext = [transaction ext:extName];
@@ -8341,7 +8512,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	[pipeline setHoldDate:distantFuture forOperationWithUUID:opUUID context:ctx];
 	[pipeline setStatusAsPendingForOperationWithUUID:opUUID];
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 	
 		ZDCNode *node = [transaction objectForKey:nodeID inCollection:kZDCCollection_Nodes];
 		if (node)
@@ -8449,7 +8620,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	}
 #endif
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		[[transaction ext:extName] skipOperationWithUUID:context.operationUUID];
 		
@@ -8475,7 +8646,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 	}
 #endif
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		[[transaction ext:extName] skipOperationWithUUID:context.operationUUID];
 		
@@ -8501,7 +8672,7 @@ typedef NS_ENUM(NSInteger, ZDCErrCode) {
 {
 	ZDCLogAutoTrace();
 	
-	[[self rwConnection] asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+	[[self writeCoalescer] asyncUncoalescedReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
 		
 		[transaction removeObjectForKey:localUserID inCollection:kZDCCollection_PullState];
 		
@@ -20,6 +20,11 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ * The maximum number of userIDs that may be included in a single batch request.
+ */
+extern NSUInteger const kZDCRestManager_UserBatchLimit;
+
 /**
  * Facilitates access to the REST API of the ZeroDark.cloud servers.
  */
@@ -162,6 +167,27 @@ NS_ASSUME_NONNULL_BEGIN
                  completionQueue:(nullable dispatch_queue_t)completionQueue
                  completionBlock:(void (^)(NSDictionary *_Nullable response, NSError *_Nullable error))completionBlock;
 
+/**
+ * Batch version of `fetchInfoForRemoteUserID:requesterID:completionQueue:completionBlock:`.
+ * Fetches the info for multiple users with a single request.
+ *
+ * @param remoteUserIDs
+ *   The list of users to fetch. Should not exceed `kZDCRestManager_UserBatchLimit`.
+ *
+ * @param completionBlock
+ *   On success, `results` is a dictionary of the form: { userID => info }.
+ *   Where `info` is the same dictionary returned by the non-batch version.
+ *   Users that don't exist (e.g. deleted accounts) are not included in the results.
+ *
+ *   If the server doesn't support batch requests, the error will have a statusCode of 404 or 501.
+ *   In which case the caller should fallback to the non-batch version.
+ */
+- (void)fetchInfoForRemoteUserIDs:(NSArray<NSString*> *)remoteUserIDs
+                      requesterID:(NSString *)localUserID
+                  completionQueue:(nullable dispatch_queue_t)completionQueue
+                  completionBlock:(void (^)(NSDictionary<NSString*, NSDictionary*> *_Nullable results,
+                                            NSError *_Nullable error))completionBlock;
+
 /**
  * Queries the server to see if the given user still exists.
  * Returns NO if the user has been deleted from the system.
@@ -415,6 +441,26 @@ NS_ASSUME_NONNULL_BEGIN
                   completionQueue:(nullable dispatch_queue_t)completionQueue
                   completionBlock:(nullable void (^)(NSURLResponse *response, id _Nullable responseObject, NSError *_Nullable error))completion;
 
+/**
+ * Batch version of `fetchFilteredAuth0Profile:requesterID:completionQueue:completionBlock:`.
+ * Fetches the profiles for multiple users with a single request.
+ *
+ * @param remoteUserIDs
+ *   The list of users to fetch. Should not exceed `kZDCRestManager_UserBatchLimit`.
+ *
+ * @param completionBlock
+ *   On success, `results` is a dictionary of the form: { userID => profileDict }.
+ *   Where `profileDict` is the same dictionary returned by the non-batch version.
+ *
+ *   If the server doesn't support batch requests, the error will have a statusCode of 404 or 501.
+ *   In which case the caller should fallback to the non-batch version.
+ */
+- (void)fetchFilteredAuth0Profiles:(NSArray<NSString*> *)remoteUserIDs
+                       requesterID:(NSString *)localUserID
+                   completionQueue:(nullable dispatch_queue_t)completionQueue
+                   completionBlock:(void (^)(NSDictionary<NSString*, NSDictionary*> *_Nullable results,
+                                             NSError *_Nullable error))completionBlock;
+
 /**
  * User search API.
  *
@@ -436,13 +482,18 @@ NS_ASSUME_NONNULL_BEGIN
  *
  * @param completionBlock
  *   Will be invoked with the result.
+ *   If the request is cancelled, the error will be NSURLErrorCancelled (in NSURLErrorDomain).
+ *
+ * @return
+ *   A progress for the request, which can be used to cancel it.
+ *   E.g. when the user has continued typing, and the query is stale.
  */
-- (void)searchUserMatch:(NSString *)queryString
-               provider:(nullable NSString *)provider
-                 treeID:(NSString *)treeID
-            requesterID:(NSString *)localUserID
-        completionQueue:(nullable dispatch_queue_t)completionQueue
-        completionBlock:(nullable void (^)(NSURLResponse *response, id _Nullable responseObject, NSError *_Nullable error))completionBlock;
+- (NSProgress *)searchUserMatch:(NSString *)queryString
+                       provider:(nullable NSString *)provider
+                         treeID:(NSString *)treeID
+                    requesterID:(NSString *)localUserID
+                completionQueue:(nullable dispatch_queue_t)completionQueue
+                completionBlock:(nullable void (^)(NSURLResponse *response, id _Nullable responseObject, NSError *_Nullable error))completionBlock;
 
 /**
  * REST API to link a normal auth0 identity to a recovery profile.
@@ -46,6 +46,8 @@
 
 #define CLAMP(min, num, max) (MAX(min, MIN(max, num)))
 
+/* extern */ NSUInteger const kZDCRestManager_UserBatchLimit = 100;
+
 #ifndef DEFAULT_AWS_STAGE
   #if DEBUG && robbie_hanson
     #define DEFAULT_AWS_STAGE @"dev"
@@ -980,6 +982,178 @@
 	}];
 }
 
+/**
+ * See header file for description.
+ * Or view the api's online (for both Swift & Objective-C):
+ * https://apis.zerodark.cloud/Classes/ZDCRestManager.html
+ */
+- (void)fetchInfoForRemoteUserIDs:(NSArray<NSString*> *)remoteUserIDs
+                      requesterID:(NSString *)localUserID
+                  completionQueue:(nullable dispatch_queue_t)completionQueue
+                  completionBlock:(void (^)(NSDictionary<NSString*, NSDictionary*> *results, NSError *error))completionBlock
+{
+	ZDCLogAutoTrace();
+	
+	NSParameterAssert(remoteUserIDs.count > 0);
+	NSParameterAssert(remoteUserIDs.count <= kZDCRestManager_UserBatchLimit);
+	
+	NSDictionary *jsonDict = @{
+		@"user_ids"      : [remoteUserIDs copy],
+		@"check_archive" : @(1)
+	};
+	
+	[self sendUserBatchRequest: jsonDict
+	                    toPath: @"/users/info/batch"
+	               requesterID: localUserID
+	           completionQueue: completionQueue
+	           completionBlock: completionBlock];
+}
+
+/**
+ * Shared code for the batch user requests.
+ *
+ * Sends a signed POST to the given path (with the given JSON body),
+ * and expects a response of the form: { "results": { userID => dict } }
+ */
+- (void)sendUserBatchRequest:(NSDictionary *)jsonDict
+                      toPath:(NSString *)path
+                 requesterID:(NSString *)localUserID
+             completionQueue:(nullable dispatch_queue_t)completionQueue
+             completionBlock:(void (^)(NSDictionary<NSString*, NSDictionary*> *results, NSError *error))completionBlock
+{
+	NSParameterAssert(localUserID != nil);
+	NSParameterAssert(completionBlock != nil);
+	
+	localUserID = [localUserID copy]; // mutable string protection
+	
+	if (!completionQueue)
+		completionQueue = dispatch_get_main_queue();
+	
+	void (^InvokeCompletionBlock)(NSDictionary*, NSError*) = ^(NSDictionary *results, NSError *error){
+		
+		dispatch_async(completionQueue, ^{ @autoreleasepool {
+			completionBlock(results, error);
+		}});
+	};
+	
+	NSError *jsonError = nil;
+	NSData *jsonData = [NSJSONSerialization dataWithJSONObject:jsonDict options:0 error:&jsonError];
+	if (jsonError)
+	{
+		InvokeCompletionBlock(nil, jsonError);
+		return;
+	}
+	
+	[zdc.awsCredentialsManager getAWSCredentialsForUser: localUserID
+	                                    completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
+	                                    completionBlock:^(ZDCLocalUserAuth *auth, NSError *error)
+	{
+		if (error)
+		{
+			InvokeCompletionBlock(nil, error);
+			return;
+		}
+		
+		// Generate request
+		
+		ZDCSessionInfo *sessionInfo = [zdc.sessionManager sessionInfoForUserID:localUserID];
+	#if TARGET_OS_IPHONE
+		AFURLSessionManager *session = sessionInfo.foregroundSession;
+	#else
+		AFURLSessionManager *session = sessionInfo.session;
+	#endif
+		ZDCSessionUserInfo *userInfo = sessionInfo.userInfo;
+		
+		AWSRegion region = AWSRegion_Master; // User info always goes through Oregon
+		
+		NSString *stage = userInfo.stage;
+		if (!stage)
+		{
+			stage = DEFAULT_AWS_STAGE;
+		}
+		
+		NSURLComponents *urlComponents = [self apiGatewayForRegion:region stage:stage path:path];
+		
+		NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[urlComponents URL]];
+		request.HTTPMethod = @"POST";
+		request.HTTPBody = jsonData;
+		
+		[request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
+		
+		[AWSSignature signRequest: request
+		               withRegion: region
+		                  service: AWSService_APIGateway
+		              accessKeyID: auth.aws_accessKeyID
+		                   secret: auth.aws_secret
+		                  session: auth.aws_session];
+		
+		// Send request
+		
+		NSURLSessionDataTask *task =
+		  [session dataTaskWithRequest: request
+		                uploadProgress: nil
+		              downloadProgress: nil
+		             completionHandler:^(NSURLResponse *response, id responseObject, NSError *error)
+		{
+			if (error)
+			{
+				InvokeCompletionBlock(nil, error);
+				return;
+			}
+			
+			NSInteger statusCode = response.httpStatusCode;
+			if (statusCode != 200)
+			{
+				error = [NSError errorWithClass:[self class] code:statusCode description:@"Unexpected statusCode"];
+				
+				InvokeCompletionBlock(nil, error);
+				return;
+			}
+			
+			NSDictionary *jsonDict = nil;
+			if ([responseObject isKindOfClass:[NSDictionary class]])
+			{
+				jsonDict = (NSDictionary *)responseObject;
+			}
+			else if ([responseObject isKindOfClass:[NSData class]])
+			{
+				id value = [NSJSONSerialization JSONObjectWithData:(NSData *)responseObject options:0 error:nil];
+				if ([value isKindOfClass:[NSDictionary class]]) {
+					jsonDict = (NSDictionary *)value;
+				}
+			}
+			
+			NSMutableDictionary<NSString*, NSDictionary*> *results = nil;
+			
+			id value = jsonDict[@"results"];
+			if ([value isKindOfClass:[NSDictionary class]])
+			{
+				NSDictionary *unparsed = (NSDictionary *)value;
+				results = [NSMutableDictionary dictionaryWithCapacity:unparsed.count];
+				
+				[unparsed enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
+					
+					if ([key isKindOfClass:[NSString class]] && [obj isKindOfClass:[NSDictionary class]]) {
+						results[(NSString *)key] = (NSDictionary *)obj;
+					}
+				}];
+			}
+			
+			if (results == nil)
+			{
+				error = [NSError errorWithClass:[self class] code:500 description:@"Invalid response from server"];
+				
+				InvokeCompletionBlock(nil, error);
+				return;
+			}
+			
+			InvokeCompletionBlock(results, nil);
+		}];
+		
+		[task resume];
+	}];
+}
+
 /**
  * See header file for description.
  * Or view the api's online (for both Swift & Objective-C):
@@ -1898,12 +2072,38 @@
  * Or view the api's online (for both Swift & Objective-C):
  * https://apis.zerodark.cloud/Classes/ZDCRestManager.html
  */
-- (void)searchUserMatch:(NSString *)queryString
-               provider:(nullable NSString *)providerString
-                 treeID:(NSString *)treeID
-            requesterID:(NSString *)localUserID
-        completionQueue:(dispatch_queue_t)completionQueue
-        completionBlock:(void (^)(NSURLResponse *response, id responseObject, NSError *error))completionBlock
+- (void)fetchFilteredAuth0Profiles:(NSArray<NSString*> *)remoteUserIDs
+                       requesterID:(NSString *)localUserID
+                   completionQueue:(nullable dispatch_queue_t)completionQueue
+                   completionBlock:(void (^)(NSDictionary<NSString*, NSDictionary*> *results, NSError *error))completionBlock
+{
+	ZDCLogAutoTrace();
+	
+	NSParameterAssert(remoteUserIDs.count > 0);
+	NSParameterAssert(remoteUserIDs.count <= kZDCRestManager_UserBatchLimit);
+	
+	NSDictionary *jsonDict = @{
+		@"user_ids" : [remoteUserIDs copy]
+	};
+	
+	[self sendUserBatchRequest: jsonDict
+	                    toPath: @"/auth0/fetch/batch"
+	               requesterID: localUserID
+	           completionQueue: completionQueue
+	           completionBlock: completionBlock];
+}
+
+/**
+ * See header file for description.
+ * Or view the api's online (for both Swift & Objective-C):
+ * https://apis.zerodark.cloud/Classes/ZDCRestManager.html
+ */
+- (NSProgress *)searchUserMatch:(NSString *)queryString
+                       provider:(nullable NSString *)providerString
+                         treeID:(NSString *)treeID
+                    requesterID:(NSString *)localUserID
+                completionQueue:(dispatch_queue_t)completionQueue
+                completionBlock:(void (^)(NSURLResponse *response, id responseObject, NSError *error))completionBlock
 {
 	ZDCLogAutoTrace();
 	
@@ -1911,9 +2111,14 @@
 	localUserID = [localUserID copy];
 	treeID      = [treeID copy];
 	
+	NSProgress *progress = [NSProgress discreteProgressWithTotalUnitCount:1];
+	progress.cancellable = YES;
+	
 	void (^InvokeCompletionBlock)(NSURLResponse*, id, NSError*) =
 	^(NSURLResponse *response, id responseObject, NSError *error)
 	{
+		progress.completedUnitCount = 1;
+		
 		if (completionBlock)
 		{
 			dispatch_async(completionQueue ?: dispatch_get_main_queue(), ^{ @autoreleasepool {
@@ -1932,6 +2137,14 @@
 			return;
 		}
 		
+		if (progress.cancelled)
+		{
+			error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+			
+			InvokeCompletionBlock(nil, nil, error);
+			return;
+		}
+		
 		ZDCSessionInfo *sessionInfo = [zdc.sessionManager sessionInfoForUserID:localUserID];
 		
 	#if TARGET_OS_IPHONE
@@ -2010,8 +2223,15 @@
 			InvokeCompletionBlock(response, responseObject, error);
 		}];
 		
+		// If the progress was cancelled before this point, the handler is invoked immediately.
+		progress.cancellationHandler = ^{
+			[task cancel];
+		};
+		
 		[task resume];
 	}];
+	
+	return progress;
 }
 
 /**
@@ -9,6 +9,8 @@
 
 #import "ZDCSyncManagerPrivate.h"
 
+#import "ZDCChangeSubscription.h"
+#import "ZDCCloudPrivate.h"
 #import "ZDCLogging.h"
 #import "ZeroDarkCloudPrivate.h"
 
@@ -30,6 +32,7 @@
 /* extern */ NSString *const kZDCSyncStatusNotificationInfo = @"ZDCSyncStatusNotificationInfo";
 
 static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in the absence of push notifications)
+static NSTimeInterval const ZDCSyncingNodeIDsCoalesceInterval = 1.0 / 60.0; // once per frame
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark -
@@ -96,16 +99,42 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 @property (nonatomic, strong, readwrite) NSDate *lastPullSuccess;
 @property (nonatomic, assign, readwrite) NSUInteger pullInterruptedFailCount;
 
-@property (nonatomic, strong, readwrite) dispatch_source_t timer;
+@property (nonatomic, strong, readwrite) dispatch_source_t timer; // for retrying failed pulls
 @property (nonatomic, assign, readwrite) BOOL timerSuspended;
 
+@property (nonatomic, strong, readwrite) ZDCChangeSubscription *changeSubscription;
+
 @property (nonatomic, strong, readwrite) NSSet<NSString *> *syncingNodeIDs;
 
+// The syncingNodeIDs are maintained incrementally:
+//
+// - activeNodeIDs        : nodes being pushed or downloaded
+// - syncingNodeRefCounts : each active node retains itself & all its ancestors
+// - parentIDs            : nodeID -> parentID (or NSNull), for every node in syncingNodeRefCounts
+//
+@property (nonatomic, assign, readwrite) BOOL isTrackingSyncingNodeIDs;
+@property (nonatomic, assign, readwrite) BOOL isResolvingParentIDs;
+@property (nonatomic, assign, readwrite) BOOL syncingNodeIDsRefreshScheduled;
+
+@property (nonatomic, strong, readonly) NSMutableSet<NSString *> *pushingNodeIDs;
+@property (nonatomic, strong, readonly) NSMutableSet<NSString *> *downloadingNodeIDs;
+@property (nonatomic, strong, readonly) NSMutableSet<NSString *> *pendingDownloadNodeIDs;
+
+@property (nonatomic, strong, readonly) NSMutableSet<NSString *> *activeNodeIDs;
+@property (nonatomic, strong, readonly) NSCountedSet<NSString *> *syncingNodeRefCounts;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSString *, id> *parentIDs;
+
 @end
 
 @implementation ZDCLocalUserSyncState
 
 @synthesize localUserID = localUserID;
+@synthesize pushingNodeIDs = pushingNodeIDs;
+@synthesize downloadingNodeIDs = downloadingNodeIDs;
+@synthesize pendingDownloadNodeIDs = pendingDownloadNodeIDs;
+@synthesize activeNodeIDs = activeNodeIDs;
+@synthesize syncingNodeRefCounts = syncingNodeRefCounts;
+@synthesize parentIDs = parentIDs;
 
 - (instancetype)initWithLocalUserID:(NSString *)inLocalUserID
 {
@@ -114,6 +143,14 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 		localUserID = [inLocalUserID copy];
 		
 		self.isPushingSuspended = YES; // to match initial suspend in DatabaseManager
+		
+		pushingNodeIDs = [[NSMutableSet alloc] init];
+		downloadingNodeIDs = [[NSMutableSet alloc] init];
+		pendingDownloadNodeIDs = [[NSMutableSet alloc] init];
+		
+		activeNodeIDs = [[NSMutableSet alloc] init];
+		syncingNodeRefCounts = [[NSCountedSet alloc] init];
+		parentIDs = [[NSMutableDictionary alloc] init];
 	}
 	return self;
 }
@@ -126,6 +163,8 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 		dispatch_resume(self.timer);
 		self.timerSuspended = NO;
 	}
+	
+	[self.changeSubscription stop];
 }
 
 @end
@@ -359,10 +398,15 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 				syncState.lastPullSuccess = [NSDate date];
 				syncState.pullInterruptedFailCount = 0;
 				
-				NSTimeInterval delay = ZDCDefaultPullInterval;
-				NSDate *nextPull = [syncState.lastPullSuccess dateByAddingTimeInterval:delay];
+				// We're up-to-date.
+				// The changeSubscription will tell us when there's something new to pull.
+				
+				[self updateTimerForSyncState:syncState withNextPull:nil];
 				
-				[self updateTimerForSyncState:syncState withNextPull:nextPull];
+				if (syncState.isEnabled && hasInternet)
+				{
+					[syncState.changeSubscription start];
+				}
 				
 				if (syncState.isPushingSuspended && syncState.isEnabled && hasInternet)
 				{
@@ -597,7 +641,7 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 	}
 	
 	NSString *localUserID = sender_cloudExt.localUserID;
-	[self refreshSyncingNodeIDsForLocalUserID:localUserID treeID:treeID];
+	[self scheduleSyncingNodeIDsRefreshForLocalUserID:localUserID downloadNodeID:nil];
 }
 
 - (void)progressListChanged:(NSNotification *)notification
@@ -606,7 +650,13 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 	
 	ZDCProgressManagerChanges *changes = notification.userInfo[kZDCProgressManagerChanges];
 	
-	[self refreshSyncingNodeIDsForLocalUserID:changes.localUserID treeID:zdc.primaryTreeID];
+	// Uploads are tracked via the operations in the pipeline (see pipelineQueueChanged:).
+	if (changes.progressType == ZDCProgressType_Upload)
+	{
+		return;
+	}
+	
+	[self scheduleSyncingNodeIDsRefreshForLocalUserID:changes.localUserID downloadNodeID:changes.nodeID];
 }
 
 #if TARGET_OS_IPHONE
@@ -842,10 +892,24 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 			
 			syncState.timerSuspended = YES;
 			
-			[self refreshSyncingNodeIDsForLocalUserID:localUserID treeID:treeID];
+			syncState.changeSubscription =
+			  [[ZDCChangeSubscription alloc] initWithOwner: zdc
+			                                   localUserID: localUserID
+			                                        treeID: treeID
+			                                   changeQueue: queue
+			                                   changeBlock:^
+			{
+				__strong typeof(self) strongSelf = weakSelf;
+				if (strongSelf) {
+					[strongSelf pullChangesForLocalUserID:localUserID];
+				}
+			}];
+			syncState.changeSubscription.maxIdleInterval = ZDCDefaultPullInterval;
 			
 			syncStates[localUserID] = syncState;
 			isNewSyncState = YES;
+			
+			[self scheduleSyncingNodeIDsRefreshForLocalUserID:localUserID downloadNodeID:nil];
 		}
 		
 		BOOL wasDisabled = syncState.isEnabled == NO;
@@ -894,6 +958,8 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 		}
 		else // disabled
 		{
+			[syncState.changeSubscription stop];
+			
 			if (syncState.isPulling)
 			{
 				syncState.isPulling = NO;
@@ -924,6 +990,8 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 			// This user has been deleted.
 			// So we have to abort everything, and clean the database.
 			
+			[syncState.changeSubscription stop];
+			
 			if (syncState.isPulling)
 			{
 				syncState.isPulling = NO;
@@ -1005,6 +1073,11 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 					[syncState.cloudExt resume];
 					syncState.isPushingSuspended = NO;
 				}
+				
+				if (!syncState.changeSubscription.isRunning && !syncState.lastPullFailed)
+				{
+					[syncState.changeSubscription start];
+				}
 			}
 		}
 		
@@ -1028,6 +1101,8 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 	#pragma clang diagnostic push
 	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
 		
+		[syncState.changeSubscription stop];
+		
 		if (syncState.isPulling)
 		{
 			syncState.isPulling = NO;
@@ -1185,6 +1260,8 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 	{
 		if (!syncState.isPulling)
 		{
+			[syncState.changeSubscription stop];
+			
 			[zdc.pullManager pullRemoteChangesForLocalUserID:syncState.localUserID treeID:zdc.primaryTreeID];
 			[self updateTimerForSyncState:syncState withNextPull:nil];
 			syncState.isPulling = YES;
@@ -1670,39 +1747,113 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 }
 
 /**
- * Internal method that actually performs the calculation.
- * External classes should use the method above, which uses a recent cached calculation.
+ * The notifications that affect the syncingNodeIDs can arrive in rapid succession (e.g. during large uploads).
+ * So we record what changed, and process the changes (at most) once per frame.
+ *
+ * @param downloadNodeID
+ *   If the download progress changed for a node, pass its nodeID.
+ *   Changes to the pushing nodes are tracked by the ZDCCloud extension.
  */
-- (NSSet<NSString *> *)syncingNodeIDsForLocalUserID:(NSString *)localUserID
-                                             treeID:(NSString *)treeID
-                                        transaction:(YapDatabaseReadTransaction *)transaction
+- (void)scheduleSyncingNodeIDsRefreshForLocalUserID:(NSString *)localUserID downloadNodeID:(NSString *)nodeID
+{
+	ZDCLogAutoTrace();
+	
+	if (localUserID == nil) return;
+	
+	__weak typeof(self) weakSelf = self;
+	dispatch_block_t block = ^{ @autoreleasepool {
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (strongSelf == nil) return;
+		
+		ZDCLocalUserSyncState *syncState = strongSelf->syncStates[localUserID];
+		if (syncState == nil) return;
+		
+		if (nodeID) {
+			[syncState.pendingDownloadNodeIDs addObject:nodeID];
+		}
+		
+		[strongSelf scheduleSyncingNodeIDsProcessing:syncState];
+	}};
+	
+	if (dispatch_get_specific(IsOnQueueKey))
+		block();
+	else
+		dispatch_async(queue, block);
+}
+
+- (void)scheduleSyncingNodeIDsProcessing:(ZDCLocalUserSyncState *)syncState
 {
-	NSMutableSet<NSString *> *active_nodeIDs = [NSMutableSet set];
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	// If we're waiting on the database, the changes will be processed when it completes.
+	
+	if (syncState.syncingNodeIDsRefreshScheduled || syncState.isResolvingParentIDs) {
+		return;
+	}
+	syncState.syncingNodeIDsRefreshScheduled = YES;
+	
+	NSString *localUserID = syncState.localUserID;
+	dispatch_time_t when =
+	  dispatch_time(DISPATCH_TIME_NOW, (int64_t)(ZDCSyncingNodeIDsCoalesceInterval * NSEC_PER_SEC));
+	
+	__weak typeof(self) weakSelf = self;
+	dispatch_after(when, queue, ^{ @autoreleasepool {
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (strongSelf == nil) return;
+		
+		ZDCLocalUserSyncState *currentSyncState = strongSelf->syncStates[localUserID];
+		if (currentSyncState)
+		{
+			currentSyncState.syncingNodeIDsRefreshScheduled = NO;
+			[strongSelf processSyncingNodeIDChanges:currentSyncState];
+		}
+	}});
+}
+
+/**
+ * Applies the changes that have accumulated since the last run.
+ *
+ * Only the nodes that started or stopped syncing are processed.
+ * And we only hit the database to lookup the parents of nodes we're not already tracking.
+ */
+- (void)processSyncingNodeIDChanges:(ZDCLocalUserSyncState *)syncState
+{
+	ZDCLogAutoTrace();
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	NSMutableSet<NSString *> *changedNodeIDs = [NSMutableSet set];
 	
 	// Grab all nodeIDs being pushed (or scheduled to be pushed)
 	
-	YapDatabaseCloudCore *ext = [zdc.databaseManager cloudExtForUserID:localUserID treeID:treeID];
-	YapDatabaseCloudCorePipeline *pipeline = [ext defaultPipeline];
+	if (!syncState.isTrackingSyncingNodeIDs)
+	{
+		syncState.isTrackingSyncingNodeIDs = YES;
 	
-	[pipeline enumerateOperationsUsingBlock:
-		^(YapDatabaseCloudCoreOperation *operation, NSUInteger graphIdx, BOOL *stop)
+		NSSet<NSString *> *pushingNodeIDs = [syncState.cloudExt startTrackingCommittedNodeIDs];
+		
+		[syncState.pushingNodeIDs unionSet:pushingNodeIDs];
+		[changedNodeIDs unionSet:pushingNodeIDs];
+		
+		NSSet<NSString *> *downloadingNodeIDs = [zdc.progressManager allDownloadingNodeIDs:syncState.localUserID];
+		
+		[syncState.pendingDownloadNodeIDs unionSet:downloadingNodeIDs];
+	}
+	else
 	{
-		__unsafe_unretained ZDCCloudOperation *op = (ZDCCloudOperation *)operation;
+		NSDictionary<NSString *, NSNumber *> *pushChanges = [syncState.cloudExt dequeueCommittedNodeIDChanges];
 		
-		NSString *nodeID = op.nodeID;
-		if (nodeID)
-		{
-			// Ignore any operations that have been marked as completed or skipped.
-			// This happens due to various optimizations.
+		[pushChanges enumerateKeysAndObjectsUsingBlock:^(NSString *nodeID, NSNumber *hasOperations, BOOL *stop) {
 			
-			YDBCloudCoreOperationStatus status = [pipeline statusForOperationWithUUID:operation.uuid];
+			if (hasOperations.boolValue)
+				[syncState.pushingNodeIDs addObject:nodeID];
+			else
+				[syncState.pushingNodeIDs removeObject:nodeID];
 			
-			if (status != YDBCloudOperationStatus_Completed && status != YDBCloudOperationStatus_Skipped)
-			{
-				[active_nodeIDs addObject:nodeID];
-			}
-		}
-	}];
+			[changedNodeIDs addObject:nodeID];
+		}];
+	}
 	
 	// Grab all nodeIDs being pulled.
 	//
@@ -1712,67 +1863,170 @@ static NSTimeInterval const ZDCDefaultPullInterval = 60 * 15; // 15 minutes (in
 	
 	// Grab all nodeIDs being downloaded.
 	
-	NSSet<NSString *> *download_nodeIDs = [zdc.progressManager allDownloadingNodeIDs:localUserID];
+	for (NSString *nodeID in syncState.pendingDownloadNodeIDs)
+	{
+		if ([zdc.progressManager downloadProgressForNodeID:nodeID])
+			[syncState.downloadingNodeIDs addObject:nodeID];
+		else
+			[syncState.downloadingNodeIDs removeObject:nodeID];
 	
-	[active_nodeIDs unionSet:download_nodeIDs];
+		[changedNodeIDs addObject:nodeID];
+	}
+	[syncState.pendingDownloadNodeIDs removeAllObjects];
 	
-	// Add all parent nodes
+	// Figure out which nodes started/stopped syncing
 	
-	NSMutableSet<NSString *> *all_nodeIDs = [NSMutableSet set];
+	NSMutableArray<NSString *> *startedNodeIDs = [NSMutableArray array];
+	BOOL changed = NO;
 	
-	for (NSString *nodeID in active_nodeIDs)
+	for (NSString *nodeID in changedNodeIDs)
 	{
-		NSString *currentNodeID = nodeID;
-		do {
+		BOOL isActive = [syncState.pushingNodeIDs containsObject:nodeID]
+		             || [syncState.downloadingNodeIDs containsObject:nodeID];
 			
-			if ([all_nodeIDs containsObject:currentNodeID])
-				break;
-			else
-				[all_nodeIDs addObject:currentNodeID];
-			
-			ZDCNode *currentNode = [transaction objectForKey:currentNodeID inCollection:kZDCCollection_Nodes];
-			currentNodeID = currentNode.parentID;
+		BOOL wasActive = [syncState.activeNodeIDs containsObject:nodeID];
 			
-		} while (currentNodeID != nil);
+		if (isActive && !wasActive)
+		{
+			[syncState.activeNodeIDs addObject:nodeID];
+			[startedNodeIDs addObject:nodeID];
+		}
+		else if (!isActive && wasActive)
+		{
+			[syncState.activeNodeIDs removeObject:nodeID];
+			[self releaseSyncingNodeID:nodeID syncState:syncState];
+			changed = YES;
+		}
 	}
 	
-	return all_nodeIDs;
-}
+	// Every node in syncingNodeRefCounts has its full parent chain in the parentIDs cache.
+	// So we only need to lookup the nodes that aren't already being tracked.
 
-- (void)refreshSyncingNodeIDsForLocalUserID:(NSString *)localUserID treeID:(NSString *)treeID
-{
-	ZDCLogAutoTrace();
+	NSMutableArray<NSString *> *unresolvedNodeIDs = [NSMutableArray array];
 	
-	if (localUserID == nil) return;
+	for (NSString *nodeID in startedNodeIDs)
+	{
+		if (syncState.parentIDs[nodeID] == nil) {
+			[unresolvedNodeIDs addObject:nodeID];
+		}
+	}
+	
+	if (unresolvedNodeIDs.count == 0)
+	{
+		for (NSString *nodeID in startedNodeIDs)
+		{
+			[self retainSyncingNodeID:nodeID syncState:syncState];
+		}
+		
+		[self updateSyncingNodeIDs:syncState changed:(changed || startedNodeIDs.count > 0)];
+		return;
+	}
+	
+	syncState.isResolvingParentIDs = YES;
 	
-	__block NSSet<NSString *> *newSyncingNodeIDs = nil;
+	NSString *localUserID = syncState.localUserID;
+	NSMutableDictionary<NSString *, id> *fetchedParentIDs = [NSMutableDictionary dictionary];
 	
 	__weak typeof(self) weakSelf = self;
 	[zdc.databaseManager.roDatabaseConnection asyncReadWithBlock:^(YapDatabaseReadTransaction *transaction) {
 		
-		__strong typeof(self) strongSelf = weakSelf;
-		if (strongSelf == nil) return;
+		for (NSString *nodeID in unresolvedNodeIDs)
+		{
+			NSString *currentNodeID = nodeID;
+			while (currentNodeID && fetchedParentIDs[currentNodeID] == nil)
+			{
+				ZDCNode *currentNode = [transaction objectForKey:currentNodeID inCollection:kZDCCollection_Nodes];
+				NSString *parentID = currentNode.parentID;
 		
-		newSyncingNodeIDs = [strongSelf syncingNodeIDsForLocalUserID:localUserID treeID:treeID transaction:transaction];
+				fetchedParentIDs[currentNodeID] = parentID ?: [NSNull null];
+				currentNodeID = parentID;
+			}
+		}
 		
 	} completionQueue:queue completionBlock:^{
 		
 		__strong typeof(self) strongSelf = weakSelf;
 		if (strongSelf == nil) return;
 		
-		ZDCLocalUserSyncState *syncState = strongSelf->syncStates[localUserID];
-		if (syncState)
-		{
-			NSSet<NSString *> *oldSyncingNodeIDs = syncState.syncingNodeIDs;
+		if (strongSelf->syncStates[localUserID] != syncState) {
+			return; // localUser was removed while we were reading
+		}
+		
+		// Don't replace cached entries: the retained chains must be released with the same parentIDs.
+		
+		[fetchedParentIDs enumerateKeysAndObjectsUsingBlock:^(NSString *nodeID, id parentID, BOOL *stop) {
 			
-			if (!oldSyncingNodeIDs || ![oldSyncingNodeIDs isEqualToSet:newSyncingNodeIDs])
-			{
-				syncState.syncingNodeIDs = newSyncingNodeIDs;
-				
-				[strongSelf postSyncingNodeIDsChangedNotification:localUserID treeID:treeID];
+			if (syncState.parentIDs[nodeID] == nil) {
+				syncState.parentIDs[nodeID] = parentID;
 			}
+		}];
+		
+		for (NSString *nodeID in startedNodeIDs)
+		{
+			[strongSelf retainSyncingNodeID:nodeID syncState:syncState];
 		}
+			
+		syncState.isResolvingParentIDs = NO;
+		[strongSelf updateSyncingNodeIDs:syncState changed:YES];
+				
+		// Process anything that arrived while we were reading
+		[strongSelf scheduleSyncingNodeIDsProcessing:syncState];
 	}];
 }
 
+- (void)retainSyncingNodeID:(NSString *)nodeID syncState:(ZDCLocalUserSyncState *)syncState
+{
+	NSMutableDictionary<NSString *, id> *parentIDs = syncState.parentIDs;
+	NSUInteger remaining = parentIDs.count; // guard against cycles
+	
+	NSString *currentNodeID = nodeID;
+	while (currentNodeID && remaining-- > 0)
+	{
+		[syncState.syncingNodeRefCounts addObject:currentNodeID];
+		
+		id parentID = parentIDs[currentNodeID];
+		currentNodeID = [parentID isKindOfClass:[NSString class]] ? (NSString *)parentID : nil;
+	}
+}
+
+- (void)releaseSyncingNodeID:(NSString *)nodeID syncState:(ZDCLocalUserSyncState *)syncState
+{
+	NSMutableDictionary<NSString *, id> *parentIDs = syncState.parentIDs;
+	NSUInteger remaining = parentIDs.count; // guard against cycles
+	
+	NSString *currentNodeID = nodeID;
+	while (currentNodeID && remaining-- > 0)
+	{
+		id parentID = parentIDs[currentNodeID];
+		
+		[syncState.syncingNodeRefCounts removeObject:currentNodeID];
+		if ([syncState.syncingNodeRefCounts countForObject:currentNodeID] == 0)
+		{
+			// No longer syncing, and neither are any of its descendants
+			[parentIDs removeObjectForKey:currentNodeID];
+		}
+		
+		currentNodeID = [parentID isKindOfClass:[NSString class]] ? (NSString *)parentID : nil;
+	}
+}
+
+- (void)updateSyncingNodeIDs:(ZDCLocalUserSyncState *)syncState changed:(BOOL)changed
+{
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	NSSet<NSString *> *oldSyncingNodeIDs = syncState.syncingNodeIDs;
+	if (oldSyncingNodeIDs && !changed) {
+		return;
+	}
+	
+	NSSet<NSString *> *newSyncingNodeIDs = [[NSSet alloc] initWithSet:syncState.syncingNodeRefCounts];
+	
+	if (!oldSyncingNodeIDs || ![oldSyncingNodeIDs isEqualToSet:newSyncingNodeIDs])
+	{
+		syncState.syncingNodeIDs = newSyncingNodeIDs;
+		
+		[self postSyncingNodeIDsChangedNotification:syncState.localUserID treeID:zdc.primaryTreeID];
+	}
+}
+
 @end
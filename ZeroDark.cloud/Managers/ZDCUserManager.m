@@ -35,6 +35,18 @@
 #endif
 #pragma unused(zdcLogLevel)
 
+/**
+ * Individual requests to fetch remote users are coalesced into batch requests.
+ * The first request starts a short window, and all requests that arrive within the window
+ * are sent to the server together (with a single round-trip).
+ */
+#define USER_FETCH_BATCH_WINDOW 0.05 // seconds
+
+typedef NS_ENUM(NSInteger, ZDCUserBatchType) {
+	ZDCUserBatchType_Info,
+	ZDCUserBatchType_Profile,
+};
+
 
 @interface ZDCUserDisplay ()
 @property (nonatomic, readwrite, copy) NSString *displayName;
@@ -67,6 +79,14 @@
 	
 	YapDatabaseConnection *internal_roConnection;
 	ZDCAsyncCompletionDispatch *asyncCompletionDispatch;
+	
+	dispatch_queue_t batchQueue;
+	
+	// The following variables can only be read/modified within batchQueue:
+	
+	NSMutableDictionary<NSString*, NSMutableDictionary<NSString*, NSMutableArray*>*> *pendingBatches;
+	BOOL batchInfoUnsupported;
+	BOOL batchProfileUnsupported;
 }
 
 - (instancetype)init
@@ -82,6 +102,9 @@
 		
 		internal_roConnection = [zdc.databaseManager internal_roConnection];
 		asyncCompletionDispatch = [[ZDCAsyncCompletionDispatch alloc] init];
+		
+		batchQueue = dispatch_queue_create("ZDCUserManager.batch", DISPATCH_QUEUE_SERIAL);
+		pendingBatches = [[NSMutableDictionary alloc] init];
 	}
 	return self;
 }
@@ -343,10 +366,10 @@
 	//
 	fetchBasicInfo = ^void (){ @autoreleasepool {
 		
-		[weakSelf _fetchRemoteUser: remoteUserID
-		               requesterID: localUserID
-		           completionQueue: concurrentQueue
-		           completionBlock:^(ZDCUser *user, NSError *error)
+		[weakSelf _batchFetchRemoteUser: remoteUserID
+		                    requesterID: localUserID
+		                completionQueue: concurrentQueue
+		                completionBlock:^(ZDCUser *user, NSError *error)
 		{
 			if (error)
 			{
@@ -367,10 +390,10 @@
 		ZDCLogVerbose(@"fetchAuth0Info() - %@", remoteUserID);
 		NSAssert(user != nil, @"Bad state");
 		
-		[weakSelf _fetchFilteredAuth0Profile: remoteUserID
-		                         requesterID: localUserID
-		                     completionQueue: concurrentQueue
-		                     completionBlock:^(ZDCUserProfile *profile, NSError *error)
+		[weakSelf _batchFetchFilteredAuth0Profile: remoteUserID
+		                              requesterID: localUserID
+		                          completionQueue: concurrentQueue
+		                          completionBlock:^(ZDCUserProfile *profile, NSError *error)
 		{
 			if (error)
 			{
@@ -1017,52 +1040,63 @@
 			}
 		}
 		
-		id value;
-		
-		AWSRegion region = AWSRegion_Invalid;
-		NSString *bucket = nil;
+		ZDCUser *user = [self userFromInfoResponse:response remoteUserID:remoteUserID error:&error];
 		
-		if ((value = response[@"region"]))
+		completionBlock(user, error);
+	}];
+}
+
+/**
+ * Parses the response from the server's "/users/info" API.
+ */
+- (nullable ZDCUser *)userFromInfoResponse:(NSDictionary *)response
+                              remoteUserID:(NSString *)remoteUserID
+                                     error:(NSError *_Nullable *_Nullable)errorOut
+{
+	id value;
+	
+	AWSRegion region = AWSRegion_Invalid;
+	NSString *bucket = nil;
+	
+	if ((value = response[@"region"]))
+	{
+		if ([value isKindOfClass:[NSString class]])
 		{
-			if ([value isKindOfClass:[NSString class]])
-			{
-				NSString *regionName = (NSString *)value;
-				region = [AWSRegions regionForName:regionName];
-			}
+			NSString *regionName = (NSString *)value;
+			region = [AWSRegions regionForName:regionName];
 		}
-		
-		if ((value = response[@"bucket"]))
+	}
+	
+	if ((value = response[@"bucket"]))
+	{
+		if ([value isKindOfClass:[NSString class]])
 		{
-			if ([value isKindOfClass:[NSString class]])
-			{
-				bucket = (NSString *)value;
-			}
+			bucket = (NSString *)value;
 		}
-		
-		if (region == AWSRegion_Invalid || !bucket)
-		{
-			// Got a bad response from the server ?
+	}
 	
-			error = [ZDCUserManager errorWithStatusCode:500 description:@"Unreadable response from server"];
-			
-			completionBlock(nil, error);
-			return;
-		}
-		
-		ZDCUser *user = [[ZDCUser alloc] initWithUUID:remoteUserID];
-		user.aws_region = region;
-		user.aws_bucket = bucket;
-		
-		if ((value = response[@"deleted"]))
+	if (region == AWSRegion_Invalid || !bucket)
+	{
+		// Got a bad response from the server ?
+	
+		if (errorOut) *errorOut = [ZDCUserManager errorWithStatusCode:500 description:@"Unreadable response from server"];
+		return nil;
+	}
+	
+	ZDCUser *user = [[ZDCUser alloc] initWithUUID:remoteUserID];
+	user.aws_region = region;
+	user.aws_bucket = bucket;
+	
+	if ((value = response[@"deleted"]))
+	{
+		if ([value isKindOfClass:[NSNumber class]])
 		{
-			if ([value isKindOfClass:[NSNumber class]])
-			{
-				user.accountDeleted = [(NSNumber *)value boolValue];
-			}
+			user.accountDeleted = [(NSNumber *)value boolValue];
 		}
+	}
 
-		completionBlock(user, nil);
-	}];
+	if (errorOut) *errorOut = nil;
+	return user;
 }
 
 - (void)_fetchFilteredAuth0Profile:(NSString *)remoteUserID
@@ -1128,6 +1162,319 @@
 	}];
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Batching
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Batched version of `_fetchRemoteUser:requesterID:completionQueue:completionBlock:`.
+ *
+ * The request is added to a pending batch, which is sent to the server after USER_FETCH_BATCH_WINDOW
+ * (or immediately, if the batch is full). So when many unknown users are encountered at once
+ * (e.g. pulling a shared tree with many collaborators), we make 1 request per batch, instead of 1 per user.
+ */
+- (void)_batchFetchRemoteUser:(NSString *)remoteUserID
+                  requesterID:(NSString *)localUserID
+              completionQueue:(dispatch_queue_t)completionQueue
+              completionBlock:(void (^)(ZDCUser *_Nullable user, NSError *_Nullable error))completionBlock
+{
+	[self enqueueBatchRequest: ZDCUserBatchType_Info
+	             remoteUserID: remoteUserID
+	              requesterID: localUserID
+	          completionBlock:^(id result, NSError *error)
+	{
+		dispatch_async(completionQueue, ^{ @autoreleasepool {
+			completionBlock(result, error);
+		}});
+	}];
+}
+
+/**
+ * Batched version of `_fetchFilteredAuth0Profile:requesterID:completionQueue:completionBlock:`.
+ */
+- (void)_batchFetchFilteredAuth0Profile:(NSString *)remoteUserID
+                            requesterID:(NSString *)localUserID
+                        completionQueue:(dispatch_queue_t)completionQueue
+                        completionBlock:(void (^)(ZDCUserProfile *profile, NSError *error))completionBlock
+{
+	[self enqueueBatchRequest: ZDCUserBatchType_Profile
+	             remoteUserID: remoteUserID
+	              requesterID: localUserID
+	          completionBlock:^(id result, NSError *error)
+	{
+		dispatch_async(completionQueue, ^{ @autoreleasepool {
+			completionBlock(result, error);
+		}});
+	}];
+}
+
+- (void)enqueueBatchRequest:(ZDCUserBatchType)type
+               remoteUserID:(NSString *)remoteUserID
+                requesterID:(NSString *)localUserID
+            completionBlock:(void (^)(id _Nullable result, NSError *_Nullable error))completionBlock
+{
+	NSString *batchKey = [NSString stringWithFormat:@"%ld|%@", (long)type, localUserID];
+	
+	__weak typeof(self) weakSelf = self;
+	dispatch_async(batchQueue, ^{ @autoreleasepool {
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (strongSelf == nil) return;
+		
+		NSMutableDictionary<NSString*, NSMutableArray*> *batch = strongSelf->pendingBatches[batchKey];
+		if (batch == nil)
+		{
+			batch = [[NSMutableDictionary alloc] init];
+			strongSelf->pendingBatches[batchKey] = batch;
+			
+			dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(USER_FETCH_BATCH_WINDOW * NSEC_PER_SEC));
+			dispatch_after(when, strongSelf->batchQueue, ^{
+				
+				[weakSelf flushBatch:batch type:type batchKey:batchKey requesterID:localUserID];
+			});
+		}
+		
+		NSMutableArray *completionBlocks = batch[remoteUserID];
+		if (completionBlocks == nil)
+		{
+			completionBlocks = [[NSMutableArray alloc] initWithCapacity:1];
+			batch[remoteUserID] = completionBlocks;
+		}
+		[completionBlocks addObject:completionBlock];
+		
+		if (batch.count >= kZDCRestManager_UserBatchLimit)
+		{
+			[strongSelf flushBatch:batch type:type batchKey:batchKey requesterID:localUserID];
+		}
+	}});
+}
+
+/**
+ * Must be invoked from within the batchQueue.
+ */
+- (void)flushBatch:(NSMutableDictionary<NSString*, NSMutableArray*> *)batch
+              type:(ZDCUserBatchType)type
+          batchKey:(NSString *)batchKey
+       requesterID:(NSString *)localUserID
+{
+	if (pendingBatches[batchKey] != batch)
+	{
+		// Already flushed (because it filled up before the window expired).
+		return;
+	}
+	[pendingBatches removeObjectForKey:batchKey];
+	
+	NSArray<NSString*> *remoteUserIDs = [batch allKeys];
+	
+	void (^InvokeCompletionBlocks)(NSDictionary<NSString*, id>*, NSError*) =
+	^(NSDictionary<NSString*, id> *results, NSError *error)
+	{
+		[batch enumerateKeysAndObjectsUsingBlock:^(NSString *remoteUserID, NSArray *completionBlocks, BOOL *stop) {
+			
+			id result = results[remoteUserID];
+			NSError *resultError = error;
+			
+			if ([result isKindOfClass:[NSError class]])
+			{
+				resultError = (NSError *)result;
+				result = nil;
+			}
+			
+			for (void (^completionBlock)(id, NSError*) in completionBlocks)
+			{
+				completionBlock(result, resultError);
+			}
+		}];
+	};
+	
+	BOOL unsupported = (type == ZDCUserBatchType_Info) ? batchInfoUnsupported : batchProfileUnsupported;
+	
+	if (remoteUserIDs.count == 1 || unsupported)
+	{
+		[self fetchIndividually: remoteUserIDs
+		                   type: type
+		            requesterID: localUserID
+		        completionBlock: InvokeCompletionBlocks];
+		return;
+	}
+	
+	__weak typeof(self) weakSelf = self;
+	
+	void (^HandleResponse)(NSDictionary<NSString*, NSDictionary*>*, NSError*) =
+	^(NSDictionary<NSString*, NSDictionary*> *responses, NSError *error)
+	{
+		__strong typeof(self) strongSelf = weakSelf;
+		if (strongSelf == nil) return;
+		
+		if (error)
+		{
+			if ([ZDCUserManager isBatchUnsupportedError:error])
+			{
+				// The server doesn't support batch requests.
+				// Remember this, and fallback to individual requests.
+				
+				if (type == ZDCUserBatchType_Info)
+					strongSelf->batchInfoUnsupported = YES;
+				else
+					strongSelf->batchProfileUnsupported = YES;
+				
+				[strongSelf fetchIndividually: remoteUserIDs
+				                         type: type
+				                  requesterID: localUserID
+				              completionBlock: InvokeCompletionBlocks];
+			}
+			else
+			{
+				InvokeCompletionBlocks(nil, error);
+			}
+			return;
+		}
+		
+		NSMutableDictionary<NSString*, id> *results = [NSMutableDictionary dictionaryWithCapacity:remoteUserIDs.count];
+		NSMutableArray<NSString*> *missingUserIDs = [NSMutableArray array];
+		
+		for (NSString *remoteUserID in remoteUserIDs)
+		{
+			NSDictionary *response = responses[remoteUserID];
+			if (response == nil)
+			{
+				// A missing entry doesn't tell us anything (e.g. the server may have truncated the response).
+				// In particular, it's NOT the same as a 404 from the non-batch API,
+				// so we mustn't conclude the account was deleted. Ask for it individually instead.
+				
+				[missingUserIDs addObject:remoteUserID];
+				continue;
+			}
+			
+			if (type == ZDCUserBatchType_Info)
+			{
+				NSError *parseError = nil;
+				ZDCUser *user = [strongSelf userFromInfoResponse:response remoteUserID:remoteUserID error:&parseError];
+					
+				results[remoteUserID] = user ?: parseError;
+			}
+			else
+			{
+				results[remoteUserID] = [[ZDCUserProfile alloc] initWithDictionary:response];
+			}
+		}
+		
+		if (missingUserIDs.count == 0)
+		{
+			InvokeCompletionBlocks(results, nil);
+			return;
+		}
+		
+		[strongSelf fetchIndividually: missingUserIDs
+		                         type: type
+		                  requesterID: localUserID
+		              completionBlock:^(NSDictionary<NSString*, id> *individualResults, NSError *error)
+		{
+			[results addEntriesFromDictionary:individualResults];
+			InvokeCompletionBlocks(results, error);
+		}];
+	};
+	
+	// Note: HandleResponse is invoked on the batchQueue, as it may modify batchXUnsupported.
+	
+	if (type == ZDCUserBatchType_Info)
+	{
+		[zdc.restManager fetchInfoForRemoteUserIDs: remoteUserIDs
+		                               requesterID: localUserID
+		                           completionQueue: batchQueue
+		                           completionBlock: HandleResponse];
+	}
+	else
+	{
+		[zdc.restManager fetchFilteredAuth0Profiles: remoteUserIDs
+		                                requesterID: localUserID
+		                            completionQueue: batchQueue
+		                            completionBlock: HandleResponse];
+	}
+}
+
+/**
+ * Fallback when the server doesn't support batch requests (or there's only a single user in the batch).
+ */
+- (void)fetchIndividually:(NSArray<NSString*> *)remoteUserIDs
+                     type:(ZDCUserBatchType)type
+              requesterID:(NSString *)localUserID
+          completionBlock:(void (^)(NSDictionary<NSString*, id> *results, NSError *error))completionBlock
+{
+	NSMutableDictionary<NSString*, id> *results = [NSMutableDictionary dictionaryWithCapacity:remoteUserIDs.count];
+	
+	dispatch_group_t group = dispatch_group_create();
+	dispatch_queue_t concurrentQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+	
+	for (NSString *remoteUserID in remoteUserIDs)
+	{
+		dispatch_group_enter(group);
+		
+		void (^completion)(id, NSError*) = ^(id result, NSError *error){
+			
+			@synchronized(results) {
+				results[remoteUserID] = result ?: error ?: [NSNull null];
+			}
+			dispatch_group_leave(group);
+		};
+		
+		if (type == ZDCUserBatchType_Info)
+		{
+			[self _fetchRemoteUser: remoteUserID
+			           requesterID: localUserID
+			       completionQueue: concurrentQueue
+			       completionBlock: completion];
+		}
+		else
+		{
+			[self _fetchFilteredAuth0Profile: remoteUserID
+			                     requesterID: localUserID
+			                 completionQueue: concurrentQueue
+			                 completionBlock: completion];
+		}
+	}
+	
+	dispatch_group_notify(group, concurrentQueue, ^{
+		
+		// Note: We cannot modify `results` while enumerating it.
+		
+		NSMutableDictionary<NSString*, id> *finalResults = [NSMutableDictionary dictionaryWithCapacity:results.count];
+		
+		[results enumerateKeysAndObjectsUsingBlock:^(NSString *key, id obj, BOOL *stop) {
+			
+			if (obj == [NSNull null])
+				finalResults[key] = [ZDCUserManager errorWithStatusCode:500 description:@"Unknown error"];
+			else
+				finalResults[key] = obj;
+		}];
+		
+		completionBlock(finalResults, nil);
+	});
+}
+
++ (BOOL)isBatchUnsupportedError:(NSError *)error
+{
+	NSInteger statusCode = 0;
+	
+	NSHTTPURLResponse *serverResponse = error.userInfo[AFNetworkingOperationFailingURLResponseErrorKey];
+	if ([serverResponse isKindOfClass:[NSHTTPURLResponse class]])
+	{
+		statusCode = serverResponse.statusCode;
+	}
+	else if ([error.domain isEqualToString:NSStringFromClass([ZDCRestManager class])])
+	{
+		statusCode = error.code;
+	}
+	
+	// 404 (Not Found) => the batch endpoint doesn't exist on this server
+	// 501 (Not Implemented) => the server knows the endpoint, but doesn't support it
+	//
+	// Anything else (such as a 403) is an error for this particular request,
+	// and says nothing about whether the server supports batch requests.
+	//
+	return (statusCode == 404 || statusCode == 501);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Errors
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -80,6 +80,16 @@ typedef NS_ENUM(NSInteger, ZDCSearchResultStage) {
  * @param resultsBlock
  *   This closure will be invoked multiple times — once for each ZDCSearchResultStage.
  *   When the search has completed, this closure will be invoked one last time with ZDCSearchResultStage_Done.
+ *
+ * Each query supersedes the previous query for the same localUserID & treeID.
+ * That is, as the user continues typing, the server is only queried once the query has settled,
+ * and any outstanding request for an older query is cancelled.
+ * So there's no need for the caller to delay queries while the user is typing.
+ * A superseded query receives its ZDCSearchResultStage_Server invocation with an NSURLErrorCancelled error
+ * (followed by ZDCSearchResultStage_Done, as usual).
+ *
+ * If a query extends a previous query (e.g. "rob" => "robb"), the server results for the previous query
+ * may be refined locally, and delivered as the ZDCSearchResultStage_Server results.
  */
 - (void)searchForUsersWithQuery:(NSString *)queryString
                          treeID:(NSString *)treeID
@@ -11,6 +11,7 @@
 
 #import "Auth0Utilities.h"
 #import "AWSRegions.h"
+#import "ZDCCachedResponse.h"
 #import "ZDCConstantsPrivate.h"
 #import "ZDCLocalUserManagerPrivate.h"
 #import "ZDCLogging.h"
@@ -36,6 +37,35 @@
 
 #define RESULTS_CACHE_LIMIT 256
 
+/**
+ * Length of the n-grams stored in the results index.
+ * Query words of this length (or shorter) require a single lookup.
+ * Longer query words are answered by intersecting the sets for each of their n-grams.
+ */
+#define RESULTS_INDEX_GRAM_LENGTH 3
+
+/**
+ * How long server responses are persisted in the database (kZDCCollection_CachedResponse).
+ * A repeated query within this window (including across app launches) skips the round-trip to the server.
+ */
+#define SEARCH_RESPONSE_CACHE_TIMEOUT (60 * 15) // 15 minutes
+
+/**
+ * How long a query must remain the latest (for a given requester & treeID) before it's sent to the server.
+ * Queries that are superseded within this window (e.g. because the user is still typing) never hit the server.
+ * This is the only debounce in the pipeline: queries answered locally (or from the persistent cache) don't wait.
+ */
+#define SEARCH_SERVER_DEBOUNCE_DELAY 0.25 // seconds
+
+/**
+ * The server may not return every match for a short query.
+ * So results are only refined locally (for a query that extends a previous one)
+ * if the previous response contained fewer than this many results.
+ */
+#define SEARCH_SERVER_REFINE_LIMIT 50
+
+static NSString *const kSearchResponseCacheKeyPrefix = @"searchUserMatch|";
+
 @implementation ZDCSearchOptions
 
 @synthesize providerToSearch = providerToSearch;
@@ -258,6 +288,228 @@
 #pragma mark -
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * The in-memory cache of ZDCSearchResult's (from previous server responses) for a single treeID.
+ *
+ * Along with the (size-limited) cache itself, we maintain an n-gram index over every searchable string
+ * of every cached result. So a query is answered by intersecting a few small sets,
+ * rather than string-matching every cached result on every keystroke.
+ *
+ * The index only narrows down the candidates. They're still run through `matches:fromIdentities:withOptions:`,
+ * so the results are identical to a full scan.
+ *
+ * Not thread-safe: must be accessed from within ZDCUserSearchManager.cacheQueue.
+ */
+@interface ZDCSearchResultsCache : NSObject
+
+- (instancetype)initWithCountLimit:(NSUInteger)countLimit;
+
+- (void)addResult:(ZDCSearchResult *)result searchableStrings:(NSSet<NSString*> *)searchableStrings;
+
+- (NSArray<ZDCSearchResult*> *)candidatesForQueryWords:(NSArray<NSString*> *)queryWords;
+
+@end
+
+@implementation ZDCSearchResultsCache {
+	
+	NSUInteger countLimit;
+	YapCache<NSString*, ZDCSearchResult*> *cache;
+	
+	NSMutableDictionary<NSString*, NSMutableSet<NSString*>*> *index; // gram => userIDs
+	NSMutableDictionary<NSString*, NSSet<NSString*>*> *userGrams;    // userID => grams
+}
+
++ (NSString *)foldedString:(NSString *)string
+{
+	// Must match the options used in `matchingRanges:fromString:`
+	return [string stringByFoldingWithOptions:(NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch) locale:nil];
+}
+
+- (instancetype)initWithCountLimit:(NSUInteger)inCountLimit
+{
+	if ((self = [super init]))
+	{
+		countLimit = inCountLimit;
+		cache = [[YapCache alloc] initWithCountLimit:countLimit];
+		
+	#ifndef NS_BLOCK_ASSERTIONS
+		cache.allowedKeyClasses = [NSSet setWithObject:[NSString class]];
+		cache.allowedObjectClasses = [NSSet setWithObject:[ZDCSearchResult class]];
+	#endif
+		
+		index = [[NSMutableDictionary alloc] init];
+		userGrams = [[NSMutableDictionary alloc] init];
+	}
+	return self;
+}
+
+- (void)addResult:(ZDCSearchResult *)result searchableStrings:(NSSet<NSString*> *)searchableStrings
+{
+	NSString *userID = result.userID;
+	
+	[self removeUserIDFromIndex:userID];
+	
+	NSMutableSet<NSString*> *grams = [NSMutableSet set];
+	for (NSString *string in searchableStrings)
+	{
+		NSString *folded = [[self class] foldedString:string];
+		NSUInteger length = folded.length;
+		
+		for (NSUInteger i = 0; i < length; i++)
+		{
+			NSUInteger maxLength = MIN(RESULTS_INDEX_GRAM_LENGTH, length - i);
+			for (NSUInteger n = 1; n <= maxLength; n++)
+			{
+				[grams addObject:[folded substringWithRange:NSMakeRange(i, n)]];
+			}
+		}
+	}
+	
+	for (NSString *gram in grams)
+	{
+		NSMutableSet<NSString*> *userIDs = index[gram];
+		if (userIDs == nil)
+		{
+			userIDs = [[NSMutableSet alloc] init];
+			index[gram] = userIDs;
+		}
+		[userIDs addObject:userID];
+	}
+	
+	userGrams[userID] = grams;
+	[cache setObject:result forKey:userID];
+	
+	// YapCache doesn't tell us when it evicts an item.
+	// So we prune the index whenever it gets noticeably larger than the cache.
+	//
+	if (userGrams.count > (countLimit + (countLimit / 4)))
+	{
+		for (NSString *indexedUserID in [userGrams allKeys])
+		{
+			if (![cache containsKey:indexedUserID]) {
+				[self removeUserIDFromIndex:indexedUserID];
+			}
+		}
+	}
+}
+
+- (void)removeUserIDFromIndex:(NSString *)userID
+{
+	NSSet<NSString*> *grams = userGrams[userID];
+	if (grams == nil) return;
+	
+	for (NSString *gram in grams)
+	{
+		NSMutableSet<NSString*> *userIDs = index[gram];
+		[userIDs removeObject:userID];
+		
+		if (userIDs.count == 0) {
+			[index removeObjectForKey:gram];
+		}
+	}
+	
+	[userGrams removeObjectForKey:userID];
+}
+
+- (NSArray<ZDCSearchResult*> *)candidatesForQueryWords:(NSArray<NSString*> *)queryWords
+{
+	NSMutableSet<NSString*> *candidateIDs = nil;
+	
+	for (NSString *queryWord in queryWords)
+	{
+		NSString *folded = [[self class] foldedString:queryWord];
+		NSUInteger length = folded.length;
+		
+		NSMutableArray<NSString*> *grams = [NSMutableArray array];
+		if (length <= RESULTS_INDEX_GRAM_LENGTH)
+		{
+			[grams addObject:folded];
+		}
+		else
+		{
+			for (NSUInteger i = 0; i + RESULTS_INDEX_GRAM_LENGTH <= length; i++)
+			{
+				[grams addObject:[folded substringWithRange:NSMakeRange(i, RESULTS_INDEX_GRAM_LENGTH)]];
+			}
+		}
+		
+		for (NSString *gram in grams)
+		{
+			NSSet<NSString*> *userIDs = index[gram];
+			if (userIDs.count == 0) {
+				return @[];
+			}
+			
+			if (candidateIDs == nil) {
+				candidateIDs = [userIDs mutableCopy];
+			} else {
+				[candidateIDs intersectSet:userIDs];
+			}
+			
+			if (candidateIDs.count == 0) {
+				return @[];
+			}
+		}
+	}
+	
+	NSMutableArray<ZDCSearchResult*> *candidates = [NSMutableArray array];
+	
+	if (candidateIDs == nil)
+	{
+		// Empty query
+		[cache enumerateKeysAndObjectsWithBlock:^(NSString *userID, ZDCSearchResult *result, BOOL *stop) {
+			[candidates addObject:result];
+		}];
+	}
+	else
+	{
+		for (NSString *userID in candidateIDs)
+		{
+			ZDCSearchResult *result = [cache objectForKey:userID];
+			if (result) {
+				[candidates addObject:result];
+			} else {
+				[self removeUserIDFromIndex:userID]; // evicted from cache
+			}
+		}
+	}
+	
+	return candidates;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Tracks the server stage of the most recent query for a particular requester & treeID.
+ *
+ * Each new query supersedes its predecessor:
+ * - if the predecessor is still waiting out the debounce delay, it never hits the server
+ * - if the predecessor's request is in-flight, the request is cancelled
+ *
+ * Must be accessed from within the pipelineQueue.
+ */
+@interface ZDCSearchPipeline : NSObject
+
+@property (nonatomic, strong, nullable) NSProgress *pendingProgress;
+@property (nonatomic, copy, nullable) void (^pendingCompletionBlock)(NSArray<ZDCSearchResult*> *_Nullable, NSError *_Nullable);
+
+@property (nonatomic, copy, nullable) NSString *settledQuery;
+@property (nonatomic, copy, nullable) NSString *settledProvider;
+@property (nonatomic, copy, nullable) NSArray<ZDCSearchResult*> *settledResults;
+
+@end
+
+@implementation ZDCSearchPipeline
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 @implementation ZDCUserSearchManager {
 	
 	__weak ZeroDarkCloud *zdc;
@@ -265,7 +517,11 @@
 	dispatch_queue_t cacheQueue;
 	void *IsOnCacheQueueKey;
 	
-	NSMutableDictionary<NSString*, YapCache*> *cacheDict; // must be accessed from within cacheQueue
+	dispatch_queue_t pipelineQueue;
+	void *IsOnPipelineQueueKey;
+	
+	NSMutableDictionary<NSString*, ZDCSearchResultsCache*> *cacheDict; // must be accessed from within cacheQueue
+	NSMutableDictionary<NSString*, ZDCSearchPipeline*> *pipelineDict;  // must be accessed from within pipelineQueue
 }
 
 - (instancetype)init
@@ -284,7 +540,13 @@
 		IsOnCacheQueueKey = &IsOnCacheQueueKey;
 		dispatch_queue_set_specific(cacheQueue, IsOnCacheQueueKey, IsOnCacheQueueKey, NULL);
 		
+		pipelineQueue = dispatch_queue_create("SearchUserManager.pipelineQueue", DISPATCH_QUEUE_SERIAL);
+		
+		IsOnPipelineQueueKey = &IsOnPipelineQueueKey;
+		dispatch_queue_set_specific(pipelineQueue, IsOnPipelineQueueKey, IsOnPipelineQueueKey, NULL);
+		
 		cacheDict = [[NSMutableDictionary alloc] init];
+		pipelineDict = [[NSMutableDictionary alloc] init];
 	}
 	return self;
 }
@@ -307,6 +569,36 @@
 			[strongSelf->cacheDict removeAllObjects];
 		}
 	});
+	
+	dispatch_async(pipelineQueue, ^{
+		
+		__strong typeof(self) strongSelf = weakSelf;
+		if (strongSelf)
+		{
+			for (ZDCSearchPipeline *pipeline in [strongSelf->pipelineDict objectEnumerator])
+			{
+				pipeline.settledQuery = nil;
+				pipeline.settledProvider = nil;
+				pipeline.settledResults = nil;
+			}
+		}
+	});
+	
+	YapDatabaseConnection *rwConnection = zdc.databaseManager.rwDatabaseConnection;
+	[rwConnection asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		NSMutableArray<NSString*> *keysToRemove = [NSMutableArray array];
+		
+		[transaction enumerateKeysInCollection: kZDCCollection_CachedResponse
+		                            usingBlock:^(NSString *key, BOOL *stop)
+		{
+			if ([key hasPrefix:kSearchResponseCacheKeyPrefix]) {
+				[keysToRemove addObject:key];
+			}
+		}];
+		
+		[transaction removeObjectsForKeys:keysToRemove inCollection:kZDCCollection_CachedResponse];
+	}];
 }
 
 /**
@@ -393,14 +685,18 @@
 	
 	if (options.searchRemoteServer)
 	{
-		[self searchRemoteServer: query
-		                  treeID: treeID
-		             requesterID: localUserID
-		                 options: options
-		         completionQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
-		         completionBlock:^(NSArray<ZDCSearchResult *> *results, NSError *error)
+		[self searchRemoteServerWhenSettled: query
+		                             treeID: treeID
+		                        requesterID: localUserID
+		                            options: options
+		                    completionBlock:^(NSArray<ZDCSearchResult *> *results, NSError *error)
 		{
-			InvokeResultsBlock(ZDCSearchResultStage_Server, results, nil);
+			// Server errors aren't reported, since the other stages may have produced results.
+			// But superseded queries are, so the caller can distinguish them from an empty result set.
+			
+			BOOL superseded = [error.domain isEqualToString:NSURLErrorDomain] && (error.code == NSURLErrorCancelled);
+			
+			InvokeResultsBlock(ZDCSearchResultStage_Server, results, (superseded ? error : nil));
 		}];
 	}
 }
@@ -454,9 +750,11 @@
 	
 	NSMutableArray<ZDCSearchResult*> *results = [NSMutableArray array];
 	
-	YapCache *cache = cacheDict[treeID];
-	[cache enumerateKeysAndObjectsWithBlock:^(NSString *key, ZDCSearchResult *result, BOOL *stop) {
-		
+	ZDCSearchResultsCache *cache = cacheDict[treeID];
+	NSArray<ZDCSearchResult*> *candidates = [cache candidatesForQueryWords:[self queryWordsFromQuery:query]];
+	
+	for (ZDCSearchResult *result in candidates)
+	{
 		NSArray<ZDCSearchMatch*> *matches =
 		  [self matches:query fromIdentities:result.identities withOptions:options];
 		
@@ -466,7 +764,7 @@
 			
 			[results addObject:newResult];
 		}
-	}];
+	}
 	
 	return [results copy];
 }
@@ -475,13 +773,275 @@
 #pragma mark Search: Remote Server
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Runs the server stage through the pipeline for the requester & treeID:
+ *
+ * - The previous query (if still pending) is superseded, and its completionBlock is invoked with NSURLErrorCancelled.
+ * - If the query extends a previous (settled) query, the previous server results are refined locally.
+ * - If the same query was sent recently, the persisted response is used (without any delay).
+ * - Otherwise the query is sent to the server once it has settled (i.e. it's still the latest query after the delay).
+ *
+ * The completionBlock is invoked exactly once, on the pipelineQueue.
+ */
+- (void)searchRemoteServerWhenSettled:(NSString *)query
+                               treeID:(NSString *)treeID
+                          requesterID:(NSString *)localUserID
+                              options:(ZDCSearchOptions *)options
+                      completionBlock:(void (^)(NSArray<ZDCSearchResult*> *results, NSError *error))completionBlock
+{
+	NSString *pipelineKey = [NSString stringWithFormat:@"%@|%@", localUserID, treeID];
+	NSString *provider = options.providerToSearch ?: @"*";
+	
+	dispatch_async(pipelineQueue, ^{ @autoreleasepool {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		ZDCSearchPipeline *pipeline = pipelineDict[pipelineKey];
+		if (pipeline == nil)
+		{
+			pipeline = [[ZDCSearchPipeline alloc] init];
+			pipelineDict[pipelineKey] = pipeline;
+		}
+		
+		if (pipeline.pendingProgress)
+		{
+			void (^supersededCompletionBlock)(NSArray<ZDCSearchResult*>*, NSError*) = pipeline.pendingCompletionBlock;
+			
+			[pipeline.pendingProgress cancel];
+			pipeline.pendingProgress = nil;
+			pipeline.pendingCompletionBlock = nil;
+			
+			NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+			supersededCompletionBlock(nil, error);
+		}
+		
+		NSArray<ZDCSearchResult*> *refinedResults = [self refineSettledResults:pipeline forQuery:query options:options];
+		if (refinedResults)
+		{
+			completionBlock(refinedResults, nil);
+			return;
+		}
+		
+		NSProgress *progress = [NSProgress discreteProgressWithTotalUnitCount:1];
+		progress.cancellable = YES;
+		
+		pipeline.pendingProgress = progress;
+		pipeline.pendingCompletionBlock = completionBlock;
+		
+		void (^SettleWithResults)(NSArray<ZDCSearchResult*>*, NSError*) =
+		  ^(NSArray<ZDCSearchResult*> *results, NSError *error)
+		{
+			if (pipeline.pendingProgress != progress) {
+				return; // superseded (completionBlock already invoked)
+			}
+			
+			pipeline.pendingProgress = nil;
+			pipeline.pendingCompletionBlock = nil;
+			
+			if (results)
+			{
+				BOOL canRefine = (results.count < SEARCH_SERVER_REFINE_LIMIT);
+				
+				pipeline.settledQuery = canRefine ? query : nil;
+				pipeline.settledProvider = canRefine ? provider : nil;
+				pipeline.settledResults = canRefine ? results : nil;
+			}
+			
+			completionBlock(results, error);
+		};
+		
+		// Check the persistent cache before waiting for the query to settle.
+		// The delay only exists to avoid sending requests to the server, and a cache hit doesn't send one.
+		
+		[self searchResponseCache: query
+		                   treeID: treeID
+		              requesterID: localUserID
+		                  options: options
+		          completionQueue: pipelineQueue
+		          completionBlock:^(NSArray<ZDCSearchResult*> *cachedResults)
+		{
+			if (pipeline.pendingProgress != progress) {
+				return; // superseded while checking the cache
+			}
+			
+			if (cachedResults)
+			{
+				SettleWithResults(cachedResults, nil);
+				return;
+			}
+			
+			dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(SEARCH_SERVER_DEBOUNCE_DELAY * NSEC_PER_SEC));
+			dispatch_after(when, pipelineQueue, ^{ @autoreleasepool {
+				
+				if (pipeline.pendingProgress != progress) {
+					return; // superseded while waiting for the query to settle
+				}
+				
+				[self searchRemoteServer: query
+				                  treeID: treeID
+				             requesterID: localUserID
+				                 options: options
+				                progress: progress
+				         completionQueue: pipelineQueue
+				         completionBlock: SettleWithResults];
+			}});
+		}];
+		
+	#pragma clang diagnostic pop
+	}});
+}
+
+/**
+ * If the query extends the last settled query (and uses the same provider),
+ * then its matches are a subset of the settled results, and can be found without asking the server.
+ *
+ * Returns nil if the settled results can't be used for the given query.
+ */
+- (nullable NSArray<ZDCSearchResult*> *)refineSettledResults:(ZDCSearchPipeline *)pipeline
+                                                    forQuery:(NSString *)query
+                                                     options:(ZDCSearchOptions *)options
+{
+	NSAssert(dispatch_get_specific(IsOnPipelineQueueKey), @"MUST be invoked within the pipelineQueue");
+	
+	NSString *settledQuery = pipeline.settledQuery;
+	if (settledQuery == nil) {
+		return nil;
+	}
+	
+	NSString *provider = options.providerToSearch ?: @"*";
+	if (![provider isEqualToString:pipeline.settledProvider]) {
+		return nil;
+	}
+	
+	NSRange range = [query rangeOfString: settledQuery
+	                             options: NSAnchoredSearch | NSCaseInsensitiveSearch];
+	if (range.location == NSNotFound) {
+		return nil;
+	}
+	
+	NSMutableArray<ZDCSearchResult*> *results = [NSMutableArray array];
+	
+	for (ZDCSearchResult *result in pipeline.settledResults)
+	{
+		NSArray<ZDCSearchMatch*> *matches =
+		  [self matches:query fromIdentities:result.identities withOptions:options];
+		
+		if (matches.count > 0)
+		{
+			[results addObject:[result copyWithMatches:matches]];
+		}
+	}
+	
+	return [results copy];
+}
+
+- (NSString *)searchResponseCacheKey:(NSString *)query
+                              treeID:(NSString *)treeID
+                         requesterID:(NSString *)localUserID
+                             options:(ZDCSearchOptions *)options
+{
+	return [NSString stringWithFormat:@"%@%@|%@|%@|%@",
+		kSearchResponseCacheKeyPrefix, localUserID, treeID, (options.providerToSearch ?: @"*"), query];
+}
+
+- (nullable NSDictionary *)parseSearchResponse:(id)responseObject
+{
+	NSDictionary *responseDict = nil;
+	if ([responseObject isKindOfClass:[NSDictionary class]])
+	{
+		responseDict = (NSDictionary *)responseObject;
+	}
+	else if ([responseObject isKindOfClass:[NSData class]])
+	{
+		NSData *data = (NSData *)responseObject;
+		
+		id value = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+		if ([value isKindOfClass:[NSDictionary class]]) {
+			responseDict = (NSDictionary *)value;
+		}
+	}
+	
+	return responseDict;
+}
+
+- (nullable NSArray<ZDCSearchResult*> *)processSearchResponse:(NSDictionary *)responseDict
+                                                        query:(NSString *)query
+                                                       treeID:(NSString *)treeID
+                                                      options:(ZDCSearchOptions *)options
+{
+	NSArray<ZDCSearchResult*> *results = [self parseSearchResults:responseDict];
+	if (results)
+	{
+		[self cacheServerResults:results forTreeID:treeID];
+		
+		for (ZDCSearchResult *result in results)
+		{
+			result.matches = [self matches:query fromIdentities:result.identities withOptions:options];
+		}
+	}
+	
+	return results;
+}
+
+/**
+ * Checks the persistent cache for a recent response to the same query.
+ * The same query may have been sent recently (possibly during a previous app launch),
+ * in which case we can skip the round-trip to the server.
+ *
+ * The completionBlock is invoked with nil if there's no (valid) cached response.
+ */
+- (void)searchResponseCache:(NSString *)query
+                     treeID:(NSString *)treeID
+                requesterID:(NSString *)localUserID
+                    options:(ZDCSearchOptions *)options
+            completionQueue:(dispatch_queue_t)completionQueue
+            completionBlock:(void (^)(NSArray<ZDCSearchResult*> *_Nullable cachedResults))completionBlock
+{
+	NSParameterAssert(completionQueue != nil);
+	NSParameterAssert(completionBlock != nil);
+	
+	NSString *requestKey = [self searchResponseCacheKey:query treeID:treeID requesterID:localUserID options:options];
+	
+	__block NSData *cachedResponseData = nil;
+	
+	YapDatabaseConnection *roConnection = zdc.databaseManager.roDatabaseConnection;
+	[roConnection asyncReadWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		ZDCCachedResponse *cachedResponse =
+		  [transaction objectForKey:requestKey inCollection:kZDCCollection_CachedResponse];
+		
+		cachedResponseData = cachedResponse.data;
+		
+	} completionQueue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) completionBlock:^{
+		
+		NSArray<ZDCSearchResult*> *cachedResults = nil;
+		if (cachedResponseData)
+		{
+			NSDictionary *responseDict = [self parseSearchResponse:cachedResponseData];
+			if (responseDict) {
+				cachedResults = [self processSearchResponse:responseDict query:query treeID:treeID options:options];
+			}
+		}
+		
+		dispatch_async(completionQueue, ^{ @autoreleasepool {
+			completionBlock(cachedResults);
+		}});
+	}];
+}
+
+/**
+ * Sends the query to the server, and persists the response (for SEARCH_RESPONSE_CACHE_TIMEOUT).
+ * The caller is expected to have checked the persistent cache first.
+ */
 - (void)searchRemoteServer:(NSString *)query
                     treeID:(NSString *)treeID
                requesterID:(NSString *)localUserID
                    options:(ZDCSearchOptions *)options
+                  progress:(NSProgress *)progress
            completionQueue:(dispatch_queue_t)completionQueue
            completionBlock:(void (^)(NSArray<ZDCSearchResult*> *results, NSError *error))completionBlock
 {
+	NSParameterAssert(progress != nil);
 	NSParameterAssert(completionQueue != nil);
 	NSParameterAssert(completionBlock != nil);
 	
@@ -493,7 +1053,18 @@
 		}});
 	};
 	
-  	[zdc.restManager searchUserMatch: query
+	if (progress.cancelled)
+	{
+		NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+		
+		InvokeCompletionBlock(nil, error);
+		return;
+	}
+	
+	NSString *requestKey = [self searchResponseCacheKey:query treeID:treeID requesterID:localUserID options:options];
+	
+	NSProgress *requestProgress =
+	[zdc.restManager searchUserMatch: query
 	                        provider: options.providerToSearch
 	                          treeID: treeID
 	                     requesterID: localUserID
@@ -506,25 +1077,12 @@
 			return;
 		}
 		
-		NSDictionary *responseDict = nil;
-		if ([responseObject isKindOfClass:[NSDictionary class]])
-		{
-			responseDict = (NSDictionary *)responseObject;
-		}
-		else if ([responseObject isKindOfClass:[NSData class]])
-		{
-			NSData *data = (NSData *)responseObject;
-			
-			id value = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
-			if ([value isKindOfClass:[NSDictionary class]]) {
-				responseDict = (NSDictionary *)value;
-			}
-		}
-		
+		NSDictionary *responseDict = [self parseSearchResponse:responseObject];
+	
 		NSArray<ZDCSearchResult*> *results = nil;
 		if (responseDict)
 		{
-			results = [self parseSearchResults:responseDict];
+			results = [self processSearchResponse:responseDict query:query treeID:treeID options:options];
 		}
 		
 		if (results == nil)
@@ -536,15 +1094,33 @@
 			return;
 		}
 		
-		[self cacheServerResults:results forTreeID:treeID];
+		NSData *data = nil;
+		if ([responseObject isKindOfClass:[NSData class]]) {
+			data = (NSData *)responseObject;
+		} else {
+			data = [NSJSONSerialization dataWithJSONObject:responseDict options:0 error:nil];
+		}
 		
-		for (ZDCSearchResult *result in results)
+		if (data)
 		{
-			result.matches = [self matches:query fromIdentities:result.identities withOptions:options];
+			ZDCCachedResponse *cachedResponse =
+			  [[ZDCCachedResponse alloc] initWithData:data timeout:SEARCH_RESPONSE_CACHE_TIMEOUT];
+			
+			YapDatabaseConnection *rwConnection = zdc.databaseManager.rwDatabaseConnection;
+			[rwConnection asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+				
+				[transaction setObject:cachedResponse forKey:requestKey inCollection:kZDCCollection_CachedResponse];
+			}];
 		}
 		
 		InvokeCompletionBlock(results, nil);
 	}];
+	
+	// Cancelling the parent progress (i.e. superseding the query) cancels the data task.
+	[progress addChild:requestProgress withPendingUnitCount:1];
+	if (progress.cancelled) {
+		[requestProgress cancel];
+	}
 }
 
 - (nullable NSArray<ZDCSearchResult *> *)parseSearchResults:(NSDictionary *)responseDict
@@ -679,35 +1255,43 @@
 {
 	NSArray *results = [[NSArray alloc] initWithArray:inResults copyItems:YES];
 	
+	// Extract the searchable strings here, rather than within the (serial) cacheQueue.
+	
+	NSMutableArray<NSSet<NSString*>*> *searchableStrings = [NSMutableArray arrayWithCapacity:results.count];
+	for (ZDCSearchResult *result in results)
+	{
+		NSMutableSet<NSString*> *strings = [NSMutableSet set];
+		for (ZDCUserIdentity *identity in result.identities)
+		{
+			if (!identity.isRecoveryAccount) {
+				[strings unionSet:[self stringsToSearchForIdentity:identity]];
+			}
+		}
+		
+		[searchableStrings addObject:strings];
+	}
+	
 	dispatch_async(cacheQueue, ^{
 	#pragma clang diagnostic push
 	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
 		
-		YapCache *cache = cacheDict[treeID];
+		ZDCSearchResultsCache *cache = cacheDict[treeID];
 		if (cache == nil)
 		{
-			cache = [[YapCache alloc] initWithCountLimit:RESULTS_CACHE_LIMIT];
-			
-		#ifndef NS_BLOCK_ASSERTIONS
-			cache.allowedKeyClasses = [NSSet setWithObject:[NSString class]];
-			cache.allowedObjectClasses = [NSSet setWithObject:[ZDCSearchResult class]];
-		#endif
-			
+			cache = [[ZDCSearchResultsCache alloc] initWithCountLimit:RESULTS_CACHE_LIMIT];
 			cacheDict[treeID] = cache;
 		}
 		
-		for (ZDCSearchResult *result in results)
-		{
-			[cache setObject:result forKey:result.userID];
-		}
+		[results enumerateObjectsUsingBlock:^(ZDCSearchResult *result, NSUInteger idx, BOOL *stop) {
+			
+			[cache addResult:result searchableStrings:searchableStrings[idx]];
+		}];
 		
 	#pragma clang diagnostic pop
 	});
 }
 
-- (NSArray<ZDCSearchMatch*> *)matches:(NSString *)query
-                       fromIdentities:(NSArray<ZDCUserIdentity*> *)identities
-                          withOptions:(ZDCSearchOptions *)options
+- (NSArray<NSString*> *)queryWordsFromQuery:(NSString *)query
 {
 	NSArray<NSString*> *possibleQueryWords =
 	  [query componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
@@ -720,6 +1304,59 @@
 		}
 	}
 	
+	return queryWords;
+}
+
+- (NSSet<NSString*> *)stringsToSearchForIdentity:(ZDCUserIdentity *)identity
+{
+	NSMutableSet *stringsToSearch = [NSMutableSet setWithCapacity:5];
+	
+	[stringsToSearch addObject:identity.displayName];
+	
+	NSDictionary *profileData = identity.profileData;
+	id value;
+	
+	value = profileData[@"email"];
+	if ([value isKindOfClass:[NSString class]])
+	{
+		NSString *email = (NSString *)value;
+		if ([identity.provider isEqualToString:A0StrategyNameAuth0])
+		{
+			email = [Auth0Utilities usernameFrom4thAEmail:email];
+		}
+		[stringsToSearch addObject:email];
+	}
+	
+	value = profileData[@"name"];
+	if ([value isKindOfClass:[NSString class]])
+	{
+		NSString *name = (NSString *)value;
+		[stringsToSearch addObject:name];
+	}
+	
+	value = profileData[@"username"];
+	if ([value isKindOfClass:[NSString class]])
+	{
+		NSString *username = (NSString *)value;
+		[stringsToSearch addObject:username];
+	}
+	
+	value = profileData[@"nickname"];
+	if ([value isKindOfClass:[NSString class]])
+	{
+		NSString *nickname = (NSString *)value;
+		[stringsToSearch addObject:nickname];
+	}
+	
+	return stringsToSearch;
+}
+
+- (NSArray<ZDCSearchMatch*> *)matches:(NSString *)query
+                       fromIdentities:(NSArray<ZDCUserIdentity*> *)identities
+                          withOptions:(ZDCSearchOptions *)options
+{
+	NSArray<NSString*> *queryWords = [self queryWordsFromQuery:query];
+	
 	NSMutableArray<ZDCSearchMatch*> *matches = [NSMutableArray array];
 	
 	for (ZDCUserIdentity *identity in identities)
@@ -733,44 +1370,7 @@
 			continue;
 		}
 		
-		NSMutableSet *stringsToSearch = [NSMutableSet setWithCapacity:5];
-		
-		[stringsToSearch addObject:identity.displayName];
-		
-		NSDictionary *profileData = identity.profileData;
-		id value;
-		
-		value = profileData[@"email"];
-		if ([value isKindOfClass:[NSString class]])
-		{
-			NSString *email = (NSString *)value;
-			if ([identity.provider isEqualToString:A0StrategyNameAuth0])
-			{
-				email = [Auth0Utilities usernameFrom4thAEmail:email];
-			}
-			[stringsToSearch addObject:email];
-		}
-		
-		value = profileData[@"name"];
-		if ([value isKindOfClass:[NSString class]])
-		{
-			NSString *name = (NSString *)value;
-			[stringsToSearch addObject:name];
-		}
-		
-		value = profileData[@"username"];
-		if ([value isKindOfClass:[NSString class]])
-		{
-			NSString *username = (NSString *)value;
-			[stringsToSearch addObject:username];
-		}
-		
-		value = profileData[@"nickname"];
-		if ([value isKindOfClass:[NSString class]])
-		{
-			NSString *nickname = (NSString *)value;
-			[stringsToSearch addObject:nickname];
-		}
+		NSSet<NSString*> *stringsToSearch = [self stringsToSearchForIdentity:identity];
 		
 		for (NSString *string in stringsToSearch)
 		{
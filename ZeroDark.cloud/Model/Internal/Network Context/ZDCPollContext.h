@@ -19,6 +19,18 @@
 
 @property (nonatomic, copy, readwrite) NSString * eTag;
 
+// Ephemeral properties (not encoded):
+
+/**
+ * Set once the first poll has been delayed (by the learned server processing time).
+ */
+@property (atomic, assign, readwrite) BOOL didDelayFirstPoll;
+
+/**
+ * The number of poll requests that have been sent for this context.
+ */
+@property (atomic, assign, readwrite) NSUInteger pollCount;
+
 /**
  * Polling could complete via the poll request itself,
  * or via an arriving push notification.
@@ -26,6 +26,8 @@ static NSString *const k_taskContext  = @"taskContext";
 
 @synthesize taskContext = taskContext;
 @synthesize eTag = eTag;
+@synthesize didDelayFirstPoll = didDelayFirstPoll;
+@synthesize pollCount = pollCount;
 
 - (id)initWithCoder:(NSCoder *)decoder
 {
@@ -53,6 +55,8 @@ static NSString *const k_taskContext  = @"taskContext";
 	
 	copy->taskContext = [taskContext copy];
 	copy->eTag = eTag;
+	copy->didDelayFirstPoll = didDelayFirstPoll;
+	copy->pollCount = pollCount;
 	
 	return copy;
 }
@@ -0,0 +1,133 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+@class ZDCNode;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A lightweight subset of a ZDCNode's properties.
+ *
+ * One of these is stored (in kZDCCollection_NodeMeta) for every node,
+ * and is kept up-to-date by the `Ext_Hooks_NodeMeta` extension.
+ *
+ * The node views & indexes use it instead of the full node, which means that when they need to
+ * fetch other rows (e.g. to compare against neighbors while sorting), they don't have to
+ * decode share lists, encryption keys, etc.
+ *
+ * The ZDCNodeMeta class is immutable.
+ */
+@interface ZDCNodeMeta : NSObject <NSCoding, NSCopying>
+
+/**
+ * Creates the meta for the given node.
+ *
+ * @param node
+ *   The node to extract the properties from.
+ *
+ * @param treeID
+ *   The treeID of the node's trunk, or nil if the node isn't attached to a trunk.
+ */
+- (instancetype)initWithNode:(ZDCNode *)node treeID:(nullable NSString *)treeID;
+
+/** Corresponds to `-[ZDCNode uuid]` */
+@property (nonatomic, copy, readonly) NSString *nodeID;
+
+/** Corresponds to `-[ZDCNode localUserID]` */
+@property (nonatomic, copy, readonly) NSString *localUserID;
+
+/** The treeID of the node's trunk (or nil if the node isn't attached to a trunk) */
+@property (nonatomic, copy, readonly, nullable) NSString *treeID;
+
+/** Corresponds to `-[ZDCNode parentID]` */
+@property (nonatomic, copy, readonly, nullable) NSString *parentID;
+
+/** Corresponds to `-[ZDCNode name]` */
+@property (nonatomic, copy, readonly, nullable) NSString *name;
+
+/**
+ * A sort key for the name, such that comparing 2 keys (bytewise) gives the same result as
+ * `-[NSString localizedCaseInsensitiveCompare:]` would for the 2 names.
+ *
+ * This is only available for names consisting of ASCII letters & digits. Other names return nil.
+ * Also, some locales tailor the ordering of ASCII characters, in which case the key isn't used.
+ * See `+[ZDCNodeMeta canUseCollationKeys]`.
+ *
+ * The key is derived from the name (it isn't stored).
+ */
+@property (nonatomic, copy, readonly, nullable) NSData *collationKey;
+
+/** Corresponds to `-[ZDCNode explicitCloudName]` */
+@property (nonatomic, copy, readonly, nullable) NSString *explicitCloudName;
+
+/** Corresponds to `-[ZDCNode dirSalt]` */
+@property (nonatomic, copy, readonly, nullable) NSData *dirSalt;
+
+/** Corresponds to `-[ZDCNode cloudID]` */
+@property (nonatomic, copy, readonly, nullable) NSString *cloudID;
+
+/** Corresponds to `-[ZDCNode dirPrefix]` */
+@property (nonatomic, copy, readonly, nullable) NSString *dirPrefix;
+
+/** Corresponds to `-[ZDCNode pointeeID]` */
+@property (nonatomic, copy, readonly, nullable) NSString *pointeeID;
+
+/**
+ * Returns the collationKey for the given name (see `collationKey`), or nil if the name doesn't qualify.
+ */
++ (nullable NSData *)collationKeyForName:(nullable NSString *)name;
+
+/**
+ * Returns NO if the current locale tailors the ordering of ASCII characters (e.g. Danish "aa"),
+ * in which case the collationKey doesn't match `localizedCaseInsensitiveCompare:`.
+ */
++ (BOOL)canUseCollationKeys;
+
+/**
+ * Same as `canUseCollationKeys`, but for the given locale (instead of the current locale).
+ */
++ (BOOL)canUseCollationKeysForLocale:(NSLocale *)locale;
+
+/**
+ * Compares 2 collationKeys.
+ * For a locale that passes `canUseCollationKeysForLocale:`, the result matches
+ * a case insensitive compare of the corresponding names in that locale.
+ */
++ (NSComparisonResult)compareCollationKey:(NSData *)key1 withCollationKey:(NSData *)key2;
+
+/**
+ * The name comparison used by Ext_View_Treesystem_Name, for both sorting & searching.
+ *
+ * The result is always the same as `localizedCaseInsensitiveCompare:` (with nil treated as an empty string),
+ * but it's faster when both names have a collationKey.
+ *
+ * Anything that binary searches the view must use this (or one of the instance methods below),
+ * so that it agrees with the view's sort order.
+ */
++ (NSComparisonResult)compareName:(nullable NSString *)name1
+                     collationKey:(nullable NSData *)key1
+                         withName:(nullable NSString *)name2
+                     collationKey:(nullable NSData *)key2;
+
+/**
+ * Compares the names of the 2 metas. (Used for sorting Ext_View_Treesystem_Name.)
+ */
+- (NSComparisonResult)compareName:(ZDCNodeMeta *)another;
+
+/**
+ * Compares this meta's name with the given name. (Used for searching Ext_View_Treesystem_Name.)
+ * Pass the result of `collationKeyForName:` as the key, to avoid re-deriving it for every comparison.
+ */
+- (NSComparisonResult)compareName:(nullable NSString *)name collationKey:(nullable NSData *)collationKey;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,304 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCNodeMeta.h"
+
+#import "ZDCNode.h"
+
+#import <YapDatabase/YapDatabaseCloudCoreOperationPrivate.h> // for YDB_IsEqualOrBothNil
+
+// Encoding/Decoding Keys
+
+static int const kCurrentVersion = 0;
+#pragma unused(kCurrentVersion)
+
+static NSString *const k_version           = @"version";
+static NSString *const k_nodeID            = @"nodeID";
+static NSString *const k_localUserID       = @"localUserID";
+static NSString *const k_treeID            = @"treeID";
+static NSString *const k_parentID          = @"parentID";
+static NSString *const k_name              = @"name";
+static NSString *const k_explicitCloudName = @"explicitCloudName";
+static NSString *const k_dirSalt           = @"dirSalt";
+static NSString *const k_cloudID           = @"cloudID";
+static NSString *const k_dirPrefix         = @"dirPrefix";
+static NSString *const k_pointeeID         = @"pointeeID";
+
+
+@implementation ZDCNodeMeta
+
+@synthesize nodeID = nodeID;
+@synthesize localUserID = localUserID;
+@synthesize treeID = treeID;
+@synthesize parentID = parentID;
+@synthesize name = name;
+@synthesize collationKey = collationKey;
+@synthesize explicitCloudName = explicitCloudName;
+@synthesize dirSalt = dirSalt;
+@synthesize cloudID = cloudID;
+@synthesize dirPrefix = dirPrefix;
+@synthesize pointeeID = pointeeID;
+
+- (instancetype)initWithNode:(ZDCNode *)node treeID:(nullable NSString *)inTreeID
+{
+	if ((self = [super init]))
+	{
+		nodeID = [node.uuid copy];
+		localUserID = [node.localUserID copy];
+		treeID = [inTreeID copy];
+		parentID = [node.parentID copy];
+		name = [node.name copy];
+		collationKey = [ZDCNodeMeta collationKeyForName:name];
+		explicitCloudName = [node.explicitCloudName copy];
+		dirSalt = [node.dirSalt copy];
+		cloudID = [node.cloudID copy];
+		dirPrefix = [node.dirPrefix copy];
+		pointeeID = [node.pointeeID copy];
+	}
+	return self;
+}
+
+#pragma mark NSCoding
+
+- (id)initWithCoder:(NSCoder *)decoder
+{
+	if ((self = [super init]))
+	{
+		nodeID = [decoder decodeObjectForKey:k_nodeID];
+		localUserID = [decoder decodeObjectForKey:k_localUserID];
+		treeID = [decoder decodeObjectForKey:k_treeID];
+		parentID = [decoder decodeObjectForKey:k_parentID];
+		name = [decoder decodeObjectForKey:k_name];
+		collationKey = [ZDCNodeMeta collationKeyForName:name]; // ignore stored key (may predate current table)
+		explicitCloudName = [decoder decodeObjectForKey:k_explicitCloudName];
+		dirSalt = [decoder decodeObjectForKey:k_dirSalt];
+		cloudID = [decoder decodeObjectForKey:k_cloudID];
+		dirPrefix = [decoder decodeObjectForKey:k_dirPrefix];
+		pointeeID = [decoder decodeObjectForKey:k_pointeeID];
+	}
+	return self;
+}
+
+- (void)encodeWithCoder:(NSCoder *)coder
+{
+	if (kCurrentVersion != 0) {
+		[coder encodeInt:kCurrentVersion forKey:k_version];
+	}
+	
+	[coder encodeObject:nodeID forKey:k_nodeID];
+	[coder encodeObject:localUserID forKey:k_localUserID];
+	[coder encodeObject:treeID forKey:k_treeID];
+	[coder encodeObject:parentID forKey:k_parentID];
+	[coder encodeObject:name forKey:k_name];
+	[coder encodeObject:explicitCloudName forKey:k_explicitCloudName];
+	[coder encodeObject:dirSalt forKey:k_dirSalt];
+	[coder encodeObject:cloudID forKey:k_cloudID];
+	[coder encodeObject:dirPrefix forKey:k_dirPrefix];
+	[coder encodeObject:pointeeID forKey:k_pointeeID];
+}
+
+#pragma mark NSCopying
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	return self; // immutable class
+}
+
+#pragma mark Equality
+
+- (BOOL)isEqual:(id)another
+{
+	if (![another isKindOfClass:[ZDCNodeMeta class]]) return NO;
+	
+	return [self isEqualToMeta:(ZDCNodeMeta *)another];
+}
+
+- (BOOL)isEqualToMeta:(ZDCNodeMeta *)another
+{
+	if (!YDB_IsEqualOrBothNil(nodeID, another->nodeID)) return NO;
+	if (!YDB_IsEqualOrBothNil(localUserID, another->localUserID)) return NO;
+	if (!YDB_IsEqualOrBothNil(treeID, another->treeID)) return NO;
+	if (!YDB_IsEqualOrBothNil(parentID, another->parentID)) return NO;
+	if (!YDB_IsEqualOrBothNil(name, another->name)) return NO;
+	if (!YDB_IsEqualOrBothNil(explicitCloudName, another->explicitCloudName)) return NO;
+	if (!YDB_IsEqualOrBothNil(dirSalt, another->dirSalt)) return NO;
+	if (!YDB_IsEqualOrBothNil(cloudID, another->cloudID)) return NO;
+	if (!YDB_IsEqualOrBothNil(dirPrefix, another->dirPrefix)) return NO;
+	if (!YDB_IsEqualOrBothNil(pointeeID, another->pointeeID)) return NO;
+	
+	return YES; // collationKey is derived from name
+}
+
+- (NSUInteger)hash
+{
+	return [nodeID hash];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Collation
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Maps each ASCII letter & digit to its primary weight in the root collation.
+ * Upper & lower case letters share the same weight (i.e. case insensitive).
+ *
+ * Only letters & digits are mapped, since their relative order is the same in every collation we allow
+ * (see `canUseCollationKeys`), and they have no secondary differences.
+ * Whitespace, punctuation & symbols are handled differently by various collations (variable weighting),
+ * so names containing them don't get a key.
+ *
+ * A weight of zero means the character isn't mapped.
+ */
+static uint8_t CollationTable[128];
+
+static void CollationTableInit(void)
+{
+	uint8_t weight = 1;
+	for (char c = '0'; c <= '9'; c++)
+	{
+		CollationTable[(uint8_t)c] = weight++;
+	}
+	
+	for (char c = 'a'; c <= 'z'; c++)
+	{
+		CollationTable[(uint8_t)c] = weight;
+		CollationTable[(uint8_t)(c - 'a' + 'A')] = weight;
+		weight++;
+	}
+}
+
++ (void)initialize
+{
+	static BOOL initialized = NO;
+	if (!initialized)
+	{
+		initialized = YES;
+		CollationTableInit();
+	}
+}
+
+/**
+ * See header file for description.
+ */
++ (nullable NSData *)collationKeyForName:(nullable NSString *)name
+{
+	if (name == nil) return nil;
+	
+	NSUInteger length = name.length;
+	NSMutableData *key = [NSMutableData dataWithLength:length];
+	uint8_t *keyBytes = (uint8_t *)key.mutableBytes;
+	
+	for (NSUInteger i = 0; i < length; i++)
+	{
+		unichar c = [name characterAtIndex:i];
+		
+		uint8_t weight = (c < 128) ? CollationTable[c] : 0;
+		if (weight == 0) {
+			return nil; // not an ASCII letter or digit
+		}
+		
+		keyBytes[i] = weight;
+	}
+	
+	return key;
+}
+
+/**
+ * See header file for description.
+ */
++ (BOOL)canUseCollationKeys
+{
+	static BOOL canUseCollationKeys = NO;
+	
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		
+		canUseCollationKeys = [self canUseCollationKeysForLocale:[NSLocale currentLocale]];
+	});
+	
+	return canUseCollationKeys;
+}
+
+/**
+ * See header file for description.
+ */
++ (BOOL)canUseCollationKeysForLocale:(NSLocale *)locale
+{
+	// Languages whose default collation doesn't tailor any ASCII characters.
+	// (e.g. Danish & Norwegian sort "aa" after "z", Lithuanian sorts "y" with "i", etc)
+	//
+	NSSet<NSString*> *untailored = [NSSet setWithObjects:
+	  @"en", @"de", @"fr", @"it", @"pt", @"nl", @"es", @"ja", @"ko", @"zh", @"ru", nil];
+	
+	NSString *languageCode = [locale objectForKey:NSLocaleLanguageCode];
+	return (languageCode != nil) && [untailored containsObject:languageCode];
+}
+
+/**
+ * See header file for description.
+ */
++ (NSComparisonResult)compareCollationKey:(NSData *)key1 withCollationKey:(NSData *)key2
+{
+	NSUInteger len1 = key1.length;
+	NSUInteger len2 = key2.length;
+	
+	int cmp = memcmp(key1.bytes, key2.bytes, MIN(len1, len2));
+	
+	if (cmp < 0) return NSOrderedAscending;
+	if (cmp > 0) return NSOrderedDescending;
+	
+	if (len1 < len2) return NSOrderedAscending;
+	if (len1 > len2) return NSOrderedDescending;
+	
+	return NSOrderedSame;
+}
+
+/**
+ * See header file for description.
+ */
++ (NSComparisonResult)compareName:(nullable NSString *)name1
+                     collationKey:(nullable NSData *)key1
+                         withName:(nullable NSString *)name2
+                     collationKey:(nullable NSData *)key2
+{
+	// The collationKey is only a shortcut:
+	// Comparing 2 keys gives the exact same result as `localizedCaseInsensitiveCompare:` would for the 2 names.
+	// So this is a single (transitive) ordering, regardless of which names have keys.
+	
+	if (key1 && key2 && [ZDCNodeMeta canUseCollationKeys])
+	{
+		return [ZDCNodeMeta compareCollationKey:key1 withCollationKey:key2];
+	}
+	
+	return [(name1 ?: @"") localizedCaseInsensitiveCompare:(name2 ?: @"")];
+}
+	
+/**
+ * See header file for description.
+ */
+- (NSComparisonResult)compareName:(ZDCNodeMeta *)another
+{
+	return [ZDCNodeMeta compareName: name
+	                   collationKey: collationKey
+	                       withName: another->name
+	                   collationKey: another->collationKey];
+}
+
+/**
+ * See header file for description.
+ */
+- (NSComparisonResult)compareName:(nullable NSString *)anotherName collationKey:(nullable NSData *)anotherKey
+{
+	return [ZDCNodeMeta compareName: name
+	                   collationKey: collationKey
+	                       withName: anotherName
+	                   collationKey: anotherKey];
+}
+
+@end
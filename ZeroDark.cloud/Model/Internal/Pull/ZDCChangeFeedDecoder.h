@@ -0,0 +1,63 @@
+#import <Foundation/Foundation.h>
+
+#import "ZDCChangeItem.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Decodes the response from the `/pull/{change_token}` API directly into ZDCChangeItem's.
+ *
+ * The response looks like this:
+ * {
+ *   "latest_change_token": "...",
+ *   "changes": [ {change}, {change}, ... ]
+ * }
+ *
+ * The body can be fed to the decoder in chunks, as they arrive from the network.
+ * Each change is converted to a ZDCChangeItem as soon as its closing brace arrives,
+ * so the full response is never materialized as a dictionary of arrays of dictionaries.
+ * Unknown top-level keys are skipped.
+ */
+@interface ZDCChangeFeedDecoder : NSObject
+
+/**
+ * Convenience method for decoding a complete response.
+ */
++ (ZDCChangeFeedDecoder *)decodeData:(NSData *)data;
+
+/**
+ * Feeds the next chunk of the response body to the decoder.
+ *
+ * @return
+ *   NO if the response is malformed (see `error`).
+ */
+- (BOOL)appendData:(NSData *)data;
+
+/**
+ * Must be invoked after the last chunk has been appended.
+ * It's safe to invoke this method multiple times.
+ *
+ * @return
+ *   YES if the response was a complete JSON document.
+ */
+- (BOOL)finish;
+
+/**
+ * The value of `latest_change_token` (if present, and a string).
+ */
+@property (nonatomic, readonly, nullable) NSString *latestChangeToken;
+
+/**
+ * The successfully parsed changes, in order.
+ * (Entries rejected by `+[ZDCChangeItem parseChangeInfo:]` are omitted.)
+ */
+@property (nonatomic, readonly) NSArray<ZDCChangeItem *> *changes;
+
+/**
+ * Non-nil if the response was malformed.
+ */
+@property (nonatomic, readonly, nullable) NSError *error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,159 @@
+#import "ZDCChangeFeedDecoder.h"
+
+#import "ZDCJSONStreamDecoder.h"
+
+static NSString *const k_latestChangeToken = @"latest_change_token";
+static NSString *const k_changes           = @"changes";
+
+/**
+ * Depths (as reported by ZDCJSONStreamDecoder) of the interesting parts of the response:
+ *
+ * { <- 1
+ *   "changes": [ <- 2
+ *     { <- 3
+ *       "id": ...
+ */
+#define DEPTH_ROOT    1
+#define DEPTH_CHANGES 2
+#define DEPTH_ITEM    3
+
+@interface ZDCChangeFeedDecoder () <ZDCJSONStreamDecoderDelegate>
+@end
+
+@implementation ZDCChangeFeedDecoder {
+	
+	ZDCJSONStreamDecoder *decoder;
+	
+	NSString *rootKey;
+	BOOL inChanges;
+	
+	NSMutableDictionary *item;
+	NSString *itemKey;
+	
+	NSMutableArray<ZDCChangeItem *> *changes;
+}
+
+@synthesize latestChangeToken = latestChangeToken;
+@synthesize changes = changes;
+
++ (ZDCChangeFeedDecoder *)decodeData:(NSData *)data
+{
+	ZDCChangeFeedDecoder *feedDecoder = [[ZDCChangeFeedDecoder alloc] init];
+	
+	[feedDecoder appendData:data];
+	[feedDecoder finish];
+	
+	return feedDecoder;
+}
+
+- (instancetype)init
+{
+	if ((self = [super init]))
+	{
+		decoder = [[ZDCJSONStreamDecoder alloc] initWithDelegate:self];
+		changes = [[NSMutableArray alloc] init];
+	}
+	return self;
+}
+
+- (BOOL)appendData:(NSData *)data
+{
+	return [decoder appendData:data];
+}
+
+- (BOOL)finish
+{
+	return [decoder finish];
+}
+
+- (NSError *)error
+{
+	return decoder.error;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark ZDCJSONStreamDecoderDelegate
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)jsonDecoderDidBeginObject:(ZDCJSONStreamDecoder *)sender
+{
+	if (inChanges && sender.depth == DEPTH_ITEM)
+	{
+		item = [[NSMutableDictionary alloc] initWithCapacity:12];
+	}
+}
+
+- (void)jsonDecoderDidEndObject:(ZDCJSONStreamDecoder *)sender
+{
+	if (item && sender.depth == DEPTH_CHANGES)
+	{
+		ZDCChangeItem *change = [ZDCChangeItem parseChangeInfo:item];
+		if (change) {
+			[changes addObject:change];
+		}
+		
+		item = nil;
+		itemKey = nil;
+	}
+}
+
+- (void)jsonDecoderDidBeginArray:(ZDCJSONStreamDecoder *)sender
+{
+	if (sender.depth == DEPTH_CHANGES && [rootKey isEqualToString:k_changes])
+	{
+		inChanges = YES;
+	}
+}
+
+- (void)jsonDecoderDidEndArray:(ZDCJSONStreamDecoder *)sender
+{
+	if (inChanges && sender.depth == DEPTH_ROOT)
+	{
+		inChanges = NO;
+	}
+}
+
+- (void)jsonDecoder:(ZDCJSONStreamDecoder *)sender didDecodeKey:(NSString *)key
+{
+	NSUInteger depth = sender.depth;
+	
+	if (depth == DEPTH_ROOT)
+	{
+		rootKey = key;
+		
+		if (![key isEqualToString:k_latestChangeToken] && ![key isEqualToString:k_changes])
+		{
+			[sender skipValue];
+		}
+	}
+	else if (item && depth == DEPTH_ITEM)
+	{
+		// Change items are flat. But if the server ever adds a nested value,
+		// we want to preserve it (the item is stored in the database as-is).
+		
+		itemKey = key;
+		[sender captureValue];
+	}
+}
+
+- (void)jsonDecoder:(ZDCJSONStreamDecoder *)sender didDecodeValue:(id)value
+{
+	NSUInteger depth = sender.depth;
+	
+	if (item && depth == DEPTH_ITEM)
+	{
+		if (itemKey) {
+			item[itemKey] = value;
+		}
+		itemKey = nil;
+	}
+	else if (depth == DEPTH_ROOT)
+	{
+		if ([rootKey isEqualToString:k_latestChangeToken] && [value isKindOfClass:[NSString class]])
+		{
+			latestChangeToken = (NSString *)value;
+		}
+	}
+}
+
+@end
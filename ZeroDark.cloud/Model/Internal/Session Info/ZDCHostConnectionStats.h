@@ -0,0 +1,37 @@
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A snapshot of the connection statistics for a single host (e.g. an S3 bucket, or the API gateway).
+ *
+ * The MetricsManager gathers these from the NSURLSessionTaskMetrics of every completed task.
+ */
+@interface ZDCHostConnectionStats : NSObject <NSCopying>
+
+- (instancetype)initWithHost:(NSString *)host;
+
+/** The host these stats apply to. */
+@property (nonatomic, copy, readonly) NSString *host;
+
+/** The total number of request/response transactions (includes redirects & auth retries). */
+@property (nonatomic, assign, readwrite) uint64_t requestCount;
+
+/** The number of transactions that were sent over an already open connection. */
+@property (nonatomic, assign, readwrite) uint64_t reusedConnectionCount;
+
+/** The number of transactions that required a new TLS handshake. */
+@property (nonatomic, assign, readwrite) uint64_t tlsHandshakeCount;
+
+/** The number of transactions that were multiplexed over HTTP/2. */
+@property (nonatomic, assign, readwrite) uint64_t http2Count;
+
+/** reusedConnectionCount / requestCount (or zero if there haven't been any requests). */
+@property (nonatomic, readonly) double reuseRatio;
+
+/** A JSON compatible representation of the stats. */
+- (NSDictionary<NSString*, id> *)dictionaryRepresentation;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,58 @@
+#import "ZDCHostConnectionStats.h"
+
+
+@implementation ZDCHostConnectionStats
+
+@synthesize host = host;
+@synthesize requestCount = requestCount;
+@synthesize reusedConnectionCount = reusedConnectionCount;
+@synthesize tlsHandshakeCount = tlsHandshakeCount;
+@synthesize http2Count = http2Count;
+
+- (instancetype)initWithHost:(NSString *)inHost
+{
+	if ((self = [super init]))
+	{
+		host = [inHost copy];
+	}
+	return self;
+}
+
+- (double)reuseRatio
+{
+	if (requestCount == 0) return 0.0;
+	
+	return (double)reusedConnectionCount / (double)requestCount;
+}
+
+- (NSDictionary<NSString*, id> *)dictionaryRepresentation
+{
+	return @{
+		@"requests"    : @(requestCount),
+		@"reused"      : @(reusedConnectionCount),
+		@"tls"         : @(tlsHandshakeCount),
+		@"h2"          : @(http2Count),
+		@"reuse_ratio" : @(self.reuseRatio)
+	};
+}
+
+- (instancetype)copyWithZone:(NSZone *)zone
+{
+	ZDCHostConnectionStats *copy = [[[self class] alloc] initWithHost:host];
+	
+	copy->requestCount = requestCount;
+	copy->reusedConnectionCount = reusedConnectionCount;
+	copy->tlsHandshakeCount = tlsHandshakeCount;
+	copy->http2Count = http2Count;
+	
+	return copy;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:
+	  @"<ZDCHostConnectionStats: %@ requests=%llu reused=%llu tls=%llu h2=%llu>",
+	  host, requestCount, reusedConnectionCount, tlsHandshakeCount, http2Count];
+}
+
+@end
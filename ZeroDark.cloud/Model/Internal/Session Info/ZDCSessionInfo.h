@@ -6,8 +6,8 @@
 /**
  * Stores the network session(s) associated with a particular user.
  *
- * Each localUser gets their own network session.
- * On iOS, there are are actually two sessions per user: background & foreground session.
+ * The foreground session (or `session` on macOS) is shared by all users.
+ * On iOS, each user also has their own background session.
  */
 @interface ZDCSessionInfo : NSObject <NSCopying>
 
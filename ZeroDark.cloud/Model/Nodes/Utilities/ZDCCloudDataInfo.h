@@ -58,6 +58,23 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, assign, readonly) uint64_t thumbnailxxHash64;
 
+/**
+ * The byte range of each section within the cloud's data file.
+ *
+ * The encryption doesn't change the size of a section, so these ranges apply to the encrypted file as well.
+ * A section that isn't present has a zero-length range.
+ *
+ * @note To decrypt a section, the request must start on a tweak block boundary,
+ *       and its length must be a multiple of the encryption key length.
+ */
+@property (nonatomic, readonly) NSRange metadataRange;
+
+/** The byte range of the thumbnail section within the cloud's data file. (See `metadataRange`.) */
+@property (nonatomic, readonly) NSRange thumbnailRange;
+
+/** The byte range of the data section within the cloud's data file. (See `metadataRange`.) */
+@property (nonatomic, readonly) NSRange dataRange;
+
 /** The server's eTag value for the DATA file. */
 @property (nonatomic, copy, readonly) NSString *eTag;
 
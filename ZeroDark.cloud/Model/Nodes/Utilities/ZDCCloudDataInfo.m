@@ -31,6 +31,10 @@ static NSString *const k_lastModified      = @"lastModified";
 @synthesize eTag = eTag;
 @synthesize lastModified = lastModified;
 
+@dynamic metadataRange;
+@dynamic thumbnailRange;
+@dynamic dataRange;
+
 - (instancetype)initWithCloudFileHeader:(ZDCCloudFileHeader)header
                                    eTag:(NSString *)inETag
                            lastModified:(NSDate *)inLastModified
@@ -106,6 +110,30 @@ static NSString *const k_lastModified      = @"lastModified";
 #pragma mark Utilities
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+- (NSRange)metadataRange
+{
+	return (NSRange){
+		.location = (NSUInteger)sizeof(ZDCCloudFileHeader),
+		.length = (NSUInteger)metadataSize
+	};
+}
+
+- (NSRange)thumbnailRange
+{
+	return (NSRange){
+		.location = NSMaxRange(self.metadataRange),
+		.length = (NSUInteger)thumbnailSize
+	};
+}
+
+- (NSRange)dataRange
+{
+	return (NSRange){
+		.location = NSMaxRange(self.thumbnailRange),
+		.length = (NSUInteger)dataSize
+	};
+}
+
 - (ZDCCloudFileHeader)rawHeader
 {
 	ZDCCloudFileHeader header;
@@ -0,0 +1,67 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Aggregate statistics for all the descendants of a node (not including the node itself).
+ *
+ * These are maintained automatically by the framework, and are updated as nodes are inserted, modified & removed.
+ * Which means you can get the stats for a very large subtree, without having to enumerate it.
+ *
+ * The ZDCNodeStats class is immutable.
+ */
+@interface ZDCNodeStats : NSObject <NSCoding, NSCopying>
+
+/**
+ * Creates a new instance using the given properties.
+ */
+- (instancetype)initWithDescendantCount:(uint64_t)descendantCount
+                         totalCloudSize:(uint64_t)totalCloudSize
+                     pendingUploadCount:(uint64_t)pendingUploadCount
+                           lastModified:(nullable NSDate *)lastModified;
+
+/**
+ * The total number of descendants (children, grandchildren, etc).
+ */
+@property (nonatomic, assign, readonly) uint64_t descendantCount;
+
+/**
+ * The sum of the cloud DATA file sizes (metadata + thumbnail + data) of all descendants.
+ * Only includes nodes for which the cloudDataInfo is known.
+ */
+@property (nonatomic, assign, readonly) uint64_t totalCloudSize;
+
+/**
+ * The number of descendants with a queued upload (i.e. a pending put operation in the push queue).
+ * This includes new nodes that haven't been uploaded yet, as well as modified nodes.
+ */
+@property (nonatomic, assign, readonly) uint64_t pendingUploadCount;
+
+/**
+ * The most recent `node.lastModified` value of all descendants.
+ *
+ * @note This value only ever moves forward.
+ *       Removing the most recently modified descendant doesn't cause it to revert to an earlier date.
+ */
+@property (nonatomic, copy, readonly, nullable) NSDate *lastModified;
+
+/**
+ * Returns a new instance with the given deltas applied.
+ */
+- (ZDCNodeStats *)statsByAddingDescendantCount:(int64_t)descendantCountDelta
+                                totalCloudSize:(int64_t)totalCloudSizeDelta
+                            pendingUploadCount:(int64_t)pendingUploadCountDelta
+                                  lastModified:(nullable NSDate *)lastModified;
+
+@end
+
+NS_ASSUME_NONNULL_END
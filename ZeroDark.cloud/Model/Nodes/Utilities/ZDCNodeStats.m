@@ -0,0 +1,115 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCNodeStats.h"
+
+#import "NSDate+ZeroDark.h"
+
+// Encoding/Decoding Keys
+
+static int const kCurrentVersion = 0;
+#pragma unused(kCurrentVersion)
+
+static NSString *const k_version            = @"version";
+static NSString *const k_descendantCount    = @"descendantCount";
+static NSString *const k_totalCloudSize     = @"totalCloudSize";
+static NSString *const k_pendingUploadCount = @"pendingUploadCount";
+static NSString *const k_lastModified       = @"lastModified";
+
+
+@implementation ZDCNodeStats
+
+@synthesize descendantCount = descendantCount;
+@synthesize totalCloudSize = totalCloudSize;
+@synthesize pendingUploadCount = pendingUploadCount;
+@synthesize lastModified = lastModified;
+
+- (instancetype)init
+{
+	return [self initWithDescendantCount:0 totalCloudSize:0 pendingUploadCount:0 lastModified:nil];
+}
+
+- (instancetype)initWithDescendantCount:(uint64_t)inDescendantCount
+                         totalCloudSize:(uint64_t)inTotalCloudSize
+                     pendingUploadCount:(uint64_t)inPendingUploadCount
+                           lastModified:(nullable NSDate *)inLastModified
+{
+	if ((self = [super init]))
+	{
+		descendantCount = inDescendantCount;
+		totalCloudSize = inTotalCloudSize;
+		pendingUploadCount = inPendingUploadCount;
+		lastModified = [inLastModified copy];
+	}
+	return self;
+}
+
+#pragma mark NSCoding
+
+- (id)initWithCoder:(NSCoder *)decoder
+{
+	if ((self = [super init]))
+	{
+		descendantCount = (uint64_t)[decoder decodeInt64ForKey:k_descendantCount];
+		totalCloudSize = (uint64_t)[decoder decodeInt64ForKey:k_totalCloudSize];
+		pendingUploadCount = (uint64_t)[decoder decodeInt64ForKey:k_pendingUploadCount];
+		lastModified = [decoder decodeObjectForKey:k_lastModified];
+	}
+	return self;
+}
+
+- (void)encodeWithCoder:(NSCoder *)coder
+{
+	if (kCurrentVersion != 0) {
+		[coder encodeInt:kCurrentVersion forKey:k_version];
+	}
+	
+	[coder encodeInt64:(int64_t)descendantCount forKey:k_descendantCount];
+	[coder encodeInt64:(int64_t)totalCloudSize forKey:k_totalCloudSize];
+	[coder encodeInt64:(int64_t)pendingUploadCount forKey:k_pendingUploadCount];
+	[coder encodeObject:lastModified forKey:k_lastModified];
+}
+
+#pragma mark NSCopying
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	return self; // immutable class
+}
+
+#pragma mark Logic
+
+static uint64_t ApplyDelta(uint64_t value, int64_t delta)
+{
+	if (delta < 0 && (uint64_t)(-delta) > value) {
+		return 0; // defensive: never underflow
+	}
+	return (uint64_t)((int64_t)value + delta);
+}
+
+/**
+ * See header file for description.
+ */
+- (ZDCNodeStats *)statsByAddingDescendantCount:(int64_t)descendantCountDelta
+                                totalCloudSize:(int64_t)totalCloudSizeDelta
+                            pendingUploadCount:(int64_t)pendingUploadCountDelta
+                                  lastModified:(nullable NSDate *)inLastModified
+{
+	NSDate *newLastModified = lastModified;
+	if (inLastModified && (newLastModified == nil || [inLastModified isAfter:newLastModified])) {
+		newLastModified = inLastModified;
+	}
+	
+	return [[ZDCNodeStats alloc] initWithDescendantCount: ApplyDelta(descendantCount, descendantCountDelta)
+	                                      totalCloudSize: ApplyDelta(totalCloudSize, totalCloudSizeDelta)
+	                                  pendingUploadCount: ApplyDelta(pendingUploadCount, pendingUploadCountDelta)
+	                                        lastModified: newLastModified];
+}
+
+@end
@@ -5,6 +5,7 @@
 #import "ZDCConstants.h"
 #import "ZDCInterruptingInputStream.h"
 #import "ZDCLogging.h"
+#import "ZDCMetricsManagerPrivate.h"
 
 #import "NSError+POSIX.h"
 #import "NSError+S4.h"
@@ -780,6 +781,8 @@ typedef NS_ENUM(NSInteger, S4CacheFileEncryptState) {
 	
 	NSUInteger bytesEncrypted = 0;
 
+	uint64_t cryptoStartTime = ZDCMetricsNow();
+	
 	while ((bytesEncrypted < inBufferLength) && ((inBufferLength - bytesEncrypted) >= keyLength))
 	{
 		// Set/Reset Tweakable Block Cipher (TBC) if:
@@ -853,6 +856,10 @@ typedef NS_ENUM(NSInteger, S4CacheFileEncryptState) {
 		}
 	}
 	
+	if (bytesEncrypted > 0) {
+		[ZDCMetricsManager recordEncryptedBytes:bytesEncrypted duration:(ZDCMetricsNow() - cryptoStartTime)];
+	}
+	
 	// Check for leftover bytes in the 'inBuffer' that we couldn't encrypt.
 	// For example:
 	//
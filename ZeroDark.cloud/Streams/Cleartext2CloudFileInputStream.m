@@ -5,6 +5,7 @@
 #import "ZDCCloudFileHeader.h"
 #import "ZDCInterruptingInputStream.h"
 #import "ZDCLogging.h"
+#import "ZDCMetricsManagerPrivate.h"
 #import "ZDCNode.h"
 
 #import "NSData+S4.h"
@@ -1162,6 +1163,8 @@ typedef NS_ENUM(NSInteger, ZDCCloudFileEncryptState) {
 	
 	NSUInteger bytesEncrypted = 0;
 
+	uint64_t cryptoStartTime = ZDCMetricsNow();
+	
 	while ((bytesEncrypted < inBufferLength) && ((inBufferLength - bytesEncrypted) >= keyLength))
 	{
 		// Set/Reset Tweakable Block Cipher (TBC) if:
@@ -1262,6 +1265,10 @@ typedef NS_ENUM(NSInteger, ZDCCloudFileEncryptState) {
 		}
 	}
 	
+	if (bytesEncrypted > 0) {
+		[ZDCMetricsManager recordEncryptedBytes:bytesEncrypted duration:(ZDCMetricsNow() - cryptoStartTime)];
+	}
+	
 	// Check for leftover bytes in the 'inBuffer' that we couldn't encrypt.
 	// For example:
 	//
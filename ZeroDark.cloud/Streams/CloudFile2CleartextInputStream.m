@@ -2,6 +2,7 @@
 
 #import "ZDCConstants.h"
 #import "ZDCLogging.h"
+#import "ZDCMetricsManagerPrivate.h"
 
 #import "NSError+S4.h"
 
@@ -952,6 +953,8 @@
 	
 	NSUInteger bytesDecrypted = 0;
 	
+	uint64_t cryptoStartTime = ZDCMetricsNow();
+	
 	while ((bytesDecrypted < inBufferLength) && ((inBufferLength - bytesDecrypted) >= keyLength))
 	{
 		// Set/Reset Tweakable Block Cipher (TBC) if:
@@ -1113,6 +1116,10 @@
 		}
 	}
 	
+	if (bytesDecrypted > 0) {
+		[ZDCMetricsManager recordDecryptedBytes:bytesDecrypted duration:(ZDCMetricsNow() - cryptoStartTime)];
+	}
+	
 	// Check for leftover bytes in the 'inBuffer' that we couldn't decrypt.
 	// For example:
 	//
@@ -61,8 +61,6 @@
 	UIImage * defaultUserImage;
 	UIImage * threeDots;
 	
-	NSTimer * queryStartTimer; // So we don't fire a search right away while user is typing.
-	
 	NSInteger searchId;  // track searches
 	NSInteger activeSearchId;
 	NSInteger displayedSearchId;
@@ -549,37 +547,21 @@ static inline UIViewAnimationOptions AnimationOptionsFromCurve(UIViewAnimationCu
 		_lblSearchPrompt.hidden = YES;
 	}
 	
-	const NSTimeInterval kQueryDelay = 0.25;
-	if (queryStartTimer)
-	{
-		ZDCLogVerbose(@"queryStartTimer: changing fire date");
-		[queryStartTimer setFireDate:[NSDate dateWithTimeIntervalSinceNow:kQueryDelay]];
-	}
-	else
-	{
-		ZDCLogVerbose(@"queryStartTimer: initializing");
-		queryStartTimer =
-		  [NSTimer scheduledTimerWithTimeInterval: kQueryDelay
-		                                   target: self
-		                                 selector: @selector(startNewSearchQuery:)
-		                                 userInfo: nil
-		                                  repeats: NO];
-	}
+	// No need to wait for the user to stop typing:
+	// the search manager answers locally right away, and debounces the requests it sends to the server.
+	[self startNewSearchQuery:nil];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Search Queries
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-- (void)startNewSearchQuery:(NSTimer *)sender
+- (void)startNewSearchQuery:(id)sender
 {
 	ZDCLogAutoTrace();
 	
 	[self queryForUsersByName:_searchBar.text];
 	
-	[queryStartTimer invalidate];
-	queryStartTimer = nil;
-	
 	_vwInfo.hidden = YES;
 }
 
@@ -649,6 +631,10 @@ static inline UIViewAnimationOptions AnimationOptionsFromCurve(UIViewAnimationCu
 		 
 	if (error)
 	{
+		if ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled) {
+			return; // Superseded by a newer query, which is still loading
+		}
+		
 		_searchBar.isLoading = NO;
 		return;
 	}
@@ -680,9 +666,11 @@ static inline UIViewAnimationOptions AnimationOptionsFromCurve(UIViewAnimationCu
 	
 	if (stage == ZDCSearchResultStage_Done)
 	{
-		// end search indicator;
+		// end search indicator (unless a newer query is still pending);
 		
-		_searchBar.isLoading = NO;
+		if (currentSearchId == (searchId - 1)) {
+			_searchBar.isLoading = NO;
+		}
 		displayedSearchId = currentSearchId;
 		
 		if (searchResults.count == 0)
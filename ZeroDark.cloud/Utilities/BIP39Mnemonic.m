@@ -51,6 +51,121 @@
 @end
 
 
+/**
+ * Per-language lookup tables, built once from the word list.
+ *
+ * Recovery phrase validation & autocomplete are invoked on every keystroke.
+ * So rather than scanning (and re-folding) all 2048 words for each lookup, we precompute:
+ *
+ * - exact      : word => index
+ * - normalized : case & diacritic folded word => index (first match wins)
+ * - prefixes   : every prefix of every folded word => first word with that prefix
+ *
+ * A BIP39 word is uniquely identified by its first 4 letters (for most languages),
+ * so the prefix table is what turns an abbreviated word into the full mnemonic.
+ */
+@interface BIP39WordIndex : NSObject
+
+- (instancetype)initWithWords:(NSArray<NSString*> *)words locale:(NSLocale *)locale;
+
+@property (nonatomic, readonly) NSArray<NSString*> *words;
+
+- (NSUInteger)indexOfWord:(NSString *)word;
+- (NSUInteger)indexOfNormalizedWord:(NSString *)normalized;
+- (nullable NSString *)wordWithNormalizedPrefix:(NSString *)normalizedPrefix;
+
+@end
+
+/**
+ * Case & diacritic insensitive form of the given string.
+ * This matches what was previously done with `localizedCaseInsensitiveCompare:`,
+ * which also treats canonically equivalent strings (e.g. NFC vs NFD) as equal.
+ */
+static NSString* BIP39NormalizedWord(NSString *word, NSLocale *locale)
+{
+	NSString *folded = [word stringByFoldingWithOptions: (NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch)
+	                                             locale: locale];
+	
+	return [folded decomposedStringWithCanonicalMapping];
+}
+
+@implementation BIP39WordIndex {
+	
+	NSDictionary<NSString*, NSNumber*> *exactIndex;
+	NSDictionary<NSString*, NSNumber*> *normalizedIndex;
+	NSDictionary<NSString*, NSNumber*> *prefixIndex;
+}
+
+@synthesize words = words;
+
+- (instancetype)initWithWords:(NSArray<NSString*> *)inWords locale:(NSLocale *)locale
+{
+	if ((self = [super init]))
+	{
+		words = [inWords copy];
+		
+		NSMutableDictionary<NSString*, NSNumber*> *exact = [NSMutableDictionary dictionaryWithCapacity:words.count];
+		NSMutableDictionary<NSString*, NSNumber*> *normalized = [NSMutableDictionary dictionaryWithCapacity:words.count];
+		NSMutableDictionary<NSString*, NSNumber*> *prefixes = [NSMutableDictionary dictionaryWithCapacity:(words.count * 4)];
+		
+		[words enumerateObjectsUsingBlock:^(NSString *word, NSUInteger idx, BOOL *stop) {
+			
+			NSNumber *number = @(idx);
+			
+			if (exact[word] == nil) {
+				exact[word] = number;
+			}
+			
+			NSString *key = BIP39NormalizedWord(word, locale);
+			if (normalized[key] == nil) {
+				normalized[key] = number;
+			}
+			
+			// Prefix completion uses a literal `hasPrefix:` comparison against the folded word.
+			
+			NSString *folded = [word stringByFoldingWithOptions: (NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch)
+			                                             locale: locale];
+			
+			for (NSUInteger length = 1; length <= folded.length; length++)
+			{
+				NSString *prefix = [folded substringToIndex:length];
+				if (prefixes[prefix] == nil) {
+					prefixes[prefix] = number;
+				}
+			}
+		}];
+		
+		exactIndex = [exact copy];
+		normalizedIndex = [normalized copy];
+		prefixIndex = [prefixes copy];
+	}
+	return self;
+}
+
+- (NSUInteger)indexOfWord:(NSString *)word
+{
+	NSNumber *number = exactIndex[word];
+	return number ? number.unsignedIntegerValue : NSNotFound;
+}
+
+- (NSUInteger)indexOfNormalizedWord:(NSString *)normalized
+{
+	NSNumber *number = normalizedIndex[normalized];
+	return number ? number.unsignedIntegerValue : NSNotFound;
+}
+
+- (nullable NSString *)wordWithNormalizedPrefix:(NSString *)normalizedPrefix
+{
+	NSNumber *number = prefixIndex[normalizedPrefix];
+	return number ? words[number.unsignedIntegerValue] : nil;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 @implementation BIP39Mnemonic
 
 /**
@@ -140,8 +255,8 @@
 	return url;
 }
 
-+(nullable NSArray<NSString*> *) wordListForLanguageID:(NSString* _Nullable)languageID
-											 error:(NSError *_Nullable *_Nullable)errorOut
++ (nullable NSArray<NSString*> *)loadWordListForLanguageID:(NSString* _Nullable)languageID
+                                                    error:(NSError *_Nullable *_Nullable)errorOut
 {
 	NSError * error = nil;
 
@@ -176,14 +291,69 @@ done:
 	return wordTable;
 }
 
+/**
+ * Returns the (cached) lookup tables for the given language.
+ * The word list is only read from disk (and indexed) once per language.
+ */
++ (nullable BIP39WordIndex *)wordIndexForLanguageID:(NSString* _Nullable)languageID
+                                              error:(NSError *_Nullable *_Nullable)errorOut
+{
+	static NSMutableDictionary<NSString*, BIP39WordIndex*> *wordIndexes = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		wordIndexes = [[NSMutableDictionary alloc] init];
+	});
+
+	NSString *key = languageID ?: [self languageIDForLocaleIdentifier:[NSLocale currentLocale].localeIdentifier];
+	BIP39WordIndex *wordIndex = nil;
+
+	if (key)
+	{
+		@synchronized(wordIndexes) {
+			wordIndex = wordIndexes[key];
+		}
+	}
+
+	if (wordIndex == nil)
+	{
+		NSError *error = nil;
+		NSArray<NSString*> *wordTable = [self loadWordListForLanguageID:languageID error:&error];
+
+		if (error)
+		{
+			if (errorOut) *errorOut = error;
+			return nil;
+		}
+
+		NSLocale *locale = [NSLocale localeWithLocaleIdentifier:(key ?: @"")];
+		wordIndex = [[BIP39WordIndex alloc] initWithWords:wordTable locale:locale];
+
+		if (key)
+		{
+			@synchronized(wordIndexes) {
+				wordIndexes[key] = wordIndex;
+			}
+		}
+	}
+
+	if (errorOut) *errorOut = nil;
+	return wordIndex;
+}
+
++(nullable NSArray<NSString*> *) wordListForLanguageID:(NSString* _Nullable)languageID
+											 error:(NSError *_Nullable *_Nullable)errorOut
+{
+	return [self wordIndexForLanguageID:languageID error:errorOut].words;
+}
+
 + (nullable NSString *)matchingMnemonicForString:(NSString*)word
 									  languageID:(NSString* _Nullable)languageID
 										   error:(NSError *_Nullable *_Nullable)errorOut
 {
 	NSLocale* matchingLocale = [NSLocale localeWithLocaleIdentifier:languageID];
-	NSArray<NSString*> *wordTable = nil;
+	BIP39WordIndex *wordIndex = nil;
 
-	__block NSString* mnemonic = NULL;
+	NSString* mnemonic = NULL;
 	NSError * error = nil;
  
 	if(!matchingLocale)
@@ -193,31 +363,19 @@ done:
 		goto done;
 	}
 
-	wordTable = [self wordListForLanguageID:languageID error:&error];
+	wordIndex = [self wordIndexForLanguageID:languageID error:&error];
 	if (error) {
 		goto done;
 	}
 
-	if([wordTable containsObject:word])
+	if([wordIndex indexOfWord:word] != NSNotFound)
 		mnemonic = word;
 	else if(word.length > 3)
 	{
 		NSString *normalized = [word stringByFoldingWithOptions: NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch
 														 locale: matchingLocale];
 
-
-		[wordTable enumerateObjectsUsingBlock:^(NSString * entry, NSUInteger idx, BOOL * _Nonnull stop) {
-
-			NSString* test  = [entry stringByFoldingWithOptions:
-							   (NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch)
-														 locale: matchingLocale];
-
-			if([test hasPrefix:normalized])
-			{
-				mnemonic = entry;
-				*stop = YES;
-			}
-		}];
+		mnemonic = [wordIndex wordWithNormalizedPrefix:normalized];
 	}
 
 done:
@@ -318,7 +476,7 @@ done:
 	uint8_t dataBytes[33] = {0};  // key + checksum; 33 bytes == 264 bits
 	uint8_t hashBuf[32] = {0};
 
-	NSArray<NSString*> *wordTable = nil;
+	BIP39WordIndex *wordIndex = nil;
 	NSMutableString *bitString = nil;
 	NSString *checksumBits_calc = nil;
 	NSString *checksumBits_input = nil;
@@ -357,7 +515,7 @@ done:
 		goto done;
 	}
 
-	wordTable = [self wordListForLanguageID:languageID error:&error];
+	wordIndex = [self wordIndexForLanguageID:languageID error:&error];
 	if (error) {
 		goto done;
 	}
@@ -366,24 +524,7 @@ done:
 
 	for (NSString *word in mnemonic)
 	{
-		NSString *normalized = [word stringByFoldingWithOptions: NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch
-														 locale: matchingLocale];
-
-		NSUInteger index = [wordTable indexOfObjectPassingTest:
-							^BOOL(NSString *entry, NSUInteger idx, BOOL *stop)
-							{
-								NSString* test  = [entry stringByFoldingWithOptions:
-												   (NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch)
-																			 locale: matchingLocale];
-
-								if([test localizedCaseInsensitiveCompare:normalized] == NSOrderedSame)
-								{
-									*stop = YES;
-									return YES;
-								}
-
-								return NO;
-							}];
+		NSUInteger index = [wordIndex indexOfNormalizedWord:BIP39NormalizedWord(word, matchingLocale)];
 
 		// if we didnt find an index then we have bad mnemonic word
 		ASSERTERR(index != NSNotFound, kS4Err_BadParams);
@@ -694,7 +835,7 @@ done:
 	uint8_t hashBuf[32] = {0};
 	uint8_t encrypted_key[33] = {0};  // key + checksum; 33 bytes == 264 bits
 	
-	NSArray<NSString*> *wordTable = nil;
+	BIP39WordIndex *wordIndex = nil;
 	
 	NSData *saltData = nil;
 	NSMutableString *bitString = nil;
@@ -739,7 +880,7 @@ done:
 		goto done;
 	}
 
-	wordTable = [self wordListForLanguageID:languageID error:&error];
+	wordIndex = [self wordIndexForLanguageID:languageID error:&error];
 	if (error) {
 		goto done;
 	}
@@ -751,24 +892,7 @@ done:
 
 	for (NSString *word in mnemonic)
 	{
-		NSString *normalized = [word stringByFoldingWithOptions: NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch
-														 locale: matchingLocale];
-
-		NSUInteger index = [wordTable indexOfObjectPassingTest:
-							^BOOL(NSString *entry, NSUInteger idx, BOOL *stop)
-							{
-								NSString* test  = [entry stringByFoldingWithOptions:
-												   (NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch)
-																			 locale: matchingLocale];
-
-								if([test localizedCaseInsensitiveCompare:normalized] == NSOrderedSame)
-								{
-									*stop = YES;
-									return YES;
-								}
-
-								return NO;
-							}];
+		NSUInteger index = [wordIndex indexOfNormalizedWord:BIP39NormalizedWord(word, matchingLocale)];
 
 		// if we didnt find an index then we have bad mnemonic word
 		ASSERTERR(index != NSNotFound, kS4Err_BadParams);
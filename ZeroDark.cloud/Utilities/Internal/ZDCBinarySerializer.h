@@ -0,0 +1,66 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A compact binary alternative to NSKeyedArchiver, used for the database objects we read most often:
+ * ZDCNode, ZDCNodeMeta, ZDCUser, ZDCCloudNode & ZDCChangeList (and their subclasses).
+ *
+ * Each of these classes is registered with a schema (see ZDCBinarySerializer.m):
+ * a stable classID, plus an ordered list of typed fields.
+ * The values are still obtained from the class' existing NSCoding implementation,
+ * but they're laid out according to the schema:
+ *
+ * - the class is identified by a small integer (not its name)
+ * - fields are positional (no keys), with a presence bitmap for nil values
+ * - typed fields (strings, data, dates, bools, integers) are written without a type tag
+ * - integers are varint encoded, strings are UTF-8, data is raw
+ *
+ * Anything the schema doesn't cover (e.g. a key added to `encodeWithCoder:` without updating the schema)
+ * is still recorded, as a (key, value) pair. Nested objects of unregistered classes are recorded as (key, value) pairs,
+ * or embedded as a keyed archive if they're not our own classes. So the result is always decodable.
+ *
+ * Blobs start with a magic header & format version number.
+ * The deserializer reads the current format, and legacy keyed archives.
+ * Existing rows are thus migrated lazily - the next time they're written.
+ *
+ * Note: ZDCCloudOperation isn't registered. Operations are persisted by the YapDatabaseCloudCore extension
+ * (in its own tables, using its own serializer), and never pass through the database serializer.
+ */
+@interface ZDCBinarySerializer : NSObject
+
+/**
+ * Returns YES if the given object will be serialized using the compact binary format.
+ * Otherwise, `serializeObject:` will fallback to NSKeyedArchiver.
+ */
++ (BOOL)supportsObject:(id)object;
+
+/**
+ * Returns YES if the given data is in the compact binary format (i.e. has the magic header).
+ */
++ (BOOL)isBinaryFormat:(NSData *)data;
+
+/**
+ * Serializes the object into the compact binary format, if supported.
+ * Otherwise falls back to a keyed archive.
+ */
++ (NSData *)serializeObject:(id)object;
+
+/**
+ * Deserializes data that was created by `serializeObject:`, or by NSKeyedArchiver.
+ * Returns nil if the data is corrupt, or references an unknown class.
+ */
++ (nullable id)deserializeData:(NSData *)data;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,1319 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCBinarySerializer.h"
+
+#import "ZDCChangeList.h"
+#import "ZDCCloudNode.h"
+#import "ZDCLogging.h"
+#import "ZDCNode.h"
+#import "ZDCNodeMeta.h"
+#import "ZDCUser.h"
+
+// Log Levels: off, error, warning, info, verbose
+// Log Flags : trace
+#if DEBUG
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#else
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#endif
+#pragma unused(zdcLogLevel)
+
+/**
+ * Every blob starts with this header (magic + format version).
+ * Bump the version if the format changes (and keep a reader for the old version).
+ *
+ * Version 2: registered classes are recorded positionally, according to their schema (see ZDCBinarySchema).
+ *            Unregistered (nested) classes of ours are recorded as (key, value) pairs,
+ *            exactly as encoded by `encodeWithCoder:`.
+ *
+ * (Version 1 was never released, so there's nothing to read.)
+ */
+static const uint8_t kHeaderMagic[3] = { 'Z', 'D', 'B' };
+#define HEADER_LENGTH 4
+
+#define FORMAT_VERSION_CURRENT 2
+
+/**
+ * Protects against cycles in the object graph (which NSKeyedArchiver supports, but we don't).
+ * If exceeded, we fallback to a keyed archive.
+ */
+#define MAX_DEPTH 64
+
+typedef NS_ENUM(uint8_t, ZDCBinaryTag) {
+	ZDCBinaryTag_Nil               = 0,
+	ZDCBinaryTag_True              = 1,
+	ZDCBinaryTag_False             = 2,
+	ZDCBinaryTag_Int               = 3,  // zigzag varint
+	ZDCBinaryTag_UInt              = 4,  // varint
+	ZDCBinaryTag_Double            = 5,  // 8 bytes, little endian
+	ZDCBinaryTag_String            = 6,  // varint length + UTF-8
+	ZDCBinaryTag_Data              = 7,  // varint length + bytes
+	ZDCBinaryTag_Date              = 8,  // timeIntervalSinceReferenceDate (as double)
+	ZDCBinaryTag_Array             = 9,  // varint count + values
+	ZDCBinaryTag_MutableArray      = 10,
+	ZDCBinaryTag_Dictionary        = 11, // varint count + (key, value) pairs
+	ZDCBinaryTag_MutableDictionary = 12,
+	ZDCBinaryTag_Set               = 13, // varint count + values
+	ZDCBinaryTag_MutableSet        = 14,
+	ZDCBinaryTag_Null              = 15,
+	ZDCBinaryTag_Object            = 16, // class symbol + (key symbol, value) pairs + end marker
+	ZDCBinaryTag_Archive           = 17, // varint length + keyed archive
+	ZDCBinaryTag_SchemaObject      = 18, // see ZDCBinarySchema (format version 2+)
+};
+
+/**
+ * The type of a field within a schema.
+ * Typed fields are written without a tag (the schema already tells the reader what to expect).
+ */
+typedef NS_ENUM(uint8_t, ZDCBinaryFieldType) {
+	ZDCBinaryFieldType_Any    = 0, // tagged value (see ZDCBinaryTag)
+	ZDCBinaryFieldType_String = 1, // varint length + UTF-8
+	ZDCBinaryFieldType_Data   = 2, // varint length + bytes
+	ZDCBinaryFieldType_Date   = 3, // timeIntervalSinceReferenceDate (as double)
+	ZDCBinaryFieldType_Bool   = 4, // 1 byte
+	ZDCBinaryFieldType_Int    = 5, // zigzag varint
+	ZDCBinaryFieldType_Double = 6, // 8 bytes, little endian
+};
+
+/**
+ * Symbols (keys & class names) are written as a varint:
+ * - 0 : end of object (only valid in key position)
+ * - 1 : new symbol, followed by varint length + UTF-8
+ * - n : reference to previously defined symbol at index (n - 2)
+ */
+#define SYMBOL_END 0
+#define SYMBOL_NEW 1
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The schema for a registered class: a stable classID, and an ordered list of (key, type) fields.
+ *
+ * A registered object is written as:
+ * - tag (ZDCBinaryTag_SchemaObject) + varint classID
+ * - class symbol, or SYMBOL_END if the object is an instance of the registered class itself (not a subclass)
+ * - varint fieldCount + presence bitmap (1 bit per field)
+ * - the value of every present field, in schema order (typed fields are written without a tag)
+ * - (key symbol, tagged value) pairs for anything the schema doesn't cover, then SYMBOL_END
+ *
+ * Rules for modifying a schema:
+ * - never change a classID
+ * - never remove, reorder or change the type of a field - only append new fields
+ *
+ * The keys must match those used by the class' `encodeWithCoder:`.
+ * If they don't (or the value doesn't match the declared type), the value is still recorded (as an extra).
+ */
+@interface ZDCBinarySchema : NSObject
+
+- (instancetype)initWithClassID:(NSUInteger)classID cls:(Class)cls fields:(NSArray<NSArray*> *)fields;
+
+@property (nonatomic, readonly) NSUInteger classID;
+@property (nonatomic, readonly) Class cls;
+@property (nonatomic, readonly) NSArray<NSString*> *keys;
+
+- (ZDCBinaryFieldType)typeAtIndex:(NSUInteger)index;
+- (NSUInteger)indexOfKey:(NSString *)key;
+
+@end
+
+@implementation ZDCBinarySchema {
+	
+	NSArray<NSNumber*> *types;
+	NSDictionary<NSString*, NSNumber*> *indexes;
+}
+
+@synthesize classID = classID;
+@synthesize cls = cls;
+@synthesize keys = keys;
+
+- (instancetype)initWithClassID:(NSUInteger)inClassID cls:(Class)inCls fields:(NSArray<NSArray*> *)fields
+{
+	if ((self = [super init]))
+	{
+		classID = inClassID;
+		cls = inCls;
+		
+		NSMutableArray<NSString*> *_keys = [NSMutableArray arrayWithCapacity:fields.count];
+		NSMutableArray<NSNumber*> *_types = [NSMutableArray arrayWithCapacity:fields.count];
+		NSMutableDictionary<NSString*, NSNumber*> *_indexes = [NSMutableDictionary dictionaryWithCapacity:fields.count];
+		
+		for (NSArray *field in fields)
+		{
+			_indexes[field[0]] = @(_keys.count);
+			[_keys addObject:field[0]];
+			[_types addObject:field[1]];
+		}
+		
+		keys = [_keys copy];
+		types = [_types copy];
+		indexes = [_indexes copy];
+	}
+	return self;
+}
+
+- (ZDCBinaryFieldType)typeAtIndex:(NSUInteger)index
+{
+	return (ZDCBinaryFieldType)[types[index] unsignedCharValue];
+}
+
+- (NSUInteger)indexOfKey:(NSString *)key
+{
+	NSNumber *index = indexes[key];
+	return index ? index.unsignedIntegerValue : NSNotFound;
+}
+
+@end
+
+static NSDictionary<NSNumber*, ZDCBinarySchema*> *schemasByID = nil;
+
+static void RegisterSchemas(void)
+{
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		
+		const ZDCBinaryFieldType Any    = ZDCBinaryFieldType_Any;
+		const ZDCBinaryFieldType String = ZDCBinaryFieldType_String;
+		const ZDCBinaryFieldType Data   = ZDCBinaryFieldType_Data;
+		const ZDCBinaryFieldType Date   = ZDCBinaryFieldType_Date;
+		const ZDCBinaryFieldType Bool   = ZDCBinaryFieldType_Bool;
+		const ZDCBinaryFieldType Int    = ZDCBinaryFieldType_Int;
+		
+		NSArray<ZDCBinarySchema*> *schemas = @[
+			
+			[[ZDCBinarySchema alloc] initWithClassID:1 cls:[ZDCNode class] fields:@[
+				@[ @"version_node"      , @(Int)    ],
+				@[ @"uuid"              , @(String) ],
+				@[ @"localUserID"       , @(String) ],
+				@[ @"parentID"          , @(String) ],
+				@[ @"name"              , @(String) ],
+				@[ @"shareList"         , @(Any)    ],
+				@[ @"burnDate"          , @(Date)   ],
+				@[ @"senderID"          , @(String) ],
+				@[ @"pendingRecipients" , @(Any)    ],
+				@[ @"encryptionKey"     , @(Data)   ],
+				@[ @"dirSalt"           , @(Data)   ],
+				@[ @"dirPrefix"         , @(String) ],
+				@[ @"cloudID"           , @(String) ],
+				@[ @"eTag_rcrd"         , @(String) ],
+				@[ @"eTag_data"         , @(String) ],
+				@[ @"lastModified_rcrd" , @(Date)   ],
+				@[ @"lastModified_data" , @(Date)   ],
+				@[ @"cloudDataInfo"     , @(Any)    ],
+				@[ @"explicitCloudName" , @(String) ],
+				@[ @"anchor"            , @(Any)    ],
+				@[ @"pointeeID"         , @(String) ],
+			]],
+			
+			[[ZDCBinarySchema alloc] initWithClassID:2 cls:[ZDCUser class] fields:@[
+				@[ @"version_user"           , @(Int)    ],
+				@[ @"uuid"                   , @(String) ],
+				@[ @"publicKeyID"            , @(String) ],
+				@[ @"blockchainProof"        , @(Any)    ],
+				@[ @"random_uuid"            , @(String) ],
+				@[ @"random_encryptionKey"   , @(Data)   ],
+				@[ @"aws_regionStr"          , @(String) ],
+				@[ @"aws_bucket"             , @(String) ],
+				@[ @"accountBlocked"         , @(Bool)   ],
+				@[ @"accountDeleted"         , @(Bool)   ],
+				@[ @"lastRefresh_profile"    , @(Date)   ],
+				@[ @"lastRefresh_blockchain" , @(Date)   ],
+				@[ @"identities"             , @(Any)    ],
+				@[ @"preferedAuth0ID"        , @(String) ],
+			]],
+			
+			[[ZDCBinarySchema alloc] initWithClassID:3 cls:[ZDCNodeMeta class] fields:@[
+				@[ @"version"           , @(Int)    ],
+				@[ @"nodeID"            , @(String) ],
+				@[ @"localUserID"       , @(String) ],
+				@[ @"treeID"            , @(String) ],
+				@[ @"parentID"          , @(String) ],
+				@[ @"name"              , @(String) ],
+				@[ @"collationKey"      , @(Any)    ],
+				@[ @"explicitCloudName" , @(String) ],
+				@[ @"dirSalt"           , @(Data)   ],
+				@[ @"cloudID"           , @(String) ],
+				@[ @"dirPrefix"         , @(String) ],
+				@[ @"pointeeID"         , @(String) ],
+			]],
+			
+			[[ZDCBinarySchema alloc] initWithClassID:4 cls:[ZDCCloudNode class] fields:@[
+				@[ @"version_node"  , @(Int)    ],
+				@[ @"uuid"          , @(String) ],
+				@[ @"localUserID"   , @(String) ],
+				@[ @"cloudLocator"  , @(Any)    ],
+				@[ @"aws_eTag_rcrd" , @(String) ],
+				@[ @"aws_eTag_data" , @(String) ],
+				@[ @"isDeletion"    , @(Bool)   ],
+			]],
+			
+			[[ZDCBinarySchema alloc] initWithClassID:5 cls:[ZDCChangeList class] fields:@[
+				@[ @"version"                  , @(Int)    ],
+				@[ @"latestChangeToken_local"  , @(String) ],
+				@[ @"latestChangeToken_remote" , @(String) ],
+				@[ @"pendingChanges"           , @(Any)    ],
+				@[ @"skippedPendingChangeIDs"  , @(Any)    ],
+			]],
+		];
+		
+		NSMutableDictionary<NSNumber*, ZDCBinarySchema*> *byID = [NSMutableDictionary dictionaryWithCapacity:schemas.count];
+		for (ZDCBinarySchema *schema in schemas)
+		{
+			NSCAssert(byID[@(schema.classID)] == nil, @"Duplicate classID");
+			byID[@(schema.classID)] = schema;
+		}
+		
+		schemasByID = [byID copy];
+	});
+}
+
+/**
+ * Returns the schema registered for the class (or its nearest registered superclass).
+ */
+static ZDCBinarySchema* SchemaForClass(Class cls)
+{
+	RegisterSchemas();
+	
+	ZDCBinarySchema *match = nil;
+	for (ZDCBinarySchema *schema in [schemasByID objectEnumerator])
+	{
+		if ([cls isSubclassOfClass:schema.cls])
+		{
+			if (match == nil || [schema.cls isSubclassOfClass:match.cls]) {
+				match = schema;
+			}
+		}
+	}
+	
+	return match;
+}
+
+static ZDCBinarySchema* SchemaForClassID(uint64_t classID)
+{
+	RegisterSchemas();
+	
+	return schemasByID[@(classID)];
+}
+
+static BOOL IsNativeClass(Class cls)
+{
+	// Our own classes use standard keyed coding, so they can be encoded directly.
+	// Everything else (Foundation & 3rd party classes) gets embedded as a keyed archive.
+	
+	return [NSStringFromClass(cls) hasPrefix:@"ZDC"] && [cls conformsToProtocol:@protocol(NSCoding)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A value recorded by `encodeWithCoder:` (for a registered class), before it's written according to the schema.
+ * The `kind` is one of: Any (for objects), Bool, Int or Double.
+ */
+@interface ZDCBinaryCapturedField : NSObject {
+@public
+	NSString *key;
+	ZDCBinaryFieldType kind;
+	id value;
+}
+@end
+
+@implementation ZDCBinaryCapturedField
+@end
+
+static BOOL CapturedFieldMatchesType(ZDCBinaryCapturedField *field, ZDCBinaryFieldType type)
+{
+	switch (type)
+	{
+		case ZDCBinaryFieldType_String : return (field->kind == ZDCBinaryFieldType_Any)
+		                                     && [field->value isKindOfClass:[NSString class]];
+		case ZDCBinaryFieldType_Data   : return (field->kind == ZDCBinaryFieldType_Any)
+		                                     && [field->value isKindOfClass:[NSData class]];
+		case ZDCBinaryFieldType_Date   : return (field->kind == ZDCBinaryFieldType_Any)
+		                                     && [field->value isKindOfClass:[NSDate class]];
+		default                        : return (field->kind == type);
+	}
+}
+
+@interface ZDCBinaryEncoder : NSCoder
+
+@property (nonatomic, readonly) NSMutableData *buffer;
+@property (nonatomic, readonly) BOOL failed;
+
+- (void)writeValue:(nullable id)value;
+
+@end
+
+@implementation ZDCBinaryEncoder {
+	
+	NSMutableDictionary<NSString*, NSNumber*> *symbols;
+	NSUInteger depth;
+	
+	NSMutableArray<ZDCBinaryCapturedField*> *capture; // non-nil while encoding a registered class
+}
+
+@synthesize buffer = buffer;
+@synthesize failed = failed;
+
+- (instancetype)init
+{
+	if ((self = [super init]))
+	{
+		buffer = [NSMutableData dataWithCapacity:256];
+		[buffer appendBytes:kHeaderMagic length:sizeof(kHeaderMagic)];
+		[self writeByte:FORMAT_VERSION_CURRENT];
+		
+		symbols = [[NSMutableDictionary alloc] init];
+	}
+	return self;
+}
+
+- (BOOL)allowsKeyedCoding
+{
+	return YES;
+}
+
+- (void)writeByte:(uint8_t)byte
+{
+	[buffer appendBytes:&byte length:1];
+}
+
+- (void)writeVarint:(uint64_t)value
+{
+	uint8_t bytes[10];
+	NSUInteger length = 0;
+	
+	do {
+		uint8_t byte = (uint8_t)(value & 0x7F);
+		value >>= 7;
+		if (value != 0) byte |= 0x80;
+		
+		bytes[length++] = byte;
+		
+	} while (value != 0);
+	
+	[buffer appendBytes:bytes length:length];
+}
+
+- (void)writeSignedVarint:(int64_t)value
+{
+	[self writeVarint:(((uint64_t)value << 1) ^ (uint64_t)(value >> 63))]; // zigzag
+}
+
+- (void)writeDouble:(double)value
+{
+	uint64_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	bits = CFSwapInt64HostToLittle(bits);
+	
+	[buffer appendBytes:&bits length:sizeof(bits)];
+}
+
+- (void)writeString:(NSString *)string
+{
+	NSData *utf8 = [string dataUsingEncoding:NSUTF8StringEncoding];
+	
+	[self writeVarint:utf8.length];
+	[buffer appendData:utf8];
+}
+
+- (void)writeSymbol:(NSString *)symbol
+{
+	NSNumber *index = symbols[symbol];
+	if (index)
+	{
+		[self writeVarint:(index.unsignedLongLongValue + 2)];
+	}
+	else
+	{
+		symbols[symbol] = @(symbols.count);
+		
+		[self writeVarint:SYMBOL_NEW];
+		[self writeString:symbol];
+	}
+}
+
+- (void)writeValue:(nullable id)value
+{
+	if (failed) return;
+	
+	if (value == nil)
+	{
+		[self writeByte:ZDCBinaryTag_Nil];
+	}
+	else if ([value isKindOfClass:[NSString class]])
+	{
+		[self writeByte:ZDCBinaryTag_String];
+		[self writeString:(NSString *)value];
+	}
+	else if ([value isKindOfClass:[NSNumber class]] && ![value isKindOfClass:[NSDecimalNumber class]])
+	{
+		NSNumber *number = (NSNumber *)value;
+		const char *type = number.objCType;
+		
+		if (CFGetTypeID((__bridge CFTypeRef)number) == CFBooleanGetTypeID())
+		{
+			[self writeByte:(number.boolValue ? ZDCBinaryTag_True : ZDCBinaryTag_False)];
+		}
+		else if (strcmp(type, @encode(float)) == 0 || strcmp(type, @encode(double)) == 0)
+		{
+			[self writeByte:ZDCBinaryTag_Double];
+			[self writeDouble:number.doubleValue];
+		}
+		else if (strcmp(type, @encode(unsigned long long)) == 0 && number.unsignedLongLongValue > INT64_MAX)
+		{
+			[self writeByte:ZDCBinaryTag_UInt];
+			[self writeVarint:number.unsignedLongLongValue];
+		}
+		else
+		{
+			[self writeByte:ZDCBinaryTag_Int];
+			[self writeSignedVarint:number.longLongValue];
+		}
+	}
+	else if ([value isKindOfClass:[NSData class]])
+	{
+		NSData *data = (NSData *)value;
+		
+		[self writeByte:ZDCBinaryTag_Data];
+		[self writeVarint:data.length];
+		[buffer appendData:data];
+	}
+	else if ([value isKindOfClass:[NSDate class]])
+	{
+		[self writeByte:ZDCBinaryTag_Date];
+		[self writeDouble:[(NSDate *)value timeIntervalSinceReferenceDate]];
+	}
+	else if ([value isKindOfClass:[NSNull class]])
+	{
+		[self writeByte:ZDCBinaryTag_Null];
+	}
+	else if ([value isKindOfClass:[NSArray class]])
+	{
+		NSArray *array = (NSArray *)value;
+		BOOL isMutable = [array isKindOfClass:[NSMutableArray class]];
+		
+		[self writeByte:(isMutable ? ZDCBinaryTag_MutableArray : ZDCBinaryTag_Array)];
+		[self writeVarint:array.count];
+		
+		if (++depth > MAX_DEPTH) { failed = YES; return; }
+		for (id item in array) {
+			[self writeValue:item];
+		}
+		depth--;
+	}
+	else if ([value isKindOfClass:[NSDictionary class]])
+	{
+		NSDictionary *dict = (NSDictionary *)value;
+		BOOL isMutable = [dict isKindOfClass:[NSMutableDictionary class]];
+		
+		[self writeByte:(isMutable ? ZDCBinaryTag_MutableDictionary : ZDCBinaryTag_Dictionary)];
+		[self writeVarint:dict.count];
+		
+		if (++depth > MAX_DEPTH) { failed = YES; return; }
+		[dict enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
+			
+			[self writeValue:key];
+			[self writeValue:obj];
+		}];
+		depth--;
+	}
+	else if ([value isKindOfClass:[NSSet class]])
+	{
+		NSSet *set = (NSSet *)value;
+		BOOL isMutable = [set isKindOfClass:[NSMutableSet class]];
+		
+		[self writeByte:(isMutable ? ZDCBinaryTag_MutableSet : ZDCBinaryTag_Set)];
+		[self writeVarint:set.count];
+		
+		if (++depth > MAX_DEPTH) { failed = YES; return; }
+		for (id item in set) {
+			[self writeValue:item];
+		}
+		depth--;
+	}
+	else if (SchemaForClass([value classForKeyedArchiver]))
+	{
+		[self writeSchemaObject:value schema:SchemaForClass([value classForKeyedArchiver])];
+	}
+	else if (IsNativeClass([value classForKeyedArchiver]))
+	{
+		[self writeByte:ZDCBinaryTag_Object];
+		[self writeSymbol:NSStringFromClass([value classForKeyedArchiver])];
+		
+		if (++depth > MAX_DEPTH) { failed = YES; return; }
+		[(id<NSCoding>)value encodeWithCoder:self];
+		depth--;
+		
+		[self writeVarint:SYMBOL_END];
+	}
+	else
+	{
+		NSData *archive = [NSKeyedArchiver archivedDataWithRootObject:value];
+		
+		[self writeByte:ZDCBinaryTag_Archive];
+		[self writeVarint:archive.length];
+		[buffer appendData:archive];
+	}
+}
+
+- (void)writeSchemaObject:(id)value schema:(ZDCBinarySchema *)schema
+{
+	Class cls = [value classForKeyedArchiver];
+	
+	[self writeByte:ZDCBinaryTag_SchemaObject];
+	[self writeVarint:schema.classID];
+	
+	if (cls == schema.cls)
+		[self writeVarint:SYMBOL_END];
+	else
+		[self writeSymbol:NSStringFromClass(cls)];
+	
+	if (++depth > MAX_DEPTH) { failed = YES; return; }
+	
+	// Record whatever the object encodes, and then lay it out according to the schema.
+	
+	NSMutableArray<ZDCBinaryCapturedField*> *prevCapture = capture;
+	capture = [NSMutableArray arrayWithCapacity:schema.keys.count];
+	
+	[(id<NSCoding>)value encodeWithCoder:self];
+	
+	NSArray<ZDCBinaryCapturedField*> *captured = capture;
+	capture = prevCapture;
+	
+	const NSUInteger fieldCount = schema.keys.count;
+	
+	NSMutableArray *slots = [NSMutableArray arrayWithCapacity:fieldCount];
+	for (NSUInteger i = 0; i < fieldCount; i++) {
+		[slots addObject:[NSNull null]];
+	}
+	
+	NSMutableArray<ZDCBinaryCapturedField*> *extras = [NSMutableArray array];
+	
+	for (ZDCBinaryCapturedField *field in captured)
+	{
+		NSUInteger index = [schema indexOfKey:field->key];
+		
+		if (index != NSNotFound
+		 && slots[index] == [NSNull null]
+		 && CapturedFieldMatchesType(field, [schema typeAtIndex:index]))
+		{
+			slots[index] = field;
+		}
+		else
+		{
+			[extras addObject:field];
+		}
+	}
+	
+	[self writeVarint:fieldCount];
+	
+	NSMutableData *bitmap = [NSMutableData dataWithLength:((fieldCount + 7) / 8)];
+	uint8_t *bits = (uint8_t *)bitmap.mutableBytes;
+	
+	for (NSUInteger i = 0; i < fieldCount; i++)
+	{
+		if (slots[i] != [NSNull null]) {
+			bits[i / 8] |= (uint8_t)(1 << (i % 8));
+		}
+	}
+	[buffer appendData:bitmap];
+	
+	for (NSUInteger i = 0; i < fieldCount; i++)
+	{
+		if (slots[i] == [NSNull null]) continue;
+		
+		ZDCBinaryCapturedField *field = slots[i];
+		switch ([schema typeAtIndex:i])
+		{
+			case ZDCBinaryFieldType_String : [self writeString:field->value]; break;
+			case ZDCBinaryFieldType_Data   : [self writeVarint:[field->value length]];
+			                                 [buffer appendData:field->value]; break;
+			case ZDCBinaryFieldType_Date   : [self writeDouble:[field->value timeIntervalSinceReferenceDate]]; break;
+			case ZDCBinaryFieldType_Bool   : [self writeByte:([field->value boolValue] ? 1 : 0)]; break;
+			case ZDCBinaryFieldType_Int    : [self writeSignedVarint:[field->value longLongValue]]; break;
+			case ZDCBinaryFieldType_Double : [self writeDouble:[field->value doubleValue]]; break;
+			case ZDCBinaryFieldType_Any    : [self writeValue:field->value]; break;
+		}
+	}
+	
+	for (ZDCBinaryCapturedField *field in extras)
+	{
+		[self writeSymbol:field->key];
+		[self writeTaggedValue:field->value kind:field->kind];
+	}
+	[self writeVarint:SYMBOL_END];
+	
+	depth--;
+}
+
+- (void)writeTaggedValue:(id)value kind:(ZDCBinaryFieldType)kind
+{
+	switch (kind)
+	{
+		case ZDCBinaryFieldType_Bool:
+		{
+			[self writeByte:([value boolValue] ? ZDCBinaryTag_True : ZDCBinaryTag_False)];
+			break;
+		}
+		case ZDCBinaryFieldType_Int:
+		{
+			[self writeByte:ZDCBinaryTag_Int];
+			[self writeSignedVarint:[value longLongValue]];
+			break;
+		}
+		case ZDCBinaryFieldType_Double:
+		{
+			[self writeByte:ZDCBinaryTag_Double];
+			[self writeDouble:[value doubleValue]];
+			break;
+		}
+		default:
+		{
+			[self writeValue:value];
+			break;
+		}
+	}
+}
+
+/**
+ * All the NSCoder methods funnel into here.
+ * Values for a registered class are captured (and written later, according to the schema).
+ * Values for other classes are written immediately.
+ */
+- (void)encodeValue:(id)value kind:(ZDCBinaryFieldType)kind forKey:(NSString *)key
+{
+	if (capture)
+	{
+		ZDCBinaryCapturedField *field = [[ZDCBinaryCapturedField alloc] init];
+		field->key = [key copy];
+		field->kind = kind;
+		field->value = value;
+		
+		[capture addObject:field];
+	}
+	else
+	{
+		[self writeSymbol:key];
+		[self writeTaggedValue:value kind:kind];
+	}
+}
+
+#pragma mark NSCoder
+
+- (void)encodeObject:(nullable id)object forKey:(NSString *)key
+{
+	if (object == nil) return; // absent key == nil
+	
+	[self encodeValue:object kind:ZDCBinaryFieldType_Any forKey:key];
+}
+
+- (void)encodeConditionalObject:(nullable id)object forKey:(NSString *)key
+{
+	[self encodeObject:object forKey:key];
+}
+
+- (void)encodeBool:(BOOL)value forKey:(NSString *)key
+{
+	[self encodeValue:@(value) kind:ZDCBinaryFieldType_Bool forKey:key];
+}
+
+- (void)encodeInt:(int)value forKey:(NSString *)key
+{
+	[self encodeInt64:value forKey:key];
+}
+
+- (void)encodeInt32:(int32_t)value forKey:(NSString *)key
+{
+	[self encodeInt64:value forKey:key];
+}
+
+- (void)encodeInteger:(NSInteger)value forKey:(NSString *)key
+{
+	[self encodeInt64:value forKey:key];
+}
+
+- (void)encodeInt64:(int64_t)value forKey:(NSString *)key
+{
+	[self encodeValue:@(value) kind:ZDCBinaryFieldType_Int forKey:key];
+}
+
+- (void)encodeFloat:(float)value forKey:(NSString *)key
+{
+	[self encodeDouble:value forKey:key];
+}
+
+- (void)encodeDouble:(double)value forKey:(NSString *)key
+{
+	[self encodeValue:@(value) kind:ZDCBinaryFieldType_Double forKey:key];
+}
+
+- (void)encodeBytes:(nullable const uint8_t *)bytes length:(NSUInteger)length forKey:(NSString *)key
+{
+	[self encodeObject:[NSData dataWithBytes:bytes length:length] forKey:key];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface ZDCBinaryDecoder : NSCoder
+
+- (instancetype)initWithData:(NSData *)data;
+
+- (nullable id)readRootValue;
+
+@end
+
+@implementation ZDCBinaryDecoder {
+	
+	NSData *data;
+	const uint8_t *bytes;
+	NSUInteger length;
+	NSUInteger offset;
+	
+	NSMutableArray<NSString*> *symbols;
+	NSMutableArray<NSDictionary<NSString*, id>*> *fieldsStack;
+	
+	BOOL failed;
+}
+
+- (instancetype)initWithData:(NSData *)inData
+{
+	if ((self = [super init]))
+	{
+		data = inData;
+		bytes = (const uint8_t *)data.bytes;
+		length = data.length;
+		offset = HEADER_LENGTH;
+		
+		symbols = [[NSMutableArray alloc] init];
+		fieldsStack = [[NSMutableArray alloc] init];
+	}
+	return self;
+}
+
+- (BOOL)allowsKeyedCoding
+{
+	return YES;
+}
+
+- (nullable id)readRootValue
+{
+	id value = [self readValue:0];
+	
+	if (failed || offset != length) {
+		return nil;
+	}
+	return value;
+}
+
+- (uint8_t)readByte
+{
+	if (offset >= length) {
+		failed = YES;
+		return 0;
+	}
+	return bytes[offset++];
+}
+
+- (uint64_t)readVarint
+{
+	uint64_t value = 0;
+	
+	for (NSUInteger shift = 0; shift < 64; shift += 7)
+	{
+		uint8_t byte = [self readByte];
+		if (failed) return 0;
+		
+		value |= ((uint64_t)(byte & 0x7F) << shift);
+		
+		if ((byte & 0x80) == 0) {
+			return value;
+		}
+	}
+	
+	failed = YES;
+	return 0;
+}
+
+- (int64_t)readSignedVarint
+{
+	uint64_t value = [self readVarint];
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); // zigzag
+}
+
+- (double)readDouble
+{
+	if ((offset + sizeof(uint64_t)) > length) {
+		failed = YES;
+		return 0;
+	}
+	
+	uint64_t bits = 0;
+	memcpy(&bits, bytes + offset, sizeof(bits));
+	offset += sizeof(bits);
+	
+	bits = CFSwapInt64LittleToHost(bits);
+	
+	double value = 0;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+- (nullable NSData *)readData
+{
+	uint64_t dataLength = [self readVarint];
+	if (failed || dataLength > (length - offset)) {
+		failed = YES;
+		return nil;
+	}
+	
+	NSData *result = [data subdataWithRange:NSMakeRange(offset, (NSUInteger)dataLength)];
+	offset += (NSUInteger)dataLength;
+	
+	return result;
+}
+
+- (nullable NSString *)readString
+{
+	NSData *utf8 = [self readData];
+	if (utf8 == nil) return nil;
+	
+	NSString *string = [[NSString alloc] initWithData:utf8 encoding:NSUTF8StringEncoding];
+	if (string == nil) {
+		failed = YES;
+	}
+	return string;
+}
+
+/**
+ * Returns nil for SYMBOL_END.
+ */
+- (nullable NSString *)readSymbol
+{
+	uint64_t marker = [self readVarint];
+	if (failed) return nil;
+	
+	if (marker == SYMBOL_END) {
+		return nil;
+	}
+	
+	if (marker == SYMBOL_NEW)
+	{
+		NSString *symbol = [self readString];
+		if (symbol) {
+			[symbols addObject:symbol];
+		}
+		return symbol;
+	}
+	
+	uint64_t index = marker - 2;
+	if (index >= symbols.count) {
+		failed = YES;
+		return nil;
+	}
+	
+	return symbols[(NSUInteger)index];
+}
+
+- (nullable id)readValue:(NSUInteger)depth
+{
+	if (depth > MAX_DEPTH) {
+		failed = YES;
+	}
+	if (failed) return nil;
+	
+	ZDCBinaryTag tag = (ZDCBinaryTag)[self readByte];
+	if (failed) return nil;
+	
+	switch (tag)
+	{
+		case ZDCBinaryTag_Nil   : return nil;
+		case ZDCBinaryTag_True  : return @(YES);
+		case ZDCBinaryTag_False : return @(NO);
+		case ZDCBinaryTag_Null  : return [NSNull null];
+		
+		case ZDCBinaryTag_Int    : return @([self readSignedVarint]);
+		case ZDCBinaryTag_UInt   : return @([self readVarint]);
+		case ZDCBinaryTag_Double : return @([self readDouble]);
+		case ZDCBinaryTag_String : return [self readString];
+		case ZDCBinaryTag_Data   : return [self readData];
+		case ZDCBinaryTag_Date   : return [NSDate dateWithTimeIntervalSinceReferenceDate:[self readDouble]];
+		
+		case ZDCBinaryTag_Array        :
+		case ZDCBinaryTag_MutableArray :
+		case ZDCBinaryTag_Set          :
+		case ZDCBinaryTag_MutableSet   :
+		{
+			uint64_t count = [self readVarint];
+			if (failed || count > (length - offset)) { failed = YES; return nil; }
+			
+			NSMutableArray *items = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
+			for (uint64_t i = 0; i < count; i++)
+			{
+				id item = [self readValue:(depth + 1)];
+				if (failed) return nil;
+				if (item) [items addObject:item];
+			}
+			
+			switch (tag)
+			{
+				case ZDCBinaryTag_Array        : return [items copy];
+				case ZDCBinaryTag_MutableArray : return items;
+				case ZDCBinaryTag_Set          : return [NSSet setWithArray:items];
+				default                        : return [NSMutableSet setWithArray:items];
+			}
+		}
+		case ZDCBinaryTag_Dictionary        :
+		case ZDCBinaryTag_MutableDictionary :
+		{
+			uint64_t count = [self readVarint];
+			if (failed || count > (length - offset)) { failed = YES; return nil; }
+			
+			NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)count];
+			for (uint64_t i = 0; i < count; i++)
+			{
+				id key = [self readValue:(depth + 1)];
+				id obj = [self readValue:(depth + 1)];
+				if (failed) return nil;
+				
+				if (key && obj) dict[key] = obj;
+			}
+			
+			return (tag == ZDCBinaryTag_Dictionary) ? [dict copy] : dict;
+		}
+		case ZDCBinaryTag_Object:
+		{
+			return [self readObject:depth];
+		}
+		case ZDCBinaryTag_SchemaObject:
+		{
+			return [self readSchemaObject:depth];
+		}
+		case ZDCBinaryTag_Archive:
+		{
+			NSData *archive = [self readData];
+			if (archive == nil) return nil;
+			
+			return [NSKeyedUnarchiver unarchiveObjectWithData:archive];
+		}
+	}
+	
+	// Unknown tag
+	failed = YES;
+	return nil;
+}
+
+- (nullable id)readObject:(NSUInteger)depth
+{
+	NSString *className = [self readSymbol];
+	if (className == nil) {
+		failed = YES;
+		return nil;
+	}
+	
+	Class cls = NSClassFromString(className);
+	if (cls == nil || !IsNativeClass(cls))
+	{
+		ZDCLogError(@"Unknown class: %@", className);
+		failed = YES;
+		return nil;
+	}
+	
+	NSMutableDictionary<NSString*, id> *fields = [NSMutableDictionary dictionary];
+	
+	NSString *key = nil;
+	while ((key = [self readSymbol]))
+	{
+		id value = [self readValue:(depth + 1)];
+		if (failed) return nil;
+		
+		if (value) fields[key] = value;
+	}
+	if (failed) return nil;
+	
+	return [self instantiateClass:cls withFields:fields];
+}
+
+- (nullable id)readSchemaObject:(NSUInteger)depth
+{
+	uint64_t classID = [self readVarint];
+	if (failed) return nil;
+	
+	ZDCBinarySchema *schema = SchemaForClassID(classID);
+	if (schema == nil)
+	{
+		ZDCLogError(@"Unknown classID: %llu", classID);
+		failed = YES;
+		return nil;
+	}
+	
+	Class cls = schema.cls;
+	
+	NSString *className = [self readSymbol]; // nil (SYMBOL_END) => schema.cls
+	if (failed) return nil;
+	
+	if (className)
+	{
+		cls = NSClassFromString(className);
+		if (cls == nil || ![cls isSubclassOfClass:schema.cls])
+		{
+			ZDCLogError(@"Unknown class: %@", className);
+			failed = YES;
+			return nil;
+		}
+	}
+	
+	uint64_t fieldCount = [self readVarint];
+	if (failed) return nil;
+	
+	if (fieldCount > schema.keys.count)
+	{
+		// Written by a newer version of the framework (with fields appended to the schema)
+		ZDCLogError(@"Unknown schema for %@: %llu fields", NSStringFromClass(cls), fieldCount);
+		failed = YES;
+		return nil;
+	}
+	
+	NSUInteger bitmapLength = (NSUInteger)((fieldCount + 7) / 8);
+	if (bitmapLength > (length - offset)) {
+		failed = YES;
+		return nil;
+	}
+	
+	const uint8_t *bits = bytes + offset;
+	offset += bitmapLength;
+	
+	NSMutableDictionary<NSString*, id> *fields = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)fieldCount];
+	
+	for (NSUInteger i = 0; i < fieldCount; i++)
+	{
+		if ((bits[i / 8] & (1 << (i % 8))) == 0) continue;
+		
+		id value = [self readFieldOfType:[schema typeAtIndex:i] depth:(depth + 1)];
+		if (failed) return nil;
+		
+		if (value) fields[schema.keys[i]] = value;
+	}
+	
+	NSString *key = nil;
+	while ((key = [self readSymbol]))
+	{
+		id value = [self readValue:(depth + 1)];
+		if (failed) return nil;
+		
+		if (value) fields[key] = value;
+	}
+	if (failed) return nil;
+	
+	return [self instantiateClass:cls withFields:fields];
+}
+
+- (nullable id)readFieldOfType:(ZDCBinaryFieldType)type depth:(NSUInteger)depth
+{
+	switch (type)
+	{
+		case ZDCBinaryFieldType_String : return [self readString];
+		case ZDCBinaryFieldType_Data   : return [self readData];
+		case ZDCBinaryFieldType_Date   : return [NSDate dateWithTimeIntervalSinceReferenceDate:[self readDouble]];
+		case ZDCBinaryFieldType_Bool   : return @([self readByte] != 0);
+		case ZDCBinaryFieldType_Int    : return @([self readSignedVarint]);
+		case ZDCBinaryFieldType_Double : return @([self readDouble]);
+		case ZDCBinaryFieldType_Any    : return [self readValue:depth];
+	}
+	
+	failed = YES;
+	return nil;
+}
+
+- (nullable id)instantiateClass:(Class)cls withFields:(NSDictionary<NSString*, id> *)fields
+{
+	[fieldsStack addObject:fields];
+	id object = [(id<NSCoding>)[cls alloc] initWithCoder:self];
+	[fieldsStack removeLastObject];
+	
+	return [object awakeAfterUsingCoder:self];
+}
+
+#pragma mark NSCoder
+
+- (nullable id)valueForCoderKey:(NSString *)key
+{
+	return [fieldsStack lastObject][key];
+}
+
+- (BOOL)containsValueForKey:(NSString *)key
+{
+	return ([self valueForCoderKey:key] != nil);
+}
+
+- (nullable id)decodeObjectForKey:(NSString *)key
+{
+	return [self valueForCoderKey:key];
+}
+
+- (nullable id)decodeObjectOfClass:(Class)cls forKey:(NSString *)key
+{
+	id value = [self valueForCoderKey:key];
+	return [value isKindOfClass:cls] ? value : nil;
+}
+
+- (nullable id)decodeObjectOfClasses:(nullable NSSet<Class> *)classes forKey:(NSString *)key
+{
+	id value = [self valueForCoderKey:key];
+	if (value == nil) return nil;
+	
+	for (Class cls in classes)
+	{
+		if ([value isKindOfClass:cls]) return value;
+	}
+	return nil;
+}
+
+- (BOOL)decodeBoolForKey:(NSString *)key
+{
+	return [[self valueForCoderKey:key] boolValue];
+}
+
+- (int)decodeIntForKey:(NSString *)key
+{
+	return [[self valueForCoderKey:key] intValue];
+}
+
+- (int32_t)decodeInt32ForKey:(NSString *)key
+{
+	return [[self valueForCoderKey:key] intValue];
+}
+
+- (int64_t)decodeInt64ForKey:(NSString *)key
+{
+	return [[self valueForCoderKey:key] longLongValue];
+}
+
+- (NSInteger)decodeIntegerForKey:(NSString *)key
+{
+	return [[self valueForCoderKey:key] integerValue];
+}
+
+- (float)decodeFloatForKey:(NSString *)key
+{
+	return [[self valueForCoderKey:key] floatValue];
+}
+
+- (double)decodeDoubleForKey:(NSString *)key
+{
+	return [[self valueForCoderKey:key] doubleValue];
+}
+
+- (nullable const uint8_t *)decodeBytesForKey:(NSString *)key returnedLength:(nullable NSUInteger *)lengthp
+{
+	NSData *value = [self valueForCoderKey:key];
+	if (![value isKindOfClass:[NSData class]])
+	{
+		if (lengthp) *lengthp = 0;
+		return NULL;
+	}
+	
+	if (lengthp) *lengthp = value.length;
+	return (const uint8_t *)value.bytes;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCBinarySerializer
+
+/**
+ * See header file for description.
+ */
++ (BOOL)supportsObject:(id)object
+{
+	return (SchemaForClass([object classForKeyedArchiver]) != nil);
+}
+
+/**
+ * See header file for description.
+ */
++ (BOOL)isBinaryFormat:(NSData *)data
+{
+	if (data.length < HEADER_LENGTH) {
+		return NO;
+	}
+	
+	if (memcmp(data.bytes, kHeaderMagic, sizeof(kHeaderMagic)) != 0) {
+		return NO;
+	}
+	
+	uint8_t version = ((const uint8_t *)data.bytes)[sizeof(kHeaderMagic)];
+	return (version == FORMAT_VERSION_CURRENT);
+}
+
+/**
+ * See header file for description.
+ */
++ (NSData *)serializeObject:(id)object
+{
+	if ([self supportsObject:object])
+	{
+		ZDCBinaryEncoder *encoder = [[ZDCBinaryEncoder alloc] init];
+		
+		@try {
+			[encoder writeValue:object];
+		}
+		@catch (NSException *exception) {
+			
+			// Most likely the object's encodeWithCoder: uses an NSCoder method we don't support.
+			ZDCLogWarn(@"Unable to encode %@: %@", [object class], exception);
+			encoder = nil;
+		}
+		
+		if (encoder && !encoder.failed) {
+			return encoder.buffer;
+		}
+	}
+	
+	return [NSKeyedArchiver archivedDataWithRootObject:object];
+}
+
+/**
+ * See header file for description.
+ */
++ (nullable id)deserializeData:(NSData *)data
+{
+	if (![self isBinaryFormat:data])
+	{
+		// Legacy row (or unsupported class)
+		return [NSKeyedUnarchiver unarchiveObjectWithData:data];
+	}
+	
+	ZDCBinaryDecoder *decoder = [[ZDCBinaryDecoder alloc] initWithData:data];
+	id object = nil;
+	
+	@try {
+		object = [decoder readRootValue];
+	}
+	@catch (NSException *exception) {
+		
+		ZDCLogError(@"Unable to decode: %@", exception);
+		object = nil;
+	}
+	
+	return object;
+}
+
+@end
@@ -0,0 +1,151 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+#import <YapDatabase/YapDatabase.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A snapshot of the coalescer's counters.
+ */
+@interface ZDCDatabaseWriteCoalescerMetrics : NSObject
+
+/** The total number of read-write transactions committed by the coalescer. */
+@property (nonatomic, assign, readonly) uint64_t commitCount;
+
+/** The total number of blocks executed (across all commits). */
+@property (nonatomic, assign, readonly) uint64_t blockCount;
+
+/** The largest number of blocks executed within a single commit. */
+@property (nonatomic, assign, readonly) uint64_t maxBatchSize;
+
+/** blockCount / commitCount (or zero if nothing has been committed yet). */
+@property (nonatomic, assign, readonly) double averageBatchSize;
+
+/** The number of commits within the last 60 seconds, divided by 60. */
+@property (nonatomic, assign, readonly) double commitsPerSecond;
+
+/** The number of blocks waiting to be committed. */
+@property (nonatomic, assign, readonly) NSUInteger pendingCount;
+
+@end
+
+/**
+ * The PullManager, DownloadManager & PushManager perform lots of tiny database updates.
+ * (e.g. a full pull may update thousands of nodes, one at a time)
+ *
+ * If each one is executed in its own read-write transaction, then each one results in a separate sqlite commit,
+ * and a separate change notification that gets processed by every database connection (including the UI).
+ *
+ * The coalescer gathers these blocks over a short window (or until a size limit is reached),
+ * and executes them, in order, within a single read-write transaction.
+ *
+ * Blocks must NOT invoke `-[YapDatabaseReadWriteTransaction rollback]`,
+ * as doing so would rollback all the other blocks in the same batch.
+ *
+ * Ordering:
+ * The coalescer owns the internal read-write connection.
+ * All of the framework's internal writes go through the coalescer (coalesced or not),
+ * and are committed in the order in which they were submitted.
+ * Writing to the connection directly would break this guarantee,
+ * since a direct write could commit before coalesced writes that were submitted earlier.
+ */
+@interface ZDCDatabaseWriteCoalescer : NSObject
+
+/**
+ * Creates a coalescer that commits to the given connection.
+ *
+ * @param connection
+ *   The read-write connection to use.
+ *
+ * @param window
+ *   The maximum amount of time a block will wait before its batch gets committed.
+ *
+ * @param maxBatchSize
+ *   A batch is committed immediately once it contains this many blocks.
+ */
+- (instancetype)initWithConnection:(YapDatabaseConnection *)connection
+                            window:(NSTimeInterval)window
+                      maxBatchSize:(NSUInteger)maxBatchSize;
+
+/** The connection used for the commits. */
+@property (nonatomic, readonly) YapDatabaseConnection *connection;
+
+/**
+ * Drop-in replacement for `-[YapDatabaseConnection asyncReadWriteWithBlock:]`.
+ */
+- (void)asyncReadWriteWithBlock:(void (^)(YapDatabaseReadWriteTransaction *transaction))block;
+
+/**
+ * Drop-in replacement for `-[YapDatabaseConnection asyncReadWriteWithBlock:completionQueue:completionBlock:]`.
+ *
+ * The completionBlock is invoked after the batch containing the block has been committed.
+ * If the completionQueue is nil, the main queue is used.
+ */
+- (void)asyncReadWriteWithBlock:(void (^)(YapDatabaseReadWriteTransaction *transaction))block
+                completionQueue:(nullable dispatch_queue_t)completionQueue
+                completionBlock:(nullable dispatch_block_t)completionBlock;
+
+/**
+ * Executes the block within its own read-write transaction (i.e. it's not batched with other blocks).
+ * Use this for large transactions, or for blocks that may need to rollback.
+ *
+ * The block is still ordered with respect to the coalesced blocks:
+ * Any pending blocks (submitted before this one) are committed first.
+ */
+- (void)asyncUncoalescedReadWriteWithBlock:(void (^)(YapDatabaseReadWriteTransaction *transaction))block;
+
+/**
+ * Executes the block within its own read-write transaction (i.e. it's not batched with other blocks).
+ * Use this for large transactions, or for blocks that may need to rollback.
+ *
+ * The block is still ordered with respect to the coalesced blocks:
+ * Any pending blocks (submitted before this one) are committed first.
+ *
+ * If the completionQueue is nil, the main queue is used.
+ */
+- (void)asyncUncoalescedReadWriteWithBlock:(void (^)(YapDatabaseReadWriteTransaction *transaction))block
+                           completionQueue:(nullable dispatch_queue_t)completionQueue
+                           completionBlock:(nullable dispatch_block_t)completionBlock;
+
+/**
+ * Commits any pending blocks immediately (asynchronously), without waiting for the window to elapse.
+ */
+- (void)flush;
+
+/**
+ * Commits any pending blocks immediately,
+ * and invokes the completionBlock once every write submitted before this call has been committed.
+ *
+ * If the completionQueue is nil, the main queue is used.
+ */
+- (void)flushWithCompletionQueue:(nullable dispatch_queue_t)completionQueue
+                 completionBlock:(dispatch_block_t)completionBlock;
+
+/**
+ * Returns a snapshot of the coalescer's counters.
+ * Safe to call from anywhere, including from within the commitObserver.
+ */
+- (ZDCDatabaseWriteCoalescerMetrics *)metrics;
+
+/**
+ * Optional block, invoked after each commit (on an internal serial queue).
+ *
+ * @param duration
+ *   The time (in nanoseconds) from the start of the read-write transaction until the commit completed.
+ *
+ * @param batchSize
+ *   The number of blocks executed within the transaction.
+ */
+@property (atomic, copy, readwrite, nullable) void (^commitObserver)(uint64_t duration, NSUInteger batchSize);
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,346 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCDatabaseWriteCoalescer.h"
+
+#import "ZDCLogging.h"
+
+#include <time.h>
+
+// Log Levels: off, error, warning, info, verbose
+// Log Flags : trace
+#if DEBUG
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#else
+  static const int zdcLogLevel = ZDCLogLevelWarning;
+#endif
+#pragma unused(zdcLogLevel)
+
+/**
+ * The period over which `commitsPerSecond` is calculated.
+ */
+#define COMMIT_RATE_PERIOD 60.0
+
+typedef void (^ZDCReadWriteBlock)(YapDatabaseReadWriteTransaction *transaction);
+
+@interface ZDCDatabaseWriteCoalescerMetrics ()
+
+@property (nonatomic, assign, readwrite) uint64_t commitCount;
+@property (nonatomic, assign, readwrite) uint64_t blockCount;
+@property (nonatomic, assign, readwrite) uint64_t maxBatchSize;
+@property (nonatomic, assign, readwrite) double averageBatchSize;
+@property (nonatomic, assign, readwrite) double commitsPerSecond;
+@property (nonatomic, assign, readwrite) NSUInteger pendingCount;
+
+@end
+
+@implementation ZDCDatabaseWriteCoalescerMetrics
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:
+	  @"<ZDCDatabaseWriteCoalescerMetrics: commits=%llu blocks=%llu avgBatch=%.1f maxBatch=%llu commits/sec=%.2f pending=%lu>",
+	  self.commitCount, self.blockCount, self.averageBatchSize, self.maxBatchSize,
+	  self.commitsPerSecond, (unsigned long)self.pendingCount];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface ZDCCoalescedWrite : NSObject
+
+@property (nonatomic, copy, readwrite) ZDCReadWriteBlock block;
+@property (nonatomic, strong, readwrite, nullable) dispatch_queue_t completionQueue;
+@property (nonatomic, copy, readwrite, nullable) dispatch_block_t completionBlock;
+
+@end
+
+@implementation ZDCCoalescedWrite
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCDatabaseWriteCoalescer {
+	
+	NSTimeInterval window;
+	NSUInteger maxBatchSize;
+	
+	dispatch_queue_t queue;
+	void *IsOnQueueKey;
+	
+	NSMutableArray<ZDCCoalescedWrite *> *pending;
+	uint64_t batchGeneration; // incremented each time a batch is dispatched
+	BOOL flushScheduled;
+	
+	uint64_t commitCount;
+	uint64_t blockCount;
+	uint64_t largestBatch;
+	NSMutableArray<NSDate *> *recentCommits;
+}
+
+@synthesize connection = connection;
+@synthesize commitObserver = commitObserver;
+
+- (instancetype)init
+{
+	return nil; // Use initWithConnection:window:maxBatchSize:
+}
+
+- (instancetype)initWithConnection:(YapDatabaseConnection *)inConnection
+                            window:(NSTimeInterval)inWindow
+                      maxBatchSize:(NSUInteger)inMaxBatchSize
+{
+	if ((self = [super init]))
+	{
+		connection = inConnection;
+		window = inWindow;
+		maxBatchSize = MAX(1, inMaxBatchSize);
+		
+		queue = dispatch_queue_create("ZDCDatabaseWriteCoalescer", DISPATCH_QUEUE_SERIAL);
+		
+		IsOnQueueKey = &IsOnQueueKey;
+		dispatch_queue_set_specific(queue, IsOnQueueKey, IsOnQueueKey, NULL);
+		
+		pending = [[NSMutableArray alloc] init];
+		recentCommits = [[NSMutableArray alloc] init];
+	}
+	return self;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Writes
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * See header file for description.
+ */
+- (void)asyncReadWriteWithBlock:(void (^)(YapDatabaseReadWriteTransaction *transaction))block
+{
+	[self asyncReadWriteWithBlock:block completionQueue:nil completionBlock:nil];
+}
+
+/**
+ * See header file for description.
+ */
+- (void)asyncReadWriteWithBlock:(void (^)(YapDatabaseReadWriteTransaction *transaction))block
+                completionQueue:(nullable dispatch_queue_t)completionQueue
+                completionBlock:(nullable dispatch_block_t)completionBlock
+{
+	NSParameterAssert(block != nil);
+	
+	ZDCCoalescedWrite *write = [[ZDCCoalescedWrite alloc] init];
+	write.block = block;
+	write.completionQueue = completionQueue;
+	write.completionBlock = completionBlock;
+	
+	dispatch_async(queue, ^{ @autoreleasepool {
+		
+		[self->pending addObject:write];
+		
+		if (self->pending.count >= self->maxBatchSize)
+		{
+			[self _dispatchBatch];
+		}
+		else if (!self->flushScheduled)
+		{
+			self->flushScheduled = YES;
+			uint64_t generation = self->batchGeneration;
+			
+			dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self->window * NSEC_PER_SEC));
+			dispatch_after(when, self->queue, ^{ @autoreleasepool {
+				
+				// Skip if the batch was already dispatched (e.g. it hit the size limit).
+				if (self->batchGeneration == generation) {
+					[self _dispatchBatch];
+				}
+			}});
+		}
+	}});
+}
+
+/**
+ * See header file for description.
+ */
+- (void)asyncUncoalescedReadWriteWithBlock:(void (^)(YapDatabaseReadWriteTransaction *transaction))block
+{
+	[self asyncUncoalescedReadWriteWithBlock:block completionQueue:nil completionBlock:nil];
+}
+
+/**
+ * See header file for description.
+ */
+- (void)asyncUncoalescedReadWriteWithBlock:(void (^)(YapDatabaseReadWriteTransaction *transaction))block
+                           completionQueue:(nullable dispatch_queue_t)completionQueue
+                           completionBlock:(nullable dispatch_block_t)completionBlock
+{
+	NSParameterAssert(block != nil);
+	
+	dispatch_async(queue, ^{ @autoreleasepool {
+		
+		// The connection executes its read-write transactions in FIFO order.
+		// So dispatching the pending batch first ensures it commits before this block.
+		
+		[self _dispatchBatch];
+		
+		[self->connection asyncReadWriteWithBlock: block
+		                          completionQueue: completionQueue ?: dispatch_get_main_queue()
+		                          completionBlock: completionBlock];
+	}});
+}
+
+/**
+ * See header file for description.
+ */
+- (void)flush
+{
+	dispatch_async(queue, ^{ @autoreleasepool {
+		
+		[self _dispatchBatch];
+	}});
+}
+
+/**
+ * See header file for description.
+ */
+- (void)flushWithCompletionQueue:(nullable dispatch_queue_t)completionQueue
+                 completionBlock:(dispatch_block_t)completionBlock
+{
+	NSParameterAssert(completionBlock != nil);
+	
+	dispatch_async(queue, ^{ @autoreleasepool {
+		
+		[self _dispatchBatch];
+		
+		[self->connection flushTransactionsWithCompletionQueue: completionQueue ?: dispatch_get_main_queue()
+		                                       completionBlock: completionBlock];
+	}});
+}
+
+/**
+ * Must be invoked on `queue`.
+ */
+- (void)_dispatchBatch
+{
+	flushScheduled = NO;
+	batchGeneration++;
+	
+	if (pending.count == 0) return;
+	
+	NSArray<ZDCCoalescedWrite *> *batch = [pending copy];
+	[pending removeAllObjects];
+	
+	__block uint64_t startTime = 0;
+	
+	[connection asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		startTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+		
+		for (ZDCCoalescedWrite *write in batch)
+		{
+			@autoreleasepool {
+				write.block(transaction);
+			}
+		}
+		
+	} completionQueue:queue completionBlock:^{
+		
+		uint64_t duration = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - startTime;
+		[self _didCommitBatch:batch duration:duration];
+	}];
+}
+
+/**
+ * Must be invoked on `queue`.
+ */
+- (void)_didCommitBatch:(NSArray<ZDCCoalescedWrite *> *)batch duration:(uint64_t)duration
+{
+	commitCount++;
+	blockCount += batch.count;
+	largestBatch = MAX(largestBatch, (uint64_t)batch.count);
+	
+	[recentCommits addObject:[NSDate date]];
+	[self _pruneRecentCommits];
+	
+	for (ZDCCoalescedWrite *write in batch)
+	{
+		if (write.completionBlock)
+		{
+			dispatch_async(write.completionQueue ?: dispatch_get_main_queue(), write.completionBlock);
+		}
+	}
+	
+	void (^observer)(uint64_t, NSUInteger) = self.commitObserver;
+	if (observer) {
+		observer(duration, batch.count);
+	}
+	
+	ZDCLogVerbose(@"Committed batch of %lu write(s)", (unsigned long)batch.count);
+}
+
+/**
+ * Must be invoked on `queue`.
+ */
+- (void)_pruneRecentCommits
+{
+	NSDate *cutoff = [NSDate dateWithTimeIntervalSinceNow:-COMMIT_RATE_PERIOD];
+	
+	NSUInteger count = 0;
+	for (NSDate *date in recentCommits)
+	{
+		if ([date compare:cutoff] == NSOrderedAscending)
+			count++;
+		else
+			break;
+	}
+	
+	if (count > 0) {
+		[recentCommits removeObjectsInRange:NSMakeRange(0, count)];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Metrics
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * See header file for description.
+ */
+- (ZDCDatabaseWriteCoalescerMetrics *)metrics
+{
+	ZDCDatabaseWriteCoalescerMetrics *metrics = [[ZDCDatabaseWriteCoalescerMetrics alloc] init];
+	
+	dispatch_block_t block = ^{ @autoreleasepool {
+		
+		[self _pruneRecentCommits];
+		
+		metrics.commitCount = self->commitCount;
+		metrics.blockCount = self->blockCount;
+		metrics.maxBatchSize = self->largestBatch;
+		metrics.averageBatchSize = (self->commitCount > 0) ? ((double)self->blockCount / (double)self->commitCount) : 0.0;
+		metrics.commitsPerSecond = (double)self->recentCommits.count / COMMIT_RATE_PERIOD;
+		metrics.pendingCount = self->pending.count;
+	}};
+	
+	// The commitObserver is invoked on our queue, and may ask for the metrics.
+	// So a dispatch_sync here would deadlock.
+	
+	if (dispatch_get_specific(IsOnQueueKey))
+		block();
+	else
+		dispatch_sync(queue, block);
+	
+	return metrics;
+}
+
+@end
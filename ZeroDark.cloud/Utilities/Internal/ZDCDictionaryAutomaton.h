@@ -0,0 +1,87 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Invoked for every dictionary word found within the string.
+ *
+ * @param range
+ *   The range of the word within the string.
+ *
+ * @param dictionaryIndex
+ *   Index into `dictionaryNames`.
+ *
+ * @param rank
+ *   The (1-based) position of the word within its dictionary's list.
+ */
+typedef void (^ZDCDictionaryMatchBlock)(NSRange range, NSUInteger dictionaryIndex, NSUInteger rank);
+
+/**
+ * An Aho-Corasick automaton over one or more ranked word lists,
+ * stored in a flat binary format that can be memory-mapped.
+ *
+ * The password strength estimator needs to find every dictionary word within a password.
+ * Doing so with a hash table means allocating a string for all O(n^2) substrings.
+ * The automaton instead finds all the matches (across all dictionaries) in a single pass,
+ * without allocating anything.
+ *
+ * The binary format is in native byte order, and is intended to be cached on the local device.
+ * It's generated via `compileDictionaries:fingerprint:`.
+ */
+@interface ZDCDictionaryAutomaton : NSObject
+
+/**
+ * Compiles the given word lists into the binary format.
+ *
+ * @param dictionaries
+ *   - key   : dictionary name
+ *   - value : list of words, ordered by rank (most common first)
+ *
+ * @param fingerprint
+ *   An arbitrary value, stored in the header.
+ *   Use it to detect when a cached automaton is stale (e.g. a hash of the source file's attributes).
+ */
++ (NSData *)compileDictionaries:(NSDictionary<NSString*, NSArray<NSString*>*> *)dictionaries
+                    fingerprint:(uint64_t)fingerprint;
+
+/**
+ * Memory-maps the given file (which must have been created by `compileDictionaries:fingerprint:`).
+ * Returns nil if the file doesn't exist, or isn't valid.
+ */
++ (nullable instancetype)automatonWithContentsOfURL:(NSURL *)url;
+
+/**
+ * Returns nil if the data isn't valid.
+ *
+ * The entire structure is validated (ranges, node indexes & depths), so a corrupt cache file is rejected,
+ * rather than read out of bounds during matching.
+ */
+- (nullable instancetype)initWithData:(NSData *)data;
+
+/** The value that was passed to `compileDictionaries:fingerprint:`. */
+@property (nonatomic, readonly) uint64_t fingerprint;
+
+/** The names of the compiled dictionaries (sorted). */
+@property (nonatomic, readonly) NSArray<NSString*> *dictionaryNames;
+
+/**
+ * Finds every dictionary word within the given characters (including overlapping words).
+ *
+ * Matching is case-sensitive. Since the dictionaries are lowercase, the caller should lowercase the input.
+ */
+- (void)enumerateMatchesInCharacters:(const unichar *)characters
+                              length:(NSUInteger)length
+                          usingBlock:(NS_NOESCAPE ZDCDictionaryMatchBlock)block;
+
+@end
+
+NS_ASSUME_NONNULL_END
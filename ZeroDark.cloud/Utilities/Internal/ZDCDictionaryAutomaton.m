@@ -0,0 +1,658 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCDictionaryAutomaton.h"
+
+#define ZDC_AUTOMATON_MAGIC   0x5A444341 // 'ZDCA'
+#define ZDC_AUTOMATON_VERSION 1
+
+/**
+ * Outputs are packed as: (dictionaryIndex << 24) | rank
+ */
+#define MAX_DICTIONARY_COUNT 256
+#define MAX_RANK             ((1 << 24) - 1)
+
+/**
+ * Node depth is stored as a uint16_t.
+ */
+#define MAX_WORD_LENGTH UINT16_MAX
+
+typedef struct {
+	
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nodeCount;
+	uint32_t edgeCount;
+	uint32_t outputCount;
+	uint32_t dictionaryCount;
+	uint32_t namesLength;
+	uint32_t reserved;
+	uint64_t fingerprint;
+	
+} ZDCAutomatonHeader;
+
+// The header is followed by:
+//
+// uint32_t edgeStart[nodeCount + 1]   : edges of node N are [edgeStart[N], edgeStart[N+1])
+// uint32_t fail[nodeCount]            : node for the longest proper suffix
+// uint32_t dictLink[nodeCount]        : nearest node along the fail chain that has outputs
+// uint32_t outputStart[nodeCount + 1] : outputs of node N are [outputStart[N], outputStart[N+1])
+// uint32_t edgeTarget[edgeCount]
+// uint32_t outputs[outputCount]
+// uint16_t edgeLabel[edgeCount]       : sorted per node (for binary search)
+// uint16_t depth[nodeCount]           : length of the word spelled by the node
+// (padding to 4 bytes)
+// char     names[namesLength]         : NUL-terminated dictionary names
+//
+// Node 0 is the root. The root is never the target of an edge (or a dictLink),
+// so 0 doubles as "no node".
+
+typedef struct {
+	
+	size_t edgeStart;
+	size_t fail;
+	size_t dictLink;
+	size_t outputStart;
+	size_t edgeTarget;
+	size_t outputs;
+	size_t edgeLabel;
+	size_t depth;
+	size_t names;
+	size_t total;
+	
+} ZDCAutomatonLayout;
+
+static ZDCAutomatonLayout ZDCAutomatonLayoutMake(uint32_t nodeCount,
+                                                 uint32_t edgeCount,
+                                                 uint32_t outputCount,
+                                                 uint32_t namesLength)
+{
+	ZDCAutomatonLayout layout;
+	size_t offset = sizeof(ZDCAutomatonHeader);
+	
+	layout.edgeStart   = offset; offset += sizeof(uint32_t) * ((size_t)nodeCount + 1);
+	layout.fail        = offset; offset += sizeof(uint32_t) * nodeCount;
+	layout.dictLink    = offset; offset += sizeof(uint32_t) * nodeCount;
+	layout.outputStart = offset; offset += sizeof(uint32_t) * ((size_t)nodeCount + 1);
+	layout.edgeTarget  = offset; offset += sizeof(uint32_t) * edgeCount;
+	layout.outputs     = offset; offset += sizeof(uint32_t) * outputCount;
+	layout.edgeLabel   = offset; offset += sizeof(uint16_t) * edgeCount;
+	layout.depth       = offset; offset += sizeof(uint16_t) * nodeCount;
+	
+	offset = (offset + 3) & ~((size_t)3);
+	
+	layout.names       = offset; offset += namesLength;
+	layout.total       = offset;
+	
+	return layout;
+}
+
+static inline uint32_t ZDCAutomatonChild(const uint32_t *edgeStart,
+                                         const uint16_t *edgeLabel,
+                                         const uint32_t *edgeTarget,
+                                         uint32_t node, unichar c)
+{
+	uint32_t lo = edgeStart[node];
+	uint32_t hi = edgeStart[node + 1];
+	
+	while (lo < hi)
+	{
+		uint32_t mid = lo + ((hi - lo) >> 1);
+		unichar label = edgeLabel[mid];
+		
+		if (label == c)
+			return edgeTarget[mid];
+		else if (label < c)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	
+	return 0;
+}
+
+/**
+ * The file is memory-mapped from the cache directory, so it can't be trusted.
+ * Every index is checked here, so enumerating matches can never read out of bounds (or loop forever):
+ *
+ * - the edge & output ranges are contiguous, and end at edgeCount & outputCount
+ * - every edge target, fail & dictLink is a valid node
+ * - every edge leads one level deeper, and every fail & dictLink leads at least one level shallower
+ *   (so the fail & dictLink chains always end at the root, and match ranges never start before the input)
+ * - edge labels are sorted per node (required by the binary search)
+ * - every output refers to a valid dictionary
+ */
+static BOOL ZDCAutomatonValidate(const ZDCAutomatonHeader *header,
+                                 const uint32_t *edgeStart,
+                                 const uint32_t *fail,
+                                 const uint32_t *dictLink,
+                                 const uint32_t *outputStart,
+                                 const uint32_t *edgeTarget,
+                                 const uint32_t *outputs,
+                                 const uint16_t *edgeLabel,
+                                 const uint16_t *depth)
+{
+	const uint32_t nodeCount = header->nodeCount;
+	
+	if (edgeStart[0] != 0 || edgeStart[nodeCount] != header->edgeCount) return NO;
+	if (outputStart[0] != 0 || outputStart[nodeCount] != header->outputCount) return NO;
+	if (depth[0] != 0 || fail[0] != 0 || dictLink[0] != 0) return NO;
+	
+	for (uint32_t u = 0; u < nodeCount; u++)
+	{
+		if (edgeStart[u + 1] < edgeStart[u]) return NO;
+		if (outputStart[u + 1] < outputStart[u]) return NO;
+		
+		if (u > 0)
+		{
+			if (fail[u] >= nodeCount || depth[fail[u]] >= depth[u]) return NO;
+			if (dictLink[u] >= nodeCount || depth[dictLink[u]] >= depth[u]) return NO;
+		}
+	}
+	
+	for (uint32_t u = 0; u < nodeCount; u++)
+	{
+		for (uint32_t e = edgeStart[u]; e < edgeStart[u + 1]; e++)
+		{
+			uint32_t v = edgeTarget[e];
+			
+			if (v == 0 || v >= nodeCount) return NO;
+			if (depth[v] != (depth[u] + 1)) return NO;
+			if ((e > edgeStart[u]) && (edgeLabel[e - 1] >= edgeLabel[e])) return NO;
+		}
+	}
+	
+	for (uint32_t o = 0; o < header->outputCount; o++)
+	{
+		if ((outputs[o] >> 24) >= header->dictionaryCount) return NO;
+	}
+	
+	return YES;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Compiler
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	
+	uint32_t firstChild;
+	uint32_t nextSibling;
+	unichar label;
+	
+} ZDCTrieBuildNode;
+
+typedef struct {
+	
+	uint32_t node;
+	uint32_t value; // (dictionaryIndex << 24) | rank
+	uint32_t seq;
+	
+} ZDCTrieBuildOutput;
+
+static int ZDCTrieBuildOutputCompare(const void *a, const void *b)
+{
+	const ZDCTrieBuildOutput *x = (const ZDCTrieBuildOutput *)a;
+	const ZDCTrieBuildOutput *y = (const ZDCTrieBuildOutput *)b;
+	
+	if (x->node != y->node) return (x->node < y->node) ? -1 : 1;
+	
+	uint32_t xDict = x->value >> 24;
+	uint32_t yDict = y->value >> 24;
+	if (xDict != yDict) return (xDict < yDict) ? -1 : 1;
+	
+	if (x->seq != y->seq) return (x->seq < y->seq) ? -1 : 1;
+	
+	return 0;
+}
+
+/**
+ * Returns the child of the given node with the given label, creating it if needed.
+ */
+static uint32_t ZDCTrieBuildChild(NSMutableData *buildNodes, uint32_t parent, unichar label)
+{
+	ZDCTrieBuildNode *nodes = (ZDCTrieBuildNode *)buildNodes.mutableBytes;
+	
+	for (uint32_t child = nodes[parent].firstChild; child != 0; child = nodes[child].nextSibling)
+	{
+		if (nodes[child].label == label) {
+			return child;
+		}
+	}
+	
+	uint32_t child = (uint32_t)(buildNodes.length / sizeof(ZDCTrieBuildNode));
+	
+	ZDCTrieBuildNode node = {
+		.firstChild = 0,
+		.nextSibling = nodes[parent].firstChild,
+		.label = label
+	};
+	[buildNodes appendBytes:&node length:sizeof(node)];
+	
+	nodes = (ZDCTrieBuildNode *)buildNodes.mutableBytes; // may have moved
+	nodes[parent].firstChild = child;
+	
+	return child;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCDictionaryAutomaton {
+	
+	NSData *data;
+	
+	uint32_t nodeCount;
+	
+	const uint32_t *edgeStart;
+	const uint32_t *fail;
+	const uint32_t *dictLink;
+	const uint32_t *outputStart;
+	const uint32_t *edgeTarget;
+	const uint32_t *outputs;
+	const uint16_t *edgeLabel;
+	const uint16_t *depth;
+}
+
+@synthesize fingerprint = fingerprint;
+@synthesize dictionaryNames = dictionaryNames;
+
+/**
+ * See header file for description.
+ */
++ (NSData *)compileDictionaries:(NSDictionary<NSString*, NSArray<NSString*>*> *)dictionaries
+                    fingerprint:(uint64_t)fingerprint
+{
+	NSArray<NSString*> *names = [dictionaries.allKeys sortedArrayUsingSelector:@selector(compare:)];
+	if (names.count > MAX_DICTIONARY_COUNT) {
+		names = [names subarrayWithRange:NSMakeRange(0, MAX_DICTIONARY_COUNT)];
+	}
+	
+	// Step 1 of 4:
+	//
+	// Build a plain trie (children stored as linked lists).
+	
+	NSMutableData *buildNodes = [NSMutableData dataWithLength:sizeof(ZDCTrieBuildNode)]; // root
+	NSMutableData *buildOutputs = [NSMutableData data];
+	
+	unichar *wordBuffer = NULL;
+	NSUInteger wordBufferLength = 0;
+	uint32_t seq = 0;
+	
+	for (NSUInteger dictIdx = 0; dictIdx < names.count; dictIdx++)
+	{
+		NSArray *list = dictionaries[names[dictIdx]];
+		if (![list isKindOfClass:[NSArray class]]) continue;
+		
+		NSUInteger rank = 0;
+		for (NSString *word in list)
+		{
+			rank++;
+			if (rank > MAX_RANK) break;
+			
+			if (![word isKindOfClass:[NSString class]]) continue;
+			
+			NSUInteger wordLength = word.length;
+			if (wordLength == 0 || wordLength > MAX_WORD_LENGTH) continue;
+			
+			if (wordLength > wordBufferLength)
+			{
+				wordBufferLength = wordLength;
+				wordBuffer = reallocf(wordBuffer, wordBufferLength * sizeof(unichar));
+			}
+			[word getCharacters:wordBuffer range:NSMakeRange(0, wordLength)];
+			
+			uint32_t node = 0;
+			for (NSUInteger i = 0; i < wordLength; i++)
+			{
+				node = ZDCTrieBuildChild(buildNodes, node, wordBuffer[i]);
+			}
+			
+			ZDCTrieBuildOutput output = {
+				.node = node,
+				.value = (uint32_t)((dictIdx << 24) | rank),
+				.seq = seq++
+			};
+			[buildOutputs appendBytes:&output length:sizeof(output)];
+		}
+	}
+	
+	free(wordBuffer);
+	
+	// Step 2 of 4:
+	//
+	// Renumber the nodes in breadth-first order, so each node's edges are contiguous (and sorted).
+	
+	const ZDCTrieBuildNode *nodes = (const ZDCTrieBuildNode *)buildNodes.bytes;
+	const uint32_t nodeCount = (uint32_t)(buildNodes.length / sizeof(ZDCTrieBuildNode));
+	const uint32_t edgeCount = nodeCount - 1;
+	
+	uint32_t *order      = malloc(sizeof(uint32_t) * nodeCount); // final => build
+	uint32_t *finalID    = malloc(sizeof(uint32_t) * nodeCount); // build => final
+	uint32_t *scratch    = malloc(sizeof(uint32_t) * nodeCount);
+	
+	uint32_t *edgeStart  = malloc(sizeof(uint32_t) * ((size_t)nodeCount + 1));
+	uint32_t *edgeTarget = malloc(sizeof(uint32_t) * MAX(edgeCount, 1));
+	uint16_t *edgeLabel  = malloc(sizeof(uint16_t) * MAX(edgeCount, 1));
+	uint16_t *depth      = malloc(sizeof(uint16_t) * nodeCount);
+	
+	uint32_t head = 0;
+	uint32_t tail = 0;
+	uint32_t edgeIdx = 0;
+	
+	order[tail] = 0;
+	finalID[0] = 0;
+	depth[0] = 0;
+	tail++;
+	
+	while (head < tail)
+	{
+		uint32_t u = head++;
+		uint32_t b = order[u];
+		
+		edgeStart[u] = edgeIdx;
+		
+		uint32_t childCount = 0;
+		for (uint32_t child = nodes[b].firstChild; child != 0; child = nodes[child].nextSibling)
+		{
+			scratch[childCount++] = child;
+		}
+		
+		// Insertion sort by label (fan-out is small, except for the root)
+		for (uint32_t i = 1; i < childCount; i++)
+		{
+			uint32_t child = scratch[i];
+			uint32_t j = i;
+			while (j > 0 && nodes[scratch[j-1]].label > nodes[child].label)
+			{
+				scratch[j] = scratch[j-1];
+				j--;
+			}
+			scratch[j] = child;
+		}
+		
+		for (uint32_t i = 0; i < childCount; i++)
+		{
+			uint32_t v = tail++;
+			
+			order[v] = scratch[i];
+			finalID[scratch[i]] = v;
+			depth[v] = depth[u] + 1;
+			
+			edgeLabel[edgeIdx] = nodes[scratch[i]].label;
+			edgeTarget[edgeIdx] = v;
+			edgeIdx++;
+		}
+	}
+	edgeStart[nodeCount] = edgeIdx;
+	
+	// Step 3 of 4:
+	//
+	// Outputs: sort by node, and dedupe.
+	// If a word appears multiple times within the same list, the last occurrence wins.
+	// (This matches the behavior of the NSDictionary based matcher.)
+	
+	ZDCTrieBuildOutput *buildOutputsPtr = (ZDCTrieBuildOutput *)buildOutputs.mutableBytes;
+	NSUInteger buildOutputCount = buildOutputs.length / sizeof(ZDCTrieBuildOutput);
+	
+	for (NSUInteger i = 0; i < buildOutputCount; i++)
+	{
+		buildOutputsPtr[i].node = finalID[buildOutputsPtr[i].node];
+	}
+	qsort(buildOutputsPtr, buildOutputCount, sizeof(ZDCTrieBuildOutput), ZDCTrieBuildOutputCompare);
+	
+	uint32_t *outputStart = calloc((size_t)nodeCount + 1, sizeof(uint32_t));
+	uint32_t *outputs = malloc(sizeof(uint32_t) * MAX(buildOutputCount, 1));
+	uint32_t outputCount = 0;
+	
+	for (NSUInteger i = 0; i < buildOutputCount; i++)
+	{
+		const ZDCTrieBuildOutput *output = &buildOutputsPtr[i];
+		
+		if ((i + 1) < buildOutputCount)
+		{
+			const ZDCTrieBuildOutput *next = &buildOutputsPtr[i + 1];
+			if ((next->node == output->node) && ((next->value >> 24) == (output->value >> 24))) {
+				continue; // superseded by a later occurrence
+			}
+		}
+		
+		outputs[outputCount++] = output->value;
+		outputStart[output->node + 1]++;
+	}
+	
+	for (uint32_t u = 0; u < nodeCount; u++)
+	{
+		outputStart[u + 1] += outputStart[u];
+	}
+	
+	// Step 4 of 4:
+	//
+	// Failure links & dictionary links (in breadth-first order, so parents are always done first).
+	
+	uint32_t *fail = calloc(nodeCount, sizeof(uint32_t));
+	uint32_t *dictLink = calloc(nodeCount, sizeof(uint32_t));
+	
+	for (uint32_t u = 0; u < nodeCount; u++)
+	{
+		if (u > 0)
+		{
+			uint32_t f = fail[u];
+			dictLink[u] = (outputStart[f + 1] > outputStart[f]) ? f : dictLink[f];
+		}
+		
+		for (uint32_t e = edgeStart[u]; e < edgeStart[u + 1]; e++)
+		{
+			uint32_t v = edgeTarget[e];
+			
+			if (u == 0)
+			{
+				fail[v] = 0;
+				continue;
+			}
+			
+			uint32_t f = fail[u];
+			for (;;)
+			{
+				uint32_t next = ZDCAutomatonChild(edgeStart, edgeLabel, edgeTarget, f, edgeLabel[e]);
+				if (next != 0)
+				{
+					fail[v] = next;
+					break;
+				}
+				if (f == 0)
+				{
+					fail[v] = 0;
+					break;
+				}
+				f = fail[f];
+			}
+		}
+	}
+	
+	// Assemble
+	
+	NSMutableData *namesData = [NSMutableData data];
+	for (NSString *name in names)
+	{
+		const char *utf8 = [name UTF8String];
+		[namesData appendBytes:utf8 length:(strlen(utf8) + 1)];
+	}
+	
+	ZDCAutomatonLayout layout =
+	  ZDCAutomatonLayoutMake(nodeCount, edgeCount, outputCount, (uint32_t)namesData.length);
+	
+	NSMutableData *result = [NSMutableData dataWithLength:layout.total];
+	uint8_t *bytes = (uint8_t *)result.mutableBytes;
+	
+	ZDCAutomatonHeader header = {
+		.magic           = ZDC_AUTOMATON_MAGIC,
+		.version         = ZDC_AUTOMATON_VERSION,
+		.nodeCount       = nodeCount,
+		.edgeCount       = edgeCount,
+		.outputCount     = outputCount,
+		.dictionaryCount = (uint32_t)names.count,
+		.namesLength     = (uint32_t)namesData.length,
+		.reserved        = 0,
+		.fingerprint     = fingerprint
+	};
+	memcpy(bytes, &header, sizeof(header));
+	
+	memcpy(bytes + layout.edgeStart,   edgeStart,   sizeof(uint32_t) * ((size_t)nodeCount + 1));
+	memcpy(bytes + layout.fail,        fail,        sizeof(uint32_t) * nodeCount);
+	memcpy(bytes + layout.dictLink,    dictLink,    sizeof(uint32_t) * nodeCount);
+	memcpy(bytes + layout.outputStart, outputStart, sizeof(uint32_t) * ((size_t)nodeCount + 1));
+	memcpy(bytes + layout.edgeTarget,  edgeTarget,  sizeof(uint32_t) * edgeCount);
+	memcpy(bytes + layout.outputs,     outputs,     sizeof(uint32_t) * outputCount);
+	memcpy(bytes + layout.edgeLabel,   edgeLabel,   sizeof(uint16_t) * edgeCount);
+	memcpy(bytes + layout.depth,       depth,       sizeof(uint16_t) * nodeCount);
+	memcpy(bytes + layout.names,       namesData.bytes, namesData.length);
+	
+	free(order);
+	free(finalID);
+	free(scratch);
+	free(edgeStart);
+	free(edgeTarget);
+	free(edgeLabel);
+	free(depth);
+	free(outputStart);
+	free(outputs);
+	free(fail);
+	free(dictLink);
+	
+	return result;
+}
+
+/**
+ * See header file for description.
+ */
++ (instancetype)automatonWithContentsOfURL:(NSURL *)url
+{
+	NSData *data = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:nil];
+	if (data == nil) return nil;
+	
+	return [[self alloc] initWithData:data];
+}
+
+- (instancetype)init
+{
+	return nil; // Use initWithData:
+}
+
+/**
+ * See header file for description.
+ */
+- (instancetype)initWithData:(NSData *)inData
+{
+	if (inData.length < sizeof(ZDCAutomatonHeader)) return nil;
+	
+	ZDCAutomatonHeader header;
+	memcpy(&header, inData.bytes, sizeof(header));
+	
+	if (header.magic != ZDC_AUTOMATON_MAGIC) return nil;
+	if (header.version != ZDC_AUTOMATON_VERSION) return nil;
+	if (header.nodeCount == 0 || header.edgeCount != (header.nodeCount - 1)) return nil;
+	if (header.dictionaryCount > MAX_DICTIONARY_COUNT) return nil;
+	
+	ZDCAutomatonLayout layout =
+	  ZDCAutomatonLayoutMake(header.nodeCount, header.edgeCount, header.outputCount, header.namesLength);
+	
+	if (inData.length < layout.total) return nil;
+	
+	if ((self = [super init]))
+	{
+		data = inData;
+		fingerprint = header.fingerprint;
+		nodeCount = header.nodeCount;
+		
+		const uint8_t *bytes = (const uint8_t *)data.bytes;
+		
+		edgeStart   = (const uint32_t *)(bytes + layout.edgeStart);
+		fail        = (const uint32_t *)(bytes + layout.fail);
+		dictLink    = (const uint32_t *)(bytes + layout.dictLink);
+		outputStart = (const uint32_t *)(bytes + layout.outputStart);
+		edgeTarget  = (const uint32_t *)(bytes + layout.edgeTarget);
+		outputs     = (const uint32_t *)(bytes + layout.outputs);
+		edgeLabel   = (const uint16_t *)(bytes + layout.edgeLabel);
+		depth       = (const uint16_t *)(bytes + layout.depth);
+		
+		if (!ZDCAutomatonValidate(&header, edgeStart, fail, dictLink, outputStart,
+		                          edgeTarget, outputs, edgeLabel, depth)) return nil;
+		
+		NSMutableArray<NSString*> *names = [NSMutableArray arrayWithCapacity:header.dictionaryCount];
+		
+		const char *namesPtr = (const char *)(bytes + layout.names);
+		const char *namesEnd = namesPtr + header.namesLength;
+		
+		for (uint32_t i = 0; i < header.dictionaryCount; i++)
+		{
+			const char *nul = memchr(namesPtr, '\0', (size_t)(namesEnd - namesPtr));
+			if (nul == NULL) return nil;
+			
+			NSString *name = [[NSString alloc] initWithUTF8String:namesPtr];
+			if (name == nil) return nil;
+			
+			[names addObject:name];
+			namesPtr = nul + 1;
+		}
+		
+		dictionaryNames = [names copy];
+	}
+	return self;
+}
+
+/**
+ * See header file for description.
+ */
+- (void)enumerateMatchesInCharacters:(const unichar *)characters
+                              length:(NSUInteger)length
+                          usingBlock:(NS_NOESCAPE ZDCDictionaryMatchBlock)block
+{
+	uint32_t state = 0;
+	
+	for (NSUInteger i = 0; i < length; i++)
+	{
+		unichar c = characters[i];
+		
+		for (;;)
+		{
+			uint32_t next = ZDCAutomatonChild(edgeStart, edgeLabel, edgeTarget, state, c);
+			if (next != 0)
+			{
+				state = next;
+				break;
+			}
+			if (state == 0) {
+				break;
+			}
+			state = fail[state];
+		}
+		
+		// Report every word that ends at this position:
+		// the current node (if it's a word), plus every word along its dictLink chain.
+		
+		uint32_t node = (outputStart[state + 1] > outputStart[state]) ? state : dictLink[state];
+		while (node != 0)
+		{
+			NSUInteger wordLength = depth[node];
+			NSRange range = NSMakeRange(i + 1 - wordLength, wordLength);
+			
+			for (uint32_t o = outputStart[node]; o < outputStart[node + 1]; o++)
+			{
+				uint32_t output = outputs[o];
+				block(range, (output >> 24), (output & MAX_RANK));
+			}
+			
+			node = dictLink[node];
+		}
+	}
+}
+
+@end
@@ -0,0 +1,117 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class ZDCJSONStreamDecoder;
+
+/**
+ * Receives the events from a ZDCJSONStreamDecoder, in document order.
+ */
+@protocol ZDCJSONStreamDecoderDelegate <NSObject>
+@required
+
+- (void)jsonDecoderDidBeginObject:(ZDCJSONStreamDecoder *)decoder;
+- (void)jsonDecoderDidEndObject:(ZDCJSONStreamDecoder *)decoder;
+
+- (void)jsonDecoderDidBeginArray:(ZDCJSONStreamDecoder *)decoder;
+- (void)jsonDecoderDidEndArray:(ZDCJSONStreamDecoder *)decoder;
+
+/**
+ * Invoked for each key within an object. The key's value is reported next.
+ */
+- (void)jsonDecoder:(ZDCJSONStreamDecoder *)decoder didDecodeKey:(NSString *)key;
+
+/**
+ * Invoked for each scalar value (NSString, NSNumber or NSNull),
+ * and for captured values (see `captureValue`), which may also be an NSDictionary or NSArray.
+ */
+- (void)jsonDecoder:(ZDCJSONStreamDecoder *)decoder didDecodeValue:(id)value;
+
+@end
+
+/**
+ * An incremental (push-style) JSON decoder.
+ *
+ * NSJSONSerialization requires the entire document up-front, and always builds the full object graph.
+ * Which is wasteful when the caller is only going to walk the graph to create its own model objects.
+ *
+ * This decoder instead accepts the document in chunks (e.g. as they arrive from the network),
+ * and reports each token to its delegate as soon as it's complete.
+ * Only the bytes of an incomplete token are buffered between chunks.
+ *
+ * The delegate can ask the decoder to skip the next value (nothing gets allocated for it),
+ * or to capture the next value (it gets delivered as a single NSDictionary/NSArray),
+ * which is handy for sub-trees the model object stores as-is.
+ *
+ * The decoder is not thread-safe. The caller must ensure the chunks are appended serially.
+ */
+@interface ZDCJSONStreamDecoder : NSObject
+
+- (instancetype)initWithDelegate:(id<ZDCJSONStreamDecoderDelegate>)delegate;
+
+@property (nonatomic, weak, readonly, nullable) id<ZDCJSONStreamDecoderDelegate> delegate;
+
+/**
+ * The number of containers (objects/arrays) that are currently open.
+ * When invoked from within `jsonDecoderDidBeginObject:`, the count includes the new object.
+ */
+@property (nonatomic, readonly) NSUInteger depth;
+
+/**
+ * Feeds the next chunk of the document to the decoder.
+ * Delegate methods are invoked synchronously, from within this method.
+ *
+ * @return
+ *   NO if the document is malformed (see `error`), in which case all further input is ignored.
+ */
+- (BOOL)appendData:(NSData *)data;
+
+/**
+ * Must be invoked after the last chunk has been appended.
+ *
+ * @return
+ *   YES if the input was a single, complete JSON document.
+ *   NO otherwise (see `error`).
+ */
+- (BOOL)finish;
+
+/**
+ * The first error encountered (if any).
+ */
+@property (nonatomic, readonly, nullable) NSError *error;
+
+/**
+ * Instructs the decoder to skip the next value.
+ * Typically invoked from within `jsonDecoder:didDecodeKey:` when the delegate doesn't care about the key.
+ *
+ * The value is still validated, but no events are reported for it, and no objects are created for it.
+ */
+- (void)skipValue;
+
+/**
+ * Instructs the decoder to capture the next value.
+ * Typically invoked from within `jsonDecoder:didDecodeKey:`.
+ *
+ * If the value is an object or array, the decoder builds the corresponding NSDictionary/NSArray,
+ * and reports it via a single `jsonDecoder:didDecodeValue:` invocation (instead of the individual events).
+ */
+- (void)captureValue;
+
+/**
+ * Convenience method that decodes a complete document, and returns the root value.
+ * Behaves like `+[NSJSONSerialization JSONObjectWithData:options:error:]` (with fragments allowed).
+ */
++ (nullable id)JSONObjectWithData:(NSData *)data error:(NSError *_Nullable *_Nullable)errorPtr;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,914 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCJSONStreamDecoder.h"
+
+#import "NSError+ZeroDark.h"
+
+/**
+ * Protects against maliciously deep documents.
+ * (NSJSONSerialization has a similar limit.)
+ */
+#define MAX_DEPTH 512
+
+/**
+ * Numbers longer than this are rejected.
+ * (A double needs at most ~25 characters.)
+ */
+#define MAX_NUMBER_LENGTH 64
+
+typedef NS_ENUM(uint8_t, ZDCJSONState) {
+	ZDCJSONState_Value,      // expecting a value
+	ZDCJSONState_ValueOrEnd, // just after '[' - expecting a value or ']'
+	ZDCJSONState_Key,        // just after ',' within an object - expecting a key
+	ZDCJSONState_KeyOrEnd,   // just after '{' - expecting a key or '}'
+	ZDCJSONState_Colon,      // just after a key
+	ZDCJSONState_CommaOrEnd, // just after a value within a container
+	ZDCJSONState_Done,       // just after the root value - expecting whitespace only
+};
+
+static inline BOOL ZDCJSONIsWhitespace(uint8_t c)
+{
+	return (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+}
+
+static inline BOOL ZDCJSONIsDigit(uint8_t c)
+{
+	return (c >= '0' && c <= '9');
+}
+
+static inline BOOL ZDCJSONIsNumberChar(uint8_t c)
+{
+	return ZDCJSONIsDigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+/**
+ * Validates the number against the JSON grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+ */
+static BOOL ZDCJSONIsValidNumber(const char *s, NSUInteger len, BOOL *isIntegerPtr)
+{
+	NSUInteger i = 0;
+	NSUInteger start = 0;
+	BOOL isInteger = YES;
+	
+	if (i < len && s[i] == '-') i++;
+	if (i >= len) return NO;
+	
+	if (s[i] == '0') {
+		i++;
+	}
+	else if (s[i] >= '1' && s[i] <= '9') {
+		while (i < len && ZDCJSONIsDigit(s[i])) i++;
+	}
+	else {
+		return NO;
+	}
+	
+	if (i < len && s[i] == '.')
+	{
+		isInteger = NO;
+		i++;
+		
+		start = i;
+		while (i < len && ZDCJSONIsDigit(s[i])) i++;
+		if (i == start) return NO;
+	}
+	
+	if (i < len && (s[i] == 'e' || s[i] == 'E'))
+	{
+		isInteger = NO;
+		i++;
+		
+		if (i < len && (s[i] == '+' || s[i] == '-')) i++;
+		
+		start = i;
+		while (i < len && ZDCJSONIsDigit(s[i])) i++;
+		if (i == start) return NO;
+	}
+	
+	if (isIntegerPtr) *isIntegerPtr = isInteger;
+	return (i == len);
+}
+
+static BOOL ZDCJSONParseHex4(const uint8_t *p, NSUInteger offset, NSUInteger len, uint32_t *outValue)
+{
+	if (offset + 4 > len) return NO;
+	
+	uint32_t value = 0;
+	for (NSUInteger i = offset; i < offset + 4; i++)
+	{
+		uint8_t c = p[i];
+		value <<= 4;
+		
+		if (c >= '0' && c <= '9')      value |= (uint32_t)(c - '0');
+		else if (c >= 'a' && c <= 'f') value |= (uint32_t)(c - 'a' + 10);
+		else if (c >= 'A' && c <= 'F') value |= (uint32_t)(c - 'A' + 10);
+		else return NO;
+	}
+	
+	*outValue = value;
+	return YES;
+}
+
+static NSUInteger ZDCJSONEncodeUTF8(uint32_t cp, uint8_t *out)
+{
+	if (cp < 0x80)
+	{
+		out[0] = (uint8_t)cp;
+		return 1;
+	}
+	if (cp < 0x800)
+	{
+		out[0] = (uint8_t)(0xC0 | (cp >> 6));
+		out[1] = (uint8_t)(0x80 | (cp & 0x3F));
+		return 2;
+	}
+	if (cp < 0x10000)
+	{
+		out[0] = (uint8_t)(0xE0 | (cp >> 12));
+		out[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+		out[2] = (uint8_t)(0x80 | (cp & 0x3F));
+		return 3;
+	}
+	
+	out[0] = (uint8_t)(0xF0 | (cp >> 18));
+	out[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+	out[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+	out[3] = (uint8_t)(0x80 | (cp & 0x3F));
+	return 4;
+}
+
+/**
+ * Decodes the escape sequences within a string (excluding the surrounding quotes).
+ * The decoded form is never longer than the encoded form, so a single buffer of `len` bytes suffices.
+ */
+static NSString* ZDCJSONUnescapeString(const uint8_t *p, NSUInteger len)
+{
+	uint8_t *buffer = malloc(MAX(len, (NSUInteger)1));
+	NSUInteger o = 0;
+	NSUInteger i = 0;
+	BOOL ok = YES;
+	
+	while (ok && i < len)
+	{
+		uint8_t c = p[i];
+		if (c != '\\')
+		{
+			buffer[o++] = c;
+			i++;
+			continue;
+		}
+		
+		if (i + 1 >= len) {
+			ok = NO;
+			break;
+		}
+		
+		uint8_t e = p[i+1];
+		i += 2;
+		
+		switch (e)
+		{
+			case '"' : buffer[o++] = '"';  break;
+			case '\\': buffer[o++] = '\\'; break;
+			case '/' : buffer[o++] = '/';  break;
+			case 'b' : buffer[o++] = '\b'; break;
+			case 'f' : buffer[o++] = '\f'; break;
+			case 'n' : buffer[o++] = '\n'; break;
+			case 'r' : buffer[o++] = '\r'; break;
+			case 't' : buffer[o++] = '\t'; break;
+			case 'u' :
+			{
+				uint32_t cp = 0;
+				if (!ZDCJSONParseHex4(p, i, len, &cp)) {
+					ok = NO;
+					break;
+				}
+				i += 4;
+				
+				if (cp >= 0xD800 && cp <= 0xDBFF)
+				{
+					// High surrogate - should be followed by an escaped low surrogate.
+					
+					uint32_t lo = 0;
+					if ((i + 6 <= len) && (p[i] == '\\') && (p[i+1] == 'u') &&
+					    ZDCJSONParseHex4(p, i+2, len, &lo) && (lo >= 0xDC00 && lo <= 0xDFFF))
+					{
+						cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+						i += 6;
+					}
+					else
+					{
+						cp = 0xFFFD; // replacement character
+					}
+				}
+				else if (cp >= 0xDC00 && cp <= 0xDFFF)
+				{
+					cp = 0xFFFD; // unpaired low surrogate
+				}
+				
+				o += ZDCJSONEncodeUTF8(cp, buffer + o);
+				break;
+			}
+			default:
+			{
+				ok = NO;
+				break;
+			}
+		}
+	}
+	
+	NSString *result = nil;
+	if (ok) {
+		result = [[NSString alloc] initWithBytes:buffer length:o encoding:NSUTF8StringEncoding];
+	}
+	
+	free(buffer);
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Used by `+[ZDCJSONStreamDecoder JSONObjectWithData:error:]`.
+ * The root value is captured, so the only event we receive is the final value.
+ */
+@interface ZDCJSONRootCollector : NSObject <ZDCJSONStreamDecoderDelegate>
+
+@property (nonatomic, strong, readwrite, nullable) id root;
+
+@end
+
+@implementation ZDCJSONRootCollector
+
+- (void)jsonDecoderDidBeginObject:(ZDCJSONStreamDecoder *)decoder {}
+- (void)jsonDecoderDidEndObject:(ZDCJSONStreamDecoder *)decoder {}
+- (void)jsonDecoderDidBeginArray:(ZDCJSONStreamDecoder *)decoder {}
+- (void)jsonDecoderDidEndArray:(ZDCJSONStreamDecoder *)decoder {}
+- (void)jsonDecoder:(ZDCJSONStreamDecoder *)decoder didDecodeKey:(NSString *)key {}
+
+- (void)jsonDecoder:(ZDCJSONStreamDecoder *)decoder didDecodeValue:(id)value
+{
+	self.root = value;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCJSONStreamDecoder {
+	
+	NSMutableData *pending;    // bytes of an incomplete token, carried over to the next chunk
+	NSUInteger consumedTotal;  // for error messages
+	
+	uint8_t containers[MAX_DEPTH]; // '{' or '['
+	NSUInteger depth;
+	ZDCJSONState state;
+	
+	NSUInteger stringResume;   // where to resume scanning an incomplete string (relative to its opening quote)
+	BOOL stringHasEscapes;
+	
+	BOOL skipNext;
+	BOOL captureNext;
+	NSUInteger skipDepth;      // NSNotFound if not currently skipping a container
+	
+	NSMutableArray *captureStack;
+	NSMutableArray<NSString *> *captureKeys;
+	
+	BOOL checkedBOM;
+	BOOL finished;
+	NSError *error;
+}
+
+@synthesize delegate = delegate;
+@synthesize depth = depth;
+@synthesize error = error;
+
+- (instancetype)init
+{
+	return nil; // Use initWithDelegate:
+}
+
+- (instancetype)initWithDelegate:(id<ZDCJSONStreamDecoderDelegate>)inDelegate
+{
+	if ((self = [super init]))
+	{
+		delegate = inDelegate;
+		
+		pending = [[NSMutableData alloc] init];
+		state = ZDCJSONState_Value;
+		skipDepth = NSNotFound;
+		
+		captureStack = [[NSMutableArray alloc] init];
+		captureKeys = [[NSMutableArray alloc] init];
+	}
+	return self;
+}
+
+/**
+ * See header file for description.
+ */
++ (nullable id)JSONObjectWithData:(NSData *)data error:(NSError *_Nullable *_Nullable)errorPtr
+{
+	ZDCJSONRootCollector *collector = [[ZDCJSONRootCollector alloc] init];
+	ZDCJSONStreamDecoder *decoder = [[ZDCJSONStreamDecoder alloc] initWithDelegate:collector];
+	
+	[decoder captureValue];
+	[decoder appendData:data];
+	[decoder finish];
+	
+	if (errorPtr) *errorPtr = decoder.error;
+	return decoder.error ? nil : collector.root;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Input
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * See header file for description.
+ */
+- (BOOL)appendData:(NSData *)data
+{
+	if (error || finished) return NO;
+	
+	// NSData may be discontiguous (e.g. dispatch_data from NSURLSession).
+	// Process each region in turn, rather than forcing the data to be flattened.
+	
+	[data enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+		
+		[self appendBytes:(const uint8_t *)bytes length:byteRange.length];
+		if (self->error) {
+			*stop = YES;
+		}
+	}];
+	
+	return (error == nil);
+}
+
+- (void)appendBytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+	if (length == 0) return;
+	
+	if (pending.length > 0)
+	{
+		[pending appendBytes:bytes length:length];
+		
+		NSUInteger consumed = [self processBytes:pending.bytes length:pending.length isFinal:NO];
+		
+		[pending replaceBytesInRange:NSMakeRange(0, consumed) withBytes:NULL length:0];
+		consumedTotal += consumed;
+	}
+	else
+	{
+		NSUInteger consumed = [self processBytes:bytes length:length isFinal:NO];
+		
+		if (consumed < length && error == nil) {
+			[pending appendBytes:(bytes + consumed) length:(length - consumed)];
+		}
+		consumedTotal += consumed;
+	}
+}
+
+/**
+ * See header file for description.
+ */
+- (BOOL)finish
+{
+	if (finished) return (error == nil);
+	finished = YES;
+	
+	if (error) return NO;
+	
+	if (pending.length > 0)
+	{
+		NSUInteger consumed = [self processBytes:pending.bytes length:pending.length isFinal:YES];
+		
+		if (error == nil && consumed < pending.length) {
+			[self failWithDescription:@"Unexpected end of data" offset:consumed];
+		}
+		
+		pending = nil;
+	}
+	
+	if (error == nil && state != ZDCJSONState_Done) {
+		[self failWithDescription:@"Unexpected end of data" offset:0];
+	}
+	
+	return (error == nil);
+}
+
+- (void)failWithDescription:(NSString *)description offset:(NSUInteger)offset
+{
+	if (error) return;
+	
+	NSString *msg = [NSString stringWithFormat:@"%@ (around byte %lu)",
+	                   description, (unsigned long)(consumedTotal + offset)];
+	
+	error = [NSError errorWithClass:[self class] code:0 description:msg];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Delegate Control
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * See header file for description.
+ */
+- (void)skipValue
+{
+	skipNext = YES;
+	captureNext = NO;
+}
+
+/**
+ * See header file for description.
+ */
+- (void)captureValue
+{
+	captureNext = YES;
+	skipNext = NO;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Tokenizer
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Processes as many complete tokens as possible.
+ *
+ * @return
+ *   The number of bytes consumed.
+ *   Any remaining bytes are the beginning of an incomplete token.
+ */
+- (NSUInteger)processBytes:(const uint8_t *)bytes length:(NSUInteger)length isFinal:(BOOL)isFinal
+{
+	NSUInteger offset = 0;
+	
+	if (!checkedBOM)
+	{
+		const uint8_t bom[3] = { 0xEF, 0xBB, 0xBF };
+		
+		if (length >= 3 || isFinal)
+		{
+			if (length >= 3 && memcmp(bytes, bom, 3) == 0) {
+				offset = 3;
+			}
+			checkedBOM = YES;
+		}
+		else if (memcmp(bytes, bom, length) == 0)
+		{
+			return 0; // need more bytes to decide
+		}
+		else
+		{
+			checkedBOM = YES;
+		}
+	}
+	
+	while (offset < length && error == nil)
+	{
+		uint8_t c = bytes[offset];
+		
+		if (ZDCJSONIsWhitespace(c))
+		{
+			offset++;
+			continue;
+		}
+		
+		if (state == ZDCJSONState_Done)
+		{
+			[self failWithDescription:@"Unexpected data after the root value" offset:offset];
+			break;
+		}
+		
+		BOOL expectingValue = (state == ZDCJSONState_Value || state == ZDCJSONState_ValueOrEnd);
+		
+		switch (c)
+		{
+			case '{':
+			case '[':
+			{
+				if (!expectingValue) {
+					[self failWithDescription:@"Unexpected container" offset:offset];
+					break;
+				}
+				
+				[self beginContainer:c offset:offset];
+				offset++;
+				break;
+			}
+			case '}':
+			case ']':
+			{
+				uint8_t open = (c == '}') ? '{' : '[';
+				ZDCJSONState emptyState = (c == '}') ? ZDCJSONState_KeyOrEnd : ZDCJSONState_ValueOrEnd;
+				
+				if (depth == 0 || containers[depth-1] != open ||
+				    (state != emptyState && state != ZDCJSONState_CommaOrEnd))
+				{
+					[self failWithDescription:@"Unexpected end of container" offset:offset];
+					break;
+				}
+				
+				[self endContainer];
+				offset++;
+				break;
+			}
+			case ',':
+			{
+				if (state != ZDCJSONState_CommaOrEnd) {
+					[self failWithDescription:@"Unexpected comma" offset:offset];
+					break;
+				}
+				
+				state = (containers[depth-1] == '{') ? ZDCJSONState_Key : ZDCJSONState_Value;
+				offset++;
+				break;
+			}
+			case ':':
+			{
+				if (state != ZDCJSONState_Colon) {
+					[self failWithDescription:@"Unexpected colon" offset:offset];
+					break;
+				}
+				
+				state = ZDCJSONState_Value;
+				offset++;
+				break;
+			}
+			case '"':
+			{
+				BOOL isKey = (state == ZDCJSONState_Key || state == ZDCJSONState_KeyOrEnd);
+				if (!isKey && !expectingValue) {
+					[self failWithDescription:@"Unexpected string" offset:offset];
+					break;
+				}
+				
+				NSUInteger end = [self scanStringAt:offset bytes:bytes length:length];
+				if (end == NSNotFound) {
+					return offset; // incomplete (or error)
+				}
+				
+				[self didScanStringAt:offset end:end bytes:bytes isKey:isKey];
+				offset = end + 1;
+				break;
+			}
+			case 't':
+			case 'f':
+			case 'n':
+			{
+				if (!expectingValue) {
+					[self failWithDescription:@"Unexpected literal" offset:offset];
+					break;
+				}
+				
+				const char *literal = (c == 't') ? "true" : ((c == 'f') ? "false" : "null");
+				NSUInteger literalLength = strlen(literal);
+				
+				if (length - offset < literalLength)
+				{
+					if (isFinal || memcmp(bytes + offset, literal, length - offset) != 0) {
+						[self failWithDescription:@"Invalid literal" offset:offset];
+						break;
+					}
+					return offset; // incomplete
+				}
+				
+				if (memcmp(bytes + offset, literal, literalLength) != 0) {
+					[self failWithDescription:@"Invalid literal" offset:offset];
+					break;
+				}
+				
+				id value;
+				if (c == 't')
+					value = @YES;
+				else if (c == 'f')
+					value = @NO;
+				else
+					value = [NSNull null];
+				
+				[self didDecodeScalar:value];
+				offset += literalLength;
+				break;
+			}
+			default:
+			{
+				if (c != '-' && !ZDCJSONIsDigit(c)) {
+					[self failWithDescription:@"Unexpected character" offset:offset];
+					break;
+				}
+				if (!expectingValue) {
+					[self failWithDescription:@"Unexpected number" offset:offset];
+					break;
+				}
+				
+				NSUInteger end = offset + 1;
+				while (end < length && ZDCJSONIsNumberChar(bytes[end])) end++;
+				
+				if (end == length && !isFinal) {
+					return offset; // the number may continue in the next chunk
+				}
+				
+				[self didScanNumberAt:offset end:end bytes:bytes];
+				offset = end;
+				break;
+			}
+		}
+	}
+	
+	return offset;
+}
+
+/**
+ * Scans for the closing quote of the string that starts at `start`.
+ *
+ * @return
+ *   The offset of the closing quote, or NSNotFound if the string is incomplete (or an error occurred).
+ */
+- (NSUInteger)scanStringAt:(NSUInteger)start bytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+	// If this string was split across chunks, we've already scanned part of it.
+	// Resuming avoids quadratic behavior for (very) long strings, such as base64 encoded content.
+	
+	NSUInteger i = start + MAX(stringResume, (NSUInteger)1);
+	
+	while (i < length)
+	{
+		uint8_t b = bytes[i];
+		
+		if (b == '"')
+		{
+			stringResume = 0;
+			return i;
+		}
+		if (b == '\\')
+		{
+			stringHasEscapes = YES;
+			if (i + 1 >= length) break;
+			
+			i += 2;
+			continue;
+		}
+		if (b < 0x20)
+		{
+			[self failWithDescription:@"Unescaped control character in string" offset:i];
+			return NSNotFound;
+		}
+		
+		i++;
+	}
+	
+	stringResume = i - start;
+	return NSNotFound;
+}
+
+- (void)didScanStringAt:(NSUInteger)start end:(NSUInteger)end bytes:(const uint8_t *)bytes isKey:(BOOL)isKey
+{
+	BOOL hasEscapes = stringHasEscapes;
+	stringHasEscapes = NO;
+	
+	BOOL materialize;
+	if (isKey)
+		materialize = (skipDepth == NSNotFound);
+	else
+		materialize = [self shouldMaterializeScalar];
+	
+	NSString *string = nil;
+	if (materialize)
+	{
+		const uint8_t *p = bytes + start + 1;
+		NSUInteger len = end - start - 1;
+		
+		if (hasEscapes)
+			string = ZDCJSONUnescapeString(p, len);
+		else
+			string = [[NSString alloc] initWithBytes:p length:len encoding:NSUTF8StringEncoding];
+		
+		if (string == nil)
+		{
+			[self failWithDescription:@"Invalid string" offset:start];
+			return;
+		}
+	}
+	
+	if (isKey)
+		[self didDecodeKey:string];
+	else
+		[self didDecodeScalar:string];
+}
+
+- (void)didScanNumberAt:(NSUInteger)start end:(NSUInteger)end bytes:(const uint8_t *)bytes
+{
+	NSUInteger len = end - start;
+	if (len >= MAX_NUMBER_LENGTH)
+	{
+		[self failWithDescription:@"Number too long" offset:start];
+		return;
+	}
+	
+	char buffer[MAX_NUMBER_LENGTH];
+	memcpy(buffer, bytes + start, len);
+	buffer[len] = '\0';
+	
+	BOOL isInteger = NO;
+	if (!ZDCJSONIsValidNumber(buffer, len, &isInteger))
+	{
+		[self failWithDescription:@"Invalid number" offset:start];
+		return;
+	}
+	
+	NSNumber *number = nil;
+	if ([self shouldMaterializeScalar])
+	{
+		if (isInteger)
+		{
+			errno = 0;
+			if (buffer[0] == '-')
+			{
+				long long value = strtoll(buffer, NULL, 10);
+				if (errno != ERANGE) {
+					number = [NSNumber numberWithLongLong:value];
+				}
+			}
+			else
+			{
+				unsigned long long value = strtoull(buffer, NULL, 10);
+				if (errno != ERANGE)
+				{
+					if (value <= LLONG_MAX)
+						number = [NSNumber numberWithLongLong:(long long)value];
+					else
+						number = [NSNumber numberWithUnsignedLongLong:value];
+				}
+			}
+		}
+		
+		if (number == nil) {
+			number = [NSNumber numberWithDouble:strtod(buffer, NULL)];
+		}
+	}
+	
+	[self didDecodeScalar:number];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Events
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (BOOL)shouldMaterializeScalar
+{
+	if (skipDepth != NSNotFound) return NO;
+	if (captureStack.count > 0) return YES;
+	
+	return !skipNext;
+}
+
+- (void)didCompleteValue
+{
+	state = (depth == 0) ? ZDCJSONState_Done : ZDCJSONState_CommaOrEnd;
+}
+
+- (void)addCapturedValue:(id)value
+{
+	// Note: The top of the containers stack is the parent of the value.
+	
+	if (containers[depth-1] == '{')
+	{
+		NSMutableDictionary *parent = [captureStack lastObject];
+		NSString *key = [captureKeys lastObject];
+		
+		parent[key] = value;
+		[captureKeys removeLastObject];
+	}
+	else
+	{
+		NSMutableArray *parent = [captureStack lastObject];
+		[parent addObject:value];
+	}
+}
+
+- (void)beginContainer:(uint8_t)c offset:(NSUInteger)offset
+{
+	if (depth >= MAX_DEPTH)
+	{
+		[self failWithDescription:@"Maximum depth exceeded" offset:offset];
+		return;
+	}
+	
+	containers[depth++] = c;
+	state = (c == '{') ? ZDCJSONState_KeyOrEnd : ZDCJSONState_ValueOrEnd;
+	
+	if (skipDepth != NSNotFound)
+	{
+		// Nested within a skipped container
+	}
+	else if (captureStack.count > 0 || captureNext)
+	{
+		captureNext = NO;
+		
+		if (c == '{')
+			[captureStack addObject:[[NSMutableDictionary alloc] init]];
+		else
+			[captureStack addObject:[[NSMutableArray alloc] init]];
+	}
+	else if (skipNext)
+	{
+		skipNext = NO;
+		skipDepth = depth;
+	}
+	else if (c == '{')
+	{
+		[delegate jsonDecoderDidBeginObject:self];
+	}
+	else
+	{
+		[delegate jsonDecoderDidBeginArray:self];
+	}
+}
+
+- (void)endContainer
+{
+	NSUInteger closedDepth = depth;
+	uint8_t c = containers[--depth];
+	
+	if (skipDepth != NSNotFound)
+	{
+		if (closedDepth == skipDepth) {
+			skipDepth = NSNotFound;
+		}
+	}
+	else if (captureStack.count > 0)
+	{
+		id container = [captureStack lastObject];
+		[captureStack removeLastObject];
+		
+		if (captureStack.count > 0)
+			[self addCapturedValue:container];
+		else
+			[delegate jsonDecoder:self didDecodeValue:container];
+	}
+	else if (c == '{')
+	{
+		[delegate jsonDecoderDidEndObject:self];
+	}
+	else
+	{
+		[delegate jsonDecoderDidEndArray:self];
+	}
+	
+	[self didCompleteValue];
+}
+
+- (void)didDecodeKey:(nullable NSString *)key
+{
+	state = ZDCJSONState_Colon;
+	
+	if (skipDepth != NSNotFound)
+	{
+		// Nested within a skipped container
+	}
+	else if (captureStack.count > 0)
+	{
+		[captureKeys addObject:key];
+	}
+	else
+	{
+		[delegate jsonDecoder:self didDecodeKey:key];
+	}
+}
+
+- (void)didDecodeScalar:(nullable id)value
+{
+	if (skipDepth != NSNotFound)
+	{
+		// Nested within a skipped container
+	}
+	else if (captureStack.count > 0)
+	{
+		[self addCapturedValue:value];
+	}
+	else if (skipNext)
+	{
+		skipNext = NO;
+	}
+	else
+	{
+		captureNext = NO;
+		[delegate jsonDecoder:self didDecodeValue:value];
+	}
+	
+	[self didCompleteValue];
+}
+
+@end
@@ -0,0 +1,66 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+#import <YapDatabase/YapDatabaseHooks.h>
+#import <YapDatabase/YapDatabaseHooksPrivate.h>
+
+#import "ZDCNodeStats.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * The YapDatabaseHooks extension that maintains the ZDCNodeStats (see Ext_Hooks_NodeStats).
+ *
+ * A single transaction often modifies many nodes within the same subtree (e.g. a pull, or a recursive delete).
+ * If every change were written straight to kZDCCollection_NodeStats,
+ * then every ancestor would be re-written once per modified descendant.
+ *
+ * So instead, the hooks record their deltas with the extension's transaction,
+ * and the accumulated deltas are written just before the transaction commits.
+ * Thus each ancestor is written (at most) once per transaction.
+ */
+@interface ZDCNodeStatsHooks : YapDatabaseHooks
+@end
+
+@interface ZDCNodeStatsHooksConnection : YapDatabaseHooksConnection
+@end
+
+@interface ZDCNodeStatsHooksTransaction : YapDatabaseHooksTransaction
+
+/**
+ * Adds the given delta to the pending changes for the node.
+ * The delta is written to kZDCCollection_NodeStats when the transaction commits.
+ */
+- (void)addDescendantCount:(int64_t)descendantCountDelta
+            totalCloudSize:(int64_t)totalCloudSizeDelta
+        pendingUploadCount:(int64_t)pendingUploadCountDelta
+              lastModified:(nullable NSDate *)lastModified
+                 forNodeID:(NSString *)nodeID;
+
+/**
+ * Returns the given (stored) stats with the pending delta for the node applied.
+ * If there's no pending delta, returns the given stats as-is.
+ */
+- (nullable ZDCNodeStats *)statsByApplyingPendingDeltaToStats:(nullable ZDCNodeStats *)stats
+                                                    forNodeID:(NSString *)nodeID;
+
+/**
+ * Discards the pending delta for the node (e.g. because the node is being removed).
+ */
+- (void)discardPendingDeltaForNodeID:(NSString *)nodeID;
+
+/**
+ * Discards all pending deltas (e.g. because all the nodes are being removed).
+ */
+- (void)discardAllPendingDeltas;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,189 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCNodeStatsHooks.h"
+
+#import "ZDCConstants.h"
+#import "NSDate+ZeroDark.h"
+
+#import <YapDatabase/YapDatabaseExtensionPrivate.h>
+
+/**
+ * A pending (signed) change to a node's stats.
+ */
+@interface ZDCNodeStatsDelta : NSObject {
+@public
+	int64_t descendantCount;
+	int64_t totalCloudSize;
+	int64_t pendingUploadCount;
+	NSDate *lastModified;
+}
+@end
+
+@implementation ZDCNodeStatsDelta
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCNodeStatsHooks
+
+/**
+ * Required override method from YapDatabaseExtension.
+ */
+- (YapDatabaseExtensionConnection *)newConnection:(YapDatabaseConnection *)databaseConnection
+{
+	return [[ZDCNodeStatsHooksConnection alloc] initWithParent:self databaseConnection:databaseConnection];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCNodeStatsHooksConnection
+
+/**
+ * Required override method from YapDatabaseExtensionConnection.
+ */
+- (id)newReadTransaction:(YapDatabaseReadTransaction *)databaseTransaction
+{
+	return [[ZDCNodeStatsHooksTransaction alloc] initWithParentConnection: self
+	                                                  databaseTransaction: databaseTransaction];
+}
+
+/**
+ * Required override method from YapDatabaseExtensionConnection.
+ */
+- (id)newReadWriteTransaction:(YapDatabaseReadWriteTransaction *)databaseTransaction
+{
+	return [[ZDCNodeStatsHooksTransaction alloc] initWithParentConnection: self
+	                                                  databaseTransaction: databaseTransaction];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation ZDCNodeStatsHooksTransaction
+{
+	NSMutableDictionary<NSString*, ZDCNodeStatsDelta*> *pendingDeltas;
+}
+
+/**
+ * See header file for description.
+ */
+- (void)addDescendantCount:(int64_t)descendantCountDelta
+            totalCloudSize:(int64_t)totalCloudSizeDelta
+        pendingUploadCount:(int64_t)pendingUploadCountDelta
+              lastModified:(nullable NSDate *)lastModified
+                 forNodeID:(NSString *)nodeID
+{
+	if (pendingDeltas == nil) {
+		pendingDeltas = [[NSMutableDictionary alloc] init];
+	}
+	
+	ZDCNodeStatsDelta *delta = pendingDeltas[nodeID];
+	if (delta == nil)
+	{
+		delta = [[ZDCNodeStatsDelta alloc] init];
+		pendingDeltas[nodeID] = delta;
+	}
+	
+	delta->descendantCount += descendantCountDelta;
+	delta->totalCloudSize += totalCloudSizeDelta;
+	delta->pendingUploadCount += pendingUploadCountDelta;
+	
+	if (lastModified && (delta->lastModified == nil || [lastModified isAfter:delta->lastModified])) {
+		delta->lastModified = lastModified;
+	}
+}
+
+/**
+ * See header file for description.
+ */
+- (nullable ZDCNodeStats *)statsByApplyingPendingDeltaToStats:(nullable ZDCNodeStats *)stats
+                                                    forNodeID:(NSString *)nodeID
+{
+	ZDCNodeStatsDelta *delta = pendingDeltas[nodeID];
+	if (delta == nil) {
+		return stats;
+	}
+	
+	return [self statsByApplyingDelta:delta toStats:stats];
+}
+
+/**
+ * See header file for description.
+ */
+- (void)discardPendingDeltaForNodeID:(NSString *)nodeID
+{
+	[pendingDeltas removeObjectForKey:nodeID];
+}
+
+/**
+ * See header file for description.
+ */
+- (void)discardAllPendingDeltas
+{
+	[pendingDeltas removeAllObjects];
+}
+
+/**
+ * YapDatabaseExtensionTransaction Hook, invoked before the transaction commits.
+ *
+ * Writes the accumulated deltas to kZDCCollection_NodeStats (one write per modified ancestor).
+ */
+- (BOOL)flushPendingChangesToMainDatabaseTable
+{
+	BOOL modified = [super flushPendingChangesToMainDatabaseTable];
+	
+	if (pendingDeltas.count == 0) {
+		return modified;
+	}
+	
+	NSDictionary<NSString*, ZDCNodeStatsDelta*> *deltas = pendingDeltas;
+	pendingDeltas = nil;
+	
+	YapDatabaseReadWriteTransaction *rwTransaction = (YapDatabaseReadWriteTransaction *)databaseTransaction;
+	
+	for (NSString *nodeID in deltas)
+	{
+		if (![rwTransaction hasObjectForKey:nodeID inCollection:kZDCCollection_Nodes]) {
+			continue; // node was removed within this transaction
+		}
+		
+		ZDCNodeStats *stats = [rwTransaction objectForKey:nodeID inCollection:kZDCCollection_NodeStats];
+		stats = [self statsByApplyingDelta:deltas[nodeID] toStats:stats];
+		
+		[rwTransaction setObject:stats forKey:nodeID inCollection:kZDCCollection_NodeStats];
+	}
+	
+	return YES;
+}
+
+- (ZDCNodeStats *)statsByApplyingDelta:(ZDCNodeStatsDelta *)delta toStats:(nullable ZDCNodeStats *)stats
+{
+	return [(stats ?: [[ZDCNodeStats alloc] init]) statsByAddingDescendantCount: delta->descendantCount
+	                                                             totalCloudSize: delta->totalCloudSize
+	                                                         pendingUploadCount: delta->pendingUploadCount
+	                                                               lastModified: delta->lastModified];
+}
+
+- (void)didRollbackTransaction
+{
+	pendingDeltas = nil;
+	[super didRollbackTransaction];
+}
+
+@end
@@ -9,6 +9,8 @@
 
 #import "ZDCPasswordStrengthCalculator.h"
 
+#import "ZDCDictionaryAutomaton.h"
+#import "ZDCDirectoryManager.h"
 #import "ZDCLogging.h"
 #import "ZeroDarkCloud.h"
 
@@ -221,23 +223,53 @@ static NSDictionary *adjacencyGraphs = nil;
 	static dispatch_once_t onceToken;
 	dispatch_once(&onceToken, ^{
 		
-		NSMutableArray *matchers = [NSMutableArray array];
+		// Parsing frequency_lists.json (~1 MB) is slow.
+		// So we compile it into an Aho-Corasick automaton, which we cache on disk.
+		// Subsequent launches simply memory-map the cached automaton.
+		//
+		// The fingerprint ties the cached file to the exact json file it was compiled from.
 		
 		NSString *jsonPath = [[ZeroDarkCloud frameworkBundle] pathForResource:@"frequency_lists" ofType:@"json"];
-		NSData *jsonData = [NSData dataWithContentsOfFile:jsonPath];
-		NSDictionary *dicts = (NSDictionary *)[NSJSONSerialization JSONObjectWithData:jsonData options:0 error:nil];
 		
-		for (NSString *dictName in dicts)
+		NSDictionary *attr = [[NSFileManager defaultManager] attributesOfItemAtPath:jsonPath error:nil];
+		uint64_t fingerprint =
+		  ((uint64_t)[attr fileSize] << 32) ^ (uint64_t)[[attr fileModificationDate] timeIntervalSinceReferenceDate];
+		
+		NSURL *cacheURL =
+		  [[ZDCDirectoryManager zdcCacheDirectoryURL] URLByAppendingPathComponent: @"frequency_lists.automaton"
+		                                                              isDirectory: NO];
+		
+		ZDCDictionaryAutomaton *automaton = [ZDCDictionaryAutomaton automatonWithContentsOfURL:cacheURL];
+		if (automaton && automaton.fingerprint != fingerprint) {
+			automaton = nil;
+		}
+		
+		if (automaton == nil)
 		{
-			NSArray *list = dicts[dictName];
+			NSData *jsonData = [NSData dataWithContentsOfFile:jsonPath];
+			NSDictionary *dicts = nil;
+			if (jsonData) {
+				dicts = (NSDictionary *)[NSJSONSerialization JSONObjectWithData:jsonData options:0 error:nil];
+			}
 			
-			BBDictionaryMatcher *matcher = [[BBDictionaryMatcher alloc] initWithDictionaryName:dictName andList:list];
-			if (matcher) {
-				[matchers addObject:matcher];
+			if ([dicts isKindOfClass:[NSDictionary class]])
+			{
+				NSData *compiled = [ZDCDictionaryAutomaton compileDictionaries:dicts fingerprint:fingerprint];
+				automaton = [[ZDCDictionaryAutomaton alloc] initWithData:compiled];
+				
+				NSError *error = nil;
+				if (![compiled writeToURL:cacheURL options:NSDataWritingAtomic error:&error]) {
+					ZDCLogWarn(@"Unable to cache compiled dictionaries: %@", error);
+				}
 			}
 		}
 		
-		dictionaryMatchers = matchers;
+		if (automaton) {
+			dictionaryMatchers = @[ [[BBDictionaryMatcher alloc] initWithAutomaton:automaton] ];
+		}
+		else {
+			dictionaryMatchers = @[];
+		}
 	});
 }
 
@@ -8,8 +8,13 @@
 
 #import "BBPatternMatcher.h"
 
+@class ZDCDictionaryAutomaton;
+
 @interface BBDictionaryMatcher : NSObject <BBPatternMatcher>
 
 - (id)initWithDictionaryName:(NSString *)name andList:(NSArray *)list;
 
+// Matches against every dictionary within the automaton, in a single pass.
+- (id)initWithAutomaton:(ZDCDictionaryAutomaton *)automaton;
+
 @end
@@ -9,28 +9,28 @@
 #import "BBDictionaryMatcher.h"
 
 #import "BBPattern.h"
+#import "ZDCDictionaryAutomaton.h"
+
+// Passwords up to this length are lowercased into a stack buffer.
+#define STACK_BUFFER_LENGTH 256
 
 @interface BBDictionaryMatcher ()
 
-@property (strong, nonatomic) NSString *name;
-@property (strong, nonatomic) NSDictionary *dictionary;
+@property (strong, nonatomic) ZDCDictionaryAutomaton *automaton;
 
 @end
 
 @implementation BBDictionaryMatcher
 
 - (id)initWithDictionaryName:(NSString *)name andList:(NSArray *)list {
+    NSData *data = [ZDCDictionaryAutomaton compileDictionaries:@{ name: list } fingerprint:0];
+    return [self initWithAutomaton:[[ZDCDictionaryAutomaton alloc] initWithData:data]];
+}
+
+- (id)initWithAutomaton:(ZDCDictionaryAutomaton *)automaton {
     self = [super init];
     if (self) {
-        self.name = name;
-        
-        NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
-        int i = 1;
-        for (NSString *word in list) {
-            [dictionary setObject:[NSNumber numberWithInt:i] forKey:word];
-            i++;
-        }
-        self.dictionary = dictionary;
+        self.automaton = automaton;
     }
     return self;
 }
@@ -38,28 +38,60 @@
 - (NSArray *)match:(NSString *)password {
     NSMutableArray *result = [NSMutableArray array];
     NSUInteger length = password.length;
-    NSString *lower = [password lowercaseString];
+    if (length == 0 || self.automaton == nil) {
+        return result;
+    }
+    
+    unichar stackBuffer[STACK_BUFFER_LENGTH];
+    unichar *lower = (length <= STACK_BUFFER_LENGTH) ? stackBuffer : malloc(length * sizeof(unichar));
+    
+    [password getCharacters:lower range:NSMakeRange(0, length)];
+    
+    // The dictionaries are lowercase.
+    // ASCII is lowercased in place. Anything else goes through NSString,
+    // as long as doing so doesn't change the length (which would break the ranges).
     
-    for (int i = 0; i < length; i++) {
-        for (int j = i; j < length; j++) {
-            NSString *word = [lower substringWithRange:NSMakeRange(i, j - i + 1)];
-            NSNumber *rank = [self.dictionary objectForKey:word];
-            if (rank) {
-                BBPattern *pattern = [[BBPattern alloc] init];
-                pattern.type = BBPatternTypeDictionary;
-                pattern.begin = i;
-                pattern.end = j;
-                pattern.token = [password substringWithRange:NSMakeRange(i, j - i + 1)];
-                pattern.userInfo = [NSDictionary dictionaryWithObjectsAndKeys:
-                                    word, BBDictionaryPatternUserInfoKeyMatchedWord,
-                                    rank, BBDictionaryPatternUserInfoKeyRank,
-                                    self.name, BBDictionaryPatternUserInfoKeyDictionaryName,
-                                    nil];
-                [result addObject:pattern];
-            }
+    BOOL isASCII = YES;
+    for (NSUInteger i = 0; i < length; i++) {
+        unichar c = lower[i];
+        if (c >= 'A' && c <= 'Z') {
+            lower[i] = c + ('a' - 'A');
+        } else if (c >= 0x80) {
+            isASCII = NO;
         }
     }
     
+    if (!isASCII) {
+        NSString *lowercase = [password lowercaseString];
+        if (lowercase.length == length) {
+            [lowercase getCharacters:lower range:NSMakeRange(0, length)];
+        }
+    }
+    
+    NSArray<NSString *> *dictionaryNames = self.automaton.dictionaryNames;
+    
+    [self.automaton enumerateMatchesInCharacters:lower length:length usingBlock:
+        ^(NSRange range, NSUInteger dictionaryIndex, NSUInteger rank)
+    {
+        NSString *word = [[NSString alloc] initWithCharacters:(lower + range.location) length:range.length];
+        
+        BBPattern *pattern = [[BBPattern alloc] init];
+        pattern.type = BBPatternTypeDictionary;
+        pattern.begin = range.location;
+        pattern.end = NSMaxRange(range) - 1;
+        pattern.token = [password substringWithRange:range];
+        pattern.userInfo = [NSDictionary dictionaryWithObjectsAndKeys:
+                            word, BBDictionaryPatternUserInfoKeyMatchedWord,
+                            [NSNumber numberWithUnsignedInteger:rank], BBDictionaryPatternUserInfoKeyRank,
+                            dictionaryNames[dictionaryIndex], BBDictionaryPatternUserInfoKeyDictionaryName,
+                            nil];
+        [result addObject:pattern];
+    }];
+    
+    if (lower != stackBuffer) {
+        free(lower);
+    }
+    
     return result;
 }
 
@@ -0,0 +1,68 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import <Foundation/Foundation.h>
+
+#import "ZDCCloudOperation.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * An in-memory index of ZDCCloudOperations, used by the ZDCCloud extension to answer
+ * per-node queries without enumerating every operation in every pipeline.
+ *
+ * Operations are indexed by:
+ * - op.nodeID
+ * - op.dstCloudLocator.bucket (for ZDCCloudOperationType_CopyLeaf operations, i.e. the recipient)
+ *
+ * Lookups return operations in the order in which they were first added to the index.
+ * Adding an operation with an existing uuid replaces the previous version (and keeps its position).
+ *
+ * This class is not thread-safe.
+ */
+@interface ZDCCloudOperationIndex : NSObject
+
+/** The number of indexed operations. */
+@property (nonatomic, readonly) NSUInteger count;
+
+- (BOOL)containsOperationWithUUID:(NSUUID *)uuid;
+- (nullable ZDCCloudOperation *)operationWithUUID:(NSUUID *)uuid;
+
+- (void)addOperation:(ZDCCloudOperation *)op;
+- (void)removeOperationWithUUID:(NSUUID *)uuid;
+
+/**
+ * Applies the changes from a read-write transaction:
+ * each operation in `changes` is added (or replaces its previous version), and then `removedUUIDs` are removed.
+ */
+- (void)addOperationsFromIndex:(nullable ZDCCloudOperationIndex *)changes
+                 removingUUIDs:(nullable NSSet<NSUUID *> *)removedUUIDs;
+
+/**
+ * Returns the nodeIDs whose set of operations would change if the given changes were applied to the receiver.
+ * This includes the nodeIDs of removed operations, and the previous nodeIDs of modified operations.
+ */
+- (NSSet<NSString *> *)nodeIDsAffectedByChanges:(nullable ZDCCloudOperationIndex *)changes
+                                  removingUUIDs:(nullable NSSet<NSUUID *> *)removedUUIDs;
+
+/** Returns YES if there's at least one indexed operation where op.nodeID matches. */
+- (BOOL)containsOperationsWithNodeID:(NSString *)nodeID;
+
+/** Returns the nodeIDs of all indexed operations. */
+- (NSSet<NSString *> *)allNodeIDs;
+
+/** Returns the indexed operations where op.nodeID matches. */
+- (NSArray<ZDCCloudOperation *> *)operationsWithNodeID:(NSString *)nodeID;
+
+/** Returns the indexed CopyLeaf operations where op.dstCloudLocator.bucket matches. */
+- (NSArray<ZDCCloudOperation *> *)copyOperationsWithRecipientBucket:(NSString *)bucket;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,251 @@
+/**
+ * ZeroDark.cloud
+ *
+ * Homepage      : https://www.zerodark.cloud
+ * GitHub        : https://github.com/4th-ATechnologies/ZeroDark.cloud
+ * Documentation : https://zerodarkcloud.readthedocs.io/en/latest/
+ * API Reference : https://apis.zerodark.cloud
+**/
+
+#import "ZDCCloudOperationIndex.h"
+
+#import "ZDCCloudLocator.h"
+
+
+@implementation ZDCCloudOperationIndex {
+	
+	NSMutableDictionary<NSUUID*, ZDCCloudOperation*> *operations;
+	NSMutableOrderedSet<NSUUID*> *order;
+	
+	NSMutableDictionary<NSString*, NSMutableOrderedSet<NSUUID*>*> *nodeIDIndex;
+	NSMutableDictionary<NSString*, NSMutableOrderedSet<NSUUID*>*> *recipientIndex;
+}
+
+- (instancetype)init
+{
+	if ((self = [super init]))
+	{
+		operations = [[NSMutableDictionary alloc] init];
+		order = [[NSMutableOrderedSet alloc] init];
+		
+		nodeIDIndex = [[NSMutableDictionary alloc] init];
+		recipientIndex = [[NSMutableDictionary alloc] init];
+	}
+	return self;
+}
+
+- (NSUInteger)count
+{
+	return operations.count;
+}
+
+- (BOOL)containsOperationWithUUID:(NSUUID *)uuid
+{
+	return (operations[uuid] != nil);
+}
+
+- (nullable ZDCCloudOperation *)operationWithUUID:(NSUUID *)uuid
+{
+	return operations[uuid];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Keys
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static NSString* RecipientKey(ZDCCloudOperation *op)
+{
+	if (op.type == ZDCCloudOperationType_CopyLeaf) {
+		return op.dstCloudLocator.bucket;
+	} else {
+		return nil;
+	}
+}
+
+static void IndexInsert(NSMutableDictionary<NSString*, NSMutableOrderedSet<NSUUID*>*> *index,
+                        NSString *key, NSUUID *uuid)
+{
+	if (key == nil) return;
+	
+	NSMutableOrderedSet<NSUUID*> *uuids = index[key];
+	if (uuids == nil)
+	{
+		uuids = [[NSMutableOrderedSet alloc] initWithCapacity:1];
+		index[key] = uuids;
+	}
+	
+	[uuids addObject:uuid];
+}
+
+static void IndexRemove(NSMutableDictionary<NSString*, NSMutableOrderedSet<NSUUID*>*> *index,
+                        NSString *key, NSUUID *uuid)
+{
+	if (key == nil) return;
+	
+	NSMutableOrderedSet<NSUUID*> *uuids = index[key];
+	[uuids removeObject:uuid];
+	
+	if (uuids.count == 0) {
+		[index removeObjectForKey:key];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Modification
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)addOperation:(ZDCCloudOperation *)op
+{
+	NSUUID *uuid = op.uuid;
+	if (uuid == nil) return;
+	
+	ZDCCloudOperation *prvOp = operations[uuid];
+	if (prvOp)
+	{
+		// The indexed properties rarely change when an operation is modified.
+		// But they can (e.g. moveCloudLocator:toCloudLocator:).
+		
+		NSString *prvNodeID = prvOp.nodeID;
+		if (prvNodeID && ![prvNodeID isEqualToString:op.nodeID]) {
+			IndexRemove(nodeIDIndex, prvNodeID, uuid);
+		}
+		
+		NSString *prvRecipient = RecipientKey(prvOp);
+		if (prvRecipient && ![prvRecipient isEqualToString:RecipientKey(op)]) {
+			IndexRemove(recipientIndex, prvRecipient, uuid);
+		}
+	}
+	
+	operations[uuid] = op;
+	[order addObject:uuid];
+	
+	IndexInsert(nodeIDIndex, op.nodeID, uuid);
+	IndexInsert(recipientIndex, RecipientKey(op), uuid);
+}
+
+- (void)removeOperationWithUUID:(NSUUID *)uuid
+{
+	ZDCCloudOperation *op = operations[uuid];
+	if (op == nil) return;
+	
+	IndexRemove(nodeIDIndex, op.nodeID, uuid);
+	IndexRemove(recipientIndex, RecipientKey(op), uuid);
+	
+	[operations removeObjectForKey:uuid];
+	[order removeObject:uuid];
+}
+
+- (void)addOperationsFromIndex:(nullable ZDCCloudOperationIndex *)changes
+                 removingUUIDs:(nullable NSSet<NSUUID *> *)removedUUIDs
+{
+	if (changes)
+	{
+		for (NSUUID *uuid in changes->order)
+		{
+			[self addOperation:changes->operations[uuid]];
+		}
+	}
+	
+	for (NSUUID *uuid in removedUUIDs)
+	{
+		[self removeOperationWithUUID:uuid];
+	}
+}
+
+- (NSSet<NSString *> *)nodeIDsAffectedByChanges:(nullable ZDCCloudOperationIndex *)changes
+                                  removingUUIDs:(nullable NSSet<NSUUID *> *)removedUUIDs
+{
+	NSMutableSet<NSString*> *nodeIDs = [NSMutableSet set];
+	
+	if (changes)
+	{
+		[nodeIDs addObjectsFromArray:changes->nodeIDIndex.allKeys];
+		
+		for (NSUUID *uuid in changes->order)
+		{
+			NSString *prvNodeID = operations[uuid].nodeID;
+			if (prvNodeID) {
+				[nodeIDs addObject:prvNodeID];
+			}
+		}
+	}
+	
+	for (NSUUID *uuid in removedUUIDs)
+	{
+		NSString *nodeID = operations[uuid].nodeID;
+		if (nodeID) {
+			[nodeIDs addObject:nodeID];
+		}
+	}
+	
+	return nodeIDs;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Lookup
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (BOOL)containsOperationsWithNodeID:(NSString *)nodeID
+{
+	if (nodeID == nil) return NO;
+	
+	return (nodeIDIndex[nodeID] != nil);
+}
+
+- (NSSet<NSString *> *)allNodeIDs
+{
+	return [NSSet setWithArray:nodeIDIndex.allKeys];
+}
+
+- (NSArray<ZDCCloudOperation *> *)operationsForUUIDs:(NSOrderedSet<NSUUID*> *)uuids
+{
+	if (uuids.count == 0) {
+		return @[];
+	}
+	
+	// The per-key sets are ordered by insertion into the key's set.
+	// But a modified operation whose key changed (rare) gets appended to the new key's set,
+	// so sort by the global insertion order to be safe. These sets are tiny.
+	
+	NSMutableArray<ZDCCloudOperation*> *results = [NSMutableArray arrayWithCapacity:uuids.count];
+	
+	if (uuids.count == 1)
+	{
+		[results addObject:operations[uuids.firstObject]];
+	}
+	else
+	{
+		NSArray<NSUUID*> *sorted = [uuids.array sortedArrayUsingComparator:^NSComparisonResult(NSUUID *a, NSUUID *b) {
+			
+			NSUInteger idxA = [self->order indexOfObject:a];
+			NSUInteger idxB = [self->order indexOfObject:b];
+			
+			if (idxA < idxB) return NSOrderedAscending;
+			if (idxA > idxB) return NSOrderedDescending;
+			return NSOrderedSame;
+		}];
+		
+		for (NSUUID *uuid in sorted)
+		{
+			[results addObject:operations[uuid]];
+		}
+	}
+	
+	return results;
+}
+
+- (NSArray<ZDCCloudOperation *> *)operationsWithNodeID:(NSString *)nodeID
+{
+	if (nodeID == nil) return @[];
+	
+	return [self operationsForUUIDs:nodeIDIndex[nodeID]];
+}
+
+- (NSArray<ZDCCloudOperation *> *)copyOperationsWithRecipientBucket:(NSString *)bucket
+{
+	if (bucket == nil) return @[];
+	
+	return [self operationsForUUIDs:recipientIndex[bucket]];
+}
+
+@end
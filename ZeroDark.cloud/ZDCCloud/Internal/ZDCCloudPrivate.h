@@ -20,6 +20,7 @@
 #import "ZDCCloudTransaction.h"
 
 #import "ZDCCloudOperation.h"
+#import "ZDCCloudOperationIndex.h"
 #import "ZDCCloudOperationPrivate.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -41,6 +42,35 @@
 - (instancetype)initWithLocalUserID:(NSString *)localUserID
                              treeID:(NSString *)treeID;
 
+/**
+ * The extension keeps an in-memory index of the committed operations (see ZDCCloudOperationIndex),
+ * which allows per-node queries without enumerating every operation in every pipeline.
+ *
+ * The index is populated lazily, from the pipelines, the first time it's queried.
+ * After that, it's updated by ZDCCloudTransaction as read-write transactions commit.
+ */
+- (NSArray<ZDCCloudOperation *> *)committedOperationsWithNodeID:(NSString *)nodeID;
+- (NSArray<ZDCCloudOperation *> *)committedCopyOperationsWithRecipientBucket:(NSString *)bucket;
+
+/**
+ * Invoked after a read-write transaction commits, with the operations it added/modified & completed/skipped.
+ */
+- (void)commitOperationIndexChanges:(ZDCCloudOperationIndex *)changes
+                       removedUUIDs:(NSSet<NSUUID *> *)removedUUIDs;
+
+/**
+ * Allows the ZDCSyncManager to track which nodes have pending operations,
+ * without enumerating the pipelines every time they change.
+ *
+ * `startTrackingCommittedNodeIDs` returns the nodeIDs that currently have committed operations,
+ * and (re)starts recording changes from that point forward.
+ *
+ * `dequeueCommittedNodeIDChanges` returns the recorded changes since the last call,
+ * in the form: { nodeID : @(hasOperations) }. It returns nil if nothing changed.
+ */
+- (NSSet<NSString *> *)startTrackingCommittedNodeIDs;
+- (NSDictionary<NSString *, NSNumber *> *)dequeueCommittedNodeIDChanges;
+
 @end
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -51,6 +81,9 @@
 @public
 	
 	NSMutableArray *operations_block;
+	
+	ZDCCloudOperationIndex *operationIndex_changes;  // ops added/modified within current read-write transaction
+	NSMutableSet<NSUUID *> *operationIndex_removed;  // ops completed/skipped within current read-write transaction
 }
 
 @end
@@ -61,6 +94,12 @@
 
 @interface ZDCCloudTransaction ()
 
+/**
+ * Returns YES if there's a queued put operation for the node (as visible within this transaction).
+ * Uses the operation index, so it doesn't enumerate the pipelines.
+ */
+- (BOOL)hasPendingPutOperationForNodeID:(NSString *)nodeID;
+
 /**
  * Checks the queue to see if there's a queued delete operation for this cloudID.
  */
@@ -54,6 +54,18 @@ NS_ASSUME_NONNULL_BEGIN
 @property (atomic, copy, readwrite, nullable) NSString *continuation_rcrd;
 @property (atomic, copy, readwrite, nullable) NSString *continuation_data;
 
+/**
+ * Monotonic timestamp (ZDCMetricsNow) from when the PushManager first started the operation.
+ * Used to record the end-to-end latency of the operation (see ZDCMetricsManager).
+ */
+@property (atomic, assign, readwrite) uint64_t metrics_startTime;
+
+/**
+ * The (cleartext) header of the cloud file being uploaded (an NSValue wrapping a ZDCCloudFileHeader).
+ * Used to populate the header cache (and node.cloudDataInfo) once the upload completes.
+ */
+@property (atomic, strong, readwrite, nullable) NSValue *cloudFileHeader;
+
 // Why is the infinite-loop-protection stuff separated ?
 //
 // Because a common infinite loop is:
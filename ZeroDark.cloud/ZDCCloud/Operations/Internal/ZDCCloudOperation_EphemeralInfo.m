@@ -45,6 +45,9 @@
 @synthesize continuation_rcrd;
 @synthesize continuation_data;
 
+@synthesize metrics_startTime;
+@synthesize cloudFileHeader;
+
 @dynamic s3_successiveFailCount;
 @dynamic s3_successiveFail_statusCode;
 
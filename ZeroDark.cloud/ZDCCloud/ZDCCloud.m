@@ -11,7 +11,14 @@
 #import "ZDCCloudPrivate.h"
 
 
-@implementation ZDCCloud
+@implementation ZDCCloud {
+	
+	dispatch_queue_t operationIndexQueue;
+	ZDCCloudOperationIndex *operationIndex; // must be accessed from within operationIndexQueue
+	BOOL operationIndexIsPopulated;         // must be accessed from within operationIndexQueue
+	
+	NSMutableDictionary<NSString*, NSNumber*> *nodeIDChanges; // nil until tracking is started
+}
 
 @synthesize localUserID = localUserID;
 @synthesize treeID = treeID;
@@ -31,10 +38,133 @@
 	{
 		localUserID = [inLocalUserID copy];
 		treeID = [inTreeID copy];
+		
+		operationIndexQueue = dispatch_queue_create("ZDCCloud.operationIndex", DISPATCH_QUEUE_SERIAL);
+		operationIndex = [[ZDCCloudOperationIndex alloc] init];
 	}
 	return self;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Operation Index
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The index is populated lazily (from the pipelines), the first time it's needed.
+ * Must be invoked from within operationIndexQueue.
+ */
+- (void)populateOperationIndexIfNeeded
+{
+	if (operationIndexIsPopulated) return;
+	
+	for (YapDatabaseCloudCorePipeline *pipeline in [self registeredPipelines])
+	{
+		[pipeline enumerateOperationsUsingBlock:
+		  ^(YapDatabaseCloudCoreOperation *operation, NSUInteger graphIdx, BOOL *stop)
+		{
+			if ([operation isKindOfClass:[ZDCCloudOperation class]])
+			{
+				[self->operationIndex addOperation:(ZDCCloudOperation *)operation];
+			}
+		}];
+	}
+	
+	operationIndexIsPopulated = YES;
+}
+
+/**
+ * Method declared in ZDCCloudPrivate.h
+ */
+- (NSArray<ZDCCloudOperation *> *)committedOperationsWithNodeID:(NSString *)nodeID
+{
+	__block NSArray<ZDCCloudOperation *> *results = nil;
+	dispatch_sync(operationIndexQueue, ^{ @autoreleasepool {
+		
+		[self populateOperationIndexIfNeeded];
+		results = [self->operationIndex operationsWithNodeID:nodeID];
+	}});
+	
+	return results;
+}
+
+/**
+ * Method declared in ZDCCloudPrivate.h
+ */
+- (NSArray<ZDCCloudOperation *> *)committedCopyOperationsWithRecipientBucket:(NSString *)bucket
+{
+	__block NSArray<ZDCCloudOperation *> *results = nil;
+	dispatch_sync(operationIndexQueue, ^{ @autoreleasepool {
+		
+		[self populateOperationIndexIfNeeded];
+		results = [self->operationIndex copyOperationsWithRecipientBucket:bucket];
+	}});
+	
+	return results;
+}
+
+/**
+ * Method declared in ZDCCloudPrivate.h
+ */
+- (void)commitOperationIndexChanges:(ZDCCloudOperationIndex *)changes removedUUIDs:(NSSet<NSUUID *> *)removedUUIDs
+{
+	dispatch_sync(operationIndexQueue, ^{ @autoreleasepool {
+		
+		// If the index hasn't been populated yet, there's nothing to update.
+		// It will include these changes when it's populated from the pipelines.
+		
+		if (self->operationIndexIsPopulated)
+		{
+			NSSet<NSString*> *affectedNodeIDs = nil;
+			if (self->nodeIDChanges) {
+				affectedNodeIDs = [self->operationIndex nodeIDsAffectedByChanges:changes removingUUIDs:removedUUIDs];
+			}
+			
+			[self->operationIndex addOperationsFromIndex:changes removingUUIDs:removedUUIDs];
+			
+			for (NSString *nodeID in affectedNodeIDs)
+			{
+				BOOL hasOperations = [self->operationIndex containsOperationsWithNodeID:nodeID];
+				self->nodeIDChanges[nodeID] = @(hasOperations);
+			}
+		}
+	}});
+}
+
+/**
+ * Method declared in ZDCCloudPrivate.h
+ */
+- (NSSet<NSString *> *)startTrackingCommittedNodeIDs
+{
+	__block NSSet<NSString *> *nodeIDs = nil;
+	dispatch_sync(operationIndexQueue, ^{ @autoreleasepool {
+		
+		[self populateOperationIndexIfNeeded];
+		
+		nodeIDs = [self->operationIndex allNodeIDs];
+		self->nodeIDChanges = [[NSMutableDictionary alloc] init];
+	}});
+	
+	return nodeIDs;
+}
+
+/**
+ * Method declared in ZDCCloudPrivate.h
+ */
+- (NSDictionary<NSString *, NSNumber *> *)dequeueCommittedNodeIDChanges
+{
+	__block NSDictionary<NSString *, NSNumber *> *changes = nil;
+	dispatch_sync(operationIndexQueue, ^{ @autoreleasepool {
+		
+		if (self->nodeIDChanges.count > 0)
+		{
+			changes = [self->nodeIDChanges copy];
+			[self->nodeIDChanges removeAllObjects];
+		}
+	}});
+	
+	return changes;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark YapDatabaseExtension Protocol
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
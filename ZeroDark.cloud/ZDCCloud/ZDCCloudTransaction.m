@@ -12,9 +12,10 @@
 
 #import "ZDCConstantsPrivate.h"
 #import "ZDCCloudPathManager.h"
+#import "ZDCCryptoTools.h"
 #import "ZDCDatabaseManager.h"
 #import "ZDCLogging.h"
-#import "ZDCNodeManager.h"
+#import "ZDCNodeManagerPrivate.h"
 #import "ZDCNodePrivate.h"
 
 #import "NSData+S4.h"
@@ -872,6 +873,55 @@
 	NSMutableSet<NSString*> *cloudIDs = [NSMutableSet set];
 	NSMutableArray<NSString*> *childNodeIDs = [NSMutableArray array];
 	
+	// The cloudNames of siblings are derived together (one dirSalt fetch per parent),
+	// rather than one-at-a-time for each child in the (potentially large) subtree.
+	//
+	// parentID => { nodeID => cloudName }
+	NSMutableDictionary<NSString*, NSDictionary<NSString*, NSString*>*> *cloudNamesByParentID =
+	  [NSMutableDictionary dictionary];
+	
+	// parentID => dirPrefix
+	NSMutableDictionary<NSString*, NSString*> *dirPrefixByParentID = [NSMutableDictionary dictionary];
+	
+	ZDCCloudLocator* (^CloudLocatorForChild)(ZDCNode*) = ^ZDCCloudLocator* (ZDCNode *childNode){
+		
+		if (childNode.anchor || childNode.parentID == nil)
+		{
+			// Anchored nodes may live in a different bucket/tree.
+			return [cloudPathManager cloudLocatorForNode:childNode transaction:databaseTransaction];
+		}
+		
+		NSDictionary<NSString*, NSString*> *siblingCloudNames = cloudNamesByParentID[childNode.parentID];
+		if (siblingCloudNames == nil)
+		{
+			ZDCNode *parent = [databaseTransaction objectForKey:childNode.parentID inCollection:kZDCCollection_Nodes];
+			if (parent.dirSalt) {
+				siblingCloudNames = [cloudPathManager cloudNamesForChildrenOfNode:parent transaction:databaseTransaction];
+			}
+			
+			cloudNamesByParentID[childNode.parentID] = siblingCloudNames ?: @{};
+			if (parent.dirPrefix) {
+				dirPrefixByParentID[childNode.parentID] = parent.dirPrefix;
+			}
+		}
+		
+		NSString *cloudName = siblingCloudNames[childNode.uuid];
+		NSString *dirPrefix = dirPrefixByParentID[childNode.parentID];
+		
+		if (cloudName.length == 0 || dirPrefix == nil) {
+			return [cloudPathManager cloudLocatorForNode:childNode transaction:databaseTransaction];
+		}
+		
+		ZDCCloudPath *cloudPath =
+		  [[ZDCCloudPath alloc] initWithTreeID: root_cloudLocator.cloudPath.treeID
+		                             dirPrefix: dirPrefix
+		                              fileName: cloudName];
+		
+		return [[ZDCCloudLocator alloc] initWithRegion: root_cloudLocator.region
+		                                        bucket: root_cloudLocator.bucket
+		                                     cloudPath: cloudPath];
+	};
+	
 	[nodeManager recursiveEnumerateNodesWithParentID: rootNode.uuid
 	                                     transaction: databaseTransaction
 	                                      usingBlock:
@@ -883,9 +933,7 @@
 		
 		if (!isPointer)
 		{
-			ZDCCloudLocator *cloudLocator =
-			  [cloudPathManager cloudLocatorForNode: childNode
-			                            transaction: databaseTransaction];
+			ZDCCloudLocator *cloudLocator = CloudLocatorForChild(childNode);
 		
 			if (cloudLocator)
 			{
@@ -1928,7 +1976,7 @@
 		[nodeIDs addObject:descendentNodeID];
 	}];
 	
-	NSMutableArray<ZDCCloudOperation*> *operations = [NSMutableArray array];
+	NSMutableArray<ZDCNode*> *modifiedNodes = [NSMutableArray arrayWithCapacity:nodeIDs.count];
 	
 	for (NSString *nodeID in nodeIDs)
 	{
@@ -1954,21 +2002,87 @@
 			//   node.shareList.add(shareItem, forUserID: userID)
 			// }
 		}
-		else
+		else if (node)
 		{
 			node = [node copy];
 			[node.shareList addShareItem:shareItem forUserID:userID];
 			
-			ZDCCloudOperation *op = [self modifyNode:node error:nil];
-			if (op) {
-				[operations addObject:op];
-			}
+			[modifiedNodes addObject:node];
+		}
+	}
+	
+	// Every one of these nodes needs the user's shareItem.key (the wrapped node.encryptionKey).
+	// If we leave it empty, the PushManager will discover the missing key while preparing each operation,
+	// and fix it one node at a time (with one read-write transaction per node).
+	//
+	// For large subtrees it's much faster to wrap all the keys here, in a single batch.
+	
+	[self wrapKeysForShareItemWithUserID:userID inNodes:modifiedNodes];
+	
+	NSMutableArray<ZDCCloudOperation*> *operations = [NSMutableArray arrayWithCapacity:modifiedNodes.count];
+	
+	for (ZDCNode *node in modifiedNodes)
+	{
+		ZDCCloudOperation *op = [self modifyNode:node error:nil];
+		if (op) {
+			[operations addObject:op];
 		}
 	}
 	
 	return operations;
 }
 
+/**
+ * Sets the shareItem.key for the given user in each of the given nodes (if possible).
+ * Nodes for which this isn't possible are left untouched, and will be handled by the PushManager as usual.
+ */
+- (void)wrapKeysForShareItemWithUserID:(NSString *)userID inNodes:(NSArray<ZDCNode*> *)nodes
+{
+	if (nodes.count == 0) return;
+	
+	ZDCUser *user = [databaseTransaction objectForKey:userID inCollection:kZDCCollection_Users];
+	if (user == nil || user.accountBlocked || user.accountDeleted) {
+		return;
+	}
+	
+	ZDCPublicKey *pubKey = [databaseTransaction objectForKey:user.publicKeyID inCollection:kZDCCollection_PublicKeys];
+	if (pubKey == nil) {
+		return;
+	}
+	
+	NSMutableArray<ZDCShareItem*> *shareItems = [NSMutableArray arrayWithCapacity:nodes.count];
+	NSMutableArray<NSData*> *symKeys = [NSMutableArray arrayWithCapacity:nodes.count];
+	
+	for (ZDCNode *node in nodes)
+	{
+		ZDCShareItem *shareItem = [node.shareList shareItemForUserID:userID];
+		
+		if (shareItem.key.length > 0) continue;
+		if (!shareItem.canAddKey || ![shareItem hasPermission:ZDCSharePermission_Read]) continue;
+		if (node.encryptionKey == nil) continue;
+		
+		[shareItems addObject:shareItem];
+		[symKeys addObject:node.encryptionKey];
+	}
+	
+	NSError *error = nil;
+	NSArray<NSData*> *wrappedKeys =
+	  [ZDCCryptoTools wrapSymmetricKeys: symKeys
+	                     usingPublicKey: pubKey
+	                              error: &error];
+	
+	if (error)
+	{
+		ZDCLogWarn(@"Error wrapping keys for user(%@): %@", userID, error);
+		return;
+	}
+	
+	[shareItems enumerateObjectsUsingBlock:^(ZDCShareItem *shareItem, NSUInteger idx, BOOL *stop) {
+		
+		shareItem.key = wrappedKeys[idx];
+	}];
+}
+
 /**
  * See header file for description.
  * Or view the api's online (for both Swift & Objective-C):
@@ -2549,25 +2663,14 @@
 {
 	if (nodeID == nil) return NO;
 	
-	__block BOOL result = NO;
-	
-	[self _enumerateOperationsUsingBlock:^(YapDatabaseCloudCorePipeline *pipeline,
-	                                       YapDatabaseCloudCoreOperation *operation, NSUInteger graphIdx, BOOL *stop)
+	for (ZDCCloudOperation *op in [self indexedOperationsWithNodeID:nodeID])
 	{
-		if ([operation isKindOfClass:[ZDCCloudOperation class]])
-		{
-			__unsafe_unretained ZDCCloudOperation *op = (ZDCCloudOperation *)operation;
-			if ([op.nodeID isEqualToString:nodeID])
-			{
-				if (op.isPutNodeDataOperation) {
-					result = YES;
-					*stop = YES;
-				}
-			}
+		if (op.isPutNodeDataOperation) {
+			return YES;
 		}
-	}];
+	}
 	
-	return result;
+	return NO;
 }
 
 /**
@@ -2577,21 +2680,13 @@
 {
 	NSMutableArray<NSDictionary*> *changesets = [NSMutableArray array];
 	
-	[self _enumerateOperationsUsingBlock:^(YapDatabaseCloudCorePipeline *pipeline,
-														YapDatabaseCloudCoreOperation *operation, NSUInteger graphIdx, BOOL *stop)
+	for (ZDCCloudOperation *op in [self indexedOperationsWithNodeID:nodeID])
 	{
-		if ([operation isKindOfClass:[ZDCCloudOperation class]])
-		{
-			__unsafe_unretained ZDCCloudOperation *op = (ZDCCloudOperation *)operation;
-			if ([op.nodeID isEqualToString:nodeID])
-			{
-				NSDictionary *changeset = op.changeset_permissions;
-				if (changeset) {
-					[changesets addObject:changeset];
-				}
-			}
+		NSDictionary *changeset = op.changeset_permissions;
+		if (changeset) {
+			[changesets addObject:changeset];
 		}
-	}];
+	}
 	
 	return changesets;
 }
@@ -2614,19 +2709,16 @@
 	
 	NSMutableArray<ZDCCloudOperation*> *pendingOps = [NSMutableArray array];
 	
-	[self enumerateOperationsUsingBlock:^(YapDatabaseCloudCorePipeline *pipeline,
-	                                      YapDatabaseCloudCoreOperation *operation, NSUInteger graphIdx, BOOL *stop)
+	for (NSString *childNodeID in childNodeIDs)
 	{
-		if ([operation isKindOfClass:[ZDCCloudOperation class]])
+		for (ZDCCloudOperation *op in [self indexedOperationsWithNodeID:childNodeID])
 		{
-			__unsafe_unretained ZDCCloudOperation *op = (ZDCCloudOperation *)operation;
-			
-			if (op.type == ZDCCloudOperationType_Put && op.nodeID && [childNodeIDs containsObject:op.nodeID])
+			if (op.type == ZDCCloudOperationType_Put)
 			{
 				[pendingOps addObject:op];
 			}
 		}
-	}];
+	}
 	
 	return pendingOps;
 }
@@ -2645,25 +2737,19 @@
 	
 	NSMutableArray<ZDCCloudOperation*> *pendingOps = [NSMutableArray array];
 	
-	[self enumerateOperationsUsingBlock:^(YapDatabaseCloudCorePipeline *pipeline,
-	                                      YapDatabaseCloudCoreOperation *operation, NSUInteger graphIdx, BOOL *stop)
+	if (bucket == nil) {
+		return pendingOps;
+	}
+	
+	for (ZDCCloudOperation *op in [self indexedCopyOperationsWithRecipientBucket:bucket])
 	{
-		if ([operation isKindOfClass:[ZDCCloudOperation class]])
+		if (op.dstCloudLocator.region == region &&
+		   [op.dstCloudLocator.cloudPath.treeID isEqual:treeID] &&
+		   [op.dstCloudLocator.cloudPath.dirPrefix isEqual:dirPrefix])
 		{
-			__unsafe_unretained ZDCCloudOperation *op = (ZDCCloudOperation *)operation;
-			
-			if (op.type == ZDCCloudOperationType_CopyLeaf)
-			{
-				if (op.dstCloudLocator.region == region &&
-				   [op.dstCloudLocator.bucket isEqual:bucket] &&
-				   [op.dstCloudLocator.cloudPath.treeID isEqual:treeID] &&
-				   [op.dstCloudLocator.cloudPath.dirPrefix isEqual:dirPrefix])
-				{
-					[pendingOps addObject:op];
-				}
-			}
+			[pendingOps addObject:op];
 		}
-	}];
+	}
 	
 	return pendingOps;
 }
@@ -2681,21 +2767,13 @@
 {
 	NSMutableArray<NSDictionary*> *changesets = [NSMutableArray array];
 	
-	[self _enumerateOperationsUsingBlock:^(YapDatabaseCloudCorePipeline *pipeline,
-														YapDatabaseCloudCoreOperation *operation, NSUInteger graphIdx, BOOL *stop)
+	for (ZDCCloudOperation *op in [self indexedOperationsWithNodeID:nodeID])
 	{
-		if ([operation isKindOfClass:[ZDCCloudOperation class]])
-		{
-			__unsafe_unretained ZDCCloudOperation *op = (ZDCCloudOperation *)operation;
-			if ([op.nodeID isEqualToString:nodeID])
-			{
-				NSDictionary *changeset = op.changeset_obj;
-				if (changeset) {
-					[changesets addObject:changeset];
-				}
-			}
+		NSDictionary *changeset = op.changeset_obj;
+		if (changeset) {
+			[changesets addObject:changeset];
 		}
-	}];
+	}
 	
 	return changesets;
 }
@@ -3127,6 +3205,177 @@
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Operation Index
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The ZDCCloud extension keeps an index of the committed operations (by nodeID & recipient).
+// And the connection keeps track of the operations that have been added/modified/removed
+// within the current read-write transaction (which get merged into the extension's index on commit).
+//
+// So a lookup is the committed operations for the key, with this transaction's changes applied on top.
+
+/**
+ * Returns the pending operations for the given nodeID, as visible within this transaction.
+ */
+- (NSArray<ZDCCloudOperation*> *)indexedOperationsWithNodeID:(NSString *)nodeID
+{
+	if (nodeID == nil) return @[];
+	
+	ZDCCloud *ext = (ZDCCloud *)parentConnection->parent;
+	ZDCCloudConnection *connection = (ZDCCloudConnection *)parentConnection;
+	
+	NSArray<ZDCCloudOperation*> *committedOps = [ext committedOperationsWithNodeID:nodeID];
+	NSArray<ZDCCloudOperation*> *changedOps = [connection->operationIndex_changes operationsWithNodeID:nodeID];
+	
+	return [self applyOperationIndexChanges:changedOps toCommittedOperations:committedOps];
+}
+
+/**
+ * Returns the pending CopyLeaf operations for the given recipient bucket, as visible within this transaction.
+ */
+- (NSArray<ZDCCloudOperation*> *)indexedCopyOperationsWithRecipientBucket:(NSString *)bucket
+{
+	ZDCCloud *ext = (ZDCCloud *)parentConnection->parent;
+	ZDCCloudConnection *connection = (ZDCCloudConnection *)parentConnection;
+	
+	NSArray<ZDCCloudOperation*> *committedOps = [ext committedCopyOperationsWithRecipientBucket:bucket];
+	NSArray<ZDCCloudOperation*> *changedOps =
+	  [connection->operationIndex_changes copyOperationsWithRecipientBucket:bucket];
+	
+	return [self applyOperationIndexChanges:changedOps toCommittedOperations:committedOps];
+}
+
+- (NSArray<ZDCCloudOperation*> *)applyOperationIndexChanges:(NSArray<ZDCCloudOperation*> *)changedOps
+                                      toCommittedOperations:(NSArray<ZDCCloudOperation*> *)committedOps
+{
+	ZDCCloudConnection *connection = (ZDCCloudConnection *)parentConnection;
+	
+	ZDCCloudOperationIndex *changes = connection->operationIndex_changes;
+	NSSet<NSUUID*> *removed = connection->operationIndex_removed;
+	
+	if (changes.count == 0 && removed.count == 0)
+	{
+		// Common case: read-only transaction, or no operation changes in this transaction
+		return committedOps;
+	}
+	
+	NSMutableArray<ZDCCloudOperation*> *results =
+	  [NSMutableArray arrayWithCapacity:(committedOps.count + changedOps.count)];
+	
+	NSMutableSet<NSUUID*> *changedUUIDs = [NSMutableSet setWithCapacity:changedOps.count];
+	for (ZDCCloudOperation *op in changedOps)
+	{
+		[changedUUIDs addObject:op.uuid];
+	}
+	
+	for (ZDCCloudOperation *op in committedOps)
+	{
+		NSUUID *uuid = op.uuid;
+		
+		if ([removed containsObject:uuid]) {
+			continue;
+		}
+		
+		if ([changes containsOperationWithUUID:uuid])
+		{
+			// Modified within this transaction.
+			// Use the modified version (in the original position), if it still matches the key.
+			
+			if ([changedUUIDs containsObject:uuid])
+			{
+				[results addObject:[changes operationWithUUID:uuid]];
+				[changedUUIDs removeObject:uuid];
+			}
+			continue;
+		}
+		
+		[results addObject:op];
+	}
+	
+	for (ZDCCloudOperation *op in changedOps)
+	{
+		if ([changedUUIDs containsObject:op.uuid])
+		{
+			// Added within this transaction
+			[results addObject:op];
+		}
+	}
+	
+	return results;
+}
+
+/**
+ * See ZDCCloudPrivate.h for description.
+ */
+- (BOOL)hasPendingPutOperationForNodeID:(NSString *)nodeID
+{
+	for (ZDCCloudOperation *op in [self indexedOperationsWithNodeID:nodeID])
+	{
+		if (op.type == ZDCCloudOperationType_Put) {
+			return YES;
+		}
+	}
+	
+	return NO;
+}
+
+/**
+ * The ZDCNodeStats of every ancestor include the number of descendants with a queued put operation.
+ * So when a node gains its first (or loses its last) queued put operation, the ancestors are updated.
+ */
+- (void)updateNodeStatsForNodeID:(NSString *)nodeID hadPendingPut:(BOOL)hadPendingPut
+{
+	if (nodeID == nil) return;
+	
+	BOOL hasPendingPut = [self hasPendingPutOperationForNodeID:nodeID];
+	if (hasPendingPut != hadPendingPut)
+	{
+		[[ZDCNodeManager sharedInstance] applyPendingUploadDelta: (hasPendingPut ? 1 : -1)
+		                                               forNodeID: nodeID
+		                                             transaction: (YapDatabaseReadWriteTransaction *)databaseTransaction];
+	}
+}
+
+- (void)operationIndexDidAddOperation:(YapDatabaseCloudCoreOperation *)operation
+{
+	if (![operation isKindOfClass:[ZDCCloudOperation class]]) {
+		return;
+	}
+	
+	NSString *nodeID = [(ZDCCloudOperation *)operation nodeID];
+	BOOL hadPendingPut = [self hasPendingPutOperationForNodeID:nodeID];
+	
+	ZDCCloudConnection *connection = (ZDCCloudConnection *)parentConnection;
+	
+	if (connection->operationIndex_changes == nil) {
+		connection->operationIndex_changes = [[ZDCCloudOperationIndex alloc] init];
+	}
+	[connection->operationIndex_changes addOperation:(ZDCCloudOperation *)operation];
+	
+	[self updateNodeStatsForNodeID:nodeID hadPendingPut:hadPendingPut];
+}
+
+- (void)operationIndexDidRemoveOperation:(YapDatabaseCloudCoreOperation *)operation
+{
+	if (![operation isKindOfClass:[ZDCCloudOperation class]]) {
+		return;
+	}
+	
+	NSString *nodeID = [(ZDCCloudOperation *)operation nodeID];
+	BOOL hadPendingPut = [self hasPendingPutOperationForNodeID:nodeID];
+	
+	ZDCCloudConnection *connection = (ZDCCloudConnection *)parentConnection;
+	
+	if (connection->operationIndex_removed == nil) {
+		connection->operationIndex_removed = [[NSMutableSet alloc] init];
+	}
+	[connection->operationIndex_removed addObject:operation.uuid];
+	[connection->operationIndex_changes removeOperationWithUUID:operation.uuid];
+	
+	[self updateNodeStatsForNodeID:nodeID hadPendingPut:hadPendingPut];
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Subclass Hooks
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -3265,6 +3514,8 @@
 			*stop = YES;
 		}
 	}];
+	
+	[self operationIndexDidAddOperation:newOp];
 }
 
 /**
@@ -3321,6 +3572,8 @@
 			*stop = YES;
 		}
 	}];
+	
+	[self operationIndexDidAddOperation:newOp];
 }
 
 /**
@@ -3434,6 +3687,8 @@
 			*stop = YES;
 		}
 	}];
+	
+	[self operationIndexDidAddOperation:newOp];
 }
 
 /**
@@ -3833,6 +4088,7 @@
 {
 	if ([operation isKindOfClass:[ZDCCloudOperation class]])
 	{
+		[self operationIndexDidRemoveOperation:operation];
 		[self maybeDeleteDetachedNodes:(ZDCCloudOperation *)operation];
 	}
 }
@@ -3841,6 +4097,7 @@
 {
 	if ([operation isKindOfClass:[ZDCCloudOperation class]])
 	{
+		[self operationIndexDidRemoveOperation:operation];
 		[self maybeDeleteDetachedNodes:(ZDCCloudOperation *)operation];
 	}
 }
@@ -3849,6 +4106,43 @@
 #pragma mark Transaction Hooks
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * YapDatabaseExtensionTransaction Hook, invoked after a read-write transaction has been committed.
+ *
+ * Merges the operations that were added/modified/removed within this transaction into the extension's index.
+**/
+- (void)didCommitTransaction
+{
+	ZDCCloudConnection *connection = (ZDCCloudConnection *)parentConnection;
+	
+	ZDCCloudOperationIndex *changes = connection->operationIndex_changes;
+	NSSet<NSUUID*> *removed = connection->operationIndex_removed;
+	
+	connection->operationIndex_changes = nil;
+	connection->operationIndex_removed = nil;
+	
+	[super didCommitTransaction];
+	
+	if (changes || removed)
+	{
+		ZDCCloud *ext = (ZDCCloud *)parentConnection->parent;
+		[ext commitOperationIndexChanges:changes removedUUIDs:removed];
+	}
+}
+
+/**
+ * YapDatabaseExtensionTransaction Hook, invoked after a read-write transaction has been rolled back.
+**/
+- (void)didRollbackTransaction
+{
+	ZDCCloudConnection *connection = (ZDCCloudConnection *)parentConnection;
+	
+	connection->operationIndex_changes = nil;
+	connection->operationIndex_removed = nil;
+	
+	[super didRollbackTransaction];
+}
+
 /**
  * YapDatabaseReadWriteTransaction Hook, invoked post-op.
  *
@@ -102,6 +102,9 @@ NS_ASSUME_NONNULL_BEGIN
 /** The functionality of ZeroDarkCloud is split into multiple managers, separated by task. */
 @property (nonatomic, readonly) ZDCDirectoryManager * directoryManager;
 
+/** The functionality of ZeroDarkCloud is split into multiple managers, separated by task. */
+@property (nonatomic, readonly) ZDCMetricsManager * metricsManager;
+
 /** The functionality of ZeroDarkCloud is split into multiple managers, separated by task. */
 @property (nonatomic, readonly) ZDCNodeManager * nodeManager;
 
@@ -20,6 +20,7 @@
 #import "ZDCLocalUserPrivate.h"
 #import "ZDCLocalUserManagerPrivate.h"
 #import "ZDCLogging.h"
+#import "ZDCMetricsManagerPrivate.h"
 #import "ZDCProgressManagerPrivate.h"
 #import "ZDCPullManagerPrivate.h"
 #import "ZDCPushInfo.h"
@@ -64,11 +65,13 @@ typedef void (^ZDCLogHandler)(ZDCLogMessage *);
 @property (nonatomic, readwrite) Auth0APIManager       * auth0APIManager;
 @property (nonatomic, readwrite) ZDCDatabaseKeyManager * databaseKeyManager;
 @property (nonatomic, readwrite) ZDCDirectoryManager   * directoryManager;
+@property (nonatomic, readwrite) ZDCMetricsManager     * metricsManager;
 @property (nonatomic, readwrite) ZDCProgressManager    * progressManager;
 
 @property (nonatomic, readwrite, nullable) Auth0ProviderManager	 * auth0ProviderManager;
 @property (nonatomic, readwrite, nullable) AWSCredentialsManager   * awsCredentialsManager;
 @property (nonatomic, readwrite, nullable) ZDCBlockchainManager    * blockchainManager;
+@property (nonatomic, readwrite, nullable) ZDCCloudHeaderCache     * cloudHeaderCache;
 @property (nonatomic, readwrite, nullable) ZDCCryptoTools          * cryptoTools;
 @property (nonatomic, readwrite, nullable) ZDCDatabaseManager      * databaseManager;
 @property (nonatomic, readwrite, nullable) ZDCDiskManager          * diskManager;
@@ -110,10 +113,12 @@ typedef void (^ZDCLogHandler)(ZDCLogMessage *);
 @dynamic cloudPathManager;
 @synthesize databaseKeyManager;
 @synthesize directoryManager;
+@synthesize metricsManager;
 @dynamic nodeManager;
 @synthesize progressManager;
 
 @synthesize awsCredentialsManager;
+@synthesize cloudHeaderCache;
 @synthesize cryptoTools;
 @synthesize uiTools;
 @synthesize databaseManager;
@@ -364,6 +369,7 @@ static YAPUnfairLock registrationLock = YAP_UNFAIR_LOCK_INIT;
 		
 		self.databaseKeyManager = [[ZDCDatabaseKeyManager alloc] initWithOwner:self];
 		self.directoryManager = [[ZDCDirectoryManager alloc] initWithOwner:self];
+		self.metricsManager = [[ZDCMetricsManager alloc] initWithOwner:self];
 		self.progressManager = [[ZDCProgressManager alloc] initWithOwner:self];
 	}
 	return self;
@@ -436,6 +442,7 @@ static YAPUnfairLock registrationLock = YAP_UNFAIR_LOCK_INIT;
 		
 		self.cryptoTools = [[ZDCCryptoTools alloc] initWithOwner:self];
 		self.networkTools = [[ZDCNetworkTools alloc] initWithOwner:self];
+		self.cloudHeaderCache = [[ZDCCloudHeaderCache alloc] initWithOwner:self];
 
 		// several others depend on internalPreferences
 		self.internalPreferences = [[ZDCInternalPreferences alloc] initWithOwner:self];
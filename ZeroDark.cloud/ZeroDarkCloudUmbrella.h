@@ -35,6 +35,7 @@
 #import "ZDCDownloadManager.h"
 #import "ZDCImageManager.h"
 #import "ZDCLocalUserManager.h"
+#import "ZDCMetricsManager.h"
 #import "ZDCNodeManager.h"
 #import "ZDCProgressManager.h"
 #import "ZDCPullManager.h"
@@ -50,6 +51,7 @@
 #import "ZDCSymmetricKey.h"
 #import "ZDCTrunkNode.h"
 #import "ZDCNode.h"
+#import "ZDCNodeStats.h"
 #import "ZDCShareList.h"
 #import "ZDCShareItem.h"
 #import "ZDCUser.h"